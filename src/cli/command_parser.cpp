@@ -19,5 +19,21 @@ std::vector<std::string> CommandParser::SplitCommaSeparated(std::string s) {
   return args;
 }
 
+protocol::raft::ConsistencyLevel CommandParser::ParseConsistency(std::string level) {
+  if (level == "linearizable") {
+    return protocol::raft::ConsistencyLevel::LINEARIZABLE;
+  } else if (level == "lease") {
+    return protocol::raft::ConsistencyLevel::LEASE;
+  } else if (level == "bounded") {
+    return protocol::raft::ConsistencyLevel::BOUNDED_STALENESS;
+  } else if (level == "any") {
+    return protocol::raft::ConsistencyLevel::ANY;
+  }
+
+  std::cerr << "Invalid consistency level " << level << ", expected one of linearizable, lease, bounded, any\n";
+  Help();
+  exit(1);
+}
+
 }
 
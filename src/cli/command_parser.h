@@ -1,10 +1,13 @@
 #ifndef COMMAND_PARSER_H
 #define COMMAND_PARSER_H
 
+#include <iostream>
 #include <sstream>
 #include <string>
 #include <vector>
 
+#include "raft.pb.h"
+
 namespace cli {
 
 class CommandParser {
@@ -18,6 +21,8 @@ public:
 
 protected:
   static std::vector<std::string> SplitCommaSeparated(std::string s); 
+
+  protocol::raft::ConsistencyLevel ParseConsistency(std::string level);
 };
 
 }
@@ -8,13 +8,23 @@ Create::Create() {
 void Create::Parse(int argc, char* argv[]) {
   static struct option long_options[] = {
     {"leader", no_argument, NULL, 'l'},
+    {"election-timeout", required_argument, NULL, 'e'},
+    {"min-election-timeout", required_argument, NULL, 'm'},
+    {"heartbeat-interval", required_argument, NULL, 'b'},
+    {"lease-timeout", required_argument, NULL, 's'},
+    {"adaptive-timeouts", no_argument, NULL, 'a'},
+    {"groups", required_argument, NULL, 'g'},
     {"help", no_argument, NULL, 'h'},
+    {0, 0, 0, 0},
   };
 
   std::string address;
   bool initialize_as_leader = false;
+  raft::RaftOptions options;
+  bool lease_timeout_set = false;
+  int group_count = 1;
   while (true) {
-    int c = getopt_long(argc, argv, "c:lh", long_options, NULL);
+    int c = getopt_long(argc, argv, "c:le:m:b:s:ag:h", long_options, NULL);
 
     if (c == -1) {
       break;
@@ -24,6 +34,25 @@ void Create::Parse(int argc, char* argv[]) {
       case 'l':
         initialize_as_leader = true;
         break;
+      case 'e':
+        options.election_timeout = std::stoi(optarg);
+        break;
+      case 'm':
+        options.min_election_timeout = std::stoi(optarg);
+        break;
+      case 'b':
+        options.heartbeat_interval = std::stoi(optarg);
+        break;
+      case 's':
+        options.lease_timeout = std::stoi(optarg);
+        lease_timeout_set = true;
+        break;
+      case 'a':
+        options.adaptive = true;
+        break;
+      case 'g':
+        group_count = std::stoi(optarg);
+        break;
       case 'h':
         Help();
         exit(0);
@@ -42,18 +71,38 @@ void Create::Parse(int argc, char* argv[]) {
   }
   address = argv[optind];
 
-  InitializeNode(address, initialize_as_leader);
+  // The lease must expire before the shortest election timeout the node may adopt
+  if (!lease_timeout_set) {
+    options.lease_timeout = options.MinElectionTimeout() * LEASE_TIMEOUT_RATIO;
+  }
+  std::string error;
+  if (!options.Validate(error)) {
+    std::cerr << error << "\n";
+    exit(1);
+  }
+  if (group_count < 1) {
+    std::cerr << "Expected at least 1 raft group\n";
+    exit(1);
+  }
+
+  InitializeNode(address, initialize_as_leader, options, group_count);
 }
 
 void Create::Help() {
 }
 
-void Create::InitializeNode(std::string address, bool leader) {
+void Create::InitializeNode(
+    std::string address,
+    bool leader,
+    const raft::RaftOptions& options,
+    int group_count) {
   std::cout << "Initializing...\n";
-  raft::GlobalCtxManager ctx(address);
-  ctx.ConsensusInstance()->StateMachineInit();
-  if (leader) {
-    ctx.ConsensusInstance()->InitializeConfiguration();
+  raft::GlobalCtxManager ctx(address, options, group_count);
+  for (int group_id = 0; group_id < group_count; group_id++) {
+    ctx.ConsensusInstance(group_id)->StateMachineInit();
+    if (leader) {
+      ctx.ConsensusInstance(group_id)->InitializeConfiguration();
+    }
   }
 
   std::thread client_worker = std::thread(&raft::RaftClientImpl::AsyncCompleteRPC, ctx.ClientInstance());
@@ -8,10 +8,13 @@
 #include "command_parser.h"
 #include "global_ctx_manager.h"
 #include "raft_client.h"
+#include "raft_options.h"
 #include "raft_server.h"
 
 namespace cli {
 
+const double LEASE_TIMEOUT_RATIO = 0.9;
+
 class Create : public CommandParser {
 public:
   Create();
@@ -21,7 +24,11 @@ public:
   void Help() override;
 
 private:
-  void InitializeNode(std::string address, bool leader);
+  void InitializeNode(
+      std::string address,
+      bool leader,
+      const raft::RaftOptions& options,
+      int group_count);
 };
 
 }
@@ -4,7 +4,10 @@
 
 #include "create.h"
 #include "query.h"
+#include "ranges.h"
 #include "reconfigure.h"
+#include "scan.h"
+#include "transfer.h"
 #include "write.h"
 
 namespace cli {
@@ -32,6 +35,15 @@ public:
     } else if (command == "write") {
       auto parser = Write();
       parser.Parse(argc, argv);
+    } else if (command == "transfer") {
+      auto parser = Transfer();
+      parser.Parse(argc, argv);
+    } else if (command == "scan") {
+      auto parser = Scan();
+      parser.Parse(argc, argv);
+    } else if (command == "ranges") {
+      auto parser = Ranges();
+      parser.Parse(argc, argv);
     } else if (command == "help") {
       CommandList();
     } else {
@@ -8,13 +8,23 @@ Query::Query() {
 void Query::Parse(int argc, char* argv[]) {
   static struct option long_options[] = {
     {"cluster", required_argument, NULL, 'c'},
+    {"group", required_argument, NULL, 'g'},
+    {"min-index", required_argument, NULL, 'm'},
+    {"consistency", required_argument, NULL, 'l'},
+    {"max-staleness", required_argument, NULL, 's'},
+    {"snapshot-index", required_argument, NULL, 'i'},
     {"help", no_argument, NULL, 'h'},
   };
 
   std::vector<std::string> cluster;
   std::string command;
+  int min_index = 0;
+  auto consistency = protocol::raft::ConsistencyLevel::LINEARIZABLE;
+  int max_staleness_ms = 0;
+  int snapshot_index = 0;
+  int group_id = 0;
   while (true) {
-    int c = getopt_long(argc, argv, "c:h", long_options, NULL);
+    int c = getopt_long(argc, argv, "c:g:m:l:s:i:h", long_options, NULL);
 
     if (c == -1) {
       break;
@@ -24,6 +34,21 @@ void Query::Parse(int argc, char* argv[]) {
       case 'c':
         cluster = SplitCommaSeparated(optarg);
         break;
+      case 'g':
+        group_id = std::stoi(optarg);
+        break;
+      case 'm':
+        min_index = std::stoi(optarg);
+        break;
+      case 'l':
+        consistency = ParseConsistency(optarg);
+        break;
+      case 's':
+        max_staleness_ms = std::stoi(optarg);
+        break;
+      case 'i':
+        snapshot_index = std::stoi(optarg);
+        break;
       case 'h':
         Help();
         exit(0);
@@ -42,21 +67,29 @@ void Query::Parse(int argc, char* argv[]) {
   }
   command = argv[optind];
 
-  Execute(cluster, command);
+  Execute(cluster, command, min_index, consistency, max_staleness_ms, snapshot_index, group_id);
 }
 
 void Query::Help() {
 }
 
-void Query::Execute(std::vector<std::string>& addresses, std::string command) {
+void Query::Execute(
+    std::vector<std::string>& addresses,
+    std::string command,
+    int min_index,
+    protocol::raft::ConsistencyLevel consistency,
+    int max_staleness_ms,
+    int snapshot_index,
+    int group_id) {
   std::cout << "Attempting to create read-only query...\n";
-  raft::LeaderProxy proxy(addresses);
+  raft::LeaderProxy proxy(addresses, group_id);
   protocol::raft::ClientQuery_Response reply;
-  auto status = proxy.ClientQuery(command, reply);
+  auto status = proxy.ClientQuery(command, min_index, consistency, max_staleness_ms, snapshot_index, reply);
 
   std::cout << "Query successful? " << (status.ok() ? "Yes" : "No") << "\n";
   if (status.ok()) {
     std::cout << "Query response: " << reply.response() << "\n";
+    std::cout << "Applied index: " << reply.appliedindex() << "\n";
   } else {
     std::cout << "Query error: " << status.error_message() << "\n";
   }
@@ -20,7 +20,14 @@ public:
   void Help() override;
 
 private:
-  void Execute(std::vector<std::string>& addresses, std::string command);
+  void Execute(
+      std::vector<std::string>& addresses,
+      std::string command,
+      int min_index,
+      protocol::raft::ConsistencyLevel consistency,
+      int max_staleness_ms,
+      int snapshot_index,
+      int group_id);
 };
 
 }
@@ -0,0 +1,85 @@
+#include "ranges.h"
+
+namespace cli {
+
+Ranges::Ranges() {
+}
+
+void Ranges::Parse(int argc, char* argv[]) {
+  static struct option long_options[] = {
+    {"cluster", required_argument, NULL, 'c'},
+    {"group", required_argument, NULL, 'g'},
+    {"help", no_argument, NULL, 'h'},
+  };
+
+  std::vector<std::string> cluster;
+  int group_id = 0;
+  while (true) {
+    int c = getopt_long(argc, argv, "c:g:h", long_options, NULL);
+
+    if (c == -1) {
+      break;
+    }
+
+    switch (c) {
+      case 'c':
+        cluster = SplitCommaSeparated(optarg);
+        break;
+      case 'g':
+        group_id = std::stoi(optarg);
+        break;
+      case 'h':
+        Help();
+        exit(0);
+      default:
+        std::cerr << "Invalid option provided " << c << "\n";
+        Help();
+        exit(1);
+    }
+  }
+
+  Execute(cluster, group_id);
+}
+
+void Ranges::Help() {
+}
+
+void Ranges::Execute(std::vector<std::string> addresses, int group_id) {
+  raft::LeaderProxy proxy(addresses, group_id);
+  protocol::raft::GetRanges_Response reply;
+  auto status = proxy.GetRanges(reply);
+
+  if (!status.ok()) {
+    std::cout << "Ranges error: " << status.error_message() << "\n";
+    return;
+  }
+
+  std::cout << "Ranges at applied index " << reply.appliedindex() << ":\n";
+  for (auto& range:reply.ranges()) {
+    std::cout << "[\"" << range.startkey() << "\", "
+      << (range.endkey().empty() ? "+inf" : "\"" + range.endkey() + "\"") << ") "
+      << "keys = " << range.keycount()
+      << " bytes = " << range.sizebytes()
+      << " operations = " << range.operations() << "\n";
+  }
+  std::cout << "Range directory:\n";
+  for (auto& assignment:reply.directory()) {
+    std::cout << "[\"" << assignment.startkey() << "\", "
+      << (assignment.endkey().empty() ? "+inf" : "\"" + assignment.endkey() + "\"") << ") "
+      << "group = " << assignment.groupid() << "\n";
+  }
+  std::cout << "Memory: data = " << reply.memory().databytes()
+    << " bytes arena = " << reply.memory().arenabytes()
+    << " bytes index = " << reply.memory().indexbytes() << " bytes\n";
+
+  auto& cache = reply.cache();
+  int64_t lookups = cache.hits() + cache.misses();
+  std::cout << "Read cache: entries = " << cache.entries()
+    << " hits = " << cache.hits()
+    << " misses = " << cache.misses()
+    << " rejected = " << cache.rejected()
+    << " hit rate = " << (lookups == 0 ? 0.0 : 100.0 * cache.hits() / lookups) << "%\n";
+}
+
+}
+
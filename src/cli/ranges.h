@@ -0,0 +1,29 @@
+#ifndef RANGES_H
+#define RANGES_H
+
+#include <getopt.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "command_parser.h"
+#include "leader_proxy.h"
+
+namespace cli {
+
+class Ranges : public CommandParser {
+public:
+  Ranges();
+
+  void Parse(int argc, char* argv[]) override;
+
+  void Help() override;
+
+private:
+  void Execute(std::vector<std::string> addresses, int group_id);
+};
+
+}
+
+#endif
+
@@ -8,13 +8,17 @@ Reconfigure::Reconfigure() {
 void Reconfigure::Parse(int argc, char* argv[]) {
   static struct option long_options[] = {
     {"cluster", required_argument, NULL, 'c'},
+    {"group", required_argument, NULL, 'g'},
+    {"learner", no_argument, NULL, 'l'},
     {"help", no_argument, NULL, 'h'},
   };
 
   std::vector<std::string> old_addresses;
   std::vector<std::string> new_addresses;
+  bool learner = false;
+  int group_id = 0;
   while (true) {
-    int c = getopt_long(argc, argv, "c:h", long_options, NULL);
+    int c = getopt_long(argc, argv, "c:g:lh", long_options, NULL);
 
     if (c == -1) {
       break;
@@ -24,6 +28,12 @@ void Reconfigure::Parse(int argc, char* argv[]) {
       case 'c':
         old_addresses = SplitCommaSeparated(optarg);
         break;
+      case 'g':
+        group_id = std::stoi(optarg);
+        break;
+      case 'l':
+        learner = true;
+        break;
       case 'h':
         Help();
         exit(0);
@@ -42,7 +52,13 @@ void Reconfigure::Parse(int argc, char* argv[]) {
   }
   new_addresses = SplitCommaSeparated(argv[optind]);
 
-  SetConfiguration(old_addresses, new_addresses);
+  // Learners are added without changing the voting configuration, once caught up they are
+  // promoted by including them in a regular reconfiguration
+  if (learner) {
+    AddLearners(old_addresses, new_addresses, group_id);
+  } else {
+    SetConfiguration(old_addresses, new_addresses, group_id);
+  }
 }
 
 void Reconfigure::Help() {
@@ -50,15 +66,19 @@ void Reconfigure::Help() {
 
 void Reconfigure::SetConfiguration(
     std::vector<std::string> old_addresses,
-    std::vector<std::string> new_addresses) {
+    std::vector<std::string> new_addresses,
+    int group_id) {
   std::cout << "Attempting to modify cluster configuration...\n";
-  raft::LeaderProxy proxy(old_addresses);
+  raft::LeaderProxy proxy(old_addresses, group_id);
   protocol::raft::GetConfiguration_Response get_reply;
   auto status = proxy.GetClusterConfiguration(get_reply);
   std::cout << "Existing configuration: ";
   for (auto server:get_reply.servers()) {
     std::cout << server.address() << " ";
   }
+  for (auto server:get_reply.learners()) {
+    std::cout << server.address() << "(learner) ";
+  }
 
   std::vector<protocol::log::Server> servers;
   std::cout << "\nNew configuration: ";
@@ -72,9 +92,44 @@ void Reconfigure::SetConfiguration(
 
   protocol::raft::SetConfiguration_Response set_reply;
   status = proxy.SetClusterConfiguration(get_reply.id(), servers, set_reply);
-  std::cout << "Membership result OK? " << (status.ok() ? "Yes" : "No") << "\n";
+  if (!status.ok()) {
+    std::cout << "Membership result OK? No\n";
+    std::cout << "Membership change error: " << status.error_message() << "\n";
+    return;
+  }
+
+  // The LEADER completes the change in the background, so its progress is polled
+  protocol::raft::GetConfigurationStatus_Response status_reply;
+  do {
+    std::this_thread::sleep_for(std::chrono::milliseconds(STATUS_POLL_INTERVAL));
+    status = proxy.GetConfigurationStatus(set_reply.operationid(), status_reply);
+  } while (status.ok() &&
+      (status_reply.state() == protocol::raft::MembershipChangeState::LOG_SYNC ||
+       status_reply.state() == protocol::raft::MembershipChangeState::JOINT_CONSENSUS));
+
+  bool committed = status.ok() && status_reply.state() == protocol::raft::MembershipChangeState::COMMITTED;
+  std::cout << "Membership result OK? " << (committed ? "Yes" : "No") << "\n";
   if (!status.ok()) {
     std::cout << "Membership change error: " << status.error_message() << "\n";
+  } else if (!committed) {
+    std::cout << "Membership change error: " << status_reply.error() << "\n";
+  }
+}
+
+void Reconfigure::AddLearners(
+    std::vector<std::string> old_addresses,
+    std::vector<std::string> learner_addresses,
+    int group_id) {
+  std::cout << "Attempting to add learners...\n";
+  raft::LeaderProxy proxy(old_addresses, group_id);
+  for (auto address:learner_addresses) {
+    protocol::raft::AddLearner_Response reply;
+    auto status = proxy.AddLearner(address, reply);
+    std::cout << "Added learner " << address << "? " << (status.ok() ? "Yes" : "No") << "\n";
+    if (!status.ok()) {
+      std::cout << "Membership change error: " << status.error_message() << "\n";
+      return;
+    }
   }
 }
 
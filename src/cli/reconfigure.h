@@ -1,8 +1,10 @@
 #ifndef RECONFIGURE_H
 #define RECONFIGURE_H
 
+#include <chrono>
 #include <getopt.h>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "command_parser.h"
@@ -10,6 +12,8 @@
 
 namespace cli {
 
+const int STATUS_POLL_INTERVAL = 100;
+
 class Reconfigure : public CommandParser {
 public:
   Reconfigure();
@@ -21,7 +25,13 @@ public:
 private:
   void SetConfiguration(
       std::vector<std::string> old_addresses,
-      std::vector<std::string> new_addresses);
+      std::vector<std::string> new_addresses,
+      int group_id);
+
+  void AddLearners(
+      std::vector<std::string> old_addresses,
+      std::vector<std::string> learner_addresses,
+      int group_id);
 };
 
 }
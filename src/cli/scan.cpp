@@ -0,0 +1,115 @@
+#include "scan.h"
+
+namespace cli {
+
+Scan::Scan() {
+}
+
+void Scan::Parse(int argc, char* argv[]) {
+  static struct option long_options[] = {
+    {"cluster", required_argument, NULL, 'c'},
+    {"group", required_argument, NULL, 'g'},
+    {"page-size", required_argument, NULL, 'p'},
+    {"consistency", required_argument, NULL, 'l'},
+    {"max-staleness", required_argument, NULL, 's'},
+    {"help", no_argument, NULL, 'h'},
+  };
+
+  std::vector<std::string> cluster;
+  std::string start_key;
+  std::string end_key;
+  int page_size = 0;
+  auto consistency = protocol::raft::ConsistencyLevel::LINEARIZABLE;
+  int max_staleness_ms = 0;
+  int group_id = 0;
+  while (true) {
+    int c = getopt_long(argc, argv, "c:g:p:l:s:h", long_options, NULL);
+
+    if (c == -1) {
+      break;
+    }
+
+    switch (c) {
+      case 'c':
+        cluster = SplitCommaSeparated(optarg);
+        break;
+      case 'g':
+        group_id = std::stoi(optarg);
+        break;
+      case 'p':
+        page_size = std::stoi(optarg);
+        break;
+      case 'l':
+        consistency = ParseConsistency(optarg);
+        break;
+      case 's':
+        max_staleness_ms = std::stoi(optarg);
+        break;
+      case 'h':
+        Help();
+        exit(0);
+      default:
+        std::cerr << "Invalid option provided " << c << "\n";
+        Help();
+        exit(1);
+    }
+  }
+
+  // Without keys the whole store is scanned
+  optind++;
+  if (optind < argc) {
+    start_key = argv[optind++];
+  }
+  if (optind < argc) {
+    end_key = argv[optind];
+  }
+
+  Execute(cluster, start_key, end_key, page_size, consistency, max_staleness_ms, group_id);
+}
+
+void Scan::Help() {
+}
+
+void Scan::Execute(
+    std::vector<std::string>& addresses,
+    std::string start_key,
+    std::string end_key,
+    int page_size,
+    protocol::raft::ConsistencyLevel consistency,
+    int max_staleness_ms,
+    int group_id) {
+  raft::LeaderProxy proxy(addresses, group_id);
+  int snapshot_index = 0;
+  int entry_count = 0;
+  // Entries are printed page by page, every page after the first is read at the index
+  // of the first so the scan observes a single version of each group's store
+  while (true) {
+    protocol::raft::Scan_Response reply;
+    auto status = proxy.Scan(
+        start_key, end_key, page_size, 0, consistency, max_staleness_ms, snapshot_index, reply);
+    if (!status.ok()) {
+      std::cout << "Scan error: " << status.error_message() << "\n";
+      return;
+    }
+
+    for (auto& entry:reply.entries()) {
+      std::cout << entry.key() << ": " << entry.value() << "\n";
+    }
+    entry_count += reply.entries_size();
+    snapshot_index = reply.appliedindex();
+
+    if (reply.nextkey().empty()) {
+      break;
+    }
+    start_key = reply.nextkey();
+    // Indices of different groups are unrelated
+    if (reply.nextgroupid() != proxy.GroupId()) {
+      proxy.SetGroup(reply.nextgroupid());
+      snapshot_index = 0;
+    }
+  }
+  std::cout << "Scanned " << entry_count << " entries at index " << snapshot_index << "\n";
+}
+
+}
+
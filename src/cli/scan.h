@@ -0,0 +1,36 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <getopt.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "command_parser.h"
+#include "leader_proxy.h"
+
+namespace cli {
+
+class Scan : public CommandParser {
+public:
+  Scan();
+
+  void Parse(int argc, char* argv[]) override;
+
+  void Help() override;
+
+private:
+  void Execute(
+      std::vector<std::string>& addresses,
+      std::string start_key,
+      std::string end_key,
+      int page_size,
+      protocol::raft::ConsistencyLevel consistency,
+      int max_staleness_ms,
+      int group_id);
+};
+
+}
+
+#endif
+
@@ -0,0 +1,69 @@
+#include "transfer.h"
+
+namespace cli {
+
+Transfer::Transfer() {
+}
+
+void Transfer::Parse(int argc, char* argv[]) {
+  static struct option long_options[] = {
+    {"cluster", required_argument, NULL, 'c'},
+    {"group", required_argument, NULL, 'g'},
+    {"help", no_argument, NULL, 'h'},
+  };
+
+  std::vector<std::string> cluster;
+  std::string target;
+  int group_id = 0;
+  while (true) {
+    int c = getopt_long(argc, argv, "c:g:h", long_options, NULL);
+
+    if (c == -1) {
+      break;
+    }
+
+    switch (c) {
+      case 'c':
+        cluster = SplitCommaSeparated(optarg);
+        break;
+      case 'g':
+        group_id = std::stoi(optarg);
+        break;
+      case 'h':
+        Help();
+        exit(0);
+      default:
+        std::cerr << "Invalid option provided " << c << "\n";
+        Help();
+        exit(1);
+    }
+  }
+
+  // Without a target the LEADER picks the most up to date FOLLOWER
+  optind++;
+  if (optind < argc) {
+    target = argv[optind];
+  }
+
+  Execute(cluster, target, group_id);
+}
+
+void Transfer::Help() {
+}
+
+void Transfer::Execute(std::vector<std::string> addresses, std::string target, int group_id) {
+  std::cout << "Attempting to transfer leadership...\n";
+  raft::LeaderProxy proxy(addresses, group_id);
+  protocol::raft::TransferLeadership_Response reply;
+  auto status = proxy.TransferLeadership(target, reply);
+
+  std::cout << "Transfer successful? " << (status.ok() ? "Yes" : "No") << "\n";
+  if (status.ok()) {
+    std::cout << "New leader: " << reply.leaderhint() << "\n";
+  } else {
+    std::cout << "Transfer error: " << status.error_message() << "\n";
+  }
+}
+
+}
+
@@ -0,0 +1,29 @@
+#ifndef TRANSFER_H
+#define TRANSFER_H
+
+#include <getopt.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "command_parser.h"
+#include "leader_proxy.h"
+
+namespace cli {
+
+class Transfer : public CommandParser {
+public:
+  Transfer();
+
+  void Parse(int argc, char* argv[]) override;
+
+  void Help() override;
+
+private:
+  void Execute(std::vector<std::string> addresses, std::string target, int group_id);
+};
+
+}
+
+#endif
+
@@ -8,13 +8,29 @@ Write::Write() {
 void Write::Parse(int argc, char* argv[]) {
   static struct option long_options[] = {
     {"cluster", required_argument, NULL, 'c'},
+    {"group", required_argument, NULL, 'g'},
+    {"delete", no_argument, NULL, 'd'},
+    {"batch", no_argument, NULL, 'b'},
+    {"expect", required_argument, NULL, 'e'},
+    {"if-absent", no_argument, NULL, 'a'},
+    {"increment", required_argument, NULL, 'i'},
+    {"ttl", required_argument, NULL, 't'},
     {"help", no_argument, NULL, 'h'},
   };
 
   std::vector<std::string> cluster;
   std::string command;
+  int group_id = 0;
+  bool delete_key = false;
+  bool batch = false;
+  // Expected value of a conditional write, conditional writes without one require the
+  // key to be absent
+  std::optional<std::string> expected;
+  bool conditional = false;
+  std::optional<int64_t> increment;
+  uint64_t ttl_ms = 0;
   while (true) {
-    int c = getopt_long(argc, argv, "c:h", long_options, NULL);
+    int c = getopt_long(argc, argv, "c:g:dbe:ai:t:h", long_options, NULL);
 
     if (c == -1) {
       break;
@@ -24,6 +40,28 @@ void Write::Parse(int argc, char* argv[]) {
       case 'c':
         cluster = SplitCommaSeparated(optarg);
         break;
+      case 'g':
+        group_id = std::stoi(optarg);
+        break;
+      case 'd':
+        delete_key = true;
+        break;
+      case 'b':
+        batch = true;
+        break;
+      case 'e':
+        expected = optarg;
+        conditional = true;
+        break;
+      case 'a':
+        conditional = true;
+        break;
+      case 'i':
+        increment = std::stoll(optarg);
+        break;
+      case 't':
+        ttl_ms = std::stoull(optarg);
+        break;
       case 'h':
         Help();
         exit(0);
@@ -35,22 +73,43 @@ void Write::Parse(int argc, char* argv[]) {
   }
 
   optind++;
-  if (optind == argc) {
+  // Deletes only take a key, writes take a key and a value. Batches repeat the arguments
+  // for every operation.
+  int operation_args = delete_key || increment.has_value() ? 1 : 2;
+  int remaining_args = argc - optind;
+  if (remaining_args == 0 || remaining_args % operation_args != 0 || (!batch && remaining_args != operation_args)) {
     std::cerr << "Expected additional argument to be provided\n";
     Help();
     exit(1);
   }
-  command = argv[optind];
 
-  Execute(cluster, command);
+  std::vector<std::string> operations;
+  for (int i = optind; i < argc; i += operation_args) {
+    if (increment.has_value()) {
+      operations.push_back(raft::EncodeIncrement(argv[i], increment.value()));
+    } else if (conditional) {
+      std::optional<std::string_view> value;
+      if (!delete_key) {
+        value = argv[i + 1];
+      }
+      operations.push_back(raft::EncodeCompareAndSwap(argv[i], expected, value, ttl_ms));
+    } else if (delete_key) {
+      operations.push_back(raft::EncodeDelete(argv[i]));
+    } else {
+      operations.push_back(raft::EncodePut(argv[i], argv[i + 1], ttl_ms));
+    }
+  }
+  command = batch ? raft::EncodeBatch(operations) : operations.front();
+
+  Execute(cluster, command, group_id);
 }
 
 void Write::Help() {
 }
 
-void Write::Execute(std::vector<std::string> addresses, std::string command) {
+void Write::Execute(std::vector<std::string> addresses, std::string command, int group_id) {
   std::cout << "Attempting to create write query...\n";
-  raft::LeaderProxy proxy(addresses);
+  raft::LeaderProxy proxy(addresses, group_id);
   protocol::raft::RegisterClient_Response session_reply;
   auto status = proxy.RegisterClient(session_reply);
 
@@ -59,13 +118,21 @@ void Write::Execute(std::vector<std::string> addresses, std::string command) {
     return;
   }
 
+  int client_id = session_reply.clientid();
   int sequence_num = 1;
   protocol::raft::ClientRequest_Response reply;
-  status = proxy.ClientRequest(session_reply.clientid(), sequence_num, command, reply);
+  status = proxy.ClientRequest(client_id, sequence_num, command, reply);
 
   std::cout << "Query successful? " << (status.ok() ? "Yes" : "No") << "\n";
   if (status.ok()) {
     std::cout << "Query response: " << reply.response() << "\n";
+    for (int i = 0; i < reply.results_size(); i++) {
+      std::cout << "Operation " << i << ": " << reply.results(i).response() << " " << reply.results(i).value() << "\n";
+    }
+    if (!reply.value().empty()) {
+      std::cout << "Value: " << reply.value() << "\n";
+    }
+    std::cout << "Write index: " << reply.index() << "\n";
   } else {
     std::cout << "Query error: " << status.error_message() << "\n";
   }
@@ -3,9 +3,11 @@
 
 #include <getopt.h>
 #include <iostream>
+#include <optional>
 #include <string>
 #include <vector>
 
+#include "command_codec.h"
 #include "command_parser.h"
 #include "leader_proxy.h"
 
@@ -20,7 +22,10 @@ public:
   void Help() override;
 
 private:
-  void Execute(std::vector<std::string> addresses, std::string command);
+  /**
+   * @param command the command encoded by one of the raft::Encode functions
+   */
+  void Execute(std::vector<std::string> addresses, std::string command, int group_id);
 };
 
 }
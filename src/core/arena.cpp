@@ -0,0 +1,140 @@
+#include "arena.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace core {
+
+const std::array<size_t, SlabArena::SIZE_CLASS_COUNT> SlabArena::SIZE_CLASSES = {
+  16, 24, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096
+};
+
+SlabArena::SlabArena()
+  : m_chunk_pos(nullptr)
+  , m_chunk_remaining(0)
+  , m_reserved_bytes(0)
+  , m_allocated_bytes(0) {
+  m_free_lists.fill(nullptr);
+}
+
+SlabArena::~SlabArena() {
+  for (auto data:m_large_allocations) {
+    delete[] data;
+  }
+}
+
+char* SlabArena::Allocate(const size_t size) {
+  if (size == 0) {
+    return nullptr;
+  }
+
+  size_t size_class = SizeClass(size);
+  if (size_class == SIZE_CLASS_COUNT) {
+    char* data = new char[size];
+    m_large_allocations.insert(data);
+    m_reserved_bytes += size;
+    m_allocated_bytes += size;
+    return data;
+  }
+
+  size_t slot_size = SIZE_CLASSES[size_class];
+  m_allocated_bytes += slot_size;
+  char* slot = m_free_lists[size_class];
+  if (slot) {
+    std::memcpy(&m_free_lists[size_class], slot, sizeof(char*));
+    return slot;
+  }
+
+  // The tail of the previous chunk is abandoned, it is smaller than the slot
+  if (m_chunk_remaining < slot_size) {
+    m_chunks.push_back(std::make_unique<char[]>(ARENA_CHUNK_SIZE));
+    m_chunk_pos = m_chunks.back().get();
+    m_chunk_remaining = ARENA_CHUNK_SIZE;
+    m_reserved_bytes += ARENA_CHUNK_SIZE;
+  }
+  slot = m_chunk_pos;
+  m_chunk_pos += slot_size;
+  m_chunk_remaining -= slot_size;
+  return slot;
+}
+
+void SlabArena::Free(char* data, const size_t size) {
+  if (!data) {
+    return;
+  }
+
+  size_t size_class = SizeClass(size);
+  if (size_class == SIZE_CLASS_COUNT) {
+    m_large_allocations.erase(data);
+    m_reserved_bytes -= size;
+    m_allocated_bytes -= size;
+    delete[] data;
+    return;
+  }
+
+  m_allocated_bytes -= SIZE_CLASSES[size_class];
+  std::memcpy(data, &m_free_lists[size_class], sizeof(char*));
+  m_free_lists[size_class] = data;
+}
+
+size_t SlabArena::ReservedBytes() const {
+  return m_reserved_bytes;
+}
+
+size_t SlabArena::AllocatedBytes() const {
+  return m_allocated_bytes;
+}
+
+size_t SlabArena::SizeClass(const size_t size) {
+  return std::lower_bound(SIZE_CLASSES.begin(), SIZE_CLASSES.end(), size) - SIZE_CLASSES.begin();
+}
+
+PackedString::PackedString()
+  : m_size(0)
+  , m_bytes() {
+}
+
+PackedString PackedString::Create(SlabArena& arena, std::string_view value) {
+  PackedString packed;
+  packed.m_size = value.size();
+  if (value.size() <= ARENA_INLINE_SIZE) {
+    std::memcpy(packed.m_bytes, value.data(), value.size());
+    return packed;
+  }
+
+  char* data = arena.Allocate(value.size());
+  std::memcpy(data, value.data(), value.size());
+  std::memcpy(packed.m_bytes, &data, sizeof(char*));
+  return packed;
+}
+
+void PackedString::Release(SlabArena& arena) {
+  if (Allocated()) {
+    arena.Free(const_cast<char*>(Data()), m_size);
+  }
+  m_size = 0;
+}
+
+std::string_view PackedString::View() const {
+  return std::string_view(Data(), m_size);
+}
+
+size_t PackedString::Size() const {
+  return m_size;
+}
+
+bool PackedString::Allocated() const {
+  return m_size > ARENA_INLINE_SIZE;
+}
+
+const char* PackedString::Data() const {
+  if (!Allocated()) {
+    return m_bytes;
+  }
+  const char* data;
+  std::memcpy(&data, m_bytes, sizeof(char*));
+  return data;
+}
+
+}
+
@@ -0,0 +1,134 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace core {
+
+const size_t ARENA_CHUNK_SIZE = 32 * 1024;
+const size_t ARENA_INLINE_SIZE = 12;
+
+/**
+ * Slab allocator for the bytes of keys and values. Allocations are rounded up to one of
+ * a fixed set of size classes and carved out of ARENA_CHUNK_SIZE chunks, so many small
+ * strings share one heap allocation. Freed slots are kept on a free list per size class
+ * and reused by later allocations of the same class. Chunks are only returned to the heap
+ * when the arena is destroyed. Allocations larger than the largest class go directly to
+ * the heap. Not thread safe.
+ */
+class SlabArena {
+public:
+  SlabArena();
+  ~SlabArena();
+
+  SlabArena(const SlabArena&) = delete;
+  SlabArena& operator=(const SlabArena&) = delete;
+
+  /**
+   * @returns memory for size bytes, nullptr if size is 0
+   */
+  char* Allocate(const size_t size);
+
+  /**
+   * Releases memory returned by Allocate.
+   *
+   * @param size the size passed to Allocate
+   */
+  void Free(char* data, const size_t size);
+
+  /**
+   * Bytes obtained from the heap, including free slots and unused chunk space.
+   */
+  size_t ReservedBytes() const;
+
+  /**
+   * Bytes of the slots and large allocations currently handed out.
+   */
+  size_t AllocatedBytes() const;
+
+private:
+  static constexpr size_t SIZE_CLASS_COUNT = 17;
+  static const std::array<size_t, SIZE_CLASS_COUNT> SIZE_CLASSES;
+
+  /**
+   * Finds the smallest size class holding a size.
+   *
+   * @returns the index of the class, or SIZE_CLASS_COUNT if the size is too large
+   */
+  static size_t SizeClass(const size_t size);
+
+private:
+  std::vector<std::unique_ptr<char[]>> m_chunks;
+
+  /**
+   * Unused space at the end of the latest chunk.
+   */
+  char* m_chunk_pos;
+  size_t m_chunk_remaining;
+
+  /**
+   * Heads of intrusive free lists, each free slot starts with the next free slot.
+   */
+  std::array<char*, SIZE_CLASS_COUNT> m_free_lists;
+
+  /**
+   * Allocations larger than the largest size class.
+   */
+  std::unordered_set<char*> m_large_allocations;
+
+  size_t m_reserved_bytes;
+  size_t m_allocated_bytes;
+};
+
+/**
+ * String of at most 4GB that is stored inline if it fits in ARENA_INLINE_SIZE bytes and
+ * in a SlabArena otherwise, occupying 16 bytes compared to 32 for std::string. Does not
+ * own arena memory, the owner must call Release with the arena that allocated it.
+ */
+class PackedString {
+public:
+  PackedString();
+
+  /**
+   * Copies a string, allocating from an arena unless it can be inlined.
+   */
+  static PackedString Create(SlabArena& arena, std::string_view value);
+
+  /**
+   * Returns arena memory and leaves the string empty.
+   */
+  void Release(SlabArena& arena);
+
+  std::string_view View() const;
+
+  size_t Size() const;
+
+  /**
+   * Determines whether the string is held in arena memory.
+   */
+  bool Allocated() const;
+
+private:
+  const char* Data() const;
+
+private:
+  uint32_t m_size;
+
+  /**
+   * The string itself if inline, otherwise the arena pointer. Copied with memcpy so the
+   * class stays at 16 bytes.
+   */
+  char m_bytes[ARENA_INLINE_SIZE];
+};
+
+}
+
+#endif
+
@@ -0,0 +1,55 @@
+#include "coding.h"
+
+namespace core {
+
+void EncodeVarint(std::string& out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back((char)(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back((char)value);
+}
+
+void EncodeFixed64(std::string& out, uint64_t value) {
+  for (int i = 0; i < 8; i++) {
+    out.push_back((char)(value >> (8 * i)));
+  }
+}
+
+void EncodeString(std::string& out, std::string_view value) {
+  EncodeVarint(out, value.size());
+  out.append(value);
+}
+
+bool DecodeVarint(std::string_view& in, uint64_t& value) {
+  value = 0;
+  for (int shift = 0; shift < 64 && !in.empty(); shift += 7) {
+    uint8_t byte = in.front();
+    in.remove_prefix(1);
+    value |= (uint64_t)(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+uint64_t DecodeFixed64(const char* in) {
+  uint64_t value = 0;
+  for (int i = 0; i < 8; i++) {
+    value |= (uint64_t)(uint8_t)in[i] << (8 * i);
+  }
+  return value;
+}
+
+bool DecodeString(std::string_view& in, std::string_view& out) {
+  uint64_t size;
+  if (!DecodeVarint(in, size) || size > in.size()) {
+    return false;
+  }
+  out = in.substr(0, size);
+  in.remove_prefix(size);
+  return true;
+}
+
+}
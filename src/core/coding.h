@@ -0,0 +1,44 @@
+#ifndef CODING_H
+#define CODING_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace core {
+
+/**
+ * Appends an unsigned integer using 7 bits per byte, least significant group first.
+ */
+void EncodeVarint(std::string& out, uint64_t value);
+
+/**
+ * Appends a little endian 64-bit integer.
+ */
+void EncodeFixed64(std::string& out, uint64_t value);
+
+/**
+ * Appends a varint length followed by the bytes of a string.
+ */
+void EncodeString(std::string& out, std::string_view value);
+
+/**
+ * Decodes a varint from the front of the input, advancing past it.
+ *
+ * @returns whether a complete varint was decoded
+ */
+bool DecodeVarint(std::string_view& in, uint64_t& value);
+
+uint64_t DecodeFixed64(const char* in);
+
+/**
+ * Decodes a length prefixed string from the front of the input without copying it.
+ *
+ * @param out set to a view into the input
+ * @returns whether the input held the complete string
+ */
+bool DecodeString(std::string_view& in, std::string_view& out);
+
+}
+
+#endif
@@ -1,13 +1,590 @@
+#include <glog/logging.h>
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
 #include "inmemory_store.h"
 
-InmemoryStore::InmemoryStore() {
+InmemoryStore::Snapshot::Snapshot(InmemoryStore& store, const int index, const int64_t time)
+  : m_store(store), m_index(index), m_time(time) {
+}
+
+InmemoryStore::Snapshot::~Snapshot() {
+  m_store.CloseSnapshot(m_index);
+}
+
+int InmemoryStore::Snapshot::Index() const {
+  return m_index;
+}
+
+std::string InmemoryStore::Snapshot::Read(std::string_view key) const {
+  return m_store.ReadAt(key, m_index, m_time).data;
+}
+
+std::vector<std::pair<std::string, std::string>> InmemoryStore::Snapshot::Scan(
+    std::string_view start_key,
+    std::string_view end_key,
+    const int limit) const {
+  return m_store.ScanAt(start_key, end_key, limit, m_index, m_time);
+}
+
+InmemoryStore::InmemoryStore(const int retained_entries, std::shared_ptr<core::LsmTree> disk)
+  : m_retained_entries(retained_entries)
+  , m_applied_index(-1)
+  , m_horizon(-1)
+  , m_time(0)
+  , m_disk(disk)
+  , m_flush_index(-1)
+  , m_flush_time(0)
+  , m_flush_scheduled(false) {
+  m_ranges.emplace("", std::make_unique<Range>());
+  if (m_disk) {
+    for (auto& range_key:m_disk->RangeKeys()) {
+      m_ranges.emplace(range_key, std::make_unique<Range>());
+    }
+    m_applied_index.store(m_disk->CheckpointIndex());
+    m_horizon = m_disk->CheckpointIndex();
+    m_time.store(m_disk->CheckpointTime());
+    m_clock.emplace(m_horizon, m_time.load());
+  }
+}
+
+InmemoryStore::~InmemoryStore() {
+  // The background flush refers to the store until it finishes
+  std::unique_lock<std::mutex> lock(m_flush_lock);
+  m_flush_sync.wait(lock, [this] { return !m_flush_scheduled; });
+}
+
+std::string InmemoryStore::Read(std::string_view key, const int index) {
+  return ReadAt(key, index, TimeAt(index)).data;
+}
+
+InmemoryStore::Value InmemoryStore::ReadValue(std::string_view key, const int index) {
+  return ReadAt(key, index, TimeAt(index));
+}
+
+void InmemoryStore::Write(std::string_view key, std::string_view value, const int index, const int64_t expires_at) {
+  if (expires_at != NO_EXPIRY) {
+    std::lock_guard<std::mutex> lock(m_expiry_lock);
+    m_expiry_queue.emplace(expires_at, std::string(key));
+  }
+
+  m_cache.Invalidate(key, index);
+  std::shared_lock<std::shared_mutex> lock(m_ranges_lock);
+  auto& range = FindRange(key);
+  range.operations++;
+  range.size_bytes += range.data.Put(key, value, index, expires_at);
+  if (!range.keys.Contains(key)) {
+    range.keys.Insert(std::string(key));
+  }
+}
+
+bool InmemoryStore::Delete(std::string_view key, const int index) {
+  std::shared_lock<std::shared_mutex> lock(m_ranges_lock);
+  auto& range = FindRange(key);
+  range.operations++;
+  auto version = range.data.Get(key, LATEST_INDEX);
+  bool exists = version.has_value()
+    ? !version->deleted && !version->Expired(m_time.load())
+    : m_disk && m_disk->Get(key, m_time.load()).has_value();
+  if (!exists) {
+    return false;
+  }
+
+  // Keys only found on disk are indexed so scans see the tombstone
+  m_cache.Invalidate(key, index);
+  range.size_bytes += range.data.Delete(key, index);
+  if (!range.keys.Contains(key)) {
+    range.keys.Insert(std::string(key));
+  }
+  return true;
 }
 
-std::string InmemoryStore::Read(const std::string& key) {
-  return m_store.at(key);
+std::vector<std::pair<std::string, std::string>> InmemoryStore::Scan(
+    std::string_view start_key,
+    std::string_view end_key,
+    const int limit,
+    const int index) {
+  return ScanAt(start_key, end_key, limit, index, TimeAt(index));
+}
+
+std::vector<std::pair<std::string, std::string>> InmemoryStore::ScanAt(
+    std::string_view start_key,
+    std::string_view end_key,
+    const int limit,
+    const int index,
+    const int64_t time) {
+  std::shared_lock<std::shared_mutex> lock(m_ranges_lock);
+  // Tombstones are kept until merging with the tables so they hide flushed values
+  std::vector<std::pair<std::string, std::optional<std::string>>> entries;
+  int live_count = 0;
+  for (auto range_it = std::prev(m_ranges.upper_bound(start_key)); range_it != m_ranges.end(); range_it++) {
+    if (live_count >= limit || (!end_key.empty() && range_it->first >= end_key)) {
+      break;
+    }
+
+    auto& range = *range_it->second;
+    range.operations++;
+    for (auto it = range.keys.Seek(start_key); it.Valid() && live_count < limit; it.Next()) {
+      if (!end_key.empty() && it.Key() >= end_key) {
+        break;
+      }
+      // Keys written after the index are indexed but have no visible version. Their
+      // value at the index, if any, was flushed.
+      auto version = range.data.Get(it.Key(), index);
+      if (!version.has_value()) {
+        continue;
+      }
+      if (version->deleted || version->Expired(time)) {
+        entries.emplace_back(it.Key(), std::nullopt);
+      } else {
+        entries.emplace_back(it.Key(), std::move(version->value));
+        live_count++;
+      }
+    }
+  }
+
+  // Versions in memory shadow at most entries.size() flushed keys, so this includes
+  // every flushed key among the first limit results
+  std::vector<std::pair<std::string, std::string>> flushed;
+  if (m_disk) {
+    flushed = m_disk->Scan(start_key, end_key, limit + entries.size(), time);
+  }
+  std::vector<std::pair<std::string, std::string>> merged;
+  auto memory_it = entries.begin();
+  auto disk_it = flushed.begin();
+  while (merged.size() < limit && (memory_it != entries.end() || disk_it != flushed.end())) {
+    if (disk_it == flushed.end() || (memory_it != entries.end() && memory_it->first <= disk_it->first)) {
+      if (disk_it != flushed.end() && disk_it->first == memory_it->first) {
+        disk_it++;
+      }
+      if (memory_it->second.has_value()) {
+        merged.emplace_back(std::move(memory_it->first), std::move(memory_it->second.value()));
+      }
+      memory_it++;
+    } else {
+      merged.push_back(std::move(*disk_it++));
+    }
+  }
+  return merged;
+}
+
+std::vector<std::pair<std::string, InmemoryStore::Value>> InmemoryStore::Export(
+    std::string_view start_key,
+    std::string_view end_key,
+    const int limit) {
+  int64_t time = m_time.load();
+  auto entries = Scan(start_key, end_key, limit);
+
+  // Scans leave out expiry times, which are taken from the visible version
+  std::vector<std::pair<std::string, Value>> values;
+  std::shared_lock<std::shared_mutex> lock(m_ranges_lock);
+  for (auto& [key, value]:entries) {
+    int64_t expires_at = NO_EXPIRY;
+    auto version = FindRange(key).data.Get(key, LATEST_INDEX);
+    if (version.has_value()) {
+      expires_at = version->expires_at;
+    } else if (m_disk) {
+      auto entry = m_disk->Get(key, time);
+      expires_at = entry.has_value() ? entry->expires_at : NO_EXPIRY;
+    }
+    values.emplace_back(std::move(key), Value{std::move(value), expires_at});
+  }
+  return values;
+}
+
+void InmemoryStore::SetAppliedIndex(const int index) {
+  m_applied_index.store(index);
+}
+
+int InmemoryStore::AppliedIndex() const {
+  return m_applied_index.load();
+}
+
+void InmemoryStore::SetTime(const int index, const int64_t time) {
+  std::lock_guard<std::mutex> lock(m_clock_lock);
+  if (m_clock.empty() || m_clock.rbegin()->second != time) {
+    m_clock[index] = time;
+  }
+  m_time.store(time);
+}
+
+int64_t InmemoryStore::Time() const {
+  return m_time.load();
+}
+
+size_t InmemoryStore::ExpireKeys(const int index) {
+  std::vector<expiry_entry> due;
+  {
+    std::lock_guard<std::mutex> lock(m_expiry_lock);
+    while (!m_expiry_queue.empty() && m_expiry_queue.top().first <= m_time.load()) {
+      due.push_back(m_expiry_queue.top());
+      m_expiry_queue.pop();
+    }
+  }
+  if (due.empty()) {
+    return 0;
+  }
+
+  // Expired values are already hidden from readers, the tombstone lets garbage
+  // collection and flushes drop them
+  std::shared_lock<std::shared_mutex> lock(m_ranges_lock);
+  size_t expired_count = 0;
+  for (auto& [expires_at, key]:due) {
+    auto& range = FindRange(key);
+    auto version = range.data.Get(key, LATEST_INDEX);
+    if (version.has_value() && !version->deleted && version->expires_at == expires_at) {
+      m_cache.Invalidate(key, index);
+      range.size_bytes += range.data.Delete(key, index);
+      expired_count++;
+    }
+  }
+  return expired_count;
+}
+
+std::optional<int64_t> InmemoryStore::NextExpiry() const {
+  std::lock_guard<std::mutex> lock(m_expiry_lock);
+  if (m_expiry_queue.empty()) {
+    return std::nullopt;
+  }
+  return m_expiry_queue.top().first;
+}
+
+std::unique_ptr<InmemoryStore::Snapshot> InmemoryStore::OpenSnapshot(const int index) {
+  std::lock_guard<std::mutex> lock(m_snapshots_lock);
+  int snapshot_index = index < 0 ? m_applied_index.load() : index;
+  if (snapshot_index < m_horizon || snapshot_index > m_applied_index.load()) {
+    return nullptr;
+  }
+  m_snapshots.insert(snapshot_index);
+  return std::make_unique<Snapshot>(*this, snapshot_index, TimeAt(snapshot_index));
+}
+
+size_t InmemoryStore::CollectGarbage() {
+  int horizon;
+  bool advanced;
+  bool flush_ready = false;
+  {
+    std::lock_guard<std::mutex> flush_lock(m_flush_lock);
+    std::lock_guard<std::mutex> lock(m_snapshots_lock);
+    horizon = m_applied_index.load() - m_retained_entries;
+    if (!m_snapshots.empty()) {
+      horizon = std::min(horizon, *m_snapshots.begin());
+    }
+    // The requested flush reads the versions visible at its index
+    if (m_flush_index >= 0) {
+      flush_ready = !m_flush_scheduled && horizon >= m_flush_index;
+      horizon = std::min(horizon, m_flush_index);
+      m_flush_scheduled |= flush_ready;
+    }
+    // Snapshots opened from now on cannot observe versions below the horizon
+    advanced = horizon > m_horizon;
+    if (advanced) {
+      m_horizon = horizon;
+    }
+  }
+  if (flush_ready) {
+    m_disk->Enqueue([this]() {
+      std::string checkpoint_state;
+      int checkpoint;
+      int64_t checkpoint_time;
+      {
+        std::lock_guard<std::mutex> lock(m_flush_lock);
+        checkpoint = m_flush_index;
+        checkpoint_time = m_flush_time;
+        checkpoint_state = std::move(m_flush_state);
+      }
+      if (!FlushAt(checkpoint, checkpoint_time, checkpoint_state)) {
+        LOG(ERROR) << "Failed to flush store at index " << checkpoint;
+      }
+
+      std::lock_guard<std::mutex> lock(m_flush_lock);
+      m_flush_index = -1;
+      m_flush_scheduled = false;
+      m_flush_sync.notify_all();
+    });
+  }
+  if (!advanced) {
+    return 0;
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_clock_lock);
+    auto clock_it = m_clock.upper_bound(horizon);
+    if (clock_it != m_clock.begin()) {
+      m_clock.erase(m_clock.begin(), std::prev(clock_it));
+    }
+  }
+
+  size_t freed_bytes = 0;
+  bool keys_dropped = false;
+  {
+    std::shared_lock<std::shared_mutex> lock(m_ranges_lock);
+    for (auto& [start_key, range]:m_ranges) {
+      // Without tables no older value can hide behind a collected tombstone
+      size_t key_count = range->data.Size();
+      size_t range_freed = range->data.Collect(horizon, !m_disk);
+      range->size_bytes -= range_freed;
+      freed_bytes += range_freed;
+      keys_dropped |= range->data.Size() < key_count;
+    }
+  }
+
+  // Collected tombstones are removed from the key index as well, readers are only
+  // blocked once there are keys to prune
+  if (keys_dropped) {
+    std::unique_lock<std::shared_mutex> lock(m_ranges_lock);
+    for (auto& [start_key, range]:m_ranges) {
+      PruneKeys(*range);
+    }
+  }
+  return freed_bytes;
+}
+
+size_t InmemoryStore::MemoryBytes() const {
+  std::shared_lock<std::shared_mutex> lock(m_ranges_lock);
+  size_t memory_bytes = 0;
+  for (auto& [start_key, range]:m_ranges) {
+    memory_bytes += range->size_bytes.load();
+  }
+  return memory_bytes;
+}
+
+InmemoryStore::MemoryStats InmemoryStore::Memory() const {
+  std::shared_lock<std::shared_mutex> lock(m_ranges_lock);
+  MemoryStats stats{0, 0, 0};
+  for (auto& [start_key, range]:m_ranges) {
+    auto usage = range->data.Memory();
+    stats.data_bytes += range->size_bytes.load();
+    stats.arena_bytes += usage.arena_bytes;
+    stats.index_bytes += usage.index_bytes;
+  }
+  return stats;
+}
+
+core::ReadCache::Stats InmemoryStore::CacheStats() const {
+  return m_cache.GetStats();
+}
+
+bool InmemoryStore::Flush(const std::string& checkpoint_state) {
+  if (!m_disk) {
+    return false;
+  }
+
+  int checkpoint;
+  {
+    std::lock_guard<std::mutex> lock(m_snapshots_lock);
+    checkpoint = m_horizon;
+  }
+  if (checkpoint <= m_disk->CheckpointIndex()) {
+    return false;
+  }
+  return FlushAt(checkpoint, TimeAt(checkpoint), checkpoint_state);
+}
+
+bool InmemoryStore::RequestFlush(std::string checkpoint_state) {
+  if (!m_disk) {
+    return false;
+  }
+
+  int index = m_applied_index.load();
+  std::lock_guard<std::mutex> lock(m_flush_lock);
+  if (m_flush_index >= 0 || index <= m_disk->CheckpointIndex()) {
+    return false;
+  }
+  m_flush_index = index;
+  m_flush_time = TimeAt(index);
+  m_flush_state = std::move(checkpoint_state);
+  return true;
+}
+
+bool InmemoryStore::CanRequestFlush() const {
+  if (!m_disk) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(m_flush_lock);
+  return m_flush_index < 0;
+}
+
+std::string InmemoryStore::CheckpointState() const {
+  return m_disk ? m_disk->CheckpointState() : "";
+}
+
+bool InmemoryStore::FlushAt(
+    const int checkpoint,
+    const int64_t checkpoint_time,
+    const std::string& checkpoint_state) {
+  // Versions at or below the horizon no longer change and no reader can tell them apart
+  // from the version visible at the horizon
+  auto table = m_disk->NewTable();
+  std::vector<std::string> range_keys;
+  {
+    std::shared_lock<std::shared_mutex> lock(m_ranges_lock);
+    for (auto& [start_key, range]:m_ranges) {
+      if (!start_key.empty()) {
+        range_keys.push_back(start_key);
+      }
+      for (auto it = range->keys.Begin(); it.Valid(); it.Next()) {
+        auto version = range->data.Get(it.Key(), checkpoint);
+        if (!version.has_value()) {
+          continue;
+        }
+        // Expired values still hide older flushed values
+        if (version->deleted || version->Expired(checkpoint_time)) {
+          table->AddDeletion(it.Key());
+        } else {
+          table->Add(it.Key(), version->value, version->expires_at);
+        }
+      }
+    }
+  }
+  if (!m_disk->Install(std::move(table), checkpoint, checkpoint_time, range_keys, checkpoint_state)) {
+    return false;
+  }
+
+  // Readers find the dropped versions on disk from now on
+  std::unique_lock<std::shared_mutex> lock(m_ranges_lock);
+  for (auto& [start_key, range]:m_ranges) {
+    range->size_bytes -= range->data.DropThrough(checkpoint);
+    PruneKeys(*range);
+  }
+  return true;
+}
+
+bool InmemoryStore::Split(const std::string& split_key) {
+  std::unique_lock<std::shared_mutex> lock(m_ranges_lock);
+  if (m_ranges.find(split_key) != m_ranges.end()) {
+    return false;
+  }
+
+  auto& range = FindRange(split_key);
+  auto new_range = std::make_unique<Range>();
+  size_t moved_bytes = range.data.MoveIf([&split_key](std::string_view key) {
+    return key >= split_key;
+  }, new_range->data);
+  range.size_bytes -= moved_bytes;
+  new_range->size_bytes += moved_bytes;
+  for (auto key_it = range.keys.Seek(split_key); key_it.Valid(); key_it.Next()) {
+    new_range->keys.Insert(key_it.Key());
+  }
+  range.keys.Truncate(split_key);
+  m_ranges.emplace(split_key, std::move(new_range));
+  return true;
+}
+
+bool InmemoryStore::Merge(const std::string& start_key) {
+  std::unique_lock<std::shared_mutex> lock(m_ranges_lock);
+  auto it = m_ranges.find(start_key);
+  if (it == m_ranges.end() || it == m_ranges.begin()) {
+    return false;
+  }
+
+  auto& left = *std::prev(it)->second;
+  auto& right = *it->second;
+  left.data.MergeFrom(right.data);
+  for (auto key_it = right.keys.Begin(); key_it.Valid(); key_it.Next()) {
+    left.keys.Insert(key_it.Key());
+  }
+  left.size_bytes += right.size_bytes.load();
+  left.operations += right.operations.load();
+  m_ranges.erase(it);
+  return true;
+}
+
+std::vector<InmemoryStore::RangeStats> InmemoryStore::Ranges() const {
+  std::shared_lock<std::shared_mutex> lock(m_ranges_lock);
+  std::vector<RangeStats> ranges;
+  for (auto it = m_ranges.begin(); it != m_ranges.end(); it++) {
+    auto next = std::next(it);
+    ranges.push_back({
+        it->first,
+        next == m_ranges.end() ? "" : next->first,
+        (int)it->second->data.Size(),
+        it->second->size_bytes.load(),
+        it->second->operations.load()});
+  }
+  return ranges;
+}
+
+std::optional<std::string> InmemoryStore::MedianKey(const std::string& start_key) const {
+  std::shared_lock<std::shared_mutex> lock(m_ranges_lock);
+  auto it = m_ranges.find(start_key);
+  size_t key_count = it == m_ranges.end() ? 0 : it->second->data.Size();
+  if (key_count < 2) {
+    return std::nullopt;
+  }
+
+  auto key_it = it->second->keys.Begin();
+  for (int i = 0; i < key_count / 2 && key_it.Valid(); i++) {
+    key_it.Next();
+  }
+  // The first key of a range cannot start a new range
+  if (!key_it.Valid() || key_it.Key() == start_key) {
+    return std::nullopt;
+  }
+  return key_it.Key();
+}
+
+InmemoryStore::Range& InmemoryStore::FindRange(std::string_view key) {
+  return *std::prev(m_ranges.upper_bound(key))->second;
+}
+
+void InmemoryStore::PruneKeys(Range& range) {
+  std::vector<std::string> remaining_keys;
+  for (auto it = range.keys.Begin(); it.Valid(); it.Next()) {
+    if (range.data.Contains(it.Key())) {
+      remaining_keys.push_back(it.Key());
+    }
+  }
+  range.keys.Truncate("");
+  for (auto& key:remaining_keys) {
+    range.keys.Insert(key);
+  }
+}
+
+int64_t InmemoryStore::TimeAt(const int index) const {
+  if (index == LATEST_INDEX) {
+    return m_time.load();
+  }
+  std::lock_guard<std::mutex> lock(m_clock_lock);
+  auto it = m_clock.upper_bound(index);
+  return it == m_clock.begin() ? 0 : std::prev(it)->second;
+}
+
+InmemoryStore::Value InmemoryStore::ReadAt(std::string_view key, const int index, const int64_t time) {
+  // Writes at later indices may be in progress while reading at the latest index
+  int read_index = std::min(index, m_applied_index.load());
+
+  std::shared_lock<std::shared_mutex> lock(m_ranges_lock);
+  auto& range = FindRange(key);
+  // Cache hits still count towards the range's load so hot ranges are split
+  range.operations++;
+  auto cached = m_cache.Get(key, index, time);
+  if (cached.has_value()) {
+    return {*cached->value, cached->expires_at};
+  }
+
+  auto version = range.data.Get(key, index);
+  if (version.has_value()) {
+    if (version->deleted || version->Expired(time)) {
+      throw std::out_of_range("Key does not exist");
+    }
+    auto value = std::make_shared<const std::string>(std::move(version->value));
+    m_cache.Insert(key, {value, version->index, version->expires_at}, read_index);
+    return {*value, version->expires_at};
+  }
+
+  // Flushed values are visible at every readable index
+  auto entry = m_disk ? m_disk->Get(key, time) : std::nullopt;
+  if (!entry.has_value()) {
+    throw std::out_of_range("Key does not exist");
+  }
+  auto value = std::make_shared<const std::string>(std::move(entry->value));
+  m_cache.Insert(key, {value, -1, entry->expires_at}, read_index);
+  return {*value, entry->expires_at};
 }
 
-void InmemoryStore::Write(std::string key, std::string value) {
-  m_store[key] = value;
+void InmemoryStore::CloseSnapshot(const int index) {
+  std::lock_guard<std::mutex> lock(m_snapshots_lock);
+  m_snapshots.erase(m_snapshots.find(index));
 }
 
@@ -1,18 +1,444 @@
 #ifndef INMEMORY_STORE_H
 #define INMEMORY_STORE_H
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <set>
+#include <shared_mutex>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <utility>
+#include <vector>
 
+#include "lsm_tree.h"
+#include "read_cache.h"
+#include "sharded_map.h"
+#include "skiplist.h"
+
+const int LATEST_INDEX = std::numeric_limits<int>::max();
+const int MVCC_RETAINED_ENTRIES = 10000;
+const int MVCC_GC_INTERVAL = 1000;
+const size_t LSM_MEMTABLE_BYTES = 64 * 1024 * 1024;
+const int64_t NO_EXPIRY = 0;
+
+/**
+ * Key-value store partitioned into contiguous key ranges. The first range always starts
+ * at the empty key and the last range is unbounded. Ranges are split and merged by
+ * replicated commands so every replica has the same partitioning. Reads and writes of
+ * different keys usually proceed concurrently. A read still waits for a write or garbage
+ * collection pass holding the ShardedMap shard of its key, and for splits and merges.
+ *
+ * Every write is tagged with the log index that applied it and older versions are kept
+ * so reads and scans can run at a fixed index while later entries are applied. Versions
+ * are garbage collected below the oldest open snapshot, but never within the last
+ * retained_entries indices so clients can read at a recent index without holding a
+ * snapshot open between requests.
+ *
+ * With an LsmTree attached the store acts as its memtable. Flushing moves every version
+ * at or below the garbage collection horizon to disk, so reads at any readable index
+ * fall back to the tables for keys without a visible version in memory. A flush can be
+ * requested at the applied index while entries are applied, it then runs on the tree's
+ * background executor once the horizon reaches that index.
+ *
+ * Values may expire at a time taken from the log rather than a local clock. Each applied
+ * index has a time, and reads at an index treat values expiring at or before its time
+ * as deleted, so every replica agrees on which keys exist at every index. Expired values
+ * are reclaimed lazily as the time advances.
+ *
+ * Reads of single keys go through a ReadCache of hot values, which writes invalidate, so
+ * repeated reads of a key skip the versioned map and the tables on disk.
+ */
 class InmemoryStore {
 public:
-  InmemoryStore();
+  struct RangeStats {
+    std::string start_key;
+    /**
+     * First key of the next range, empty for the last range.
+     */
+    std::string end_key;
+    int key_count;
+    size_t size_bytes;
+    /**
+     * Reads and writes served by the range since it was created.
+     */
+    uint64_t operations;
+  };
+
+  struct MemoryStats {
+    /**
+     * Bytes of keys and values in memory, the same as MemoryBytes.
+     */
+    size_t data_bytes;
+    /**
+     * Bytes the ranges' arenas obtained from the heap to hold the keys and values.
+     */
+    size_t arena_bytes;
+    /**
+     * Estimated bytes of the hash tables and version lists indexing them.
+     */
+    size_t index_bytes;
+  };
+
+  struct Value {
+    std::string data;
+    /**
+     * Time in ms at which the value expires, NO_EXPIRY if it does not expire.
+     */
+    int64_t expires_at;
+  };
+
+  /**
+   * Consistent view of the store at a log index. Versions visible to an open snapshot
+   * are not garbage collected.
+   */
+  class Snapshot {
+  public:
+    Snapshot(InmemoryStore& store, const int index, const int64_t time);
+    ~Snapshot();
+
+    Snapshot(const Snapshot&) = delete;
+    Snapshot& operator=(const Snapshot&) = delete;
+
+    int Index() const;
+
+    std::string Read(std::string_view key) const;
+
+    std::vector<std::pair<std::string, std::string>> Scan(
+        std::string_view start_key,
+        std::string_view end_key,
+        const int limit) const;
+
+  private:
+    InmemoryStore& m_store;
+    const int m_index;
+    const int64_t m_time;
+  };
+
+public:
+  /**
+   * @param retained_entries the number of recent log indices that stay readable
+   * @param disk tables holding flushed data, the store is purely in memory if null. The
+   *    store resumes from the tables' checkpoint.
+   */
+  InmemoryStore(
+      const int retained_entries = MVCC_RETAINED_ENTRIES,
+      std::shared_ptr<core::LsmTree> disk = nullptr);
+
+  /**
+   * Waits for a scheduled flush to finish.
+   */
+  ~InmemoryStore();
+
+  /**
+   * Retrieves the value of a key.
+   *
+   * @param key the key to read
+   * @param index the log index to read at, the latest value by default
+   * @throws std::out_of_range if the key does not exist at the index
+   */
+  std::string Read(std::string_view key, const int index = LATEST_INDEX);
+
+  /**
+   * Retrieves the value of a key along with its expiry time.
+   *
+   * @throws std::out_of_range if the key does not exist at the index
+   */
+  Value ReadValue(std::string_view key, const int index = LATEST_INDEX);
+
+  /**
+   * Writes a new version of a key. Only called while applying log entries.
+   *
+   * @param index the log index of the write
+   * @param expires_at time in ms at which the value expires, NO_EXPIRY if it does not
+   */
+  void Write(std::string_view key, std::string_view value, const int index, const int64_t expires_at = NO_EXPIRY);
+
+  /**
+   * Writes a tombstone version of a key. Only called while applying log entries.
+   *
+   * @param index the log index of the delete
+   * @returns whether the key existed, nothing is written otherwise
+   */
+  bool Delete(std::string_view key, const int index);
+
+  /**
+   * Retrieves keys in order along with their values.
+   *
+   * @param start_key the first key to include
+   * @param end_key the key after the last key to include, empty for no upper bound
+   * @param limit the maximum number of entries to return
+   * @param index the log index to read at. Scanning at the latest index may include
+   *    some of the keys written during the scan.
+   * @returns the entries in key order
+   */
+  std::vector<std::pair<std::string, std::string>> Scan(
+      std::string_view start_key,
+      std::string_view end_key,
+      const int limit,
+      const int index = LATEST_INDEX);
+
+  /**
+   * Retrieves keys in order along with their latest values and expiry times to copy
+   * them elsewhere. Unlike reads, the values are not counted towards the load of their
+   * range and are not offered to the read cache.
+   *
+   * @param end_key the key after the last key to include, empty for no upper bound
+   * @returns the entries in key order
+   */
+  std::vector<std::pair<std::string, Value>> Export(
+      std::string_view start_key,
+      std::string_view end_key,
+      const int limit);
+
+  /**
+   * Records that every log entry up to an index has been applied.
+   */
+  void SetAppliedIndex(const int index);
+
+  int AppliedIndex() const;
+
+  /**
+   * Records the time of the log entry being applied. Only called while applying entries,
+   * before the entry's writes.
+   *
+   * @param index the log index of the entry
+   * @param time the time in ms, which must not decrease
+   */
+  void SetTime(const int index, const int64_t time);
+
+  /**
+   * Time in ms of the latest log entry, 0 before any time was recorded.
+   */
+  int64_t Time() const;
+
+  /**
+   * Reclaims values that have expired by the current time by writing tombstones. Only
+   * called while applying entries.
+   *
+   * @param index the log index of the entry being applied
+   * @returns the number of values reclaimed
+   */
+  size_t ExpireKeys(const int index);
+
+  /**
+   * Earliest expiry time of a value in memory, which may have been overwritten since.
+   */
+  std::optional<int64_t> NextExpiry() const;
+
+  /**
+   * Opens a snapshot at a log index.
+   *
+   * @param index the index to read at, or -1 for the applied index
+   * @returns the snapshot, or nullptr if the index has not been applied or its versions
+   *    may have been garbage collected
+   */
+  std::unique_ptr<Snapshot> OpenSnapshot(const int index = -1);
+
+  /**
+   * Removes versions that neither an open snapshot nor a read within the retained
+   * entries can observe. While a flush is requested the horizon stops at its index, and
+   * the flush is scheduled once the horizon reaches it.
+   *
+   * @returns the number of bytes freed
+   */
+  size_t CollectGarbage();
+
+  /**
+   * Number of bytes of keys and versions held in memory.
+   */
+  size_t MemoryBytes() const;
+
+  /**
+   * Estimates the memory used to hold the data in memory. Keys and values are packed
+   * into arenas, so the arena bytes exceed the data bytes by the unused space of partly
+   * filled chunks and freed slots.
+   */
+  MemoryStats Memory() const;
 
-  std::string Read(const std::string& key);
-  void Write(std::string key, std::string value);
+  /**
+   * Hit rate and size of the read cache.
+   */
+  core::ReadCache::Stats CacheStats() const;
+
+  /**
+   * Writes every version visible at the garbage collection horizon to a new table and
+   * removes versions at or below the horizon from memory. The horizon becomes the
+   * checkpoint from which a restarted node resumes. Only called while applying entries.
+   *
+   * @param checkpoint_state state outside the store at the horizon, saved with the table
+   * @returns whether a table was flushed
+   */
+  bool Flush(const std::string& checkpoint_state = "");
+
+  /**
+   * Requests a flush at the applied index. The flush runs in the background after
+   * garbage collection reaches the index, so the caller does not wait for the table to
+   * be written. Only called while applying entries.
+   *
+   * @param checkpoint_state state outside the store at the applied index, saved with
+   *    the table
+   * @returns whether the flush was requested, false without tables, while another flush
+   *    is pending or if nothing was applied since the checkpoint
+   */
+  bool RequestFlush(std::string checkpoint_state);
+
+  /**
+   * Determines whether a flush can be requested, the store has tables and no flush is
+   * pending.
+   */
+  bool CanRequestFlush() const;
+
+  /**
+   * State saved with the checkpoint the store resumed from, or with the latest flush.
+   */
+  std::string CheckpointState() const;
+
+  /**
+   * Splits the range containing a key so that the key starts a new range.
+   *
+   * @param split_key the first key of the new range
+   * @returns whether the range was split, false if the key already starts a range
+   */
+  bool Split(const std::string& split_key);
+
+  /**
+   * Merges a range into the range before it.
+   *
+   * @param start_key the first key of the range to merge
+   * @returns whether the ranges were merged, false if no range other than the first
+   *    starts at the key
+   */
+  bool Merge(const std::string& start_key);
+
+  /**
+   * Retrieve statistics for every range in key order.
+   */
+  std::vector<RangeStats> Ranges() const;
+
+  /**
+   * Finds the key that splits a range into two halves with the same number of keys.
+   *
+   * @param start_key the first key of the range
+   * @returns the median key, or nothing if the range cannot be split
+   */
+  std::optional<std::string> MedianKey(const std::string& start_key) const;
+
+private:
+  struct Range {
+    core::ShardedMap data;
+    /**
+     * Ordered index of the keys in data. Keys are added after their value so a scan
+     * always finds the value of an indexed key.
+     */
+    core::SkipList keys;
+    std::atomic<size_t> size_bytes = 0;
+    std::atomic<uint64_t> operations = 0;
+  };
+
+  /**
+   * Finds the range containing a key. Requires m_ranges_lock.
+   */
+  Range& FindRange(std::string_view key);
+
+  /**
+   * Rebuilds the key index of a range without the keys that were removed from its data.
+   * Requires m_ranges_lock in exclusive mode.
+   */
+  static void PruneKeys(Range& range);
+
+  /**
+   * Time in ms of the log entry at an index that is still readable.
+   */
+  int64_t TimeAt(const int index) const;
+
+  /**
+   * Writes every version visible at the checkpoint to a new table and removes versions
+   * at or below it from memory. Requires the horizon to be at the checkpoint.
+   */
+  bool FlushAt(const int checkpoint, const int64_t checkpoint_time, const std::string& checkpoint_state);
+
+  Value ReadAt(std::string_view key, const int index, const int64_t time);
+
+  std::vector<std::pair<std::string, std::string>> ScanAt(
+      std::string_view start_key,
+      std::string_view end_key,
+      const int limit,
+      const int index,
+      const int64_t time);
+
+  void CloseSnapshot(const int index);
 
 private:
-  std::unordered_map<std::string, std::string> m_store;
+  /**
+   * Ranges keyed by their first key.
+   */
+  std::map<std::string, std::unique_ptr<Range>, std::less<>> m_ranges;
+
+  /**
+   * Held exclusively while ranges are split or merged.
+   */
+  mutable std::shared_mutex m_ranges_lock;
+
+  const int m_retained_entries;
+  std::atomic<int> m_applied_index;
+
+  /**
+   * Guards the open snapshots and the garbage collection horizon.
+   */
+  std::mutex m_snapshots_lock;
+  std::multiset<int> m_snapshots;
+
+  /**
+   * Lowest index that can still be read, versions visible at lower indices may have
+   * been removed.
+   */
+  int m_horizon;
+
+  /**
+   * Time of the latest entry, and the indices at which the time changed since the
+   * horizon.
+   */
+  std::atomic<int64_t> m_time;
+  mutable std::mutex m_clock_lock;
+  std::map<int, int64_t> m_clock;
+
+  /**
+   * Min-heap of expiry times and keys of values written with an expiry. Entries of
+   * values that were overwritten are skipped when they reach the top.
+   */
+  using expiry_entry = std::pair<int64_t, std::string>;
+  mutable std::mutex m_expiry_lock;
+  std::priority_queue<expiry_entry, std::vector<expiry_entry>, std::greater<expiry_entry>> m_expiry_queue;
+
+  std::shared_ptr<core::LsmTree> m_disk;
+
+  /**
+   * Guards the requested flush, which is pending from the request until the table is
+   * installed.
+   */
+  mutable std::mutex m_flush_lock;
+  std::condition_variable m_flush_sync;
+
+  /**
+   * Index of the requested flush, -1 if none is pending.
+   */
+  int m_flush_index;
+  int64_t m_flush_time;
+  std::string m_flush_state;
+
+  /**
+   * Whether the requested flush was handed to the background executor.
+   */
+  bool m_flush_scheduled;
+
+  core::ReadCache m_cache;
 };
 
 #endif
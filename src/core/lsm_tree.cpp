@@ -0,0 +1,370 @@
+#include <glog/logging.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <unordered_set>
+
+#include "lsm_tree.h"
+
+namespace core {
+
+namespace {
+
+const std::string MANIFEST_FILENAME = "MANIFEST";
+const std::string TABLE_EXTENSION = ".sst";
+const std::string STATE_EXTENSION = ".state";
+
+std::string HexEncode(const std::string& s) {
+  static const char* digits = "0123456789abcdef";
+  std::string out;
+  for (unsigned char c:s) {
+    out.push_back(digits[c >> 4]);
+    out.push_back(digits[c & 0xf]);
+  }
+  return out;
+}
+
+bool Expired(const int64_t expires_at, const int64_t time) {
+  return expires_at > 0 && expires_at <= time;
+}
+
+std::string HexDecode(const std::string& s) {
+  std::string out;
+  for (int i = 0; i + 1 < s.size(); i += 2) {
+    out.push_back((char)std::stoi(s.substr(i, 2), nullptr, 16));
+  }
+  return out;
+}
+
+}
+
+LsmTree::LsmTree(const std::string& directory)
+  : m_directory(directory)
+  , m_next_table_id(0)
+  , m_checkpoint_index(-1)
+  , m_checkpoint_time(0)
+  , m_state_index(-1)
+  , m_compaction_pending(false)
+  , m_compaction_executor(std::make_shared<Strand>()) {
+  std::filesystem::create_directories(m_directory);
+  LoadManifest();
+}
+
+LsmTree::~LsmTree() {
+  m_compaction_executor->Shutdown();
+}
+
+int LsmTree::CheckpointIndex() const {
+  std::lock_guard<std::mutex> lock(m_lock);
+  return m_checkpoint_index;
+}
+
+int64_t LsmTree::CheckpointTime() const {
+  std::lock_guard<std::mutex> lock(m_lock);
+  return m_checkpoint_time;
+}
+
+std::vector<std::string> LsmTree::RangeKeys() const {
+  std::lock_guard<std::mutex> lock(m_lock);
+  return m_range_keys;
+}
+
+std::string LsmTree::CheckpointState() const {
+  std::lock_guard<std::mutex> lock(m_lock);
+  return m_checkpoint_state;
+}
+
+int LsmTree::TableCount() const {
+  std::lock_guard<std::mutex> lock(m_lock);
+  return m_tables.size();
+}
+
+std::optional<SSTable::Entry> LsmTree::Get(std::string_view key, const int64_t time) const {
+  auto tables = Tables();
+  for (auto it = tables.rbegin(); it != tables.rend(); it++) {
+    auto entry = (*it)->Get(key);
+    if (entry.has_value()) {
+      // Tombstones and expired values hide values in older tables
+      if (entry->deleted || Expired(entry->expires_at, time)) {
+        return std::nullopt;
+      }
+      return entry;
+    }
+  }
+  return std::nullopt;
+}
+
+std::vector<std::pair<std::string, std::string>> LsmTree::Scan(
+    std::string_view start_key,
+    std::string_view end_key,
+    const int limit,
+    const int64_t time) const {
+  std::vector<std::pair<std::string, std::string>> entries;
+  if (limit <= 0) {
+    return entries;
+  }
+
+  MergeTables(Tables(), start_key, [&](const SSTable::Iterator& it) {
+    if (!end_key.empty() && it.Key() >= end_key) {
+      return false;
+    }
+    if (!it.Deleted() && !Expired(it.ExpiresAt(), time)) {
+      entries.emplace_back(it.Key(), it.Value());
+    }
+    return entries.size() < limit;
+  });
+  return entries;
+}
+
+std::unique_ptr<SSTableWriter> LsmTree::NewTable() {
+  std::lock_guard<std::mutex> lock(m_lock);
+  return std::make_unique<SSTableWriter>(TablePath(m_next_table_id++));
+}
+
+bool LsmTree::Install(
+    std::unique_ptr<SSTableWriter> table,
+    const int checkpoint_index,
+    const int64_t checkpoint_time,
+    const std::vector<std::string>& range_keys,
+    const std::string& checkpoint_state) {
+  std::string path = table->Path();
+  if (!table->Finish()) {
+    LOG(ERROR) << "Failed to write table " << path;
+    std::filesystem::remove(path);
+    return false;
+  }
+  auto sstable = SSTable::Open(path);
+  if (!sstable) {
+    LOG(ERROR) << "Failed to open flushed table " << path;
+    return false;
+  }
+  if (!checkpoint_state.empty() && !WriteState(checkpoint_index, checkpoint_state)) {
+    LOG(ERROR) << "Failed to write checkpoint state " << StatePath(checkpoint_index);
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(m_lock);
+  int previous_state_index = m_state_index;
+  m_tables.push_back(sstable);
+  m_table_ids.push_back(std::stoi(std::filesystem::path(path).stem().string()));
+  m_checkpoint_index = checkpoint_index;
+  m_checkpoint_time = checkpoint_time;
+  m_range_keys = range_keys;
+  m_checkpoint_state = checkpoint_state;
+  m_state_index = checkpoint_state.empty() ? -1 : checkpoint_index;
+  if (!WriteManifest()) {
+    LOG(FATAL) << "Failed to write manifest in " << m_directory;
+  }
+  if (previous_state_index >= 0 && previous_state_index != m_state_index) {
+    std::filesystem::remove(StatePath(previous_state_index));
+  }
+  DLOG(INFO) << "Flushed " << path << " at checkpoint index = " << checkpoint_index;
+
+  if (m_tables.size() >= LSM_COMPACTION_TRIGGER && !m_compaction_pending) {
+    m_compaction_pending = true;
+    m_compaction_executor->Enqueue([this] {
+      Compact();
+    });
+  }
+  return true;
+}
+
+void LsmTree::Compact() {
+  table_list tables;
+  std::unique_ptr<SSTableWriter> writer;
+  int64_t checkpoint_time;
+  {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_compaction_pending = false;
+    if (m_tables.size() < 2) {
+      return;
+    }
+    tables = m_tables;
+    checkpoint_time = m_checkpoint_time;
+    writer = std::make_unique<SSTableWriter>(TablePath(m_next_table_id++));
+  }
+
+  // Flushes only append tables, so the merged tables stay a prefix of the table list.
+  // The prefix includes the oldest table, so tombstones have nothing left to hide.
+  // Every readable index is at or after the checkpoint, so values expired by the
+  // checkpoint time are never visible again.
+  MergeTables(tables, "", [&writer, checkpoint_time](const SSTable::Iterator& it) {
+    if (!it.Deleted() && !Expired(it.ExpiresAt(), checkpoint_time)) {
+      writer->Add(it.Key(), it.Value(), it.ExpiresAt());
+    }
+    return true;
+  });
+
+  std::string path = writer->Path();
+  std::shared_ptr<SSTable> merged;
+  if (writer->Finish()) {
+    merged = SSTable::Open(path);
+  }
+  if (!merged) {
+    LOG(ERROR) << "Failed to write compacted table " << path;
+    std::filesystem::remove(path);
+    return;
+  }
+
+  std::vector<int> obsolete_ids;
+  {
+    std::lock_guard<std::mutex> lock(m_lock);
+    obsolete_ids.assign(m_table_ids.begin(), m_table_ids.begin() + tables.size());
+    m_tables.erase(m_tables.begin(), m_tables.begin() + tables.size());
+    m_table_ids.erase(m_table_ids.begin(), m_table_ids.begin() + tables.size());
+    m_tables.insert(m_tables.begin(), merged);
+    m_table_ids.insert(m_table_ids.begin(), std::stoi(std::filesystem::path(path).stem().string()));
+    if (!WriteManifest()) {
+      LOG(FATAL) << "Failed to write manifest in " << m_directory;
+    }
+  }
+
+  // Readers holding the old tables keep their file descriptors open
+  for (int table_id:obsolete_ids) {
+    std::filesystem::remove(TablePath(table_id));
+  }
+  DLOG(INFO) << "Compacted " << tables.size() << " tables into " << path;
+}
+
+void LsmTree::Enqueue(AsyncExecutor::callback_t task) {
+  m_compaction_executor->Enqueue(std::move(task));
+}
+
+void LsmTree::LoadManifest() {
+  std::ifstream in(m_directory + MANIFEST_FILENAME);
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream fields(line);
+    std::string type;
+    std::string value;
+    fields >> type >> value;
+    if (type == "checkpoint") {
+      m_checkpoint_index = std::stoi(value);
+    } else if (type == "checkpoint_time") {
+      m_checkpoint_time = std::stoll(value);
+    } else if (type == "next_table") {
+      m_next_table_id = std::stoi(value);
+    } else if (type == "table") {
+      int table_id = std::stoi(value);
+      auto table = SSTable::Open(TablePath(table_id));
+      if (!table) {
+        LOG(FATAL) << "Table " << TablePath(table_id) << " listed in the manifest is missing or corrupt";
+      }
+      m_tables.push_back(table);
+      m_table_ids.push_back(table_id);
+    } else if (type == "range") {
+      m_range_keys.push_back(HexDecode(value));
+    } else if (type == "state") {
+      m_state_index = std::stoi(value);
+      std::ifstream state_in(StatePath(m_state_index), std::ios::in | std::ios::binary);
+      if (!state_in) {
+        LOG(FATAL) << "Checkpoint state " << StatePath(m_state_index) << " listed in the manifest is missing";
+      }
+      m_checkpoint_state.assign(std::istreambuf_iterator<char>(state_in), std::istreambuf_iterator<char>());
+    }
+  }
+
+  std::unordered_set<int> live_ids(m_table_ids.begin(), m_table_ids.end());
+  for (const auto& entry:std::filesystem::directory_iterator(m_directory)) {
+    auto path = entry.path();
+    if (path.extension() == TABLE_EXTENSION && live_ids.find(std::stoi(path.stem().string())) == live_ids.end()) {
+      std::filesystem::remove(path);
+    } else if (path.extension() == STATE_EXTENSION && std::stoi(path.stem().string()) != m_state_index) {
+      std::filesystem::remove(path);
+    }
+  }
+}
+
+bool LsmTree::WriteManifest() {
+  std::string tmp_path = m_directory + MANIFEST_FILENAME + ".tmp";
+  {
+    std::ofstream out(tmp_path, std::ios::out | std::ios::trunc);
+    out << "checkpoint " << m_checkpoint_index << "\n";
+    out << "checkpoint_time " << m_checkpoint_time << "\n";
+    out << "next_table " << m_next_table_id << "\n";
+    for (int table_id:m_table_ids) {
+      out << "table " << table_id << "\n";
+    }
+    for (auto& range_key:m_range_keys) {
+      out << "range " << HexEncode(range_key) << "\n";
+    }
+    if (m_state_index >= 0) {
+      out << "state " << m_state_index << "\n";
+    }
+    out.flush();
+    if (!out.good()) {
+      return false;
+    }
+  }
+  if (!SyncPath(tmp_path)) {
+    return false;
+  }
+  std::filesystem::rename(tmp_path, m_directory + MANIFEST_FILENAME);
+  // Persists the rename along with the directory entries of newly written tables
+  return SyncPath(m_directory);
+}
+
+std::string LsmTree::TablePath(const int table_id) const {
+  return m_directory + std::to_string(table_id) + TABLE_EXTENSION;
+}
+
+std::string LsmTree::StatePath(const int checkpoint_index) const {
+  return m_directory + std::to_string(checkpoint_index) + STATE_EXTENSION;
+}
+
+bool LsmTree::WriteState(const int checkpoint_index, const std::string& state) const {
+  std::string path = StatePath(checkpoint_index);
+  {
+    std::ofstream out(path, std::ios::out | std::ios::trunc | std::ios::binary);
+    out.write(state.data(), state.size());
+    out.flush();
+    if (!out.good()) {
+      return false;
+    }
+  }
+  return SyncPath(path);
+}
+
+LsmTree::table_list LsmTree::Tables() const {
+  std::lock_guard<std::mutex> lock(m_lock);
+  return m_tables;
+}
+
+void LsmTree::MergeTables(
+    const table_list& tables,
+    std::string_view start_key,
+    const std::function<bool(const SSTable::Iterator&)>& func) {
+  std::vector<SSTable::Iterator> iterators;
+  for (auto& table:tables) {
+    iterators.emplace_back(*table);
+    iterators.back().Seek(start_key);
+  }
+
+  while (true) {
+    // Later iterators belong to newer tables and win ties
+    int next = -1;
+    for (int i = 0; i < iterators.size(); i++) {
+      if (iterators[i].Valid() && (next < 0 || iterators[i].Key() <= iterators[next].Key())) {
+        next = i;
+      }
+    }
+    if (next < 0) {
+      return;
+    }
+
+    std::string key = iterators[next].Key();
+    if (!func(iterators[next])) {
+      return;
+    }
+    for (auto& it:iterators) {
+      if (it.Valid() && it.Key() == key) {
+        it.Next();
+      }
+    }
+  }
+}
+
+}
+
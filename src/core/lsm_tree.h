@@ -0,0 +1,185 @@
+#ifndef LSM_TREE_H
+#define LSM_TREE_H
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "async_executor.h"
+#include "sstable.h"
+
+namespace core {
+
+const int LSM_COMPACTION_TRIGGER = 4;
+
+/**
+ * On-disk part of the state machine. The in-memory store acts as the memtable and is
+ * flushed into immutable sorted tables without a write-ahead log, since every write is
+ * already durable in the raft log. A manifest records the live tables together with
+ * the log index they were flushed at, so a restarted node only re-applies entries after
+ * that checkpoint. State outside the store that must match the checkpoint, such as
+ * client sessions, is saved in a file next to the tables. Tables are merged in the
+ * background once LSM_COMPACTION_TRIGGER tables accumulate.
+ */
+class LsmTree {
+public:
+  /**
+   * Opens the tables listed in the directory's manifest, removing tables left behind by
+   * an interrupted flush or compaction.
+   */
+  LsmTree(const std::string& directory);
+  ~LsmTree();
+
+  /**
+   * Log index at which the tables were last flushed, -1 if nothing was flushed.
+   */
+  int CheckpointIndex() const;
+
+  /**
+   * Time in ms of the log entry at the checkpoint index, values that expired by then are
+   * not visible at any readable index.
+   */
+  int64_t CheckpointTime() const;
+
+  /**
+   * Start keys of the store's ranges at the last flush.
+   */
+  std::vector<std::string> RangeKeys() const;
+
+  /**
+   * State saved with the last flush, empty if none was given.
+   */
+  std::string CheckpointState() const;
+
+  int TableCount() const;
+
+  /**
+   * Looks up a key in the tables, newest first.
+   *
+   * @param key the key to find
+   * @param time the time in ms to read at, values expiring at or before it are ignored
+   * @returns the entry, or nothing if the key was never flushed or its latest flushed
+   *    version is a deletion or has expired
+   */
+  std::optional<SSTable::Entry> Get(std::string_view key, const int64_t time) const;
+
+  /**
+   * Retrieves entries in key order, using the newest table's value for duplicate keys.
+   *
+   * @param start_key the first key to include
+   * @param end_key the key after the last key to include, empty for no upper bound
+   * @param limit the maximum number of entries to return
+   * @param time the time in ms to read at, expired values are skipped
+   */
+  std::vector<std::pair<std::string, std::string>> Scan(
+      std::string_view start_key,
+      std::string_view end_key,
+      const int limit,
+      const int64_t time) const;
+
+  /**
+   * Creates a writer for a new table. The table is ignored until it is installed.
+   */
+  std::unique_ptr<SSTableWriter> NewTable();
+
+  /**
+   * Atomically adds a finished table and advances the checkpoint by rewriting the manifest.
+   *
+   * @param table a writer returned by NewTable holding every value visible at the
+   *    checkpoint that is not already in an older table
+   * @param checkpoint_index the log index the table was flushed at
+   * @param checkpoint_time the time in ms of the entry at the checkpoint index
+   * @param range_keys the start keys of the store's ranges
+   * @param checkpoint_state opaque state at the checkpoint index, restored with it
+   * @returns whether the table was installed
+   */
+  bool Install(
+      std::unique_ptr<SSTableWriter> table,
+      const int checkpoint_index,
+      const int64_t checkpoint_time,
+      const std::vector<std::string>& range_keys,
+      const std::string& checkpoint_state = "");
+
+  /**
+   * Merges every table into one, dropping tombstones and values that expired by the
+   * checkpoint time. Runs on the compaction executor.
+   */
+  void Compact();
+
+  /**
+   * Runs a task on the background executor shared with compactions.
+   */
+  void Enqueue(AsyncExecutor::callback_t task);
+
+private:
+  using table_list = std::vector<std::shared_ptr<SSTable>>;
+
+  void LoadManifest();
+
+  /**
+   * Writes the manifest to a temporary file and renames it over the previous one,
+   * syncing the file and the directory so the new manifest survives a crash.
+   * Requires m_lock.
+   */
+  bool WriteManifest();
+
+  std::string TablePath(const int table_id) const;
+
+  std::string StatePath(const int checkpoint_index) const;
+
+  /**
+   * Writes the state of a checkpoint to its own file and syncs it. The file only takes
+   * effect once the manifest refers to it.
+   */
+  bool WriteState(const int checkpoint_index, const std::string& state) const;
+
+  table_list Tables() const;
+
+  /**
+   * Merges tables in key order, newest table first for duplicate keys.
+   *
+   * @param func called with an iterator positioned at each entry, including tombstones,
+   *    returns whether to continue
+   */
+  static void MergeTables(
+      const table_list& tables,
+      std::string_view start_key,
+      const std::function<bool(const SSTable::Iterator&)>& func);
+
+private:
+  const std::string m_directory;
+
+  /**
+   * Guards the table list, the checkpoint and the manifest.
+   */
+  mutable std::mutex m_lock;
+
+  /**
+   * Live tables from oldest to newest.
+   */
+  table_list m_tables;
+  std::vector<int> m_table_ids;
+  int m_next_table_id;
+  int m_checkpoint_index;
+  int64_t m_checkpoint_time;
+  std::vector<std::string> m_range_keys;
+  std::string m_checkpoint_state;
+
+  /**
+   * Checkpoint index of the state file listed in the manifest, -1 if there is none.
+   */
+  int m_state_index;
+  bool m_compaction_pending;
+
+  std::shared_ptr<Strand> m_compaction_executor;
+};
+
+}
+
+#endif
+
@@ -0,0 +1,160 @@
+#include "read_cache.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace core {
+
+FrequencySketch::FrequencySketch(const size_t capacity)
+  : m_width(1)
+  , m_additions(0)
+  , m_sample_size(std::max<size_t>(capacity, 1) * 10) {
+  // A power of two width lets slots be found with a mask
+  while (m_width < std::max<size_t>(capacity * 4, 64)) {
+    m_width <<= 1;
+  }
+  m_counters.resize(m_width * FREQUENCY_SKETCH_DEPTH, 0);
+}
+
+void FrequencySketch::Increment(std::string_view key) {
+  size_t hash = std::hash<std::string_view>{}(key);
+  for (int row = 0; row < FREQUENCY_SKETCH_DEPTH; row++) {
+    auto& counter = m_counters[Slot(hash, row)];
+    if (counter < 15) {
+      counter++;
+    }
+  }
+
+  if (++m_additions >= m_sample_size) {
+    for (auto& counter:m_counters) {
+      counter >>= 1;
+    }
+    m_additions /= 2;
+  }
+}
+
+int FrequencySketch::Frequency(std::string_view key) const {
+  size_t hash = std::hash<std::string_view>{}(key);
+  int frequency = 15;
+  for (int row = 0; row < FREQUENCY_SKETCH_DEPTH; row++) {
+    frequency = std::min(frequency, (int)m_counters[Slot(hash, row)]);
+  }
+  return frequency;
+}
+
+size_t FrequencySketch::Slot(const size_t hash, const int row) const {
+  // Each row probes with a different multiple of the upper half of the hash
+  size_t step = (hash >> 32) | 1;
+  return row * m_width + ((hash + row * step) & (m_width - 1));
+}
+
+ReadCache::Shard::Shard(const size_t capacity)
+  : sketch(capacity)
+  , hits(0)
+  , misses(0)
+  , rejected(0) {
+  invalidated.fill(-1);
+}
+
+ReadCache::ReadCache(const size_t capacity)
+  : m_shard_capacity(std::max<size_t>(capacity / READ_CACHE_SHARD_COUNT, 1)) {
+  for (int i = 0; i < READ_CACHE_SHARD_COUNT; i++) {
+    m_shards.push_back(std::make_unique<Shard>(m_shard_capacity));
+  }
+}
+
+std::optional<ReadCache::Entry> ReadCache::Get(std::string_view key, const int index, const int64_t time) {
+  auto& shard = ShardFor(std::hash<std::string_view>{}(key));
+  std::lock_guard<std::mutex> lock(shard.lock);
+  shard.sketch.Increment(key);
+
+  auto it = shard.entries.find(key);
+  if (it == shard.entries.end()) {
+    shard.misses++;
+    return std::nullopt;
+  }
+  auto& entry = it->second->second;
+  bool expired = entry.expires_at > 0 && entry.expires_at <= time;
+  if (entry.index > index || expired) {
+    shard.misses++;
+    return std::nullopt;
+  }
+
+  shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+  shard.hits++;
+  return entry;
+}
+
+void ReadCache::Insert(std::string_view key, Entry entry, const int read_index) {
+  if (entry.value->size() > READ_CACHE_MAX_VALUE_BYTES) {
+    return;
+  }
+
+  size_t hash = std::hash<std::string_view>{}(key);
+  auto& shard = ShardFor(hash);
+  std::lock_guard<std::mutex> lock(shard.lock);
+  // A write the reader did not see may have been invalidated before this insert
+  if (read_index < shard.invalidated[StripeFor(hash)]) {
+    return;
+  }
+
+  auto it = shard.entries.find(key);
+  if (it != shard.entries.end()) {
+    if (entry.index >= it->second->second.index) {
+      it->second->second = std::move(entry);
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    return;
+  }
+
+  if (shard.lru.size() >= m_shard_capacity) {
+    auto& victim = shard.lru.back();
+    if (shard.sketch.Frequency(key) <= shard.sketch.Frequency(victim.first)) {
+      shard.rejected++;
+      return;
+    }
+    shard.entries.erase(victim.first);
+    shard.lru.pop_back();
+  }
+
+  shard.lru.emplace_front(std::string(key), std::move(entry));
+  shard.entries.emplace(shard.lru.front().first, shard.lru.begin());
+}
+
+void ReadCache::Invalidate(std::string_view key, const int index) {
+  size_t hash = std::hash<std::string_view>{}(key);
+  auto& shard = ShardFor(hash);
+  std::lock_guard<std::mutex> lock(shard.lock);
+  auto& invalidated = shard.invalidated[StripeFor(hash)];
+  invalidated = std::max(invalidated, index);
+
+  auto it = shard.entries.find(key);
+  if (it != shard.entries.end()) {
+    auto list_it = it->second;
+    shard.entries.erase(it);
+    shard.lru.erase(list_it);
+  }
+}
+
+ReadCache::Stats ReadCache::GetStats() const {
+  Stats stats{0, 0, 0, 0};
+  for (auto& shard:m_shards) {
+    std::lock_guard<std::mutex> lock(shard->lock);
+    stats.hits += shard->hits;
+    stats.misses += shard->misses;
+    stats.rejected += shard->rejected;
+    stats.entries += shard->lru.size();
+  }
+  return stats;
+}
+
+ReadCache::Shard& ReadCache::ShardFor(const size_t hash) {
+  return *m_shards[hash % READ_CACHE_SHARD_COUNT];
+}
+
+int ReadCache::StripeFor(const size_t hash) {
+  return (hash / READ_CACHE_SHARD_COUNT) % READ_CACHE_INVALIDATION_STRIPES;
+}
+
+}
+
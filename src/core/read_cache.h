@@ -0,0 +1,156 @@
+#ifndef READ_CACHE_H
+#define READ_CACHE_H
+
+#include <array>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace core {
+
+const int READ_CACHE_SHARD_COUNT = 16;
+const int READ_CACHE_INVALIDATION_STRIPES = 64;
+const size_t READ_CACHE_CAPACITY = 8192;
+const size_t READ_CACHE_MAX_VALUE_BYTES = 64 * 1024;
+const int FREQUENCY_SKETCH_DEPTH = 4;
+
+/**
+ * Count-min sketch estimating how often keys were accessed recently. Counters saturate
+ * at 15 and are halved once the number of recorded accesses reaches a sample size, so the
+ * popularity of keys that are no longer read fades. Not thread safe.
+ */
+class FrequencySketch {
+public:
+  /**
+   * @param capacity the number of keys whose frequency should be told apart
+   */
+  FrequencySketch(const size_t capacity);
+
+  void Increment(std::string_view key);
+
+  /**
+   * Estimates the number of recent accesses to a key, never underestimating it.
+   */
+  int Frequency(std::string_view key) const;
+
+private:
+  size_t Slot(const size_t hash, const int row) const;
+
+private:
+  /**
+   * FREQUENCY_SKETCH_DEPTH rows of m_width counters.
+   */
+  std::vector<uint8_t> m_counters;
+  size_t m_width;
+  size_t m_additions;
+  size_t m_sample_size;
+};
+
+/**
+ * Cache of recently read values in front of a store. Values are shared with readers, so
+ * evicting an entry never invalidates a value being returned.
+ *
+ * Every entry records the log index of the version it holds and is only returned to
+ * reads at or above that index. Writers invalidate a key before their index becomes
+ * readable. A reader that raced with a write may still offer the older value afterwards,
+ * so each shard remembers the highest invalidated index of every stripe of keys and
+ * rejects values read below it.
+ *
+ * A new key only replaces the least recently used entry of a full shard if it was read
+ * more often recently, following TinyLFU, so a scan of cold keys does not flush hot keys.
+ */
+class ReadCache {
+public:
+  struct Entry {
+    std::shared_ptr<const std::string> value;
+    /**
+     * Log index of the cached version, -1 if it is visible at every readable index.
+     */
+    int index;
+    /**
+     * Time in ms at which the value expires, 0 if it does not expire.
+     */
+    int64_t expires_at;
+  };
+
+  struct Stats {
+    uint64_t hits;
+    uint64_t misses;
+    /**
+     * Values not cached because the admission policy preferred the entry they would
+     * have evicted.
+     */
+    uint64_t rejected;
+    size_t entries;
+  };
+
+public:
+  ReadCache(const size_t capacity = READ_CACHE_CAPACITY);
+
+  /**
+   * Looks up the value of a key as of a log index and records the access.
+   *
+   * @param index the log index of the read
+   * @param time the time in ms of the read, expired values are not returned
+   * @returns the cached entry, or nothing if the cache cannot serve the read
+   */
+  std::optional<Entry> Get(std::string_view key, const int index, const int64_t time);
+
+  /**
+   * Offers a value read from the store.
+   *
+   * @param entry the value and the index of its version
+   * @param read_index the log index at which the value was read, which must not exceed
+   *    the applied index at the start of the read
+   */
+  void Insert(std::string_view key, Entry entry, const int read_index);
+
+  /**
+   * Removes a key before a write at an index becomes readable.
+   */
+  void Invalidate(std::string_view key, const int index);
+
+  Stats GetStats() const;
+
+private:
+  using lru_list = std::list<std::pair<std::string, Entry>>;
+
+  struct Shard {
+    Shard(const size_t capacity);
+
+    mutable std::mutex lock;
+    /**
+     * Entries ordered from most to least recently used.
+     */
+    lru_list lru;
+    /**
+     * Keys are views into the keys held by lru.
+     */
+    std::unordered_map<std::string_view, lru_list::iterator> entries;
+    FrequencySketch sketch;
+    std::array<int, READ_CACHE_INVALIDATION_STRIPES> invalidated;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t rejected;
+  };
+
+  Shard& ShardFor(const size_t hash);
+
+  static int StripeFor(const size_t hash);
+
+private:
+  const size_t m_shard_capacity;
+  std::vector<std::unique_ptr<Shard>> m_shards;
+};
+
+}
+
+#endif
+
@@ -0,0 +1,213 @@
+#include "sharded_map.h"
+
+namespace core {
+
+ShardedMap::ShardedMap() {
+}
+
+std::optional<ShardedMap::Version> ShardedMap::Get(std::string_view key, const int index) const {
+  auto& shard = ShardFor(key);
+  std::shared_lock<std::shared_mutex> lock(shard.lock);
+  auto it = shard.data.find(key);
+  if (it == shard.data.end()) {
+    return std::nullopt;
+  }
+
+  auto& versions = it->second;
+  for (auto version = versions.rbegin(); version != versions.rend(); version++) {
+    if (version->index <= index) {
+      return Version{version->index, version->deleted, std::string(version->value.View()), version->expires_at};
+    }
+  }
+  return std::nullopt;
+}
+
+long ShardedMap::Put(std::string_view key, std::string_view value, const int index, const int64_t expires_at) {
+  return AddVersion(key, index, false, value, expires_at);
+}
+
+long ShardedMap::Delete(std::string_view key, const int index) {
+  return AddVersion(key, index, true, "", 0);
+}
+
+size_t ShardedMap::Collect(const int horizon, const bool drop_deleted) {
+  size_t freed_bytes = 0;
+  for (auto& shard:m_shards) {
+    std::unique_lock<std::shared_mutex> lock(shard.lock);
+    for (auto it = shard.data.begin(); it != shard.data.end();) {
+      auto& versions = it->second;
+      // Versions before the latest one visible at the horizon are unreachable
+      int visible = 0;
+      while (visible + 1 < versions.size() && versions[visible + 1].index <= horizon) {
+        visible++;
+      }
+      freed_bytes += EraseVersions(shard, versions, visible);
+
+      if (drop_deleted && versions.size() == 1 && versions[0].deleted && versions[0].index <= horizon) {
+        freed_bytes += it->first.size();
+        it = EraseEntry(shard, it);
+      } else {
+        it++;
+      }
+    }
+  }
+  return freed_bytes;
+}
+
+bool ShardedMap::Contains(std::string_view key) const {
+  auto& shard = ShardFor(key);
+  std::shared_lock<std::shared_mutex> lock(shard.lock);
+  return shard.data.find(key) != shard.data.end();
+}
+
+size_t ShardedMap::DropThrough(const int index) {
+  size_t freed_bytes = 0;
+  for (auto& shard:m_shards) {
+    std::unique_lock<std::shared_mutex> lock(shard.lock);
+    for (auto it = shard.data.begin(); it != shard.data.end();) {
+      auto& versions = it->second;
+      int dropped = 0;
+      while (dropped < versions.size() && versions[dropped].index <= index) {
+        dropped++;
+      }
+      freed_bytes += EraseVersions(shard, versions, dropped);
+
+      if (versions.empty()) {
+        freed_bytes += it->first.size();
+        it = EraseEntry(shard, it);
+      } else {
+        it++;
+      }
+    }
+  }
+  return freed_bytes;
+}
+
+size_t ShardedMap::Size() const {
+  size_t size = 0;
+  for (auto& shard:m_shards) {
+    std::shared_lock<std::shared_mutex> lock(shard.lock);
+    size += shard.data.size();
+  }
+  return size;
+}
+
+ShardedMap::MemoryUsage ShardedMap::Memory() const {
+  // Each hash table node holds the entry along with the next pointer and cached hash
+  const size_t node_bytes = sizeof(map_type::value_type) + 2 * sizeof(void*);
+
+  MemoryUsage usage;
+  for (auto& shard:m_shards) {
+    std::shared_lock<std::shared_mutex> lock(shard.lock);
+    usage.arena_bytes += shard.arena.ReservedBytes();
+    usage.index_bytes += shard.data.bucket_count() * sizeof(void*)
+      + shard.data.size() * node_bytes
+      + shard.version_count * sizeof(StoredVersion);
+  }
+  return usage;
+}
+
+size_t ShardedMap::MoveIf(const std::function<bool(std::string_view)>& predicate, ShardedMap& dest) {
+  size_t moved_bytes = 0;
+  // Both maps hash keys identically, so entries stay in the shard with the same index
+  for (int i = 0; i < MAP_SHARD_COUNT; i++) {
+    std::scoped_lock lock(m_shards[i].lock, dest.m_shards[i].lock);
+    auto& data = m_shards[i].data;
+    for (auto it = data.begin(); it != data.end();) {
+      if (!predicate(it->first)) {
+        it++;
+        continue;
+      }
+      moved_bytes += it->first.size();
+      for (auto& version:it->second) {
+        moved_bytes += version.value.Size();
+      }
+      it = MoveEntry(m_shards[i], it, dest.m_shards[i]);
+    }
+  }
+  return moved_bytes;
+}
+
+void ShardedMap::MergeFrom(ShardedMap& source) {
+  for (int i = 0; i < MAP_SHARD_COUNT; i++) {
+    std::scoped_lock lock(m_shards[i].lock, source.m_shards[i].lock);
+    auto& data = source.m_shards[i].data;
+    for (auto it = data.begin(); it != data.end();) {
+      it = MoveEntry(source.m_shards[i], it, m_shards[i]);
+    }
+  }
+}
+
+long ShardedMap::AddVersion(
+    std::string_view key,
+    const int index,
+    const bool deleted,
+    std::string_view value,
+    const int64_t expires_at) {
+  auto& shard = ShardFor(key);
+  std::unique_lock<std::shared_mutex> lock(shard.lock);
+  StoredVersion version{index, deleted, expires_at, PackedString::Create(shard.arena, value)};
+  auto it = shard.data.find(key);
+  if (it == shard.data.end()) {
+    char* key_data = shard.arena.Allocate(key.size());
+    std::copy(key.begin(), key.end(), key_data);
+    shard.data.emplace(std::string_view(key_data, key.size()), version_chain{version});
+    shard.version_count++;
+    return key.size() + value.size();
+  }
+
+  auto& versions = it->second;
+  if (versions.back().index == index) {
+    long delta = (long)value.size() - (long)versions.back().value.Size();
+    versions.back().value.Release(shard.arena);
+    versions.back() = version;
+    return delta;
+  }
+  versions.push_back(version);
+  shard.version_count++;
+  return value.size();
+}
+
+size_t ShardedMap::EraseVersions(Shard& shard, version_chain& versions, const size_t count) {
+  size_t freed_bytes = 0;
+  for (int i = 0; i < count; i++) {
+    freed_bytes += versions[i].value.Size();
+    versions[i].value.Release(shard.arena);
+  }
+  versions.erase(versions.begin(), versions.begin() + count);
+  shard.version_count -= count;
+  return freed_bytes;
+}
+
+ShardedMap::map_type::iterator ShardedMap::EraseEntry(Shard& shard, map_type::iterator it) {
+  EraseVersions(shard, it->second, it->second.size());
+  shard.arena.Free(const_cast<char*>(it->first.data()), it->first.size());
+  return shard.data.erase(it);
+}
+
+ShardedMap::map_type::iterator ShardedMap::MoveEntry(Shard& source, map_type::iterator it, Shard& dest) {
+  char* key_data = dest.arena.Allocate(it->first.size());
+  std::copy(it->first.begin(), it->first.end(), key_data);
+  version_chain versions;
+  versions.reserve(it->second.size());
+  for (auto& version:it->second) {
+    versions.push_back({
+        version.index,
+        version.deleted,
+        version.expires_at,
+        PackedString::Create(dest.arena, version.value.View())});
+  }
+  dest.version_count += versions.size();
+  dest.data.emplace(std::string_view(key_data, it->first.size()), std::move(versions));
+  return EraseEntry(source, it);
+}
+
+ShardedMap::Shard& ShardedMap::ShardFor(std::string_view key) {
+  return m_shards[StringHash{}(key) % MAP_SHARD_COUNT];
+}
+
+const ShardedMap::Shard& ShardedMap::ShardFor(std::string_view key) const {
+  return m_shards[StringHash{}(key) % MAP_SHARD_COUNT];
+}
+
+}
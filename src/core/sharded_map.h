@@ -0,0 +1,231 @@
+#ifndef SHARDED_MAP_H
+#define SHARDED_MAP_H
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "arena.h"
+
+namespace core {
+
+const int MAP_SHARD_COUNT = 16;
+
+/**
+ * Hash map from strings to versioned strings split into independently locked shards.
+ * Every write adds a version tagged with a log index, so readers can look up the value
+ * a key had at any index that has not been garbage collected. Deletes add a tombstone
+ * version so that readers at earlier indices still see the old value. Lookups accept
+ * string_views without copying the key.
+ *
+ * Reads are not lock-free. A reader takes its shard's lock in shared mode, so readers
+ * never wait for each other, but they do wait while the same shard is locked exclusively:
+ * by the apply thread for the duration of one Put or Delete, or for a whole pass over the
+ * shard by Collect, DropThrough, MoveIf and MergeFrom. Sharding only makes it unlikely
+ * that a reader and a writer need the same shard at the same time.
+ *
+ * Keys and values are copied into a SlabArena owned by their shard, values short enough
+ * are stored inline in their version, so an entry costs a few heap allocations per
+ * shard rather than one per key and per version.
+ */
+class ShardedMap {
+public:
+  /**
+   * Hash usable with both std::string and std::string_view keys.
+   */
+  struct StringHash {
+    using is_transparent = void;
+
+    size_t operator()(std::string_view key) const {
+      return std::hash<std::string_view>{}(key);
+    }
+  };
+
+  struct Version {
+    int index;
+    /**
+     * Set for tombstones, which have an empty value.
+     */
+    bool deleted;
+    std::string value;
+    /**
+     * Time in ms at which the value expires, 0 if it does not expire.
+     */
+    int64_t expires_at = 0;
+
+    /**
+     * Determines whether the value no longer exists at a time.
+     */
+    bool Expired(const int64_t time) const {
+      return expires_at > 0 && expires_at <= time;
+    }
+  };
+
+  /**
+   * Estimated memory held by the map, in addition to the bytes of its keys and values.
+   */
+  struct MemoryUsage {
+    /**
+     * Bytes the arenas obtained from the heap, including free slots.
+     */
+    size_t arena_bytes = 0;
+    /**
+     * Bytes of the hash tables and version lists.
+     */
+    size_t index_bytes = 0;
+  };
+
+public:
+  ShardedMap();
+
+  /**
+   * Looks up the version of a key visible at a log index.
+   *
+   * @param key the key to find
+   * @param index the log index to read at
+   * @returns a copy of the latest version written at or before the index, which is a
+   *    tombstone if the key was deleted, or nothing if the map has no such version
+   */
+  std::optional<Version> Get(std::string_view key, const int index) const;
+
+  /**
+   * Adds a version of a key. Indices must increase with every write to a key, a write
+   * with the same index as the latest version overwrites it.
+   *
+   * @param expires_at time in ms at which the value expires, 0 if it does not expire
+   * @returns the number of bytes added to the map
+   */
+  long Put(std::string_view key, std::string_view value, const int index, const int64_t expires_at = 0);
+
+  /**
+   * Adds a tombstone version of a key, following the same rules as Put.
+   *
+   * @returns the number of bytes added to the map
+   */
+  long Delete(std::string_view key, const int index);
+
+  /**
+   * Removes versions that no reader at or above an index can observe, keeping the
+   * latest version at or before the index.
+   *
+   * @param horizon the lowest index that may still be read
+   * @param drop_deleted whether keys whose only remaining version is a tombstone are
+   *    removed, only safe if no older value of the key is stored elsewhere
+   * @returns the number of bytes removed from the map
+   */
+  size_t Collect(const int horizon, const bool drop_deleted);
+
+  bool Contains(std::string_view key) const;
+
+  /**
+   * Removes every version written at or before an index, along with keys left without
+   * versions. Used once those versions are persisted elsewhere.
+   *
+   * @returns the number of bytes removed from the map
+   */
+  size_t DropThrough(const int index);
+
+  /**
+   * Number of keys in the map. Not a consistent snapshot while writers are active.
+   */
+  size_t Size() const;
+
+  /**
+   * Estimates the memory held by the map. Not a consistent snapshot while writers are
+   * active.
+   */
+  MemoryUsage Memory() const;
+
+  /**
+   * Moves every entry whose key matches a predicate into another map.
+   *
+   * @param predicate selects the keys to move
+   * @param dest the map receiving the entries
+   * @returns the total size of the moved keys and values in bytes
+   */
+  size_t MoveIf(const std::function<bool(std::string_view)>& predicate, ShardedMap& dest);
+
+  /**
+   * Moves every entry of another map into this one.
+   */
+  void MergeFrom(ShardedMap& source);
+
+private:
+  /**
+   * Version as stored in the map, the value lives in the shard's arena unless inlined.
+   */
+  struct StoredVersion {
+    int index;
+    bool deleted;
+    int64_t expires_at;
+    PackedString value;
+  };
+
+  /**
+   * Versions of a key ordered by ascending index.
+   */
+  using version_chain = std::vector<StoredVersion>;
+
+  /**
+   * Keys are views into the shard's arena.
+   */
+  using map_type = std::unordered_map<std::string_view, version_chain, StringHash, std::equal_to<>>;
+
+  /**
+   * Shards are aligned to cache lines so readers of neighbouring shards do not contend
+   * on the same line.
+   */
+  struct alignas(64) Shard {
+    mutable std::shared_mutex lock;
+    map_type data;
+    SlabArena arena;
+    /**
+     * Number of versions of every key.
+     */
+    size_t version_count = 0;
+  };
+
+  long AddVersion(std::string_view key, const int index, const bool deleted, std::string_view value,
+      const int64_t expires_at);
+
+  /**
+   * Frees the arena memory of the versions before a position in a key's list and removes
+   * them. Requires the shard's lock.
+   *
+   * @returns the number of value bytes removed
+   */
+  static size_t EraseVersions(Shard& shard, version_chain& versions, const size_t count);
+
+  /**
+   * Frees the arena memory of an entry and removes it. Requires the shard's lock.
+   *
+   * @returns the iterator following the entry
+   */
+  static map_type::iterator EraseEntry(Shard& shard, map_type::iterator it);
+
+  /**
+   * Copies an entry into another shard's arena and removes it from its shard. Requires
+   * both shards' locks.
+   *
+   * @returns the iterator following the entry
+   */
+  static map_type::iterator MoveEntry(Shard& source, map_type::iterator it, Shard& dest);
+
+  Shard& ShardFor(std::string_view key);
+  const Shard& ShardFor(std::string_view key) const;
+
+private:
+  std::array<Shard, MAP_SHARD_COUNT> m_shards;
+};
+
+}
+
+#endif
+
@@ -0,0 +1,124 @@
+#include "skiplist.h"
+
+namespace core {
+
+SkipList::Node::Node(std::string node_key, const int height)
+  : key(std::move(node_key)), next(height) {
+  for (auto& link:next) {
+    link.store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+SkipList::Iterator::Iterator(const Node* node)
+  : m_node(node) {
+}
+
+bool SkipList::Iterator::Valid() const {
+  return m_node != nullptr;
+}
+
+const std::string& SkipList::Iterator::Key() const {
+  return m_node->key;
+}
+
+void SkipList::Iterator::Next() {
+  m_node = m_node->next[0].load(std::memory_order_acquire);
+}
+
+SkipList::SkipList()
+  : m_head(new Node("", SKIPLIST_MAX_HEIGHT)), m_height(1), m_rng(std::random_device{}()) {
+}
+
+SkipList::~SkipList() {
+  Node* node = m_head;
+  while (node != nullptr) {
+    Node* next = node->next[0].load(std::memory_order_relaxed);
+    delete node;
+    node = next;
+  }
+}
+
+bool SkipList::Insert(const std::string& key) {
+  Node* prev[SKIPLIST_MAX_HEIGHT];
+  Node* next = FindLessThan(key, prev);
+  if (next != nullptr && next->key == key) {
+    return false;
+  }
+
+  int height = RandomHeight();
+  int list_height = m_height.load(std::memory_order_relaxed);
+  if (height > list_height) {
+    for (int level = list_height; level < height; level++) {
+      prev[level] = m_head;
+    }
+    // Readers observing the new height before the node is linked see null links from
+    // the head at the new levels and move down
+    m_height.store(height, std::memory_order_relaxed);
+  }
+
+  Node* node = new Node(key, height);
+  for (int level = 0; level < height; level++) {
+    node->next[level].store(prev[level]->next[level].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    prev[level]->next[level].store(node, std::memory_order_release);
+  }
+  return true;
+}
+
+bool SkipList::Contains(std::string_view key) const {
+  auto it = Seek(key);
+  return it.Valid() && it.Key() == key;
+}
+
+SkipList::Iterator SkipList::Seek(std::string_view key) const {
+  return Iterator(FindLessThan(key, nullptr));
+}
+
+SkipList::Iterator SkipList::Begin() const {
+  return Iterator(m_head->next[0].load(std::memory_order_acquire));
+}
+
+void SkipList::Truncate(std::string_view key) {
+  Node* prev[SKIPLIST_MAX_HEIGHT];
+  Node* node = FindLessThan(key, prev);
+  for (int level = 0; level < m_height.load(std::memory_order_relaxed); level++) {
+    prev[level]->next[level].store(nullptr, std::memory_order_relaxed);
+  }
+
+  while (node != nullptr) {
+    Node* next = node->next[0].load(std::memory_order_relaxed);
+    delete node;
+    node = next;
+  }
+}
+
+SkipList::Node* SkipList::FindLessThan(std::string_view key, Node** prev) const {
+  Node* node = m_head;
+  int level = m_height.load(std::memory_order_relaxed) - 1;
+  while (true) {
+    Node* next = node->next[level].load(std::memory_order_acquire);
+    if (next != nullptr && next->key < key) {
+      node = next;
+      continue;
+    }
+
+    if (prev != nullptr) {
+      prev[level] = node;
+    }
+    if (level == 0) {
+      return next;
+    }
+    level--;
+  }
+}
+
+int SkipList::RandomHeight() {
+  // Each level holds a quarter of the nodes of the level below
+  int height = 1;
+  while (height < SKIPLIST_MAX_HEIGHT && m_rng() % 4 == 0) {
+    height++;
+  }
+  return height;
+}
+
+}
+
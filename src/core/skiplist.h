@@ -0,0 +1,93 @@
+#ifndef SKIPLIST_H
+#define SKIPLIST_H
+
+#include <atomic>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace core {
+
+const int SKIPLIST_MAX_HEIGHT = 16;
+
+/**
+ * Ordered set of keys supporting one writer and any number of concurrent readers
+ * without locks. A node is fully initialised before it is published with a release
+ * store, and readers traverse links with acquire loads, so a reader sees each key
+ * either completely or not at all. Nodes are only freed when the list is destroyed or
+ * truncated, both of which require that no readers are active.
+ */
+class SkipList {
+private:
+  struct Node {
+    Node(std::string node_key, const int height);
+
+    const std::string key;
+    std::vector<std::atomic<Node*>> next;
+  };
+
+public:
+  class Iterator {
+  public:
+    Iterator(const Node* node);
+
+    bool Valid() const;
+    const std::string& Key() const;
+    void Next();
+
+  private:
+    const Node* m_node;
+  };
+
+public:
+  SkipList();
+  ~SkipList();
+
+  SkipList(const SkipList&) = delete;
+  SkipList& operator=(const SkipList&) = delete;
+
+  /**
+   * Inserts a key if it is not already present. Only one thread may insert at a time.
+   *
+   * @returns whether the key was inserted
+   */
+  bool Insert(const std::string& key);
+
+  bool Contains(std::string_view key) const;
+
+  /**
+   * Positions an iterator at the first key greater than or equal to a key.
+   */
+  Iterator Seek(std::string_view key) const;
+
+  Iterator Begin() const;
+
+  /**
+   * Removes every key greater than or equal to a key. Requires that no readers or
+   * writers are active.
+   */
+  void Truncate(std::string_view key);
+
+private:
+  /**
+   * Finds the last node at each level with a key less than a key.
+   */
+  Node* FindLessThan(std::string_view key, Node** prev) const;
+
+  int RandomHeight();
+
+private:
+  Node* const m_head;
+  std::atomic<int> m_height;
+
+  /**
+   * Only used by the writer.
+   */
+  std::mt19937 m_rng;
+};
+
+}
+
+#endif
+
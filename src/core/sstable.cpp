@@ -0,0 +1,246 @@
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+
+#include "coding.h"
+#include "sstable.h"
+
+namespace core {
+
+namespace {
+
+const char VALUE_RECORD = 0;
+const char DELETION_RECORD = 1;
+const char EXPIRING_RECORD = 2;
+
+}
+
+bool SyncPath(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  bool ok = fsync(fd) == 0;
+  close(fd);
+  return ok;
+}
+
+SSTableWriter::SSTableWriter(const std::string& path)
+  : m_path(path), m_out(path, std::ios::out | std::ios::trunc | std::ios::binary), m_offset(0), m_entry_count(0) {
+}
+
+void SSTableWriter::Add(std::string_view key, std::string_view value, const int64_t expires_at) {
+  AddRecord(key, false, value, expires_at);
+}
+
+void SSTableWriter::AddDeletion(std::string_view key) {
+  AddRecord(key, true, "", 0);
+}
+
+void SSTableWriter::AddRecord(
+    std::string_view key,
+    const bool deleted,
+    std::string_view value,
+    const int64_t expires_at) {
+  if (m_entry_count % SSTABLE_INDEX_INTERVAL == 0) {
+    m_index.emplace_back(key, m_offset);
+  }
+
+  std::string record;
+  EncodeString(record, key);
+  record.push_back(deleted ? DELETION_RECORD : expires_at > 0 ? EXPIRING_RECORD : VALUE_RECORD);
+  if (!deleted) {
+    EncodeString(record, value);
+  }
+  if (!deleted && expires_at > 0) {
+    EncodeVarint(record, expires_at);
+  }
+  m_out.write(record.data(), record.size());
+  m_offset += record.size();
+  m_entry_count++;
+}
+
+bool SSTableWriter::Finish() {
+  std::string index;
+  EncodeVarint(index, m_index.size());
+  for (auto& [key, offset]:m_index) {
+    EncodeString(index, key);
+    EncodeFixed64(index, offset);
+  }
+  EncodeFixed64(index, m_offset);
+  EncodeFixed64(index, SSTABLE_MAGIC);
+  m_out.write(index.data(), index.size());
+  m_out.flush();
+  bool ok = m_out.good();
+  m_out.close();
+  // The manifest must never reference a table that a crash could leave incomplete
+  return ok && SyncPath(m_path);
+}
+
+const std::string& SSTableWriter::Path() const {
+  return m_path;
+}
+
+int SSTableWriter::EntryCount() const {
+  return m_entry_count;
+}
+
+SSTable::Iterator::Iterator(const SSTable& table)
+  : m_table(table), m_block(0), m_position(0) {
+  LoadBlock(0);
+}
+
+void SSTable::Iterator::Seek(std::string_view key) {
+  LoadBlock(std::max(m_table.FindBlock(key), 0));
+  while (Valid() && Key() < key) {
+    Next();
+  }
+}
+
+bool SSTable::Iterator::Valid() const {
+  return m_position < m_entries.size();
+}
+
+const std::string& SSTable::Iterator::Key() const {
+  return m_entries[m_position].key;
+}
+
+const std::string& SSTable::Iterator::Value() const {
+  return m_entries[m_position].value;
+}
+
+bool SSTable::Iterator::Deleted() const {
+  return m_entries[m_position].deleted;
+}
+
+int64_t SSTable::Iterator::ExpiresAt() const {
+  return m_entries[m_position].expires_at;
+}
+
+void SSTable::Iterator::Next() {
+  m_position++;
+  if (m_position >= m_entries.size() && m_block + 1 < m_table.m_index.size()) {
+    LoadBlock(m_block + 1);
+  }
+}
+
+void SSTable::Iterator::LoadBlock(const int block) {
+  m_block = block;
+  m_position = 0;
+  m_entries = block < m_table.m_index.size() ? m_table.ReadBlock(block) : decltype(m_entries)();
+}
+
+SSTable::SSTable(const std::string& path, const int fd)
+  : m_path(path), m_fd(fd), m_index_offset(0) {
+}
+
+SSTable::~SSTable() {
+  close(m_fd);
+}
+
+std::shared_ptr<SSTable> SSTable::Open(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return nullptr;
+  }
+
+  std::shared_ptr<SSTable> table(new SSTable(path, fd));
+  if (!table->LoadIndex()) {
+    return nullptr;
+  }
+  return table;
+}
+
+std::optional<SSTable::Entry> SSTable::Get(std::string_view key) const {
+  int block = FindBlock(key);
+  if (block < 0) {
+    return std::nullopt;
+  }
+
+  for (auto& entry:ReadBlock(block)) {
+    if (entry.key == key) {
+      return std::move(entry);
+    }
+  }
+  return std::nullopt;
+}
+
+const std::string& SSTable::Path() const {
+  return m_path;
+}
+
+bool SSTable::LoadIndex() {
+  struct stat file_stat;
+  if (fstat(m_fd, &file_stat) != 0 || file_stat.st_size < 16) {
+    return false;
+  }
+
+  char footer[16];
+  if (pread(m_fd, footer, sizeof(footer), file_stat.st_size - sizeof(footer)) != sizeof(footer) ||
+      DecodeFixed64(footer + 8) != SSTABLE_MAGIC) {
+    return false;
+  }
+  m_index_offset = DecodeFixed64(footer);
+
+  std::string index(file_stat.st_size - sizeof(footer) - m_index_offset, '\0');
+  if (pread(m_fd, index.data(), index.size(), m_index_offset) != index.size()) {
+    return false;
+  }
+
+  std::string_view in(index);
+  uint64_t block_count;
+  if (!DecodeVarint(in, block_count)) {
+    return false;
+  }
+  for (int i = 0; i < block_count; i++) {
+    std::string_view key;
+    if (!DecodeString(in, key) || in.size() < 8) {
+      return false;
+    }
+    m_index.emplace_back(key, DecodeFixed64(in.data()));
+    in.remove_prefix(8);
+  }
+  return true;
+}
+
+std::vector<SSTable::Entry> SSTable::ReadBlock(const int block) const {
+  uint64_t start = m_index[block].second;
+  uint64_t end = block + 1 < m_index.size() ? m_index[block + 1].second : m_index_offset;
+  std::string data(end - start, '\0');
+  std::vector<Entry> entries;
+  if (pread(m_fd, data.data(), data.size(), start) != data.size()) {
+    return entries;
+  }
+
+  std::string_view in(data);
+  while (!in.empty()) {
+    std::string_view key;
+    std::string_view value;
+    if (!DecodeString(in, key) || in.empty()) {
+      break;
+    }
+    char type = in.front();
+    in.remove_prefix(1);
+    bool deleted = type == DELETION_RECORD;
+    if (!deleted && !DecodeString(in, value)) {
+      break;
+    }
+    uint64_t expires_at = 0;
+    if (type == EXPIRING_RECORD && !DecodeVarint(in, expires_at)) {
+      break;
+    }
+    entries.push_back({std::string(key), deleted, std::string(value), (int64_t)expires_at});
+  }
+  return entries;
+}
+
+int SSTable::FindBlock(std::string_view key) const {
+  auto it = std::upper_bound(m_index.begin(), m_index.end(), key, [](std::string_view key, const auto& entry) {
+    return key < entry.first;
+  });
+  return (int)(it - m_index.begin()) - 1;
+}
+
+}
+
@@ -0,0 +1,159 @@
+#ifndef SSTABLE_H
+#define SSTABLE_H
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace core {
+
+const int SSTABLE_INDEX_INTERVAL = 16;
+const uint64_t SSTABLE_MAGIC = 0x6d61656c73746d32;
+
+/**
+ * Flushes a file, or the entries of a directory, from the page cache to stable storage.
+ *
+ * @returns whether the path could be opened and synced
+ */
+bool SyncPath(const std::string& path);
+
+/**
+ * Writes an immutable sorted table. Entries are stored as a length prefixed key, a type
+ * byte and, unless the entry records a deletion, a length prefixed value followed by a
+ * varint expiry time if the value expires. The entries are
+ * followed by a sparse index holding the offset of every SSTABLE_INDEX_INTERVAL entry and
+ * a fixed size footer locating the index.
+ */
+class SSTableWriter {
+public:
+  SSTableWriter(const std::string& path);
+
+  /**
+   * Appends an entry. Keys must be added in strictly increasing order.
+   *
+   * @param expires_at time in ms at which the value expires, 0 if it does not expire
+   */
+  void Add(std::string_view key, std::string_view value, const int64_t expires_at = 0);
+
+  /**
+   * Appends a tombstone hiding the key's value in older tables.
+   */
+  void AddDeletion(std::string_view key);
+
+  /**
+   * Writes the index and footer, syncs the file to disk and closes it.
+   *
+   * @returns whether every write succeeded
+   */
+  bool Finish();
+
+  const std::string& Path() const;
+
+  int EntryCount() const;
+
+private:
+  void AddRecord(std::string_view key, const bool deleted, std::string_view value, const int64_t expires_at);
+
+private:
+  const std::string m_path;
+  std::ofstream m_out;
+  uint64_t m_offset;
+  int m_entry_count;
+  std::vector<std::pair<std::string, uint64_t>> m_index;
+};
+
+/**
+ * Immutable sorted table read with positional reads so lookups from several threads do
+ * not share a file position. Only the sparse index is kept in memory.
+ */
+class SSTable {
+public:
+  struct Entry {
+    std::string key;
+    /**
+     * Set for tombstones, which have no value.
+     */
+    bool deleted;
+    std::string value;
+    /**
+     * Time in ms at which the value expires, 0 if it does not expire.
+     */
+    int64_t expires_at;
+  };
+
+  class Iterator {
+  public:
+    Iterator(const SSTable& table);
+
+    /**
+     * Positions the iterator at the first entry with a key greater than or equal to a key.
+     */
+    void Seek(std::string_view key);
+
+    bool Valid() const;
+    const std::string& Key() const;
+    const std::string& Value() const;
+    bool Deleted() const;
+    int64_t ExpiresAt() const;
+    void Next();
+
+  private:
+    void LoadBlock(const int block);
+
+  private:
+    const SSTable& m_table;
+    int m_block;
+    std::vector<Entry> m_entries;
+    int m_position;
+  };
+
+public:
+  ~SSTable();
+
+  /**
+   * Opens a table written by SSTableWriter.
+   *
+   * @returns the table, or nullptr if the file is missing or corrupt
+   */
+  static std::shared_ptr<SSTable> Open(const std::string& path);
+
+  /**
+   * Looks up the entry of a key, which may be a tombstone.
+   */
+  std::optional<Entry> Get(std::string_view key) const;
+
+  const std::string& Path() const;
+
+private:
+  SSTable(const std::string& path, const int fd);
+
+  bool LoadIndex();
+
+  /**
+   * Reads and decodes every entry in a block of the sparse index.
+   */
+  std::vector<Entry> ReadBlock(const int block) const;
+
+  /**
+   * Finds the last block whose first key is less than or equal to a key.
+   *
+   * @returns the block, or -1 if the key precedes every block
+   */
+  int FindBlock(std::string_view key) const;
+
+private:
+  const std::string m_path;
+  const int m_fd;
+  uint64_t m_index_offset;
+  std::vector<std::pair<std::string, uint64_t>> m_index;
+};
+
+}
+
+#endif
+
@@ -5,7 +5,7 @@
 namespace raft {
 
 ClusterConfiguration::ClusterConfiguration()
-  : m_id(-1), m_state(ConfigurationState::EMPTY) {
+  : m_id(-1), m_state(ConfigurationState::EMPTY), m_has_recycled(false) {
 }
 
 protocol::log::Configuration ClusterConfiguration::Configuration() const {
@@ -28,14 +28,40 @@ void ClusterConfiguration::SetConfiguration(int new_id, const protocol::log::Con
   }
   m_id = new_id;
   m_current_configuration = configuration;
-  m_addresses.clear();
+  m_prev_peers.reset();
+  m_next_peers.reset();
+  m_learners.reset();
 
-  for (auto& server:configuration.prev_configuration()) {
-    m_addresses.insert(server.address());
-  }
-  for (auto& server:configuration.next_configuration()) {
-    m_addresses.insert(server.address());
+  {
+    std::unique_lock<std::shared_mutex> lock(m_peers_lock);
+    PeerSet taken;
+    // The LEADER reserves ids before appending a configuration, so only a node retaining
+    // older configurations than the LEADER did can run out of ids
+    if (!InternConfigurationLocked(configuration, taken)) {
+      LOG(ERROR) << "Unable to track every server of the configuration with id = " << new_id
+        << ", cluster is limited to " << MAX_CLUSTER_SIZE << " servers";
+    }
+    for (auto& server:configuration.prev_configuration()) {
+      int peer_id = FindLocked(server.address());
+      if (peer_id >= 0) {
+        m_prev_peers.set(peer_id);
+      }
+    }
+    for (auto& server:configuration.next_configuration()) {
+      int peer_id = FindLocked(server.address());
+      if (peer_id >= 0) {
+        m_next_peers.set(peer_id);
+      }
+    }
+    for (auto& server:configuration.learners()) {
+      int peer_id = FindLocked(server.address());
+      if (peer_id >= 0) {
+        m_learners.set(peer_id);
+      }
+    }
+    UpdateRetainedLocked();
   }
+  UpdateMembers();
 }
 
 int ClusterConfiguration::Id() const {
@@ -51,78 +77,158 @@ void ClusterConfiguration::SetState(ClusterConfiguration::ConfigurationState new
 }
 
 void ClusterConfiguration::InsertNewConfiguration(int new_id, const protocol::log::Configuration& new_configuration) {
-  m_configurations.insert({new_id, new_configuration});
+  {
+    std::unique_lock<std::shared_mutex> lock(m_peers_lock);
+    PeerSet taken;
+    InternConfigurationLocked(new_configuration, taken);
+    m_configurations.insert({new_id, new_configuration});
+    UpdateRetainedLocked();
+  }
   auto it = m_configurations.rbegin();
   if (Id() != it->first) {
     SetConfiguration(it->first, it->second);
   }
 }
 
-std::unordered_set<std::string> ClusterConfiguration::ServerAddresses() const {
-  if (State() == ConfigurationState::SYNC) {
-    std::unordered_set<std::string> address_union(m_addresses);
-    for (auto& address:m_log_sync->sync_addresses) {
-      address_union.insert(address);
+const std::unordered_set<std::string>& ClusterConfiguration::ServerAddresses() const {
+  return m_addresses;
+}
+
+PeerSet ClusterConfiguration::Members() const {
+  return m_members;
+}
+
+PeerSet ClusterConfiguration::Voters() const {
+  return m_prev_peers | m_next_peers;
+}
+
+bool ClusterConfiguration::IsLearner(const int peer_id) const {
+  return m_learners.test(peer_id);
+}
+
+bool ClusterConfiguration::KnownServer(const std::string& address) const {
+  return m_addresses.find(address) != m_addresses.end();
+}
+
+bool ClusterConfiguration::KnownServer(const int peer_id) const {
+  return m_members.test(peer_id);
+}
+
+int ClusterConfiguration::PeerId(const std::string& address) {
+  {
+    std::shared_lock<std::shared_mutex> lock(m_peers_lock);
+    int peer_id = FindLocked(address);
+    if (peer_id >= 0) {
+      return peer_id;
     }
-    return address_union;
   }
-  return m_addresses;
+
+  std::unique_lock<std::shared_mutex> lock(m_peers_lock);
+  PeerSet taken;
+  return InternLocked(address, taken);
 }
 
-bool ClusterConfiguration::KnownServer(std::string address) {
-  bool found = m_addresses.find(address) != m_addresses.end();
-  if (State() == ConfigurationState::SYNC) {
-    found |= m_log_sync->sync_addresses.find(address) != m_log_sync->sync_addresses.end();
+int ClusterConfiguration::SelfId(const std::string& address) {
+  std::unique_lock<std::shared_mutex> lock(m_peers_lock);
+  PeerSet taken;
+  int peer_id = InternLocked(address, taken);
+  m_pinned |= taken;
+  return peer_id;
+}
+
+bool ClusterConfiguration::ReservePeers(const std::vector<std::string>& addresses) {
+  std::unique_lock<std::shared_mutex> lock(m_peers_lock);
+  PeerSet taken;
+  for (auto& address:addresses) {
+    if (InternLocked(address, taken) < 0) {
+      return false;
+    }
+  }
+  m_reserved |= taken;
+  return true;
+}
+
+PeerSet ClusterConfiguration::TakeRecycledPeers() {
+  if (!m_has_recycled.load()) {
+    return PeerSet();
   }
-  return found;
+  std::unique_lock<std::shared_mutex> lock(m_peers_lock);
+  PeerSet recycled = m_recycled;
+  m_recycled.reset();
+  m_has_recycled.store(false);
+  return recycled;
+}
+
+std::string ClusterConfiguration::PeerAddress(const int peer_id) const {
+  std::shared_lock<std::shared_mutex> lock(m_peers_lock);
+  if (peer_id < 0 || peer_id >= m_peer_addresses.size()) {
+    return "";
+  }
+  return m_peer_addresses[peer_id];
 }
 
 void ClusterConfiguration::TruncateSuffix(int removal_index) {
-  m_configurations.erase(m_configurations.upper_bound(removal_index), m_configurations.end());
+  {
+    std::unique_lock<std::shared_mutex> lock(m_peers_lock);
+    m_configurations.erase(m_configurations.upper_bound(removal_index), m_configurations.end());
+    UpdateRetainedLocked();
+  }
   auto it = m_configurations.rbegin();
   if (Id() != it->first) {
     SetConfiguration(it->first, it->second);
   }
 }
 
-bool ClusterConfiguration::CheckQuorum(std::unordered_set<std::string> peer_votes) {
+void ClusterConfiguration::Compact(const int commit_index) {
+  std::unique_lock<std::shared_mutex> lock(m_peers_lock);
+  auto committed = m_configurations.upper_bound(commit_index);
+  if (committed == m_configurations.begin()) {
+    return;
+  }
+  committed--;
+  if (committed == m_configurations.begin()) {
+    return;
+  }
+  m_configurations.erase(m_configurations.begin(), committed);
+  UpdateRetainedLocked();
+}
+
+bool ClusterConfiguration::CheckQuorum(const PeerSet& peer_votes) const {
+  bool prev_majority = (peer_votes & m_prev_peers).count()*2 > m_prev_peers.count();
   if (State() == ConfigurationState::JOINT) {
-    int prev_votes = 0;
-    int next_votes = 0;
-    for (auto old_server:m_current_configuration.prev_configuration()) {
-      if (peer_votes.find(old_server.address()) != peer_votes.end()) {
-        prev_votes++;
-      }
-    }
-    for (auto new_server:m_current_configuration.next_configuration()) {
-      if (peer_votes.find(new_server.address()) != peer_votes.end()) {
-        next_votes++;
-      }
-    }
-    bool prev_majority = prev_votes*2 > m_current_configuration.prev_configuration().size();
-    bool next_majority = next_votes*2 > m_current_configuration.next_configuration().size();
+    bool next_majority = (peer_votes & m_next_peers).count()*2 > m_next_peers.count();
     return prev_majority && next_majority;
-  } else {
-    return peer_votes.size()*2 > m_current_configuration.prev_configuration().size();
   }
+  return prev_majority;
 }
 
-void ClusterConfiguration::StartLogSync(int commit_index, const std::vector<std::string>& new_servers) {
+bool ClusterConfiguration::StartLogSync(int commit_index, const std::vector<std::string>& new_servers) {
+  if (!ReservePeers(new_servers)) {
+    return false;
+  }
   DLOG(INFO) << "Starting membership change log sync...";
-  std::vector<std::string> sync_servers;
+  PeerSet sync_servers;
+  // Learners being promoted must also catch up before they can vote
   for (auto& server:new_servers) {
-    if (!KnownServer(server)) {
-      sync_servers.push_back(server);
+    if (!KnownServer(server) || IsLearner(PeerId(server))) {
+      sync_servers.set(PeerId(server));
     }
   }
 
   m_log_sync.reset(new SyncState(commit_index, sync_servers));
   SetState(ConfigurationState::SYNC);
+  UpdateMembers();
+  return true;
 }
 
 void ClusterConfiguration::CancelLogSync() {
+  if (m_log_sync) {
+    std::unique_lock<std::shared_mutex> lock(m_peers_lock);
+    m_reserved &= ~m_log_sync->sync_peers;
+  }
   m_log_sync.reset();
   SetState(ConfigurationState::STABLE);
+  UpdateMembers();
 }
 
 bool ClusterConfiguration::SyncProgress() {
@@ -130,18 +236,20 @@ bool ClusterConfiguration::SyncProgress() {
   return m_log_sync->progress;
 }
 
-bool ClusterConfiguration::UpdateSyncProgress(std::string address, int new_match_index) {
-  if (m_state != ConfigurationState::SYNC) {
+bool ClusterConfiguration::UpdateSyncProgress(const int peer_id, int new_match_index) {
+  if (m_state != ConfigurationState::SYNC || !m_log_sync->sync_peers.test(peer_id)) {
     return false;
   }
   std::lock_guard<std::mutex> lock(m_log_sync->sync_mutex);
-  auto [prev_index, _] = m_log_sync->state_diff[address];
-  m_log_sync->state_diff[address] = {prev_index, new_match_index};
+  m_log_sync->state_diff[peer_id].second = new_match_index;
 
   bool progress = true;
   bool done = true;
-  for (auto& it:m_log_sync->state_diff) {
-    auto [prev_index, curr_index] = it.second;
+  for (int id = 0; id < MAX_CLUSTER_SIZE; id++) {
+    if (!m_log_sync->sync_peers.test(id)) {
+      continue;
+    }
+    auto [prev_index, curr_index] = m_log_sync->state_diff[id];
     if (prev_index >= curr_index) {
       progress = false;
       done = false;
@@ -161,12 +269,88 @@ bool ClusterConfiguration::SyncComplete() {
   return m_log_sync->done;
 }
 
-ClusterConfiguration::SyncState::SyncState(int commit_index, const std::vector<std::string>& new_servers)
-  : sync_index(commit_index), done(false), progress(false) {
-  for (auto& address:new_servers) {
-    state_diff[address] = {0, 0};
-    sync_addresses.insert(address);
+void ClusterConfiguration::UpdateMembers() {
+  m_members = m_prev_peers | m_next_peers | m_learners;
+  if (State() == ConfigurationState::SYNC) {
+    m_members |= m_log_sync->sync_peers;
   }
+
+  m_addresses.clear();
+  for (int id = 0; id < MAX_CLUSTER_SIZE; id++) {
+    if (m_members.test(id)) {
+      m_addresses.insert(PeerAddress(id));
+    }
+  }
+}
+
+int ClusterConfiguration::InternLocked(const std::string& address, PeerSet& taken) {
+  int peer_id = FindLocked(address);
+  if (peer_id < 0 && m_peer_addresses.size() < MAX_CLUSTER_SIZE) {
+    peer_id = m_peer_addresses.size();
+    m_peer_addresses.push_back(address);
+    m_peer_ids.insert({address, peer_id});
+  } else if (peer_id < 0) {
+    PeerSet in_use = m_retained | m_reserved | m_pinned | taken;
+    for (int id = 0; id < MAX_CLUSTER_SIZE; id++) {
+      if (!in_use.test(id)) {
+        peer_id = id;
+        break;
+      }
+    }
+    if (peer_id < 0) {
+      return -1;
+    }
+    m_peer_ids.erase(m_peer_addresses[peer_id]);
+    m_peer_addresses[peer_id] = address;
+    m_peer_ids.insert({address, peer_id});
+    m_recycled.set(peer_id);
+    m_has_recycled.store(true);
+  }
+  taken.set(peer_id);
+  return peer_id;
+}
+
+bool ClusterConfiguration::InternConfigurationLocked(const protocol::log::Configuration& configuration, PeerSet& taken) {
+  bool interned = true;
+  for (auto servers:{&configuration.prev_configuration(), &configuration.next_configuration(), &configuration.learners()}) {
+    for (auto& server:*servers) {
+      interned = InternLocked(server.address(), taken) >= 0 && interned;
+    }
+  }
+  return interned;
+}
+
+void ClusterConfiguration::UpdateRetainedLocked() {
+  m_retained.reset();
+  auto retain = [this](const protocol::log::Configuration& configuration) {
+    for (auto servers:{&configuration.prev_configuration(), &configuration.next_configuration(), &configuration.learners()}) {
+      for (auto& server:*servers) {
+        int peer_id = FindLocked(server.address());
+        if (peer_id >= 0) {
+          m_retained.set(peer_id);
+        }
+      }
+    }
+  };
+  retain(m_current_configuration);
+  for (auto& [id, configuration]:m_configurations) {
+    retain(configuration);
+  }
+  // Reserved servers are protected by their configuration from now on
+  m_reserved &= ~m_retained;
+}
+
+int ClusterConfiguration::FindLocked(const std::string& address) const {
+  auto it = m_peer_ids.find(address);
+  return it == m_peer_ids.end() ? -1 : it->second;
+}
+
+ClusterConfiguration::SyncState::SyncState(int commit_index, const PeerSet& new_servers)
+  : sync_index(commit_index)
+  , done(new_servers.none())
+  , progress(new_servers.none())
+  , state_diff(MAX_CLUSTER_SIZE, {0, 0})
+  , sync_peers(new_servers) {
 }
 
 }
@@ -1,15 +1,29 @@
 #ifndef CLUSTER_CONFIGURATION_H
 #define CLUSTER_CONFIGURATION_H
 
+#include <atomic>
+#include <bitset>
 #include <map>
 #include <mutex>
+#include <shared_mutex>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "raft.grpc.pb.h"
 
 namespace raft {
 
+/**
+ * Upper bound on the number of distinct servers a node can learn about. Servers are
+ * interned to ids in [0, MAX_CLUSTER_SIZE) so per-peer state fits in flat arrays and
+ * sets of peers fit in a single machine word.
+ */
+const int MAX_CLUSTER_SIZE = 64;
+
+using PeerSet = std::bitset<MAX_CLUSTER_SIZE>;
+
 class ClusterConfiguration {
 public:
   enum class ConfigurationState {
@@ -33,33 +47,151 @@ public:
 
   void InsertNewConfiguration(int new_id, const protocol::log::Configuration& new_configuration);
 
-  std::unordered_set<std::string> ServerAddresses() const;
-
-  bool KnownServer(std::string address);
+  /**
+   * Retrieve the addresses of every server in the configuration, including servers
+   * being synced before a membership change.
+   *
+   * @returns reference to the cached address set, only valid until the configuration changes
+   */
+  const std::unordered_set<std::string>& ServerAddresses() const;
+
+  /**
+   * Retrieve the ids of every server in the configuration, including servers being
+   * synced before a membership change.
+   *
+   * @returns set of peer ids
+   */
+  PeerSet Members() const;
+
+  /**
+   * Retrieve the ids of the servers whose votes count towards quorums, excluding learners
+   * and servers being synced.
+   *
+   * @returns set of peer ids
+   */
+  PeerSet Voters() const;
+
+  bool IsLearner(const int peer_id) const;
+
+  bool KnownServer(const std::string& address) const;
+  bool KnownServer(const int peer_id) const;
+
+  /**
+   * Retrieve the id of a server, assigning a new id if the address was not seen before.
+   * Once every id is taken, the id of a server in no retained configuration is recycled,
+   * see TakeRecycledPeers.
+   *
+   * @param address the ip address of the server
+   * @returns the id of the server, or -1 if every id belongs to a server still in use
+   */
+  int PeerId(const std::string& address);
+
+  /**
+   * Retrieve the id of this node like PeerId. The id is never recycled.
+   */
+  int SelfId(const std::string& address);
+
+  /**
+   * Assigns ids to servers about to join the cluster, which are not recycled until the
+   * servers are part of a configuration or their log sync is cancelled.
+   *
+   * @param addresses the ip addresses of the servers
+   * @returns whether every server has an id, if not the servers must not be added
+   */
+  bool ReservePeers(const std::vector<std::string>& addresses);
+
+  /**
+   * Retrieve the ids recycled since the last call and forget them. State kept for such
+   * an id belongs to the server that held it before.
+   */
+  PeerSet TakeRecycledPeers();
+
+  /**
+   * Retrieve the address of a server from its id.
+   *
+   * @param peer_id the id returned by PeerId
+   * @returns the ip address of the server, empty if the id was never assigned
+   */
+  std::string PeerAddress(const int peer_id) const;
 
   void TruncateSuffix(int removal_index);
 
-  bool CheckQuorum(std::unordered_set<std::string> peer_votes);
-
-  void StartLogSync(int commit_index, const std::vector<std::string>& new_servers);
+  /**
+   * Forgets configurations replaced by a committed configuration, which are never
+   * truncated, so the ids of their servers can be recycled.
+   *
+   * @param commit_index the commit index of the raft log
+   */
+  void Compact(const int commit_index);
+
+  /**
+   * Determines whether a set of servers forms a majority. During joint consensus a
+   * majority of both the old and new configuration is required.
+   *
+   * @param peer_votes ids of the servers that agreed
+   * @returns whether the servers form a quorum
+   */
+  bool CheckQuorum(const PeerSet& peer_votes) const;
+
+  /**
+   * Starts syncing the log of servers joining the cluster.
+   *
+   * @returns whether every new server could be assigned an id, if not nothing changes
+   */
+  bool StartLogSync(int commit_index, const std::vector<std::string>& new_servers);
   void CancelLogSync();
 
   bool SyncProgress();
-  bool UpdateSyncProgress(std::string address, int new_match_index);
+  bool UpdateSyncProgress(const int peer_id, int new_match_index);
   bool SyncComplete();
 
 private:
   struct SyncState {
-    SyncState(int commit_index, const std::vector<std::string>& new_servers);
+    SyncState(int commit_index, const PeerSet& new_servers);
 
     int sync_index;
     bool done;
     bool progress;
     std::mutex sync_mutex;
-    std::unordered_map<std::string, std::pair<int, int>> state_diff;
-    std::unordered_set<std::string> sync_addresses;
+    std::vector<std::pair<int, int>> state_diff;
+    PeerSet sync_peers;
   };
 
+  /**
+   * Rebuilds the cached address set and member ids after the configuration or the
+   * servers being synced change.
+   */
+  void UpdateMembers();
+
+  /**
+   * Interns an address, recycling an id in neither m_retained, m_reserved, m_pinned nor
+   * taken. Requires m_peers_lock.
+   *
+   * @param taken ids assigned by the caller that are not yet retained or reserved, the
+   *    new id is added to it
+   * @returns the id of the server, or -1 if no id is free
+   */
+  int InternLocked(const std::string& address, PeerSet& taken);
+
+  /**
+   * Interns the addresses of every server in a configuration. Requires m_peers_lock.
+   *
+   * @returns whether every server has an id
+   */
+  bool InternConfigurationLocked(const protocol::log::Configuration& configuration, PeerSet& taken);
+
+  /**
+   * Recomputes m_retained from the configurations. Requires m_peers_lock.
+   */
+  void UpdateRetainedLocked();
+
+  /**
+   * Looks up an interned address. Requires m_peers_lock.
+   *
+   * @returns the id of the server, or -1 if it is unknown
+   */
+  int FindLocked(const std::string& address) const;
+
 private:
   int m_id;
   ConfigurationState m_state;
@@ -67,6 +199,51 @@ private:
   std::unordered_set<std::string> m_addresses;
   std::map<int, protocol::log::Configuration> m_configurations;
   std::unique_ptr<SyncState> m_log_sync;
+
+  /**
+   * Ids of the servers in the old (prev) and new (next) configuration.
+   */
+  PeerSet m_prev_peers;
+  PeerSet m_next_peers;
+
+  /**
+   * Ids of the non-voting servers in the configuration.
+   */
+  PeerSet m_learners;
+
+  /**
+   * Union of m_prev_peers, m_next_peers, m_learners and the servers being synced.
+   */
+  PeerSet m_members;
+
+  /**
+   * Guards the interned addresses and the sets of ids that cannot be recycled, since
+   * replies from peers are handled while servers are interned.
+   */
+  mutable std::shared_mutex m_peers_lock;
+  std::unordered_map<std::string, int> m_peer_ids;
+  std::vector<std::string> m_peer_addresses;
+
+  /**
+   * Ids of the servers in the current or a retained configuration.
+   */
+  PeerSet m_retained;
+
+  /**
+   * Ids of the servers being added to the cluster, see ReservePeers.
+   */
+  PeerSet m_reserved;
+
+  /**
+   * Id of the node itself.
+   */
+  PeerSet m_pinned;
+
+  /**
+   * Ids recycled since the last TakeRecycledPeers call.
+   */
+  PeerSet m_recycled;
+  std::atomic<bool> m_has_recycled;
 };
 
 }
@@ -0,0 +1,153 @@
+#include "coding.h"
+#include "command_codec.h"
+
+namespace raft {
+
+namespace {
+
+const uint8_t EXPECTED_FLAG = 0x1;
+const uint8_t VALUE_FLAG = 0x2;
+
+std::string EncodeHeader(CommandType type, std::string_view key) {
+  std::string out(1, (char)type);
+  core::EncodeString(out, key);
+  return out;
+}
+
+std::optional<Command> DecodeOperation(std::string_view data, const bool nested) {
+  if (data.empty()) {
+    return std::nullopt;
+  }
+
+  Command command;
+  command.type = (CommandType)data.front();
+  data.remove_prefix(1);
+  if (command.type != CommandType::BATCH && !core::DecodeString(data, command.key)) {
+    return std::nullopt;
+  }
+
+  switch (command.type) {
+    case CommandType::PUT: {
+      std::string_view value;
+      if (!core::DecodeString(data, value) || !core::DecodeVarint(data, command.ttl_ms)) {
+        return std::nullopt;
+      }
+      command.value = value;
+      break;
+    }
+    case CommandType::DELETE: {
+      break;
+    }
+    case CommandType::COMPARE_AND_SWAP: {
+      if (data.empty()) {
+        return std::nullopt;
+      }
+      uint8_t flags = data.front();
+      data.remove_prefix(1);
+      std::string_view field;
+      if (flags & EXPECTED_FLAG) {
+        if (!core::DecodeString(data, field)) {
+          return std::nullopt;
+        }
+        command.expected = field;
+      }
+      if (flags & VALUE_FLAG) {
+        if (!core::DecodeString(data, field)) {
+          return std::nullopt;
+        }
+        command.value = field;
+      }
+      if (!core::DecodeVarint(data, command.ttl_ms)) {
+        return std::nullopt;
+      }
+      break;
+    }
+    case CommandType::INCREMENT: {
+      uint64_t zigzag;
+      if (!core::DecodeVarint(data, zigzag)) {
+        return std::nullopt;
+      }
+      command.delta = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+      break;
+    }
+    case CommandType::BATCH: {
+      uint64_t count;
+      if (nested || !core::DecodeVarint(data, count) || count > data.size()) {
+        return std::nullopt;
+      }
+      command.operations.reserve(count);
+      for (int i = 0; i < count; i++) {
+        std::string_view operation_data;
+        if (!core::DecodeString(data, operation_data)) {
+          return std::nullopt;
+        }
+        auto operation = DecodeOperation(operation_data, true);
+        if (!operation.has_value()) {
+          return std::nullopt;
+        }
+        command.operations.push_back(std::move(operation.value()));
+      }
+      break;
+    }
+    default: {
+      return std::nullopt;
+    }
+  }
+
+  // Trailing bytes mean the command was encoded by an incompatible client
+  if (!data.empty()) {
+    return std::nullopt;
+  }
+  return command;
+}
+
+}
+
+std::string EncodePut(std::string_view key, std::string_view value, const uint64_t ttl_ms) {
+  std::string out = EncodeHeader(CommandType::PUT, key);
+  core::EncodeString(out, value);
+  core::EncodeVarint(out, ttl_ms);
+  return out;
+}
+
+std::string EncodeDelete(std::string_view key) {
+  return EncodeHeader(CommandType::DELETE, key);
+}
+
+std::string EncodeCompareAndSwap(
+    std::string_view key,
+    std::optional<std::string_view> expected,
+    std::optional<std::string_view> value,
+    const uint64_t ttl_ms) {
+  std::string out = EncodeHeader(CommandType::COMPARE_AND_SWAP, key);
+  out.push_back((char)((expected.has_value() ? EXPECTED_FLAG : 0) | (value.has_value() ? VALUE_FLAG : 0)));
+  if (expected.has_value()) {
+    core::EncodeString(out, expected.value());
+  }
+  if (value.has_value()) {
+    core::EncodeString(out, value.value());
+  }
+  core::EncodeVarint(out, ttl_ms);
+  return out;
+}
+
+std::string EncodeIncrement(std::string_view key, const int64_t delta) {
+  std::string out = EncodeHeader(CommandType::INCREMENT, key);
+  core::EncodeVarint(out, ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63));
+  return out;
+}
+
+std::string EncodeBatch(const std::vector<std::string>& operations) {
+  std::string out(1, (char)CommandType::BATCH);
+  core::EncodeVarint(out, operations.size());
+  for (auto& operation:operations) {
+    core::EncodeString(out, operation);
+  }
+  return out;
+}
+
+std::optional<Command> DecodeCommand(std::string_view data) {
+  return DecodeOperation(data, false);
+}
+
+}
@@ -0,0 +1,88 @@
+#ifndef COMMAND_CODEC_H
+#define COMMAND_CODEC_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace raft {
+
+/**
+ * Type of a client command, stored in the first byte of the encoded command.
+ */
+enum class CommandType : uint8_t {
+  PUT = 1,
+  DELETE = 2,
+  COMPARE_AND_SWAP = 3,
+  INCREMENT = 4,
+  BATCH = 5
+};
+
+/**
+ * Client command decoded from the data of a log entry. Strings are views into the
+ * encoded command, which must outlive the command.
+ *
+ * Commands are encoded as the type byte followed by,
+ * - PUT: key, value, varint ttl
+ * - DELETE: key
+ * - COMPARE_AND_SWAP: key, flags byte, expected value if flag 0x1 is set, new value if
+ *   flag 0x2 is set, varint ttl
+ * - INCREMENT: key, zigzag varint delta
+ * - BATCH: varint operation count, then each encoded operation as a string
+ * where strings are varint lengths followed by the bytes.
+ */
+struct Command {
+  CommandType type;
+  std::string_view key;
+  /**
+   * Value written by PUT and COMPARE_AND_SWAP, a COMPARE_AND_SWAP without a value
+   * deletes the key.
+   */
+  std::optional<std::string_view> value;
+  /**
+   * Value the key must have for COMPARE_AND_SWAP to succeed, nothing if the key must
+   * not exist.
+   */
+  std::optional<std::string_view> expected;
+  int64_t delta = 0;
+  /**
+   * Time to live in ms of the value written by PUT and COMPARE_AND_SWAP, measured from
+   * the time of the log entry. 0 if the value does not expire.
+   */
+  uint64_t ttl_ms = 0;
+  /**
+   * Operations of a BATCH, which cannot contain other batches.
+   */
+  std::vector<Command> operations;
+};
+
+std::string EncodePut(std::string_view key, std::string_view value, const uint64_t ttl_ms = 0);
+
+std::string EncodeDelete(std::string_view key);
+
+std::string EncodeCompareAndSwap(
+    std::string_view key,
+    std::optional<std::string_view> expected,
+    std::optional<std::string_view> value,
+    const uint64_t ttl_ms = 0);
+
+std::string EncodeIncrement(std::string_view key, const int64_t delta);
+
+/**
+ * @param operations commands encoded by the other Encode functions
+ */
+std::string EncodeBatch(const std::vector<std::string>& operations);
+
+/**
+ * Decodes a command without copying its keys or values.
+ *
+ * @param data the encoded command
+ * @returns the command, or nothing if the data is not a valid command
+ */
+std::optional<Command> DecodeCommand(std::string_view data);
+
+}
+
+#endif
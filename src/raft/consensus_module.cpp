@@ -1,77 +1,89 @@
 #include <glog/logging.h>
 
 #include "consensus_module.h"
+#include "command_codec.h"
 #include "global_ctx_manager.h"
 #include "raft_client.h"
 #include "storage.h"
 
 namespace raft {
 
-ConsensusModule::ConsensusModule(GlobalCtxManager& ctx)
+ConsensusModule::ConsensusModule(GlobalCtxManager& ctx, const int group_id, const std::string& store_directory)
   : m_ctx(ctx)
+  , m_group_id(group_id)
   , m_vote("")
   , m_votes_received(0)
+  , m_self_id(-1)
   , m_term(0)
   , m_state(RaftState::CANDIDATE)
   , m_last_applied(-1)
   , m_commit_index(-1)
+  , m_progress(MAX_CLUSTER_SIZE, PeerProgress(0))
   , m_leader_id("")
   , m_configuration(std::make_unique<ClusterConfiguration>())
   , m_timer_executor(std::make_shared<core::Strand>())
-  , m_election_timeout(std::chrono::milliseconds(ELECTION_TIMEOUT))
+  , m_election_timeout(std::chrono::milliseconds(ctx.options.election_timeout))
+  , m_base_election_timeout(ctx.options.election_timeout)
+  , m_heartbeat_interval(ctx.options.heartbeat_interval)
   , m_election_deadline(clock_type::now())
   , m_session(std::make_shared<SessionCache>(1000))
-  , m_store(std::make_shared<InmemoryStore>())
-  , m_renew_lease(false)
-  , m_lease_holder(false) {
+  , m_store(std::make_shared<InmemoryStore>(
+        MVCC_RETAINED_ENTRIES,
+        store_directory.empty() ? nullptr : std::make_shared<core::LsmTree>(store_directory)))
+  , m_lease_expiry(time_point())
+  , m_active_change(-1)
+  , m_next_change_id(0)
+  , m_transferring(false)
+  , m_term_start_index(0)
+  , m_heartbeat_round(0)
+  , m_heartbeat_pending(false)
+  , m_confirmed_round(-1)
+  , m_leader_contact()
+  , m_leader_commit_index(-1)
+  , m_forward_pending(false)
+  , m_forward_executor(std::make_shared<core::Strand>())
+  , m_last_range_check()
+  , m_range_change_index(-1)
+  , m_move_executor(std::make_shared<core::Strand>())
+  , m_move_running(false)
+  , m_clock_index(-1) {
 }
 
 void ConsensusModule::StateMachineInit() {
   // Restore raft metadata from disk if restarting node after server failure
   protocol::log::LogMetadata metadata;
-  bool ok = m_ctx.LogInstance()->Metadata(metadata);
+  bool ok = m_ctx.LogInstance(m_group_id)->Metadata(metadata);
   if (ok) {
     m_term.store(metadata.term());
     m_vote = metadata.vote();
   }
 
-  m_state_machine = std::make_unique<StateMachine>(m_session, m_store);
+  m_state_machine = std::make_unique<StateMachine>(m_session, m_store, m_group_id);
+  m_self_id = m_configuration->SelfId(m_ctx.address);
 
   protocol::log::Configuration configuration;
   int log_index;
-  std::tie(log_index, ok) = m_ctx.LogInstance()->LatestConfiguration(configuration);
+  std::tie(log_index, ok) = m_ctx.LogInstance(m_group_id)->LatestConfiguration(configuration);
   if (ok) {
     DLOG(INFO) << "Restored cluster configuration from disk with id = " << log_index;
     m_configuration->SetConfiguration(log_index, configuration);
   }
 
-  m_ctx.ClientInstance()->CreateConnections(m_configuration->ServerAddresses());
-
-  for (auto peer:m_configuration->ServerAddresses()) {
-    if (peer == m_ctx.address) {
-      continue;
-    }
-    m_next_index[peer] = 0;
-    m_match_index[peer] = -1;
-  }
+  m_ctx.ClientInstance()->CreateConnections(m_group_id, m_configuration->ServerAddresses());
 
   m_election_timer = m_ctx.TimerQueueInstance()->CreateTimer(
-      ELECTION_TIMEOUT,
+      ElectionTimeout(),
       m_timer_executor,
       std::bind(&ConsensusModule::ElectionCallback, this, Term()));
   m_heartbeat_timer = m_ctx.TimerQueueInstance()->CreateTimer(
-      HEARTBEAT_TIMEOUT,
+      HeartbeatInterval(),
       m_timer_executor,
       std::bind(&ConsensusModule::HeartbeatCallback, this));
-  m_lease_timer = m_ctx.TimerQueueInstance()->CreateTimer(
-      LEADER_LEASE_TIMEOUT,
-      m_timer_executor,
-      std::bind(&ConsensusModule::ResetToFollower, this, Term()));
 }
 
 void ConsensusModule::InitializeConfiguration() {
   if (Term() != 0 ||
-      m_ctx.LogInstance()->LastLogIndex() != -1 ||
+      m_ctx.LogInstance(m_group_id)->LastLogIndex() != -1 ||
       m_configuration->ServerAddresses().size() > 0) {
     PromoteToLeader();
     return;
@@ -94,6 +106,22 @@ int ConsensusModule::Term() const {
   return m_term.load();
 }
 
+int ConsensusModule::GroupId() const {
+  return m_group_id;
+}
+
+std::string ConsensusModule::PeerAddress(const int peer_id) const {
+  return m_configuration->PeerAddress(peer_id);
+}
+
+std::shared_ptr<InmemoryStore> ConsensusModule::Store() const {
+  return m_store;
+}
+
+int ConsensusModule::RangeGroup(std::string_view key) const {
+  return m_state_machine->Directory().GroupFor(key);
+}
+
 ConsensusModule::RaftState ConsensusModule::State() const {
   return m_state.load();
 }
@@ -114,6 +142,14 @@ std::string ConsensusModule::LeaderHint() const {
   return m_leader_id;
 }
 
+int ConsensusModule::ElectionTimeout() const {
+  return m_base_election_timeout.load();
+}
+
+int ConsensusModule::HeartbeatInterval() const {
+  return m_heartbeat_interval.load();
+}
+
 void ConsensusModule::ElectionCallback(const int term) {
   DLOG(INFO) << "Starting election";
 
@@ -133,38 +169,75 @@ void ConsensusModule::ElectionCallback(const int term) {
     return;
   }
 
+  // Learners only replicate the log and never campaign
+  if (m_configuration->IsLearner(m_self_id)) {
+    ScheduleElection(term);
+    return;
+  }
+
+  DLOG(INFO) << "Starting pre-vote for term " << term + 1;
+  m_granted_pre_votes.reset();
+  m_granted_pre_votes.set(m_self_id);
+  if (m_configuration->CheckQuorum(m_granted_pre_votes)) {
+    StartElection(term);
+    return;
+  }
+
+  BroadcastRequestVote(term + 1, true, false);
+
+  // Retry the pre-vote if a majority is not reached within time limit
+  ScheduleElection(term);
+}
+
+void ConsensusModule::StartElection(const int term, const bool leadership_transfer) {
+  if (Term() != term) {
+    DLOG(INFO) << "Term changed from " << term << " to " << Term();
+    return;
+  }
+
   m_state.store(RaftState::CANDIDATE);
   m_term++;
   int saved_term = Term();
   // Once a node becomes a CANDIDATE it votes for itself
   m_vote = m_ctx.address;
   m_votes_received = 1;
+  m_granted_votes.reset();
+  m_granted_votes.set(m_self_id);
 
   StoreState();
 
-  if (m_configuration->ServerAddresses().size() == 1 &&
-      m_configuration->KnownServer(m_ctx.address)) {
+  if (m_configuration->CheckQuorum(m_granted_votes)) {
     PromoteToLeader();
     return;
   }
 
-  int last_log_index = m_ctx.LogInstance()->LastLogIndex();
-  int last_log_term = m_ctx.LogInstance()->LastLogTerm();
-  for (auto peer_id:m_configuration->ServerAddresses()) {
-    if (peer_id == m_ctx.address) {
+  BroadcastRequestVote(saved_term, false, leadership_transfer);
+
+  // Start a new election if the node does not get a majority of votes within time limit
+  ScheduleElection(saved_term);
+}
+
+void ConsensusModule::BroadcastRequestVote(const int term, const bool pre_vote, const bool leadership_transfer) {
+  int last_log_index = m_ctx.LogInstance(m_group_id)->LastLogIndex();
+  int last_log_term = m_ctx.LogInstance(m_group_id)->LastLogTerm();
+  PeerSet voters = m_configuration->Voters();
+  for (int peer_id = 0; peer_id < MAX_CLUSTER_SIZE; peer_id++) {
+    if (!voters.test(peer_id) || peer_id == m_self_id) {
       continue;
     }
-    DLOG(INFO) << "Sending RequestVote rpc to " << peer_id;
+    auto address = m_configuration->PeerAddress(peer_id);
+    DLOG(INFO) << "Sending RequestVote rpc to " << address << (pre_vote ? " for pre-vote" : "");
 
     m_ctx.ClientInstance()->RequestVote(
+        address,
+        m_group_id,
         peer_id,
-        saved_term,
+        term,
         last_log_index,
-        last_log_term);
+        last_log_term,
+        pre_vote,
+        leadership_transfer);
   }
-
-  // Start a new election if the node does not get a majority of votes within time limit
-  ScheduleElection(saved_term);
 }
 
 void ConsensusModule::HeartbeatCallback() {
@@ -173,45 +246,72 @@ void ConsensusModule::HeartbeatCallback() {
     return;
   }
 
-  m_heartbeat_time = clock_type::now();
-  m_renew_lease.store(true);
-  m_responding_peers = {m_ctx.address};
+  if (!QuorumActive()) {
+    DLOG(INFO) << "Stepping down since a majority did not respond within the election timeout";
+    ResetToFollower(Term());
+    return;
+  }
 
-  int saved_term = Term();
-  for (auto peer_id:m_configuration->ServerAddresses()) {
-    if (peer_id == m_ctx.address) {
-      continue;
-    }
-    DLOG(INFO) << "Sending AppendEntries rpc to " << peer_id;
+  if (m_ctx.options.adaptive) {
+    std::lock_guard<std::mutex> lock(m_replication_lock);
+    AdaptTimeouts();
+  }
+
+  // Stalled membership changes and reads time out even if no replies arrive
+  AdvanceMembershipChange();
+  CompletePendingReads();
+  MaybeChangeRanges();
+  MaybeAdvanceClock();
+  // Periodic heartbeats of a node leading several groups are batched per peer, while
+  // rounds requested by reads are sent immediately
+  BroadcastHeartbeat(m_ctx.GroupCount() > 1);
+  ScheduleHeartbeat();
+}
+
+bool ConsensusModule::QuorumActive() {
+  std::lock_guard<std::mutex> lock(m_replication_lock);
+  auto contact_time = std::max(QuorumContactTime(), m_leader_start);
+  return clock_type::now() - contact_time <= milliseconds(ElectionTimeout());
+}
+
+void ConsensusModule::BroadcastHeartbeat(const bool coalesce) {
+  std::lock_guard<std::mutex> lock(m_replication_lock);
+  m_heartbeat_pending = false;
+  if (State() != RaftState::LEADER) {
+    return;
+  }
 
-    int next = m_next_index[peer_id];
-    int prev_log_index = next - 1;
-    int prev_log_term = -1;
-    if (prev_log_index >= 0) {
-      prev_log_term = m_ctx.LogInstance()->Entry(prev_log_index).term();
+  m_heartbeat_round++;
+
+  PeerSet members = m_configuration->Members();
+  for (int peer_id = 0; peer_id < MAX_CLUSTER_SIZE; peer_id++) {
+    if (!members.test(peer_id) || peer_id == m_self_id) {
+      continue;
     }
 
-    auto entries = m_ctx.LogInstance()->Entries(next, m_ctx.LogInstance()->LogSize());
-    m_ctx.ClientInstance()->AppendEntries(
-        peer_id,
-        saved_term,
-        prev_log_index,
-        prev_log_term,
-        entries,
-        CommitIndex());
+    // Every heartbeat allows one probe so a lost probe does not stall the FOLLOWER
+    auto& progress = Progress(peer_id);
+    progress.ResumeProbe();
+    SendAppendEntries(peer_id, progress, coalesce);
   }
 
-  if (m_configuration->ServerAddresses().size() == 1 && m_configuration->KnownServer(m_ctx.address)) {
+  // A single node cluster commits entries and confirms reads without waiting for replies
+  UpdateConfirmedRound();
+  PeerSet self;
+  self.set(m_self_id);
+  if (m_configuration->CheckQuorum(self)) {
+    UpdateLease();
     UpdateCommitIndex();
   }
-
-  ScheduleHeartbeat();
 }
 
 void ConsensusModule::ScheduleElection(const int term) {
   std::random_device rd; // Obtain a random number from hardware
   std::mt19937 gen(rd()); // Seed the generator
-  std::uniform_int_distribution<> distr(ELECTION_TIMEOUT, ELECTION_TIMEOUT + 150);
+  // Jitter shrinks with adaptive timeouts so it stays proportional to the timeout
+  int base_timeout = ElectionTimeout();
+  int jitter = (long)m_ctx.options.election_jitter * base_timeout / m_ctx.options.election_timeout;
+  std::uniform_int_distribution<> distr(base_timeout, base_timeout + jitter);
   int random_timeout = distr(gen);
 
   DLOG(INFO) << "Election timer created: " << random_timeout << " ms";
@@ -222,7 +322,62 @@ void ConsensusModule::ScheduleElection(const int term) {
 }
 
 void ConsensusModule::ScheduleHeartbeat() {
-  m_heartbeat_timer->Reset();
+  m_heartbeat_timer->Reset(HeartbeatInterval());
+}
+
+PeerProgress& ConsensusModule::Progress(const int peer_id) {
+  // A recycled id belongs to a new server, the progress of the previous one is dropped
+  m_tracked_peers &= ~m_configuration->TakeRecycledPeers();
+  if (!m_tracked_peers.test(peer_id)) {
+    m_progress[peer_id] = PeerProgress(m_ctx.LogInstance(m_group_id)->LogSize());
+    m_tracked_peers.set(peer_id);
+  }
+  return m_progress[peer_id];
+}
+
+void ConsensusModule::SendAppendEntries(const int peer_id, PeerProgress& progress, const bool coalesce) {
+  int prev_log_index;
+  std::vector<std::shared_ptr<const std::string>> entries;
+  if (progress.Paused()) {
+    if (progress.State() != PeerProgress::ProgressState::REPLICATE) {
+      return;
+    }
+    // Heartbeat at the match index is always accepted and does not interfere with
+    // the entries that are in flight
+    prev_log_index = progress.MatchIndex();
+  } else {
+    int next = progress.NextIndex();
+    prev_log_index = next - 1;
+
+    // Probes do not carry entries since the FOLLOWER is likely to reject them
+    if (progress.State() == PeerProgress::ProgressState::REPLICATE) {
+      int end = std::min(m_ctx.LogInstance(m_group_id)->LogSize(), next + MAX_APPEND_ENTRIES_BATCH);
+      // Entries are shared with the log rather than copied, so every FOLLOWER is sent
+      // the same serialized bytes
+      entries = m_ctx.LogInstance(m_group_id)->SerializedEntries(next, end);
+    }
+    progress.SentEntries(prev_log_index + entries.size(), entries.size());
+  }
+
+  int prev_log_term = -1;
+  if (prev_log_index >= 0) {
+    prev_log_term = m_ctx.LogInstance(m_group_id)->Entry(prev_log_index).term();
+  }
+
+  auto address = m_configuration->PeerAddress(peer_id);
+  DLOG(INFO) << "Sending AppendEntries rpc to " << address << " with " << entries.size() << " entries";
+  m_ctx.ClientInstance()->AppendEntries(
+      address,
+      m_group_id,
+      peer_id,
+      m_heartbeat_round,
+      Term(),
+      prev_log_index,
+      prev_log_term,
+      entries,
+      CommitIndex(),
+      m_ctx.options.adaptive ? ElectionTimeout() : 0,
+      coalesce);
 }
 
 void ConsensusModule::Shutdown() {
@@ -230,29 +385,43 @@ void ConsensusModule::Shutdown() {
   m_heartbeat_timer->Cancel();
 
   m_state.store(RaftState::DEAD);
+  CompletePendingReads();
   LOG(INFO) << "Node shutdown";
 }
 
 void ConsensusModule::ResetToFollower(const int term) {
   m_state.store(RaftState::FOLLOWER);
-  m_renew_lease.store(false);
-  m_lease_holder.store(false);
+  // A node stepping down within a term must not vote for a second CANDIDATE
+  if (term != Term()) {
+    m_vote = "";
+  }
   m_term.store(term);
-  m_vote = "";
   m_votes_received = 0;
   DLOG(INFO) << "Reset to follower, term: " << Term();
 
   m_heartbeat_timer->Cancel();
-  m_lease_timer->Cancel();
 
   // Since term/vote of node is modified, changes must be persisted to disk
   StoreState();
 
   // FOLLOWER will start an election if it doesn't receive heartbeat from LEADER
   ScheduleElection(term);
+
+  // Requests waiting on the LEADER are woken up so they can be redirected
+  {
+    std::lock_guard<std::mutex> lock(m_apply_lock);
+    m_apply_sync.notify_all();
+  }
+  CompletePendingReads();
+  m_transfer_sync.notify_all();
+
+  // Membership changes started as LEADER can no longer complete
+  AdvanceMembershipChange();
 }
 
 void ConsensusModule::PromoteToLeader() {
+  // The NO_OP entry appended below is the first entry of the term
+  m_term_start_index.store(m_ctx.LogInstance(m_group_id)->LogSize());
   m_state.store(RaftState::LEADER);
   m_votes_received = 0;
   m_leader_id = m_ctx.address;
@@ -260,6 +429,15 @@ void ConsensusModule::PromoteToLeader() {
 
   m_election_timer->Cancel();
 
+  // Progress from a previous term is stale, FOLLOWERs are probed starting from the end of the log
+  {
+    std::lock_guard<std::mutex> lock(m_replication_lock);
+    m_tracked_peers.reset();
+    m_heartbeat_pending = false;
+  }
+  m_lease_expiry.store(time_point());
+  m_leader_start = clock_type::now();
+
   protocol::log::LogEntry noop_entry;
   noop_entry.set_term(Term());
   noop_entry.set_type(protocol::log::NO_OP);
@@ -270,73 +448,97 @@ void ConsensusModule::PromoteToLeader() {
 
 void ConsensusModule::InjectTimers(
     std::shared_ptr<core::DeadlineTimer> election_timer,
-    std::shared_ptr<core::DeadlineTimer> heartbeat_timer,
-    std::shared_ptr<core::DeadlineTimer> lease_timer) {
+    std::shared_ptr<core::DeadlineTimer> heartbeat_timer) {
   m_election_timer = election_timer;
   m_heartbeat_timer = heartbeat_timer;
-  m_lease_timer = lease_timer;
+}
+
+bool ConsensusModule::LeaseHolder() const {
+  return State() == RaftState::LEADER && clock_type::now() < m_lease_expiry.load();
 }
 
 void ConsensusModule::StoreState() const {
   protocol::log::LogMetadata metadata;
   metadata.set_term(Term());
   metadata.set_vote(m_vote);
-  m_ctx.LogInstance()->SetMetadata(metadata);
+  m_ctx.LogInstance(m_group_id)->SetMetadata(metadata);
   DLOG(INFO) << "Persisted metadata to disk, term = " << Term() << " vote = " << m_vote;
 }
 
 int ConsensusModule::Append(protocol::log::LogEntry& log_entry) {
-  int log_index = m_ctx.LogInstance()->Append(log_entry);
+  std::lock_guard<std::mutex> lock(m_append_lock);
+  return AppendLocked(log_entry);
+}
+
+int ConsensusModule::AppendInTerm(protocol::log::LogEntry& log_entry, const int term) {
+  std::lock_guard<std::mutex> lock(m_append_lock);
+  if (State() != RaftState::LEADER || Term() != term) {
+    return -1;
+  }
+  return AppendLocked(log_entry);
+}
+
+int ConsensusModule::AppendLocked(protocol::log::LogEntry& log_entry) {
+  log_entry.set_timestamp(std::chrono::duration_cast<milliseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count());
+  int log_index = m_ctx.LogInstance(m_group_id)->Append(log_entry);
   if (log_entry.has_configuration()) {
     m_configuration->InsertNewConfiguration(log_index, log_entry.configuration());
-    m_ctx.ClientInstance()->CreateConnections(m_configuration->ServerAddresses());
+    m_ctx.ClientInstance()->CreateConnections(m_group_id, m_configuration->ServerAddresses());
   }
   return log_index;
 }
 
-std::pair<int, int> ConsensusModule::Append(std::vector<protocol::log::LogEntry>& log_entries) {
-  auto [log_start, log_end] = m_ctx.LogInstance()->Append(log_entries);
+std::pair<int, int> ConsensusModule::Append(
+    std::vector<protocol::log::LogEntry>& log_entries,
+    const std::vector<std::shared_ptr<const std::string>>& serialized_entries) {
+  std::lock_guard<std::mutex> lock(m_append_lock);
+  auto [log_start, log_end] = m_ctx.LogInstance(m_group_id)->Append(log_entries, serialized_entries);
   for (int i = 0; i < log_entries.size(); i++) {
     if (log_entries[i].has_configuration()) {
       int log_index = log_start + i;
       m_configuration->InsertNewConfiguration(log_index, log_entries[i].configuration());
-    m_ctx.ClientInstance()->CreateConnections(m_configuration->ServerAddresses());
+      m_ctx.ClientInstance()->CreateConnections(m_group_id, m_configuration->ServerAddresses());
     }
   }
   return {log_start, log_end};
 }
 
-void ConsensusModule::CommitEntries(int start_index, std::vector<protocol::log::LogEntry>& log_entries) {
-  for (int i = 0; i < log_entries.size(); i++) {
-    switch (log_entries[i].type()) {
-      case protocol::log::LogOpCode::NO_OP: {
-        break;
-      }
-      case protocol::log::LogOpCode::DATA: {
-        m_write_command_sync.notify_one();
-        break;
-      }
-      case protocol::log::LogOpCode::REGISTER_CLIENT: {
-        m_session_sync.notify_one();
-        break;
-      }
-      default: {
-      }
-    }
+void ConsensusModule::ApplyCommittedEntries() {
+  std::lock_guard<std::mutex> lock(m_apply_lock);
+  int last_applied = m_state_machine->LastApplied();
+  int commit_index = CommitIndex();
+  if (last_applied >= commit_index) {
+    return;
+  }
+
+  auto committed_entries = m_ctx.LogInstance(m_group_id)->Entries(last_applied + 1, commit_index + 1);
+  for (int i = 0; i < committed_entries.size(); i++) {
+    m_state_machine->ApplyCommand(last_applied + i + 1, committed_entries[i]);
   }
+  DLOG(INFO) << "Applied log entries up to index = " << commit_index;
+  {
+    // Committed configurations are never truncated, so older ones no longer pin peer ids
+    std::lock_guard<std::mutex> append_lock(m_append_lock);
+    m_configuration->Compact(commit_index);
+  }
+
+  m_apply_sync.notify_all();
 }
 
 void ConsensusModule::UpdateCommitIndex() {
   int saved_commit_index = CommitIndex();
-  int log_size = m_ctx.LogInstance()->LogSize();
-  auto log_entries = m_ctx.LogInstance()->Entries(saved_commit_index + 1, log_size);
+  int log_size = m_ctx.LogInstance(m_group_id)->LogSize();
+  auto log_entries = m_ctx.LogInstance(m_group_id)->Entries(saved_commit_index + 1, log_size);
   int new_commit_index = saved_commit_index;
+  PeerSet members = m_configuration->Members();
   for (int i = saved_commit_index + 1; i < log_size; i++) {
     if (log_entries[i - saved_commit_index - 1].term() == Term()) {
-      std::unordered_set<std::string> match_peers = {m_ctx.address};
-      for (auto peer:m_configuration->ServerAddresses()) {
-        if (m_match_index[peer] >= i) {
-          match_peers.insert(peer);
+      PeerSet match_peers;
+      match_peers.set(m_self_id);
+      for (int peer_id = 0; peer_id < MAX_CLUSTER_SIZE; peer_id++) {
+        if (members.test(peer_id) && peer_id != m_self_id && Progress(peer_id).MatchIndex() >= i) {
+          match_peers.set(peer_id);
         }
       }
 
@@ -351,22 +553,11 @@ void ConsensusModule::UpdateCommitIndex() {
     m_commit_index.store(new_commit_index);
     DLOG(INFO) << "Leader set commit_index = " << new_commit_index;
 
-    int next_log_index = m_state_machine->LastApplied();
-    std::vector<protocol::log::LogEntry> uncommited_entries;
-    while (next_log_index < new_commit_index) {
-      next_log_index++;
-
-      auto uncommited_entry = m_ctx.LogInstance()->Entry(next_log_index);
-      uncommited_entries.push_back(uncommited_entry);
-    }
-
-    CommitEntries(saved_commit_index, uncommited_entries);
+    ApplyCommittedEntries();
   }
 
   if (CommitIndex() >= m_configuration->Id()) {
-    m_membership_sync.notify_one();
-
-    if (!m_configuration->KnownServer(m_ctx.address)) {
+    if (!m_configuration->Voters().test(m_self_id)) {
       DLOG(INFO) << "Committed configuration does not include LEADER, resetting to FOLLOWER...";
       ResetToFollower(Term() + 1);
       return;
@@ -379,8 +570,433 @@ void ConsensusModule::UpdateCommitIndex() {
       entry.set_type(protocol::log::CONFIGURATION);
       *entry.mutable_configuration()->mutable_prev_configuration() =
         m_configuration->Configuration().next_configuration();
+      *entry.mutable_configuration()->mutable_learners() =
+        m_configuration->Configuration().learners();
       Append(entry);
     }
+    AdvanceMembershipChange();
+  }
+}
+
+std::tuple<int, grpc::Status> ConsensusModule::ForwardReadIndex() {
+  std::string leader_id = LeaderHint();
+  if (leader_id == "" || leader_id == m_ctx.address) {
+    grpc::Status err = ConstructError("Peer does not know the leader", protocol::raft::Error::Code::Error_Code_NOT_LEADER);
+    return std::make_tuple(-1, err);
+  }
+
+  protocol::raft::ReadIndex_Response reply;
+  grpc::Status status = m_ctx.ClientInstance()->ReadIndex(leader_id, m_group_id, reply);
+  if (!status.ok()) {
+    DLOG(INFO) << "Unable to obtain read index from " << leader_id << ": " << status.error_message();
+    return std::make_tuple(-1, status);
+  }
+  return std::make_tuple(reply.readindex(), grpc::Status::OK);
+}
+
+std::tuple<int, grpc::Status> ConsensusModule::LeaseReadIndex() {
+  if (State() != RaftState::LEADER) {
+    grpc::Status err = ConstructError("Peer is not a leader", protocol::raft::Error::Code::Error_Code_NOT_LEADER);
+    return std::make_tuple(-1, err);
+  }
+  if (!LeaseHolder()) {
+    grpc::Status err = ConstructError("Leader does not own lease to serve reads", protocol::raft::Error::Code::Error_Code_LEASE_EXPIRED);
+    return std::make_tuple(-1, err);
+  }
+  if (CommitIndex() < m_term_start_index.load()) {
+    grpc::Status err = ConstructError("Leader has not committed an entry in its term", protocol::raft::Error::Code::Error_Code_RETRY);
+    return std::make_tuple(-1, err);
+  }
+  return std::make_tuple(CommitIndex(), grpc::Status::OK);
+}
+
+std::tuple<int, ConsensusModule::time_point, grpc::Status> ConsensusModule::StaleReadIndex(milliseconds max_staleness) {
+  time_point contact_time;
+  int read_index;
+  if (State() == RaftState::LEADER) {
+    std::lock_guard<std::mutex> lock(m_replication_lock);
+    contact_time = QuorumContactTime();
+    read_index = CommitIndex();
+  } else {
+    std::lock_guard<std::mutex> lock(m_apply_lock);
+    contact_time = m_leader_contact;
+    read_index = m_leader_commit_index;
+  }
+
+  time_point deadline = contact_time + max_staleness;
+  if (deadline < clock_type::now()) {
+    grpc::Status err = ConstructError("Peer has not contacted the leader within the staleness bound",
+        protocol::raft::Error::Code::Error_Code_OUT_OF_DATE);
+    return std::make_tuple(-1, deadline, err);
+  }
+  return std::make_tuple(read_index, deadline, grpc::Status::OK);
+}
+
+void ConsensusModule::UpdateLease() {
+  auto lease_expiry = QuorumContactTime() + milliseconds(m_ctx.options.lease_timeout);
+  if (lease_expiry > m_lease_expiry.load()) {
+    m_lease_expiry.store(lease_expiry);
+  }
+}
+
+void ConsensusModule::MaybeChangeRanges() {
+  auto now = clock_type::now();
+  // A finished move appends its RANGE_MOVE_DONE before clearing m_move_running
+  if (now - m_last_range_check < milliseconds(RANGE_CHECK_INTERVAL) || m_move_running.load() ||
+      m_state_machine->LastApplied() < m_range_change_index.load() || m_transferring.load()) {
+    return;
+  }
+  m_last_range_check = now;
+
+  auto moves = m_state_machine->OutgoingMoves();
+  if (!moves.empty()) {
+    m_move_running.store(true);
+    m_move_executor->Enqueue(std::bind(&ConsensusModule::MoveRange, this, moves.front()));
+    return;
+  }
+
+  auto range_entry = m_range_policy.Evaluate(*m_store, now);
+  if (!range_entry.has_value() && m_ctx.GroupCount() > 1) {
+    std::vector<std::shared_ptr<InmemoryStore>> group_stores;
+    for (int group_id = 0; group_id < m_ctx.GroupCount(); group_id++) {
+      group_stores.push_back(m_ctx.ConsensusInstance(group_id)->Store());
+    }
+    range_entry = m_range_policy.Rebalance(m_state_machine->Directory(), m_group_id, group_stores, now);
+  }
+  if (!range_entry.has_value()) {
+    return;
+  }
+  range_entry->set_term(Term());
+  m_range_change_index.store(Append(range_entry.value()));
+  DLOG(INFO) << "Appended " << protocol::log::LogOpCode_Name(range_entry->type())
+    << " at key = " << (range_entry->has_move() ? range_entry->move().startkey() : range_entry->range().key())
+    << " with index = " << m_range_change_index.load();
+}
+
+void ConsensusModule::MoveRange(protocol::log::RangeMove move) {
+  int saved_term = Term();
+  // The values no longer change once the move out is applied, so a resumed move sends
+  // the same values again
+  protocol::log::RangeMove chunk;
+  chunk.set_startkey(move.startkey());
+  chunk.set_endkey(move.endkey());
+  chunk.set_groupid(move.groupid());
+  size_t chunk_bytes = 0;
+  std::string next_key = move.startkey();
+  grpc::Status status;
+  while (status.ok()) {
+    auto entries = m_store->Export(next_key, move.endkey(), RANGE_MOVE_PAGE);
+    for (auto& [key, value]:entries) {
+      auto moved_value = chunk.add_values();
+      moved_value->set_key(key);
+      moved_value->set_value(value.data);
+      moved_value->set_expiresat(value.expires_at);
+      chunk_bytes += key.size() + value.data.size();
+      if (chunk_bytes >= RANGE_MOVE_CHUNK_BYTES) {
+        status = SendRangeMove(move.groupid(), protocol::log::LogOpCode::RANGE_MOVE_IN, chunk);
+        chunk.clear_values();
+        chunk_bytes = 0;
+        if (!status.ok()) {
+          break;
+        }
+      }
+    }
+    if (entries.size() < RANGE_MOVE_PAGE) {
+      break;
+    }
+    next_key = entries.back().first + '\0';
+  }
+
+  if (status.ok()) {
+    chunk.set_last(true);
+    status = SendRangeMove(move.groupid(), protocol::log::LogOpCode::RANGE_MOVE_IN, chunk);
+  }
+  if (status.ok()) {
+    chunk.clear_values();
+    status = SendRangeMove(0, protocol::log::LogOpCode::RANGE_ASSIGN, chunk);
+  }
+
+  if (!status.ok()) {
+    LOG(WARNING) << "Failed to move range at key = " << move.startkey() << " to group "
+      << move.groupid() << ": " << status.error_message();
+  } else {
+    protocol::log::LogEntry done_entry;
+    done_entry.set_term(saved_term);
+    done_entry.set_type(protocol::log::LogOpCode::RANGE_MOVE_DONE);
+    *done_entry.mutable_move() = move;
+    // A new LEADER resumes the move if this node stepped down meanwhile
+    int done_index = AppendInTerm(done_entry, saved_term);
+    if (done_index >= 0) {
+      m_range_change_index.store(done_index);
+      DLOG(INFO) << "Moved range at key = " << move.startkey() << " to group " << move.groupid();
+    }
+  }
+  m_move_running.store(false);
+}
+
+grpc::Status ConsensusModule::SendRangeMove(
+    const int group_id,
+    protocol::log::LogOpCode type,
+    const protocol::log::RangeMove& move) {
+  protocol::raft::ApplyRangeMove_Request request;
+  request.set_groupid(group_id);
+  request.set_type(type);
+  *request.mutable_move() = move;
+
+  auto consensus = m_ctx.ConsensusInstance(group_id);
+  if (!consensus) {
+    return grpc::Status(grpc::StatusCode::NOT_FOUND, "Group " + std::to_string(group_id) + " is not hosted");
+  }
+  if (consensus->State() == RaftState::LEADER) {
+    return std::get<1>(consensus->ProcessApplyRangeMoveClientRequest(request));
+  }
+
+  std::string leader_id = consensus->LeaderHint();
+  if (leader_id == "" || leader_id == m_ctx.address) {
+    return ConstructError("Peer does not know the leader of group " + std::to_string(group_id),
+        protocol::raft::Error::Code::Error_Code_NOT_LEADER);
+  }
+  protocol::raft::ApplyRangeMove_Response reply;
+  return m_ctx.ClientInstance()->ApplyRangeMove(leader_id, request, reply);
+}
+
+grpc::Status ConsensusModule::WrongGroupError(std::string_view key) const {
+  int group_id = m_ctx.ConsensusInstance(0)->RangeGroup(key);
+  if (group_id == m_group_id) {
+    return ConstructError("Range is moving to the group", protocol::raft::Error::Code::Error_Code_RETRY);
+  }
+
+  protocol::raft::Error err_details;
+  err_details.set_statuscode(protocol::raft::Error::Code::Error_Code_WRONG_GROUP);
+  err_details.set_grouphint(group_id);
+  return grpc::Status(grpc::StatusCode::UNKNOWN, "Key is served by group " + std::to_string(group_id),
+      err_details.SerializeAsString());
+}
+
+void ConsensusModule::MaybeAdvanceClock() {
+  auto next_expiry = m_store->NextExpiry();
+  if (!next_expiry.has_value() || m_state_machine->LastApplied() < m_clock_index) {
+    return;
+  }
+  int64_t now = std::chrono::duration_cast<milliseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+  // Time only advances while entries are applied, so keys expire once an entry at or
+  // after their expiry time is applied
+  if (now < next_expiry.value() || m_store->Time() >= next_expiry.value()) {
+    return;
+  }
+
+  protocol::log::LogEntry noop_entry;
+  noop_entry.set_term(Term());
+  noop_entry.set_type(protocol::log::NO_OP);
+  m_clock_index = Append(noop_entry);
+  DLOG(INFO) << "Appended NO_OP to expire keys with index = " << m_clock_index;
+}
+
+void ConsensusModule::AdaptTimeouts() {
+  // The slowest voter bounds the timeout since any of them may be needed for a quorum
+  PeerSet voters = m_configuration->Voters();
+  PeerProgress::microseconds rtt(0);
+  for (int peer_id = 0; peer_id < MAX_CLUSTER_SIZE; peer_id++) {
+    if (!voters.test(peer_id) || peer_id == m_self_id || !m_tracked_peers.test(peer_id)) {
+      continue;
+    }
+    rtt = std::max(rtt, m_progress[peer_id].RttPercentile(0.99));
+  }
+  if (rtt.count() == 0) {
+    return;
+  }
+
+  auto& options = m_ctx.options;
+  int rtt_ms = std::chrono::ceil<milliseconds>(rtt).count();
+  int election_timeout = std::clamp(rtt_ms * options.rtt_multiplier,
+      options.min_election_timeout,
+      options.election_timeout);
+  int heartbeat_interval = std::max(1,
+      (int)((long)election_timeout * options.heartbeat_interval / options.election_timeout));
+
+  if (election_timeout != ElectionTimeout()) {
+    DLOG(INFO) << "Adapting to p99 round trip time of " << rtt.count() << " us: election timeout = "
+      << election_timeout << " ms heartbeat interval = " << heartbeat_interval << " ms";
+  }
+  m_base_election_timeout.store(election_timeout);
+  m_heartbeat_interval.store(heartbeat_interval);
+}
+
+void ConsensusModule::AdoptElectionTimeout(const int election_timeout) {
+  if (!m_ctx.options.adaptive || election_timeout <= 0) {
+    return;
+  }
+  m_base_election_timeout.store(std::clamp(election_timeout,
+      m_ctx.options.min_election_timeout,
+      m_ctx.options.election_timeout));
+}
+
+ConsensusModule::time_point ConsensusModule::QuorumContactTime() {
+  PeerSet members = m_configuration->Members();
+  auto now = clock_type::now();
+
+  // The LEADER is always in contact with itself
+  std::vector<time_point> contact_times = {now};
+  for (int peer_id = 0; peer_id < MAX_CLUSTER_SIZE; peer_id++) {
+    if (members.test(peer_id) && peer_id != m_self_id) {
+      contact_times.push_back(Progress(peer_id).LastContact());
+    }
+  }
+  std::sort(contact_times.begin(), contact_times.end(), std::greater<time_point>());
+
+  for (auto contact_time:contact_times) {
+    PeerSet contacted_peers;
+    contacted_peers.set(m_self_id);
+    for (int peer_id = 0; peer_id < MAX_CLUSTER_SIZE; peer_id++) {
+      if (members.test(peer_id) && peer_id != m_self_id && Progress(peer_id).LastContact() >= contact_time) {
+        contacted_peers.set(peer_id);
+      }
+    }
+
+    if (m_configuration->CheckQuorum(contacted_peers)) {
+      return contact_time;
+    }
+  }
+  return time_point();
+}
+
+void ConsensusModule::ReadIndexAsync(read_callback callback) {
+  if (State() != RaftState::LEADER) {
+    bool send;
+    {
+      std::lock_guard<std::mutex> lock(m_read_lock);
+      m_forwarded_reads.push_back(std::move(callback));
+      send = !m_forward_pending;
+      m_forward_pending = true;
+    }
+    if (send) {
+      m_forward_executor->Enqueue(std::bind(&ConsensusModule::ForwardPendingReads, this));
+    }
+    return;
+  }
+
+  int saved_term = Term();
+  // Entries from previous terms are only known to be committed once the LEADER commits
+  // an entry from its own term, so the read must also wait for that entry to be applied
+  int read_index = std::max(CommitIndex(), m_term_start_index.load());
+
+  std::lock_guard<std::mutex> replication_lock(m_replication_lock);
+  int round = RequestHeartbeatRound();
+  {
+    // Checked under m_read_lock so a LEADER stepping down afterwards fails the read
+    std::lock_guard<std::mutex> lock(m_read_lock);
+    if (State() == RaftState::LEADER) {
+      m_pending_reads.push_back({round, saved_term, read_index, clock_type::now() + m_election_timeout, std::move(callback)});
+      return;
+    }
+  }
+  callback(-1, ConstructError("Peer is not a leader", protocol::raft::Error::Code::Error_Code_NOT_LEADER));
+}
+
+std::tuple<int, grpc::Status> ConsensusModule::ReadIndex() {
+  std::promise<std::tuple<int, grpc::Status>> result;
+  ReadIndexAsync([&result](const int read_index, grpc::Status status) {
+    result.set_value(std::make_tuple(read_index, status));
+  });
+  return result.get_future().get();
+}
+
+void ConsensusModule::ForwardPendingReads() {
+  while (true) {
+    std::vector<read_callback> reads;
+    {
+      std::lock_guard<std::mutex> lock(m_read_lock);
+      if (m_forwarded_reads.empty()) {
+        m_forward_pending = false;
+        return;
+      }
+      reads.swap(m_forwarded_reads);
+    }
+
+    // Reads queued while the RPC is in flight may have arrived after the LEADER chose
+    // the read index, so they wait for the next RPC
+    auto [read_index, status] = ForwardReadIndex();
+    for (auto& callback:reads) {
+      callback(read_index, status);
+    }
+  }
+}
+
+void ConsensusModule::CompletePendingReads() {
+  std::vector<std::tuple<read_callback, int, grpc::Status>> completed;
+  {
+    std::lock_guard<std::mutex> lock(m_read_lock);
+    if (m_pending_reads.empty()) {
+      return;
+    }
+
+    auto now = clock_type::now();
+    std::vector<PendingRead> waiting;
+    for (auto& read:m_pending_reads) {
+      if (Term() != read.term || State() != RaftState::LEADER) {
+        grpc::Status err = ConstructError("Peer is not a leader", protocol::raft::Error::Code::Error_Code_NOT_LEADER);
+        completed.emplace_back(std::move(read.callback), -1, err);
+      } else if (m_confirmed_round.load() >= read.round) {
+        DLOG(INFO) << "Leadership confirmed in heartbeat round " << read.round << " for read index = " << read.read_index;
+        completed.emplace_back(std::move(read.callback), read.read_index, grpc::Status::OK);
+      } else if (now > read.deadline) {
+        grpc::Status err = ConstructError("Leader unable to contact a majority", protocol::raft::Error::Code::Error_Code_TIMEOUT);
+        completed.emplace_back(std::move(read.callback), -1, err);
+      } else {
+        waiting.push_back(std::move(read));
+      }
+    }
+    m_pending_reads = std::move(waiting);
+  }
+
+  for (auto& [callback, read_index, status]:completed) {
+    callback(read_index, status);
+  }
+}
+
+int ConsensusModule::RequestHeartbeatRound() {
+  // Reads arriving before the queued broadcast is sent share its round
+  if (!m_heartbeat_pending) {
+    m_heartbeat_pending = true;
+    m_timer_executor->Enqueue(std::bind(&ConsensusModule::BroadcastHeartbeat, this, false));
+  }
+  return m_heartbeat_round + 1;
+}
+
+void ConsensusModule::UpdateConfirmedRound() {
+  PeerSet members = m_configuration->Members();
+
+  // The LEADER acknowledges every round it starts
+  std::vector<int> acked_rounds = {m_heartbeat_round};
+  for (int peer_id = 0; peer_id < MAX_CLUSTER_SIZE; peer_id++) {
+    if (members.test(peer_id) && peer_id != m_self_id) {
+      acked_rounds.push_back(Progress(peer_id).AckedRound());
+    }
+  }
+  std::sort(acked_rounds.begin(), acked_rounds.end(), std::greater<int>());
+
+  for (auto round:acked_rounds) {
+    if (round <= m_confirmed_round.load()) {
+      return;
+    }
+
+    PeerSet acked_peers;
+    acked_peers.set(m_self_id);
+    for (int peer_id = 0; peer_id < MAX_CLUSTER_SIZE; peer_id++) {
+      if (members.test(peer_id) && peer_id != m_self_id && Progress(peer_id).AckedRound() >= round) {
+        acked_peers.set(peer_id);
+      }
+    }
+
+    if (m_configuration->CheckQuorum(acked_peers)) {
+      {
+        std::lock_guard<std::mutex> lock(m_read_lock);
+        m_confirmed_round.store(round);
+      }
+      CompletePendingReads();
+      return;
+    }
   }
 }
 
@@ -401,27 +1017,38 @@ std::tuple<protocol::raft::RequestVote_Response, grpc::Status> ConsensusModule::
     return std::make_tuple(reply, grpc::Status::CANCELLED);
   }
 
-  if (clock_type::now() <= m_election_deadline || State() == RaftState::LEADER) {
+  // CANDIDATEs asked by the LEADER to take over are not disrupting a healthy LEADER
+  if ((clock_type::now() <= m_election_deadline && !request.leadershiptransfer()) ||
+      State() == RaftState::LEADER) {
     DLOG(INFO) << "Rejecting RequestVote RPC from " << request.candidateid() << " since this node recently received a heartbeat";
     reply.set_votegranted(false);
     reply.set_term(Term());
     return std::make_tuple(reply, grpc::Status::OK);
   }
 
+  auto last_log_index = m_ctx.LogInstance(m_group_id)->LastLogIndex();
+  auto last_log_term = m_ctx.LogInstance(m_group_id)->LastLogTerm();
+  bool log_up_to_date = request.lastlogterm() > last_log_term ||
+      (request.lastlogterm() == last_log_term && request.lastlogindex() >= last_log_index);
+
+  // Pre-votes are granted to CANDIDATEs that could win the election without modifying
+  // the term or vote of this node
+  if (request.prevote()) {
+    reply.set_votegranted(request.term() > Term() && log_up_to_date);
+    reply.set_term(Term());
+    return std::make_tuple(reply, grpc::Status::OK);
+  }
+
   if (request.term() > Term()) {
     DLOG(INFO) << "Term out of date in RequestVote RPC, changed from " << Term() << " to " << request.term();
     ResetToFollower(request.term());
   }
 
-  auto last_log_index = m_ctx.LogInstance()->LastLogIndex();
-  auto last_log_term = m_ctx.LogInstance()->LastLogTerm();
-
   // Vote can only be granted if node hasn't voted for a different node and entries in raft log
   // must be valid
   if (request.term() == Term() &&
       (m_vote == "" || m_vote == request.candidateid()) &&
-      (request.lastlogterm() > last_log_term ||
-      (request.lastlogterm() == last_log_term && request.lastlogindex() >= last_log_index))) {
+      log_up_to_date) {
     reply.set_votegranted(true);
     m_vote = request.candidateid();
     StoreState();
@@ -438,9 +1065,14 @@ std::tuple<protocol::raft::RequestVote_Response, grpc::Status> ConsensusModule::
 void ConsensusModule::ProcessRequestVoteServerResponse(
     protocol::raft::RequestVote_Request& request,
     protocol::raft::RequestVote_Response& reply,
-    const std::string& address) {
-  if (State() != RaftState::CANDIDATE) {
-    DLOG(INFO) << "Node changed state while waiting for RequestVote reply";
+    const int peer_id) {
+  if (request.prevote()) {
+    ProcessPreVoteServerResponse(request, reply, peer_id);
+    return;
+  }
+
+  if (State() != RaftState::CANDIDATE) {
+    DLOG(INFO) << "Node changed state while waiting for RequestVote reply";
     return;
   }
 
@@ -451,9 +1083,10 @@ void ConsensusModule::ProcessRequestVoteServerResponse(
   } else if (reply.term() == request.term()) {
     if (reply.votegranted()) {
       m_votes_received++;
+      m_granted_votes.set(peer_id);
 
       // If CANDIDATE receives majority of votes it becomes the new leader
-      if (m_votes_received*2 > m_configuration->ServerAddresses().size()) {
+      if (m_configuration->CheckQuorum(m_granted_votes)) {
         DLOG(INFO) << "Wins election with " << m_votes_received << " votes";
         PromoteToLeader();
         return;
@@ -462,6 +1095,32 @@ void ConsensusModule::ProcessRequestVoteServerResponse(
   }
 }
 
+void ConsensusModule::ProcessPreVoteServerResponse(
+    protocol::raft::RequestVote_Request& request,
+    protocol::raft::RequestVote_Response& reply,
+    const int peer_id) {
+  // Replies from an earlier pre-vote are ignored once the node starts an election
+  if ((State() != RaftState::FOLLOWER && State() != RaftState::CANDIDATE) ||
+      request.term() != Term() + 1) {
+    DLOG(INFO) << "Node changed state while waiting for pre-vote reply";
+    return;
+  }
+
+  if (reply.term() > Term()) {
+    DLOG(INFO) << "Term out of date in pre-vote reply, changed from " << Term() << " to " << reply.term();
+    ResetToFollower(reply.term());
+    return;
+  }
+
+  if (reply.votegranted()) {
+    m_granted_pre_votes.set(peer_id);
+    if (m_configuration->CheckQuorum(m_granted_pre_votes)) {
+      DLOG(INFO) << "Wins pre-vote, starting election for term " << request.term();
+      StartElection(Term());
+    }
+  }
+}
+
 std::tuple<protocol::raft::AppendEntries_Response, grpc::Status> ConsensusModule::ProcessAppendEntriesClientRequest(
     protocol::raft::AppendEntries_Request& request) {
   protocol::raft::AppendEntries_Response reply;
@@ -477,6 +1136,7 @@ std::tuple<protocol::raft::AppendEntries_Response, grpc::Status> ConsensusModule
 
   bool success = false;
   if (request.term() == Term()) {
+    AdoptElectionTimeout(request.electiontimeoutms());
     if (State() != RaftState::FOLLOWER) {
       ResetToFollower(request.term());
     } else {
@@ -486,54 +1146,67 @@ std::tuple<protocol::raft::AppendEntries_Response, grpc::Status> ConsensusModule
 
     // Verify that the two logs agree at prevLogIndex
     if (request.prevlogindex() == -1 ||
-        (request.prevlogindex() < m_ctx.LogInstance()->LogSize() &&
-         request.prevlogterm() == m_ctx.LogInstance()->Entry(request.prevlogindex()).term())) {
+        (request.prevlogindex() < m_ctx.LogInstance(m_group_id)->LogSize() &&
+         request.prevlogterm() == m_ctx.LogInstance(m_group_id)->Entry(request.prevlogindex()).term())) {
       success = true;
       m_leader_id = request.leaderid();
 
+      std::vector<protocol::log::LogEntry> request_entries(request.entries().size());
+      for (int i = 0; i < request.entries().size(); i++) {
+        if (!request_entries[i].ParseFromString(request.entries()[i])) {
+          LOG(ERROR) << "Unable to parse log entry in AppendEntries RPC at index = " << request.prevlogindex() + i + 1;
+          reply.set_term(Term());
+          reply.set_success(false);
+          return std::make_tuple(reply, grpc::Status::OK);
+        }
+      }
+
       int log_insert_index = request.prevlogindex() + 1;
       int new_entries_index = 0;
 
-      while (log_insert_index < m_ctx.LogInstance()->LogSize() &&
-          new_entries_index < request.entries().size()) {
-        if (m_ctx.LogInstance()->Entry(log_insert_index).term() == request.entries()[new_entries_index].term()) {
+      while (log_insert_index < m_ctx.LogInstance(m_group_id)->LogSize() &&
+          new_entries_index < request_entries.size()) {
+        if (m_ctx.LogInstance(m_group_id)->Entry(log_insert_index).term() == request_entries[new_entries_index].term()) {
           log_insert_index++;
           new_entries_index++;
         } else {
           // If the two logs do not agree at an index, N, all indices >= N are deleted
-          m_ctx.LogInstance()->TruncateSuffix(log_insert_index);
+          std::lock_guard<std::mutex> lock(m_append_lock);
+          m_ctx.LogInstance(m_group_id)->TruncateSuffix(log_insert_index);
           m_configuration->TruncateSuffix(log_insert_index);
           break;
         }
       }
 
       // Append entries from the request that have not been replicated to the raft log
-      if (new_entries_index < request.entries().size()) {
-        std::vector<protocol::log::LogEntry> new_entries(request.entries().begin() + new_entries_index, request.entries().end());
-        Append(new_entries);
+      if (new_entries_index < request_entries.size()) {
+        std::vector<protocol::log::LogEntry> new_entries(
+            std::make_move_iterator(request_entries.begin() + new_entries_index),
+            std::make_move_iterator(request_entries.end()));
+        // The received bytes are stored as is instead of serializing the parsed entries again
+        std::vector<std::shared_ptr<const std::string>> serialized_entries;
+        for (int i = new_entries_index; i < request.entries().size(); i++) {
+          serialized_entries.push_back(std::make_shared<const std::string>(
+              std::move(*request.mutable_entries(i))));
+        }
+        Append(new_entries, serialized_entries);
       }
 
       // Commits log entries that have been committed by the LEADER
-      if (request.leadercommit() > CommitIndex()) {
-        int saved_commit_index = CommitIndex();
-        int new_commit_index = std::min((int)request.leadercommit(), m_ctx.LogInstance()->LogSize());
+      // Only entries known to match the LEADER's log can be committed
+      int last_new_index = request.prevlogindex() + request.entries().size();
+      int new_commit_index = std::min((int)request.leadercommit(), last_new_index);
+      if (new_commit_index > CommitIndex()) {
         m_commit_index.store(new_commit_index);
         DLOG(INFO) << "Setting commit index = " << new_commit_index;
 
-        int next_log_index = m_state_machine->LastApplied();
-        std::vector<protocol::log::LogEntry> uncommited_entries;
-        while (next_log_index < new_commit_index) {
-          next_log_index++;
-          auto uncommited_entry = m_ctx.LogInstance()->Entry(next_log_index);
-          uncommited_entries.push_back(uncommited_entry);
-        }
-
-        CommitEntries(saved_commit_index, uncommited_entries);
-
-        for (int i = 0; i < uncommited_entries.size(); i++) {
-          m_state_machine->ApplyCommand(saved_commit_index + i, uncommited_entries[i]);
-        }
+        ApplyCommittedEntries();
       }
+
+      // Local reads are as fresh as this contact once the LEADER's commit index is applied
+      std::lock_guard<std::mutex> lock(m_apply_lock);
+      m_leader_contact = clock_type::now();
+      m_leader_commit_index = request.leadercommit();
     }
   }
 
@@ -543,13 +1216,16 @@ std::tuple<protocol::raft::AppendEntries_Response, grpc::Status> ConsensusModule
 
   reply.set_term(Term());
   reply.set_success(success);
+  reply.set_lastlogindex(m_ctx.LogInstance(m_group_id)->LastLogIndex());
   return std::make_tuple(reply, grpc::Status::OK);
 }
 
 void ConsensusModule::ProcessAppendEntriesServerResponse(
     protocol::raft::AppendEntries_Request& request,
     protocol::raft::AppendEntries_Response& reply,
-    const std::string& address) {
+    const int peer_id,
+    const int round,
+    const time_point send_time) {
   if (reply.term() > request.term()) {
     DLOG(INFO) << "Term out of date in heartbeat reply, changed from " << request.term() << " to " << reply.term();
     m_leader_id = "";
@@ -557,38 +1233,76 @@ void ConsensusModule::ProcessAppendEntriesServerResponse(
   }
 
   if (State() == RaftState::LEADER && reply.term() == Term()) {
-    int next = m_next_index[address];
+    std::lock_guard<std::mutex> lock(m_replication_lock);
+    auto& progress = Progress(peer_id);
+
+    // Any reply in the current term shows the FOLLOWER still recognizes this LEADER, so
+    // replication traffic renews the lease as well as heartbeats
+    progress.RecordContact(send_time);
+    progress.RecordRtt(std::chrono::duration_cast<PeerProgress::microseconds>(clock_type::now() - send_time));
+    UpdateLease();
+    if (progress.RecordAck(round)) {
+      UpdateConfirmedRound();
+    }
+
     if (reply.success()) {
-      // If heartbeat is successful for majority, reads can be served
-      m_responding_peers.insert(address);
-      if (m_renew_lease.load() && m_configuration->CheckQuorum(m_responding_peers)) {
-        DLOG(INFO) << "Leader lease acquired";
-        int commit_delay = std::chrono::duration_cast<milliseconds>(clock_type::now() - m_heartbeat_time).count();
-        int lease_expiry = LEADER_LEASE_TIMEOUT - commit_delay;
-        m_lease_timer->Reset(lease_expiry);
-        m_lease_holder.store(true);
-        m_renew_lease.store(false);
+      // All entries in the request were replicated on FOLLOWER
+      int match_index = request.prevlogindex() + request.entries().size();
+      bool updated = progress.MaybeUpdate(match_index, request.entries().size() > 0);
+      DLOG(INFO) << "AppendEntries reply from " << m_configuration->PeerAddress(peer_id) << " successful: next_index = "
+        << progress.NextIndex() << " match_index = " << progress.MatchIndex();
+
+      if (m_configuration->UpdateSyncProgress(peer_id, progress.MatchIndex())) {
+        {
+          std::lock_guard<std::mutex> membership_lock(m_membership_lock);
+          if (m_active_change != -1) {
+            m_membership_changes.at(m_active_change).last_progress = clock_type::now();
+          }
+        }
+        AdvanceMembershipChange();
       }
-      // Update next and match index since all entries in request were replicated on FOLLOWER
-      m_next_index[address] = next + request.entries().size();
-      m_match_index[address] = next + request.entries().size() - 1;
-      DLOG(INFO) << "AppendEntries reply from " << address << "successful: next_index = " << m_next_index[address]
-        << "match_index = " << m_match_index[address];
-
-      if (m_configuration->UpdateSyncProgress(address, m_match_index[address])) {
-        m_membership_sync.notify_one();
+
+      if (updated) {
+        UpdateCommitIndex();
+        if (m_transferring.load()) {
+          m_transfer_sync.notify_all();
+        }
       }
 
-      UpdateCommitIndex();
+      // Keep the in flight window full while the FOLLOWER is behind. A paused FOLLOWER
+      // would only be sent another heartbeat, whose reply would send one again, so it
+      // waits for the heartbeat timer instead.
+      if (State() == RaftState::LEADER && !progress.Paused() &&
+          progress.NextIndex() < m_ctx.LogInstance(m_group_id)->LogSize()) {
+        SendAppendEntries(peer_id, progress);
+      }
     } else {
-      // If the AppendEntries RPC was unsuccessful the prevLogIndex for the specific node is decremented.
+      // If the AppendEntries RPC was unsuccessful the FOLLOWER is probed at an earlier index.
       // This will continue until a raft log entry with a matching term is found.
-      m_next_index[address] = next - 1;
-      DLOG(INFO) << "AppendEntries reply from " << address << " unsuccessful: next_index = " << next;
+      if (progress.MaybeDecrement(request.prevlogindex(), reply.lastlogindex())) {
+        DLOG(INFO) << "AppendEntries reply from " << m_configuration->PeerAddress(peer_id) << " unsuccessful: next_index = "
+          << progress.NextIndex();
+        SendAppendEntries(peer_id, progress);
+      }
     }
   }
 }
 
+void ConsensusModule::ProcessAppendEntriesServerFailure(
+    protocol::raft::AppendEntries_Request& request,
+    const int peer_id) {
+  if (State() != RaftState::LEADER || request.term() != Term()) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(m_replication_lock);
+  auto& progress = Progress(peer_id);
+  if (progress.State() != PeerProgress::ProgressState::PROBE) {
+    DLOG(INFO) << "AppendEntries rpc to " << m_configuration->PeerAddress(peer_id) << " failed, probing FOLLOWER";
+    progress.BecomeProbe();
+  }
+}
+
 std::tuple<protocol::raft::GetConfiguration_Response, grpc::Status> ConsensusModule::ProcessGetConfigurationClientRequest() {
   protocol::raft::GetConfiguration_Response reply;
   if (m_state != RaftState::LEADER) {
@@ -603,6 +1317,7 @@ std::tuple<protocol::raft::GetConfiguration_Response, grpc::Status> ConsensusMod
 
   reply.set_id(m_configuration->Id());
   *reply.mutable_servers() = m_configuration->Configuration().prev_configuration();
+  *reply.mutable_learners() = m_configuration->Configuration().learners();
   return std::make_tuple(reply, grpc::Status::OK);
 }
 
@@ -621,73 +1336,210 @@ std::tuple<protocol::raft::SetConfiguration_Response, grpc::Status> ConsensusMod
     return std::make_tuple(reply, err);
   }
 
-  if (m_configuration->State() != ClusterConfiguration::ConfigurationState::STABLE) {
+  // Changes from a previous term are failed before checking for one in progress
+  AdvanceMembershipChange();
+
+  std::lock_guard<std::mutex> lock(m_membership_lock);
+  if (m_active_change != -1 ||
+      m_configuration->State() != ClusterConfiguration::ConfigurationState::STABLE) {
     reply.set_ok(false);
     grpc::Status err = ConstructError("Peer is not in a stable state", protocol::raft::Error::Code::Error_Code_RETRY);
-    std::make_tuple(reply, err);
-  }
-
-  std::mutex m;
-  std::unique_lock<std::mutex> lock(m);
-
-  int saved_term = Term();
-  protocol::log::Configuration new_configuration;
-  for (auto& new_server:request.new_servers()) {
-    *new_configuration.add_next_configuration() = new_server;
+    return std::make_tuple(reply, err);
   }
-  *new_configuration.mutable_next_configuration() = {request.new_servers().begin(), request.new_servers().end()};
-  *new_configuration.mutable_prev_configuration() = m_configuration->Configuration().prev_configuration();
 
   std::vector<std::string> new_servers;
   for (auto& server:request.new_servers()) {
     new_servers.push_back(server.address());
   }
-  m_configuration->StartLogSync(CommitIndex(), new_servers);
-  m_ctx.ClientInstance()->CreateConnections(m_configuration->ServerAddresses());
 
-  while (!m_configuration->SyncComplete()) {
-    if (Term() != saved_term) {
+  if (!m_configuration->StartLogSync(CommitIndex(), new_servers)) {
+    reply.set_ok(false);
+    grpc::Status err = ConstructError("Cluster is limited to " + std::to_string(MAX_CLUSTER_SIZE) + " servers",
+        protocol::raft::Error::Code::Error_Code_UNEXPECTED_ERROR);
+    return std::make_tuple(reply, err);
+  }
+  m_ctx.ClientInstance()->CreateConnections(m_group_id, m_configuration->ServerAddresses());
+
+  int change_id = m_next_change_id++;
+  MembershipChange change;
+  change.state = protocol::raft::MembershipChangeState::LOG_SYNC;
+  change.term = Term();
+  change.servers = {request.new_servers().begin(), request.new_servers().end()};
+  change.joint_id = -1;
+  change.configuration_id = -1;
+  change.last_progress = clock_type::now();
+  m_membership_changes.insert({change_id, change});
+  m_active_change = change_id;
+  DLOG(INFO) << "Started membership change with operation id = " << change_id;
+
+  reply.set_ok(true);
+  reply.set_operationid(change_id);
+  return std::make_tuple(reply, grpc::Status::OK);
+}
+
+std::tuple<protocol::raft::GetConfigurationStatus_Response, grpc::Status> ConsensusModule::ProcessGetConfigurationStatusClientRequest(
+    protocol::raft::GetConfigurationStatus_Request& request) {
+  protocol::raft::GetConfigurationStatus_Response reply;
+  AdvanceMembershipChange();
+
+  std::lock_guard<std::mutex> lock(m_membership_lock);
+  auto it = m_membership_changes.find(request.operationid());
+  if (it == m_membership_changes.end()) {
+    grpc::Status err = ConstructError("Membership change is unknown to this peer", protocol::raft::Error::Code::Error_Code_OUT_OF_DATE);
+    return std::make_tuple(reply, err);
+  }
+
+  reply.set_state(it->second.state);
+  reply.set_configurationid(it->second.configuration_id);
+  reply.set_error(it->second.error);
+  return std::make_tuple(reply, grpc::Status::OK);
+}
+
+void ConsensusModule::AdvanceMembershipChange() {
+  std::lock_guard<std::mutex> lock(m_membership_lock);
+  if (m_active_change == -1) {
+    return;
+  }
+
+  auto& change = m_membership_changes.at(m_active_change);
+  if (Term() != change.term || State() != RaftState::LEADER) {
+    if (change.state == protocol::raft::MembershipChangeState::LOG_SYNC) {
       m_configuration->CancelLogSync();
-      grpc::Status err = ConstructError("Peer is not a leader", protocol::raft::Error::Code::Error_Code_NOT_LEADER);
+    }
+    FinishMembershipChange(protocol::raft::MembershipChangeState::FAILED, "Peer is not a leader");
+    return;
+  }
+
+  switch (change.state) {
+    case protocol::raft::MembershipChangeState::LOG_SYNC: {
+      if (!m_configuration->SyncComplete()) {
+        if (clock_type::now() - change.last_progress > m_election_timeout) {
+          m_configuration->CancelLogSync();
+          FinishMembershipChange(protocol::raft::MembershipChangeState::FAILED, "Peer log sync timed out");
+        }
+        return;
+      }
+      DLOG(INFO) << "Log syncing with new servers complete";
+
+      // The joint configuration is built from the configuration in effect now rather than
+      // when the change was requested, so entries appended during log sync are kept
+      auto current = m_configuration->Configuration();
+      protocol::log::LogEntry configuration_entry;
+      configuration_entry.set_term(Term());
+      configuration_entry.set_type(protocol::log::LogOpCode::CONFIGURATION);
+      auto joint = configuration_entry.mutable_configuration();
+      *joint->mutable_prev_configuration() = current.prev_configuration();
+      *joint->mutable_next_configuration() = {change.servers.begin(), change.servers.end()};
+
+      // Learners included in the new configuration are promoted to voters
+      for (auto& learner:current.learners()) {
+        auto promoted = std::find_if(change.servers.begin(), change.servers.end(), [&learner](const protocol::log::Server& server) {
+            return server.address() == learner.address();
+        });
+        if (promoted == change.servers.end()) {
+          *joint->add_learners() = learner;
+        }
+      }
+
+      change.joint_id = Append(configuration_entry);
+      change.state = protocol::raft::MembershipChangeState::JOINT_CONSENSUS;
+      break;
+    }
+    case protocol::raft::MembershipChangeState::JOINT_CONSENSUS: {
+      // The LEADER appends the new configuration once the joint configuration commits
+      if (m_configuration->Id() > change.joint_id && CommitIndex() >= m_configuration->Id()) {
+        DLOG(INFO) << "Configuration log entry committed successfully";
+        change.configuration_id = m_configuration->Id();
+        FinishMembershipChange(protocol::raft::MembershipChangeState::COMMITTED, "");
+      }
+      break;
+    }
+    default: {
+      break;
+    }
+  }
+}
+
+void ConsensusModule::FinishMembershipChange(protocol::raft::MembershipChangeState state, const std::string& error) {
+  auto& change = m_membership_changes.at(m_active_change);
+  change.state = state;
+  change.error = error;
+  DLOG(INFO) << "Membership change with operation id = " << m_active_change << " finished: "
+    << protocol::raft::MembershipChangeState_Name(state) << " " << error;
+  m_active_change = -1;
+}
+
+std::tuple<protocol::raft::AddLearner_Response, grpc::Status> ConsensusModule::ProcessAddLearnerClientRequest(
+    protocol::raft::AddLearner_Request& request) {
+  protocol::raft::AddLearner_Response reply;
+  if (State() != RaftState::LEADER) {
+    reply.set_ok(false);
+    grpc::Status err = ConstructError("Peer is not a leader", protocol::raft::Error::Code::Error_Code_NOT_LEADER);
+    return std::make_tuple(reply, err);
+  }
+
+  // Changes from a previous term are failed before checking for one in progress
+  AdvanceMembershipChange();
+
+  int saved_term = Term();
+  int configuration_id;
+  {
+    // A membership change in LOG_SYNC has not appended its joint configuration yet, so the
+    // configuration is still STABLE. Holding m_membership_lock until the learner's entry is
+    // appended keeps the change from building its joint configuration in between.
+    std::lock_guard<std::mutex> membership_lock(m_membership_lock);
+    if (m_active_change != -1 ||
+        m_configuration->State() != ClusterConfiguration::ConfigurationState::STABLE ||
+        CommitIndex() < m_configuration->Id()) {
       reply.set_ok(false);
+      grpc::Status err = ConstructError("Peer is not in a stable state", protocol::raft::Error::Code::Error_Code_RETRY);
       return std::make_tuple(reply, err);
     }
 
-    bool progress = m_membership_sync.wait_for(lock, m_election_timeout, [this] {
-      return m_configuration->SyncProgress();
-    });
-
-    if (!progress) {
-      m_configuration->CancelLogSync();
-      grpc::Status err = ConstructError("Peer log sync timed out", protocol::raft::Error::Code::Error_Code_TIMEOUT);
+    if (m_configuration->KnownServer(request.learner().address())) {
       reply.set_ok(false);
+      grpc::Status err = ConstructError("Server is already a member of the cluster", protocol::raft::Error::Code::Error_Code_UNEXPECTED_ERROR);
       return std::make_tuple(reply, err);
     }
-  }
-  DLOG(INFO) << "Log syncing with new servers complete";
 
-  protocol::log::LogEntry configuration_entry;
-  configuration_entry.set_term(Term());
-  configuration_entry.set_type(protocol::log::LogOpCode::CONFIGURATION);
-  *configuration_entry.mutable_configuration() = new_configuration;
+    if (!m_configuration->ReservePeers({request.learner().address()})) {
+      reply.set_ok(false);
+      grpc::Status err = ConstructError("Cluster is limited to " + std::to_string(MAX_CLUSTER_SIZE) + " servers",
+          protocol::raft::Error::Code::Error_Code_UNEXPECTED_ERROR);
+      return std::make_tuple(reply, err);
+    }
 
-  int joint_id = Append(configuration_entry);
+    protocol::log::LogEntry configuration_entry;
+    configuration_entry.set_term(saved_term);
+    configuration_entry.set_type(protocol::log::LogOpCode::CONFIGURATION);
+    *configuration_entry.mutable_configuration() = m_configuration->Configuration();
+    *configuration_entry.mutable_configuration()->add_learners() = request.learner();
+    configuration_id = Append(configuration_entry);
+  }
 
-  m_membership_sync.wait(lock, [this, joint_id, saved_term] {
-    return (m_configuration->Id() > joint_id &&
-        CommitIndex() >= m_configuration->Id()) ||
-        Term() != saved_term;
+  // A LEADER cut off from its FOLLOWERs would never apply the entry
+  std::unique_lock<std::mutex> lock(m_apply_lock);
+  bool applied = m_apply_sync.wait_for(lock, milliseconds(ElectionTimeout()), [this, configuration_id, saved_term] {
+      return m_state_machine->LastApplied() >= configuration_id ||
+          Term() != saved_term ||
+          State() != RaftState::LEADER;
   });
 
-  if (m_configuration->Id() > joint_id && CommitIndex() >= m_configuration->Id()) {
-    DLOG(INFO) << "Configuration log entry committed successfully";
-    reply.set_ok(true);
-    return std::make_tuple(reply, grpc::Status::OK);
-  } else {
+  if (Term() != saved_term || State() != RaftState::LEADER) {
+    reply.set_ok(false);
     grpc::Status err = ConstructError("Peer is not a leader", protocol::raft::Error::Code::Error_Code_NOT_LEADER);
+    return std::make_tuple(reply, err);
+  }
+  if (!applied) {
     reply.set_ok(false);
+    reply.set_id(configuration_id);
+    grpc::Status err = ConstructError("Learner configuration was not committed in time", protocol::raft::Error::Code::Error_Code_TIMEOUT);
     return std::make_tuple(reply, err);
   }
+
+  reply.set_ok(true);
+  reply.set_id(configuration_id);
+  return std::make_tuple(reply, grpc::Status::OK);
 }
 
 std::tuple<protocol::raft::RegisterClient_Response, grpc::Status> ConsensusModule::ProcessRegisterClientClientRequest() {
@@ -697,9 +1549,11 @@ std::tuple<protocol::raft::RegisterClient_Response, grpc::Status> ConsensusModul
     grpc::Status err = ConstructError("Peer is not a leader", protocol::raft::Error::Code::Error_Code_NOT_LEADER);
     return std::make_tuple(reply, err);
   }
-
-  std::mutex m;
-  std::unique_lock<std::mutex> lock(m);
+  if (m_transferring.load()) {
+    reply.set_status(false);
+    grpc::Status err = ConstructError("Leadership transfer in progress", protocol::raft::Error::Code::Error_Code_RETRY);
+    return std::make_tuple(reply, err);
+  }
 
   int saved_term = Term();
   protocol::log::LogEntry session_entry;
@@ -707,24 +1561,89 @@ std::tuple<protocol::raft::RegisterClient_Response, grpc::Status> ConsensusModul
   session_entry.set_type(protocol::log::LogOpCode::REGISTER_CLIENT);
   int session_id = Append(session_entry);
 
-  m_session_sync.wait(lock, [this, session_id, saved_term] {
-      return CommitIndex() >= session_id || Term() != saved_term;
+  // The session is created when the entry is applied. A LEADER that steps down after
+  // check quorum keeps its term, so the wait also ends when the node stops leading.
+  std::unique_lock<std::mutex> lock(m_apply_lock);
+  bool applied = m_apply_sync.wait_for(lock, milliseconds(ElectionTimeout()), [this, session_id, saved_term] {
+      return m_state_machine->LastApplied() >= session_id ||
+          Term() != saved_term ||
+          State() != RaftState::LEADER;
   });
 
-  if (Term() != saved_term) {
+  if (Term() != saved_term || State() != RaftState::LEADER) {
     grpc::Status err = ConstructError("Peer is not a leader", protocol::raft::Error::Code::Error_Code_NOT_LEADER);
     reply.set_status(false);
-    m_state_machine->IncrementLastApplied();
     return std::make_tuple(reply, err);
   }
-
-  m_state_machine->ApplyCommand(session_id, session_entry);
+  if (!applied) {
+    grpc::Status err = ConstructError("Session was not registered in time", protocol::raft::Error::Code::Error_Code_RETRY);
+    reply.set_status(false);
+    return std::make_tuple(reply, err);
+  }
 
   reply.set_clientid(session_id);
   reply.set_status(true);
   return std::make_tuple(reply, grpc::Status::OK);
 }
 
+std::tuple<protocol::raft::ApplyRangeMove_Response, grpc::Status> ConsensusModule::ProcessApplyRangeMoveClientRequest(
+    protocol::raft::ApplyRangeMove_Request& request) {
+  protocol::raft::ApplyRangeMove_Response reply;
+  if (State() != RaftState::LEADER) {
+    reply.set_ok(false);
+    grpc::Status err = ConstructError("Peer is not a leader", protocol::raft::Error::Code::Error_Code_NOT_LEADER);
+    return std::make_tuple(reply, err);
+  }
+  if (m_transferring.load()) {
+    reply.set_ok(false);
+    grpc::Status err = ConstructError("Leadership transfer in progress", protocol::raft::Error::Code::Error_Code_RETRY);
+    return std::make_tuple(reply, err);
+  }
+  if (request.type() != protocol::log::LogOpCode::RANGE_MOVE_IN &&
+      request.type() != protocol::log::LogOpCode::RANGE_ASSIGN) {
+    reply.set_ok(false);
+    grpc::Status err = ConstructError("Only moves into a group and assignments can be applied",
+        protocol::raft::Error::Code::Error_Code_INVALID_COMMAND);
+    return std::make_tuple(reply, err);
+  }
+
+  int saved_term = Term();
+  protocol::log::LogEntry move_entry;
+  move_entry.set_term(saved_term);
+  move_entry.set_type(request.type());
+  *move_entry.mutable_move() = request.move();
+  int move_index = AppendInTerm(move_entry, saved_term);
+  if (move_index < 0) {
+    reply.set_ok(false);
+    grpc::Status err = ConstructError("Peer is not a leader", protocol::raft::Error::Code::Error_Code_NOT_LEADER);
+    return std::make_tuple(reply, err);
+  }
+
+  // The moving LEADER only continues once the entry is applied, so it must not wait forever
+  std::unique_lock<std::mutex> lock(m_apply_lock);
+  bool applied = m_apply_sync.wait_for(lock, milliseconds(ElectionTimeout()), [this, move_index, saved_term] {
+      return m_state_machine->LastApplied() >= move_index ||
+          Term() != saved_term ||
+          State() != RaftState::LEADER;
+  });
+
+  if (Term() != saved_term || State() != RaftState::LEADER) {
+    reply.set_ok(false);
+    grpc::Status err = ConstructError("Peer is not a leader", protocol::raft::Error::Code::Error_Code_NOT_LEADER);
+    return std::make_tuple(reply, err);
+  }
+  if (!applied) {
+    reply.set_ok(false);
+    reply.set_index(move_index);
+    grpc::Status err = ConstructError("Range move was not applied in time", protocol::raft::Error::Code::Error_Code_TIMEOUT);
+    return std::make_tuple(reply, err);
+  }
+
+  reply.set_ok(true);
+  reply.set_index(move_index);
+  return std::make_tuple(reply, grpc::Status::OK);
+}
+
 std::tuple<protocol::raft::ClientRequest_Response, grpc::Status> ConsensusModule::ProcessClientRequestClientRequest(
     protocol::raft::ClientRequest_Request& request) {
   protocol::raft::ClientRequest_Response reply;
@@ -733,62 +1652,202 @@ std::tuple<protocol::raft::ClientRequest_Response, grpc::Status> ConsensusModule
     grpc::Status err = ConstructError("Peer is not a leader", protocol::raft::Error::Code::Error_Code_NOT_LEADER);
     return std::make_tuple(reply, err);
   }
+  // New entries would delay the transfer target from catching up
+  if (m_transferring.load()) {
+    reply.set_status(false);
+    grpc::Status err = ConstructError("Leadership transfer in progress", protocol::raft::Error::Code::Error_Code_RETRY);
+    return std::make_tuple(reply, err);
+  }
 
-  std::mutex m;
-  std::unique_lock<std::mutex> lock(m);
+  // Retried commands that were already applied are answered from the session
+  if (m_session->PeekCachedResponse(request.clientid(), request.sequencenum(), reply)) {
+    return std::make_tuple(reply, grpc::Status::OK);
+  }
+  auto command = DecodeCommand(request.command());
+  if (!command.has_value()) {
+    reply.set_status(false);
+    grpc::Status err = ConstructError("Command could not be decoded", protocol::raft::Error::Code::Error_Code_INVALID_COMMAND);
+    return std::make_tuple(reply, err);
+  }
+  // The state machine rejects the command as well if the range moves before it is applied
+  std::vector<std::string_view> keys{command->key};
+  if (command->type == CommandType::BATCH) {
+    keys.clear();
+    for (auto& operation:command->operations) {
+      keys.push_back(operation.key);
+    }
+  }
+  for (auto key:keys) {
+    if (!m_state_machine->Serves(key)) {
+      reply.set_status(false);
+      return std::make_tuple(reply, WrongGroupError(key));
+    }
+  }
 
   int saved_term = Term();
   protocol::log::LogEntry write_entry;
   write_entry.set_term(saved_term);
   write_entry.set_type(protocol::log::LogOpCode::DATA);
   write_entry.set_data(request.command());
+  write_entry.set_clientid(request.clientid());
+  write_entry.set_sequencenum(request.sequencenum());
   int write_id = Append(write_entry);
 
-  m_write_command_sync.wait(lock, [this, write_id, saved_term] {
-      return CommitIndex() >= write_id || Term() != saved_term;
+  std::unique_lock<std::mutex> lock(m_apply_lock);
+  bool applied = m_apply_sync.wait_for(lock, milliseconds(ElectionTimeout()), [this, write_id, saved_term] {
+      return m_state_machine->LastApplied() >= write_id ||
+          Term() != saved_term ||
+          State() != RaftState::LEADER;
   });
 
-  if (Term() != saved_term) {
+  if (Term() != saved_term || State() != RaftState::LEADER) {
     reply.set_status(false);
     grpc::Status err = ConstructError("Peer is not a leader", protocol::raft::Error::Code::Error_Code_NOT_LEADER);
-    m_state_machine->IncrementLastApplied();
+    return std::make_tuple(reply, err);
+  }
+  // Retrying with the same sequence number is safe since applied commands are deduplicated
+  if (!applied) {
+    reply.set_status(false);
+    grpc::Status err = ConstructError("Command was not applied in time", protocol::raft::Error::Code::Error_Code_RETRY);
     return std::make_tuple(reply, err);
   }
 
+  // The state machine caches the response of every command it applies
   if (!m_session->SessionExists(request.clientid())) {
     reply.set_status(false);
     grpc::Status err = ConstructError("Client session has expired", protocol::raft::Error::Code::Error_Code_SESSION_EXPIRED);
-    m_state_machine->IncrementLastApplied();
     return std::make_tuple(reply, err);
-  } else if (m_session->GetCachedResponse(request.clientid(), request.sequencenum(), reply)) {
-    m_state_machine->IncrementLastApplied();
-    return std::make_tuple(reply, grpc::Status::OK);
+  } else if (!m_session->PeekCachedResponse(request.clientid(), request.sequencenum(), reply)) {
+    reply.set_status(false);
+    grpc::Status err = ConstructError("Command was not applied", protocol::raft::Error::Code::Error_Code_UNEXPECTED_ERROR);
+    return std::make_tuple(reply, err);
+  } else if (reply.response() == "WRONG_GROUP") {
+    for (auto key:keys) {
+      if (!m_state_machine->Serves(key)) {
+        return std::make_tuple(reply, WrongGroupError(key));
+      }
+    }
+    grpc::Status err = ConstructError("Range moved while the command was applied", protocol::raft::Error::Code::Error_Code_RETRY);
+    return std::make_tuple(reply, err);
   }
-
-  std::string response = m_state_machine->ApplyCommand(write_id, write_entry);
-  reply.set_response(response);
-  reply.set_status(true);
-  m_session->CacheResponse(request.clientid(), request.sequencenum(), reply);
   return std::make_tuple(reply, grpc::Status::OK);
 }
 
+void ConsensusModule::ProcessReadIndexClientRequest(
+    std::function<void(protocol::raft::ReadIndex_Response, grpc::Status)> callback) {
+  protocol::raft::ReadIndex_Response reply;
+  // FOLLOWERs do not forward the request, the requester already thinks it is the LEADER
+  if (State() != RaftState::LEADER) {
+    grpc::Status err = ConstructError("Peer is not a leader", protocol::raft::Error::Code::Error_Code_NOT_LEADER);
+    callback(reply, err);
+    return;
+  }
+
+  ReadIndexAsync([callback](const int read_index, grpc::Status status) {
+    protocol::raft::ReadIndex_Response reply;
+    reply.set_readindex(read_index);
+    callback(reply, status);
+  });
+}
+
+std::tuple<int, grpc::Status> ConsensusModule::AwaitReadIndex(
+    protocol::raft::ConsistencyLevel consistency,
+    int min_index,
+    int max_staleness_ms) {
+  int read_index = -1;
+  time_point deadline = clock_type::now() + m_election_timeout;
+  grpc::Status status;
+  switch (consistency) {
+    case protocol::raft::ConsistencyLevel::LINEARIZABLE: {
+      std::tie(read_index, status) = ReadIndex();
+      break;
+    }
+    case protocol::raft::ConsistencyLevel::LEASE: {
+      std::tie(read_index, status) = LeaseReadIndex();
+      break;
+    }
+    case protocol::raft::ConsistencyLevel::BOUNDED_STALENESS: {
+      std::tie(read_index, deadline, status) = StaleReadIndex(milliseconds(max_staleness_ms));
+      break;
+    }
+    case protocol::raft::ConsistencyLevel::ANY: {
+      break;
+    }
+    default: {
+      status = ConstructError("Unknown consistency level", protocol::raft::Error::Code::Error_Code_UNEXPECTED_ERROR);
+    }
+  }
+  if (!status.ok()) {
+    return std::make_tuple(-1, status);
+  }
+
+  // Read-your-writes requires the node to have applied the client's writes
+  read_index = std::max(read_index, min_index);
+
+  std::unique_lock<std::mutex> lock(m_apply_lock);
+  bool applied = m_apply_sync.wait_until(lock, deadline, [this, read_index] {
+    return m_state_machine->LastApplied() >= read_index;
+  });
+
+  if (!applied) {
+    if (consistency == protocol::raft::ConsistencyLevel::BOUNDED_STALENESS) {
+      grpc::Status err = ConstructError("Peer has not applied entries within the staleness bound",
+          protocol::raft::Error::Code::Error_Code_OUT_OF_DATE);
+      return std::make_tuple(-1, err);
+    }
+    grpc::Status err = ConstructError("Peer has not applied the read index", protocol::raft::Error::Code::Error_Code_RETRY);
+    return std::make_tuple(-1, err);
+  }
+  return std::make_tuple(m_state_machine->LastApplied(), grpc::Status::OK);
+}
+
+std::tuple<std::unique_ptr<InmemoryStore::Snapshot>, grpc::Status> ConsensusModule::OpenReadSnapshot(
+    protocol::raft::ConsistencyLevel consistency,
+    int min_index,
+    int max_staleness_ms,
+    int snapshot_index) {
+  // Reading at a past index still requires the node to have applied it
+  auto [applied_index, status] = AwaitReadIndex(consistency, std::max(min_index, snapshot_index), max_staleness_ms);
+  if (!status.ok()) {
+    return std::make_tuple(nullptr, status);
+  }
+
+  auto snapshot = m_store->OpenSnapshot(snapshot_index > 0 ? snapshot_index : -1);
+  if (!snapshot) {
+    grpc::Status err = ConstructError("Snapshot index is no longer retained",
+        protocol::raft::Error::Code::Error_Code_OUT_OF_DATE);
+    return std::make_tuple(nullptr, err);
+  }
+  return std::make_tuple(std::move(snapshot), grpc::Status::OK);
+}
+
 std::tuple<protocol::raft::ClientQuery_Response, grpc::Status> ConsensusModule::ProcessClientQueryClientRequest(
     protocol::raft::ClientQuery_Request& request) {
   protocol::raft::ClientQuery_Response reply;
-  if (State() != RaftState::LEADER) {
-    reply.set_status(false);
-    grpc::Status err = ConstructError("Peer is not a leader", protocol::raft::Error::Code::Error_Code_NOT_LEADER);
-    return std::make_tuple(reply, err);
+  if (State() == RaftState::DEAD) {
+    return std::make_tuple(reply, grpc::Status::CANCELLED);
   }
 
-  if (!m_lease_holder.load()) {
+  auto [snapshot, status] = OpenReadSnapshot(
+      request.consistency(), request.minindex(), request.maxstalenessms(), request.snapshotindex());
+  if (!status.ok()) {
     reply.set_status(false);
-    grpc::Status err = ConstructError("Leader does not own lease to serve reads", protocol::raft::Error::Code::Error_Code_LEASE_EXPIRED);
+    return std::make_tuple(reply, status);
+  }
+  reply.set_appliedindex(snapshot->Index());
+  if (!m_state_machine->Serves(request.query())) {
+    reply.set_status(false);
+    return std::make_tuple(reply, WrongGroupError(request.query()));
+  }
+  if (snapshot->Index() < m_state_machine->MovedInIndex()) {
+    reply.set_status(false);
+    grpc::Status err = ConstructError("Snapshot index precedes a range moved into the group",
+        protocol::raft::Error::Code::Error_Code_OUT_OF_DATE);
     return std::make_tuple(reply, err);
   }
 
   try {
-    std::string response = m_store->Read(request.query());
+    std::string response = snapshot->Read(request.query());
     reply.set_response(response);
   } catch (std::out_of_range) {
     reply.set_status(false);
@@ -800,4 +1859,211 @@ std::tuple<protocol::raft::ClientQuery_Response, grpc::Status> ConsensusModule::
   return std::make_tuple(reply, grpc::Status::OK);
 }
 
+std::tuple<protocol::raft::Scan_Response, grpc::Status> ConsensusModule::ProcessScanClientRequest(
+    protocol::raft::Scan_Request& request) {
+  protocol::raft::Scan_Response reply;
+  if (State() == RaftState::DEAD) {
+    return std::make_tuple(reply, grpc::Status::CANCELLED);
+  }
+
+  auto [snapshot, status] = OpenReadSnapshot(
+      request.consistency(), request.minindex(), request.maxstalenessms(), request.snapshotindex());
+  if (!status.ok()) {
+    return std::make_tuple(reply, status);
+  }
+  reply.set_appliedindex(snapshot->Index());
+  if (!m_state_machine->Serves(request.startkey())) {
+    return std::make_tuple(reply, WrongGroupError(request.startkey()));
+  }
+  if (snapshot->Index() < m_state_machine->MovedInIndex()) {
+    grpc::Status err = ConstructError("Snapshot index precedes a range moved into the group",
+        protocol::raft::Error::Code::Error_Code_OUT_OF_DATE);
+    return std::make_tuple(reply, err);
+  }
+
+  // The scan stops at the end of the group's range, the rest is served by other groups
+  std::string end_key = request.endkey();
+  std::string range_end = m_state_machine->Directory().EndOf(request.startkey());
+  bool clipped = !range_end.empty() && (end_key.empty() || range_end < end_key);
+  if (clipped) {
+    end_key = range_end;
+  }
+
+  int limit = request.limit();
+  if (limit <= 0 || limit > MAX_SCAN_LIMIT) {
+    limit = MAX_SCAN_LIMIT;
+  }
+  auto entries = snapshot->Scan(request.startkey(), end_key, limit);
+  for (auto& [key, value]:entries) {
+    auto entry = reply.add_entries();
+    entry->set_key(std::move(key));
+    entry->set_value(std::move(value));
+  }
+
+  // A full page may be followed by more entries, the smallest key after the last one
+  // is the key with a null byte appended
+  if (entries.size() == limit) {
+    reply.set_nextkey(reply.entries(limit - 1).key() + '\0');
+    reply.set_nextgroupid(m_group_id);
+  } else if (clipped) {
+    reply.set_nextkey(range_end);
+    reply.set_nextgroupid(m_ctx.ConsensusInstance(0)->RangeGroup(range_end));
+  }
+  return std::make_tuple(reply, grpc::Status::OK);
+}
+
+std::tuple<protocol::raft::GetRanges_Response, grpc::Status> ConsensusModule::ProcessGetRangesClientRequest() {
+  protocol::raft::GetRanges_Response reply;
+  reply.set_appliedindex(m_state_machine->LastApplied());
+  for (auto& range:m_store->Ranges()) {
+    auto range_info = reply.add_ranges();
+    range_info->set_startkey(range.start_key);
+    range_info->set_endkey(range.end_key);
+    range_info->set_keycount(range.key_count);
+    range_info->set_sizebytes(range.size_bytes);
+    range_info->set_operations(range.operations);
+  }
+  for (auto& assignment:m_state_machine->Directory().Assignments()) {
+    auto directory_info = reply.add_directory();
+    directory_info->set_startkey(assignment.start_key);
+    directory_info->set_endkey(assignment.end_key);
+    directory_info->set_groupid(assignment.group_id);
+  }
+
+  auto memory = m_store->Memory();
+  reply.mutable_memory()->set_databytes(memory.data_bytes);
+  reply.mutable_memory()->set_arenabytes(memory.arena_bytes);
+  reply.mutable_memory()->set_indexbytes(memory.index_bytes);
+
+  auto cache = m_store->CacheStats();
+  reply.mutable_cache()->set_hits(cache.hits);
+  reply.mutable_cache()->set_misses(cache.misses);
+  reply.mutable_cache()->set_rejected(cache.rejected);
+  reply.mutable_cache()->set_entries(cache.entries);
+  return std::make_tuple(reply, grpc::Status::OK);
+}
+
+std::tuple<protocol::raft::TransferLeadership_Response, grpc::Status> ConsensusModule::ProcessTransferLeadershipClientRequest(
+    protocol::raft::TransferLeadership_Request& request) {
+  protocol::raft::TransferLeadership_Response reply;
+  if (State() != RaftState::LEADER) {
+    reply.set_ok(false);
+    grpc::Status err = ConstructError("Peer is not a leader", protocol::raft::Error::Code::Error_Code_NOT_LEADER);
+    return std::make_tuple(reply, err);
+  }
+
+  if (m_transferring.exchange(true)) {
+    reply.set_ok(false);
+    grpc::Status err = ConstructError("Leadership transfer in progress", protocol::raft::Error::Code::Error_Code_RETRY);
+    return std::make_tuple(reply, err);
+  }
+
+  int saved_term = Term();
+  int target_id = -1;
+  {
+    std::unique_lock<std::mutex> lock(m_replication_lock);
+    // Learners cannot be elected
+    PeerSet members = m_configuration->Voters();
+    if (request.targetid() != "") {
+      if (m_configuration->KnownServer(request.targetid())) {
+        target_id = m_configuration->PeerId(request.targetid());
+      }
+    } else {
+      // The most up to date FOLLOWER needs the fewest entries to catch up
+      for (int peer_id = 0; peer_id < MAX_CLUSTER_SIZE; peer_id++) {
+        if (!members.test(peer_id) || peer_id == m_self_id) {
+          continue;
+        }
+        if (target_id == -1 || Progress(peer_id).MatchIndex() > Progress(target_id).MatchIndex()) {
+          target_id = peer_id;
+        }
+      }
+    }
+
+    if (target_id == -1 || target_id == m_self_id || !members.test(target_id)) {
+      m_transferring.store(false);
+      reply.set_ok(false);
+      grpc::Status err = ConstructError("Transfer target is not a member of the cluster", protocol::raft::Error::Code::Error_Code_UNEXPECTED_ERROR);
+      return std::make_tuple(reply, err);
+    }
+
+    // No entries are appended while transferring so the target only has to reach the current log
+    int last_log_index = m_ctx.LogInstance(m_group_id)->LastLogIndex();
+    auto& progress = Progress(target_id);
+    if (progress.MatchIndex() < last_log_index) {
+      SendAppendEntries(target_id, progress);
+    }
+
+    bool caught_up = m_transfer_sync.wait_for(lock, milliseconds(ElectionTimeout()), [this, target_id, last_log_index, saved_term] {
+      return Progress(target_id).MatchIndex() >= last_log_index || Term() != saved_term;
+    });
+
+    if (Term() != saved_term) {
+      m_transferring.store(false);
+      reply.set_ok(false);
+      grpc::Status err = ConstructError("Peer is not a leader", protocol::raft::Error::Code::Error_Code_NOT_LEADER);
+      return std::make_tuple(reply, err);
+    }
+    if (!caught_up) {
+      m_transferring.store(false);
+      reply.set_ok(false);
+      grpc::Status err = ConstructError("Transfer target did not catch up with the leader", protocol::raft::Error::Code::Error_Code_TIMEOUT);
+      return std::make_tuple(reply, err);
+    }
+  }
+
+  auto address = m_configuration->PeerAddress(target_id);
+  DLOG(INFO) << "Transferring leadership to " << address;
+  protocol::raft::TimeoutNow_Response timeout_reply;
+  grpc::Status status = m_ctx.ClientInstance()->TimeoutNow(address, m_group_id, saved_term, timeout_reply);
+  if (!status.ok()) {
+    DLOG(INFO) << "Unable to send TimeoutNow to " << address << ": " << status.error_message();
+    m_transferring.store(false);
+    reply.set_ok(false);
+    return std::make_tuple(reply, status);
+  }
+
+  // Heartbeat replies from the target carry its new term, causing the LEADER to step down
+  {
+    std::lock_guard<std::mutex> lock(m_replication_lock);
+    RequestHeartbeatRound();
+  }
+  {
+    std::unique_lock<std::mutex> lock(m_apply_lock);
+    m_apply_sync.wait_for(lock, milliseconds(ElectionTimeout()), [this, saved_term] {
+      return Term() != saved_term;
+    });
+  }
+  m_transferring.store(false);
+
+  if (Term() == saved_term) {
+    reply.set_ok(false);
+    grpc::Status err = ConstructError("Transfer target was not elected", protocol::raft::Error::Code::Error_Code_TIMEOUT);
+    return std::make_tuple(reply, err);
+  }
+
+  reply.set_ok(true);
+  reply.set_leaderhint(address);
+  return std::make_tuple(reply, grpc::Status::OK);
+}
+
+std::tuple<protocol::raft::TimeoutNow_Response, grpc::Status> ConsensusModule::ProcessTimeoutNowClientRequest(
+    protocol::raft::TimeoutNow_Request& request) {
+  protocol::raft::TimeoutNow_Response reply;
+  if (State() == RaftState::DEAD) {
+    return std::make_tuple(reply, grpc::Status::CANCELLED);
+  }
+
+  reply.set_term(Term());
+  if (request.term() != Term() || State() != RaftState::FOLLOWER) {
+    grpc::Status err = ConstructError("Leadership transfer is from a different term", protocol::raft::Error::Code::Error_Code_OUT_OF_DATE);
+    return std::make_tuple(reply, err);
+  }
+
+  // Election is started on the timer executor so it is serialized with the election timer
+  DLOG(INFO) << "Starting election requested by " << request.leaderid();
+  m_timer_executor->Enqueue(std::bind(&ConsensusModule::StartElection, this, Term(), true));
+  return std::make_tuple(reply, grpc::Status::OK);
+}
+
 }
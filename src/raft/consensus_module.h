@@ -6,10 +6,13 @@
 #include <chrono>
 #include <condition_variable>
 #include <functional>
+#include <future>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <random>
 #include <string>
+#include <string_view>
 #include <tuple>
 #include <utility>
 #include <vector>
@@ -17,20 +20,23 @@
 #include "async_executor.h"
 #include "cluster_configuration.h"
 #include "inmemory_store.h"
+#include "peer_progress.h"
 #include "raft.grpc.pb.h"
+#include "raft_options.h"
+#include "range_policy.h"
 #include "session_cache.h"
 #include "state_machine.h"
 #include "timer.h"
 
 namespace raft {
 
+const int MAX_SCAN_LIMIT = 1000;
+const size_t RANGE_MOVE_CHUNK_BYTES = 256 * 1024;
+const int RANGE_MOVE_PAGE = 1000;
+
 class GlobalCtxManager;
 class ConsensusModuleTest;
 
-const int ELECTION_TIMEOUT = 1000;
-const int HEARTBEAT_TIMEOUT = 500;
-const int LEADER_LEASE_TIMEOUT = 900;
-
 class ConsensusModule {
 public:
   using clock_type = std::chrono::steady_clock;
@@ -41,7 +47,7 @@ public:
     /**
      * Indicates that this node should handle all read/write requests.
      * Only 1 node can be a LEADER in a cluster at any time.
-     * Every 200ms a LEADER will send a heartbeat message to reset election
+     * Every heartbeat interval a LEADER will send a heartbeat message to reset election
      * timers and synchronize entries in the raft log. Resets to a FOLLOWER
      * if term is out of date (can happen if node gets
      * partitioned).
@@ -55,7 +61,7 @@ public:
      */
     CANDIDATE,
     /**
-     * Stable state running an election timer every 450-600ms. If a heartbeat message
+     * Stable state running a randomized election timer. If a heartbeat message
      * is received from the cluster LEADER the timer is reset. Otherwise, a new
      * election is started and the node is promoted to CANDIDATE.
      */
@@ -68,7 +74,13 @@ public:
   };
 
 public:
-  ConsensusModule(GlobalCtxManager& ctx);
+  /**
+   * @param ctx the node's shared components
+   * @param group_id the raft group replicated by this consensus module
+   * @param store_directory the directory holding the store's tables, empty to keep the
+   *    store in memory only
+   */
+  ConsensusModule(GlobalCtxManager& ctx, const int group_id = 0, const std::string& store_directory = "");
 
   ConsensusModule(const ConsensusModule&) = delete;
   ConsensusModule& operator=(const ConsensusModule&) = delete;
@@ -88,6 +100,35 @@ public:
    */
   int Term() const;
 
+  /**
+   * Retrieve the id of the raft group replicated by this node.
+   *
+   * @return m_group_id
+   */
+  int GroupId() const;
+
+  /**
+   * Retrieve the address of a peer. Ids of servers that left the cluster are recycled,
+   * so replies from the id's previous server must be dropped.
+   *
+   * @param peer_id the id of the peer within this group
+   * @returns the ip address of the peer, empty if the id is unassigned
+   */
+  std::string PeerAddress(const int peer_id) const;
+
+  /**
+   * Retrieve the store of the group's state machine.
+   *
+   * @return m_store
+   */
+  std::shared_ptr<InmemoryStore> Store() const;
+
+  /**
+   * Finds the group serving a key according to this group's range directory, which is
+   * complete for group 0.
+   */
+  int RangeGroup(std::string_view key) const;
+
   /**
    * Retrieve state of node (LEADER, CANDIDATE, FOLLOWER, DEAD).
    *
@@ -138,8 +179,31 @@ public:
 
   void InjectTimers(
       std::shared_ptr<core::DeadlineTimer> election_timer,
-      std::shared_ptr<core::DeadlineTimer> heartbeat_timer,
-      std::shared_ptr<core::DeadlineTimer> lease_timer);
+      std::shared_ptr<core::DeadlineTimer> heartbeat_timer);
+
+  /**
+   * Determines whether the node is a LEADER holding the leader lease. While the lease is
+   * held no other node can have been elected, so reads can be served without contacting
+   * a quorum.
+   *
+   * @returns whether the lease is held
+   */
+  bool LeaseHolder() const;
+
+  /**
+   * Retrieve the election timeout in ms before jitter is added. Fixed unless adaptive
+   * timeouts are enabled.
+   *
+   * @return m_base_election_timeout
+   */
+  int ElectionTimeout() const;
+
+  /**
+   * Retrieve the interval in ms between heartbeats sent while LEADER.
+   *
+   * @return m_heartbeat_interval
+   */
+  int HeartbeatInterval() const;
 
   /**
    * Handles RequestVote RPC request. If the node has yet to vote and the
@@ -162,11 +226,12 @@ public:
    *
    * @param request the RequestVote RPC that was sent to the server
    * @param reply the reply message sent from the server
+   * @param peer_id the id of the server that responded
    */
   void ProcessRequestVoteServerResponse(
       protocol::raft::RequestVote_Request& request,
       protocol::raft::RequestVote_Response& reply,
-      const std::string& address);
+      const int peer_id);
 
   /**
    * Handles AppendEntries RPC request. Compares raft log indices to append
@@ -190,37 +255,201 @@ public:
    *
    * @param request the AppendEntries RPC that was sent to the server
    * @param reply the AppendEntries RPC response that was sent from the server
-   * @param address the ip address of the server that responded
+   * @param peer_id the id of the server that responded
+   * @param round the heartbeat round in which the request was sent
+   * @param send_time the time at which the request was sent
    */
   void ProcessAppendEntriesServerResponse(
       protocol::raft::AppendEntries_Request& request,
       protocol::raft::AppendEntries_Response& reply,
-      const std::string& address);
+      const int peer_id,
+      const int round,
+      const time_point send_time);
+
+  /**
+   * Handles AppendEntries RPCs that failed to reach a server. The server is moved back
+   * to PROBE so that it is not sent entries until it responds again.
+   *
+   * @param request the AppendEntries RPC that was sent to the server
+   * @param peer_id the id of the server that failed to respond
+   */
+  void ProcessAppendEntriesServerFailure(
+      protocol::raft::AppendEntries_Request& request,
+      const int peer_id);
 
   std::tuple<protocol::raft::GetConfiguration_Response, grpc::Status> ProcessGetConfigurationClientRequest();
 
+  /**
+   * Handles membership change requests. The new servers start catching up with the log and
+   * the request returns immediately with an operation id. The change is then driven by
+   * replication replies, commits and heartbeats rather than blocking the RPC thread.
+   *
+   * @param request the SetConfiguration RPC sent from the client
+   * @returns SetConfiguration RPC response containing the operation id
+   */
   std::tuple<protocol::raft::SetConfiguration_Response, grpc::Status> ProcessSetConfigurationClientRequest(
       protocol::raft::SetConfiguration_Request& request);
 
+  /**
+   * Handles requests for the progress of a membership change started by SetConfiguration.
+   *
+   * @param request the GetConfigurationStatus RPC sent from the client
+   * @returns GetConfigurationStatus RPC response containing the state of the change
+   */
+  std::tuple<protocol::raft::GetConfigurationStatus_Response, grpc::Status> ProcessGetConfigurationStatusClientRequest(
+      protocol::raft::GetConfigurationStatus_Request& request);
+
+  /**
+   * Handles requests to add a non-voting learner. Since learners do not affect quorums the
+   * new configuration is appended directly without joint consensus. Learners are promoted
+   * to voters with SetConfiguration once they have caught up. Waits up to an election
+   * timeout for the configuration to be applied, so it must not run on the RPC thread.
+   *
+   * @param request the AddLearner RPC sent from the client
+   * @returns AddLearner RPC response containing the id of the new configuration
+   */
+  std::tuple<protocol::raft::AddLearner_Response, grpc::Status> ProcessAddLearnerClientRequest(
+      protocol::raft::AddLearner_Request& request);
+
   std::tuple<protocol::raft::RegisterClient_Response, grpc::Status> ProcessRegisterClientClientRequest();
 
   std::tuple<protocol::raft::ClientRequest_Response, grpc::Status> ProcessClientRequestClientRequest(
       protocol::raft::ClientRequest_Request& request);
 
+  using read_callback = std::function<void(const int read_index, grpc::Status status)>;
+
+  /**
+   * Obtains the index at which a linearizable read can be served without blocking. The
+   * LEADER confirms leadership with a heartbeat round shared by every read waiting for
+   * it, while FOLLOWERs share one ReadIndex RPC to the LEADER between the reads that
+   * arrived before it was sent. The callback runs on the thread that completes the round
+   * or RPC and must not block.
+   *
+   * @param callback receives the read index and a status indicating whether it was confirmed
+   */
+  void ReadIndexAsync(read_callback callback);
+
+  /**
+   * Handles ReadIndex RPC requests from FOLLOWERs serving reads. Confirms leadership
+   * before replying with the read index, without blocking the caller.
+   *
+   * @param callback receives the ReadIndex RPC response containing the index FOLLOWERs
+   *    must apply before reading
+   */
+  void ProcessReadIndexClientRequest(
+      std::function<void(protocol::raft::ReadIndex_Response, grpc::Status)> callback);
+
+  /**
+   * Handles requests for the key ranges of the state machine. Served by any node from its
+   * own state machine, so FOLLOWERs may lag behind the LEADER's partitioning.
+   *
+   * @returns GetRanges RPC response containing every range in key order
+   */
+  std::tuple<protocol::raft::GetRanges_Response, grpc::Status> ProcessGetRangesClientRequest();
+
+  /**
+   * Handles range scans. Each page is served at the requested consistency level like a
+   * ClientQuery, pages are not a consistent snapshot of the store.
+   *
+   * @param request the Scan RPC sent from the client
+   * @returns Scan RPC response containing a page of entries in key order
+   */
+  std::tuple<protocol::raft::Scan_Response, grpc::Status> ProcessScanClientRequest(
+      protocol::raft::Scan_Request& request);
+
+  /**
+   * Handles the steps of a range move that another group's LEADER asks this group to
+   * apply, either part of the range's values for the target group or the new assignment
+   * for group 0's range directory. Blocks until the entry is applied or the node steps
+   * down.
+   *
+   * @param request the ApplyRangeMove RPC sent from the LEADER moving the range
+   * @returns ApplyRangeMove RPC response containing the index of the applied entry
+   */
+  std::tuple<protocol::raft::ApplyRangeMove_Response, grpc::Status> ProcessApplyRangeMoveClientRequest(
+      protocol::raft::ApplyRangeMove_Request& request);
+
+  /**
+   * Handles read requests at the requested consistency level. Linearizable reads use the
+   * ReadIndex protocol: the LEADER records the commit index when the read arrives and
+   * confirms leadership by a quorum acknowledging a heartbeat round started after the
+   * read arrived, while FOLLOWERs obtain the read index from the LEADER. Lease reads are
+   * served by the LEADER while it holds the lease. Bounded staleness reads are served by
+   * any node that heard from the LEADER (or a quorum, for the LEADER) within the bound.
+   * The read is served once the state machine has applied the read index and the
+   * minimum index requested by the client.
+   *
+   * @param request the ClientQuery RPC sent from the client
+   * @returns ClientQuery RPC response containing the value read
+   */
   std::tuple<protocol::raft::ClientQuery_Response, grpc::Status> ProcessClientQueryClientRequest(
       protocol::raft::ClientQuery_Request& request);
 
+  /**
+   * Handles requests to hand leadership to a FOLLOWER, e.g. before restarting the LEADER.
+   * New writes are rejected while the FOLLOWER is brought up to date, after which it is
+   * sent a TimeoutNow RPC so it starts an election without waiting for its election timer.
+   * Blocks for up to two election timeouts, so it must not run on the RPC thread.
+   *
+   * @param request the TransferLeadership RPC sent from the client
+   * @returns TransferLeadership RPC response indicating whether another node was elected
+   */
+  std::tuple<protocol::raft::TransferLeadership_Response, grpc::Status> ProcessTransferLeadershipClientRequest(
+      protocol::raft::TransferLeadership_Request& request);
+
+  /**
+   * Handles TimeoutNow RPC requests from the LEADER by immediately starting an election.
+   *
+   * @param request the TimeoutNow RPC sent from the LEADER
+   * @returns TimeoutNow RPC response containing the current raft term
+   */
+  std::tuple<protocol::raft::TimeoutNow_Response, grpc::Status> ProcessTimeoutNowClientRequest(
+      protocol::raft::TimeoutNow_Request& request);
+
 private:
   /**
-   * Callback for ScheduleElection when election timer times out. Promotes node to
-   * CANDIDATE state and sends RequestVote RPCs to all nodes to get votes.
-   * Starts a new election timer in case a CANDIDATE in cluster does not get
-   * a majority of votes within timeout.
+   * Callback for ScheduleElection when election timer times out. Starts a pre-vote by
+   * sending RequestVote RPCs for the next term without incrementing the term, so a node
+   * that cannot win an election (e.g. rejoining after a partition) does not force the
+   * LEADER to step down. Starts a new election timer in case a majority is not reached
+   * within timeout.
    *
    * @param term the raft term when the election was originally scheduled
    */
   void ElectionCallback(const int term);
 
+  /**
+   * Promotes node to CANDIDATE state and sends RequestVote RPCs to all nodes to get votes
+   * once a majority granted the pre-vote. Starts a new election timer in case a CANDIDATE
+   * in cluster does not get a majority of votes within timeout.
+   *
+   * @param term the raft term in which the pre-vote was held
+   * @param leadership_transfer whether the election was requested by the LEADER
+   */
+  void StartElection(const int term, const bool leadership_transfer = false);
+
+  /**
+   * Sends RequestVote RPCs to every other node in the cluster configuration.
+   *
+   * @param term the term the node is campaigning for
+   * @param pre_vote whether the RPCs are for a pre-vote
+   * @param leadership_transfer whether the election was requested by the LEADER
+   */
+  void BroadcastRequestVote(const int term, const bool pre_vote, const bool leadership_transfer);
+
+  /**
+   * Handles a reply to a pre-vote RequestVote RPC, starting an election once a majority
+   * granted the pre-vote.
+   *
+   * @param request the RequestVote RPC that was sent to the server
+   * @param reply the reply message sent from the server
+   * @param peer_id the id of the server that responded
+   */
+  void ProcessPreVoteServerResponse(
+      protocol::raft::RequestVote_Request& request,
+      protocol::raft::RequestVote_Response& reply,
+      const int peer_id);
+
   /**
    * Callback for ScheduleHeartbeat when heartbeat timer times out. Only called by node
    * that is a LEADER. Sends heartbeat message to other nodes to indicate that the cluster
@@ -228,7 +457,22 @@ private:
    */
   void HeartbeatCallback();
 
-  void LeaseExpiryCallback();
+  /**
+   * Starts a new heartbeat round by sending AppendEntries RPCs to every FOLLOWER.
+   * Used by the heartbeat timer and by reads waiting to confirm leadership.
+   *
+   * @param coalesce whether empty heartbeats may be batched with other groups' heartbeats
+   */
+  void BroadcastHeartbeat(const bool coalesce = false);
+
+  /**
+   * Determines whether a majority of the cluster acknowledged RPCs from this LEADER within
+   * the election timeout. Otherwise the LEADER may be partitioned from the cluster and
+   * steps down so clients can find the LEADER elected by the majority.
+   *
+   * @returns whether the LEADER is in contact with a quorum
+   */
+  bool QuorumActive();
 
   /**
    * Creates an election timer with a random timeout to trigger an election on expiry.
@@ -245,6 +489,26 @@ private:
    */
   void ScheduleHeartbeat();
 
+  /**
+   * Retrieves the replication progress of a FOLLOWER, creating it in the PROBE state
+   * if the FOLLOWER was not previously known. Requires m_replication_lock.
+   *
+   * @param peer_id the id of the FOLLOWER
+   * @returns replication progress of the FOLLOWER
+   */
+  PeerProgress& Progress(const int peer_id);
+
+  /**
+   * Sends an AppendEntries RPC to a FOLLOWER based on its replication progress. Entries
+   * are only sent if the progress is not paused, otherwise an empty heartbeat is sent.
+   * Requires m_replication_lock.
+   *
+   * @param peer_id the id of the FOLLOWER
+   * @param progress replication progress of the FOLLOWER
+   * @param coalesce whether an empty heartbeat may be sent in a CoalescedHeartbeat RPC
+   */
+  void SendAppendEntries(const int peer_id, PeerProgress& progress, const bool coalesce = false);
+
   /**
    * Persists raft metadata (term, vote) to disk.
    */
@@ -255,13 +519,210 @@ private:
    */
   void Shutdown();
 
+  /**
+   * Appends an entry created by the LEADER, stamping it with the LEADER's wall clock time.
+   * Holds m_append_lock.
+   *
+   * @returns the index of the entry
+   */
   int Append(protocol::log::LogEntry& log_entry);
-  std::pair<int, int> Append(std::vector<protocol::log::LogEntry>& log_entries);
 
-  void CommitEntries(int start_index, std::vector<protocol::log::LogEntry>& log_entries);
+  /**
+   * Appends an entry like Append if the node still leads in a term. Used by range moves,
+   * which run off the timer executor and may outlive the node's leadership.
+   *
+   * @param term the term the entry was created in
+   * @returns the index of the entry, or -1 if the node no longer leads in the term
+   */
+  int AppendInTerm(protocol::log::LogEntry& log_entry, const int term);
+
+  /**
+   * Requires m_append_lock.
+   */
+  int AppendLocked(protocol::log::LogEntry& log_entry);
+
+  /**
+   * Appends entries received from the LEADER. Holds m_append_lock.
+   *
+   * @param serialized_entries the bytes of each entry as received, written to the log as is
+   */
+  std::pair<int, int> Append(
+      std::vector<protocol::log::LogEntry>& log_entries,
+      const std::vector<std::shared_ptr<const std::string>>& serialized_entries);
+
+  /**
+   * Applies committed entries that have not been applied to the state machine and wakes
+   * up requests waiting for their entries to be applied.
+   */
+  void ApplyCommittedEntries();
 
   void UpdateCommitIndex();
 
+  /**
+   * Moves the active membership change to its next stage. Appends the joint configuration
+   * once the new servers have caught up, completes the change once the new configuration is
+   * committed and fails it if the log sync stalls or the node is no longer LEADER.
+   */
+  void AdvanceMembershipChange();
+
+  /**
+   * Marks the active membership change as finished. Requires m_membership_lock.
+   */
+  void FinishMembershipChange(protocol::raft::MembershipChangeState state, const std::string& error);
+
+  /**
+   * Blocking form of ReadIndexAsync.
+   *
+   * @returns the read index and a status indicating whether it was confirmed
+   */
+  std::tuple<int, grpc::Status> ReadIndex();
+
+  /**
+   * Obtains a read index from the LEADER so that a FOLLOWER can serve linearizable reads.
+   * Blocks until the LEADER replies.
+   *
+   * @returns the read index and the status of the request to the LEADER
+   */
+  std::tuple<int, grpc::Status> ForwardReadIndex();
+
+  /**
+   * Sends ReadIndex RPCs on m_forward_executor until no forwarded reads are waiting. Each
+   * RPC answers the reads queued before it was sent.
+   */
+  void ForwardPendingReads();
+
+  /**
+   * Completes the pending reads whose heartbeat round was confirmed, and fails those that
+   * timed out or whose LEADER stepped down.
+   */
+  void CompletePendingReads();
+
+  /**
+   * Determines the read index for reads served by the LEADER while it holds the lease.
+   *
+   * @returns the commit index and a status indicating whether the lease is held
+   */
+  std::tuple<int, grpc::Status> LeaseReadIndex();
+
+  /**
+   * Determines the read index for bounded staleness reads. The node's data is as fresh as
+   * its last contact with the LEADER, provided it applied the commit index known then.
+   *
+   * @param max_staleness the maximum age of the last contact
+   * @returns the read index, the time after which the read would exceed the staleness
+   *    bound and a status indicating whether the node is fresh enough
+   */
+  std::tuple<int, time_point, grpc::Status> StaleReadIndex(milliseconds max_staleness);
+
+  /**
+   * Waits until the store can serve a read at a consistency level.
+   *
+   * @param consistency the consistency level requested by the client
+   * @param min_index the minimum index the node must have applied
+   * @param max_staleness_ms the staleness bound of BOUNDED_STALENESS reads
+   * @returns the index applied by the node and a status indicating whether the read can
+   *    be served
+   */
+  std::tuple<int, grpc::Status> AwaitReadIndex(
+      protocol::raft::ConsistencyLevel consistency,
+      int min_index,
+      int max_staleness_ms);
+
+  /**
+   * Waits until a read can be served and opens a store snapshot to serve it from, so
+   * the read is unaffected by entries applied while it runs.
+   *
+   * @param snapshot_index the index to read at, or 0 for the latest applied index
+   * @returns the snapshot and a status indicating whether the read can be served
+   */
+  std::tuple<std::unique_ptr<InmemoryStore::Snapshot>, grpc::Status> OpenReadSnapshot(
+      protocol::raft::ConsistencyLevel consistency,
+      int min_index,
+      int max_staleness_ms,
+      int snapshot_index);
+
+  /**
+   * Determines the latest time at which a quorum of nodes was known to follow this
+   * LEADER. Requires m_replication_lock.
+   *
+   * @returns time of the last quorum contact
+   */
+  time_point QuorumContactTime();
+
+  /**
+   * Derives the election timeout and heartbeat interval from the p99 round trip time to
+   * the voting FOLLOWERs. The heartbeat interval keeps its configured ratio to the
+   * election timeout. Requires m_replication_lock.
+   */
+  void AdaptTimeouts();
+
+  /**
+   * Adopts the election timeout advertised by the LEADER, clamped to the configured bounds.
+   *
+   * @param election_timeout the timeout in ms from an AppendEntries RPC, 0 if not adaptive
+   */
+  void AdoptElectionTimeout(const int election_timeout);
+
+  /**
+   * Appends a range split, merge or move proposed by the range policy. Evaluated at most
+   * once every RANGE_CHECK_INTERVAL and only once the previous range change has been
+   * applied. Moves out of the group that are not finished, including moves started by a
+   * previous LEADER, are resumed first.
+   */
+  void MaybeChangeRanges();
+
+  /**
+   * Finishes moving a range out of the group after its RANGE_MOVE_OUT was applied. The
+   * range's values are sent to the target group in chunks of RANGE_MOVE_CHUNK_BYTES,
+   * group 0 records the target in the range directory, and the group finally appends a
+   * RANGE_MOVE_DONE deleting its copy. Every step can be repeated, so a failed move is
+   * resumed from the start at the next range check. Runs on m_move_executor.
+   */
+  void MoveRange(protocol::log::RangeMove move);
+
+  /**
+   * Asks the LEADER of a group to apply a step of a range move, calling the local
+   * consensus module directly if it leads the group. Blocks until the step is applied.
+   *
+   * @param group_id the group applying the step
+   * @param type RANGE_MOVE_IN or RANGE_ASSIGN
+   * @returns status of the request
+   */
+  grpc::Status SendRangeMove(const int group_id, protocol::log::LogOpCode type, const protocol::log::RangeMove& move);
+
+  /**
+   * Rejects a request for a key the group does not serve. Points the client at the group
+   * serving the key according to the node's copy of group 0's range directory, or asks
+   * it to retry while the range is still moving to this group.
+   */
+  grpc::Status WrongGroupError(std::string_view key) const;
+
+  /**
+   * Appends a NO_OP once a value in the store is due to expire, so that keys expire even
+   * when no other entries are appended. Only one such entry is outstanding at a time.
+   */
+  void MaybeAdvanceClock();
+
+  /**
+   * Extends the leader lease to the configured lease timeout past the time at which a quorum was
+   * last known to follow this LEADER. Requires m_replication_lock.
+   */
+  void UpdateLease();
+
+  /**
+   * Requests a heartbeat round that starts after the call, sharing a pending round
+   * between concurrent reads. Requires m_replication_lock.
+   *
+   * @returns the heartbeat round that must be acknowledged by a quorum
+   */
+  int RequestHeartbeatRound();
+
+  /**
+   * Recomputes the latest heartbeat round acknowledged by a quorum and completes reads
+   * waiting on it. Requires m_replication_lock.
+   */
+  void UpdateConfirmedRound();
+
   grpc::Status ConstructError(std::string err_msg, protocol::raft::Error::Code code) const;
 
 private:
@@ -271,6 +732,11 @@ private:
    */
   GlobalCtxManager& m_ctx;
 
+  /**
+   * Id of the raft group, included in every RPC so the receiving node can route it.
+   */
+  const int m_group_id;
+
   std::unique_ptr<ClusterConfiguration> m_configuration;
 
   /**
@@ -292,21 +758,30 @@ private:
   std::shared_ptr<core::DeadlineTimer> m_heartbeat_timer;
 
   /**
-   * Asynchronous timer used by LEADER to renew leader leases. Expires
-   * after 900ms causing the LEADER to step down and become a FOLLOWER.
+   * The address of the CANDIDATE node that this node voted for. 
    */
-  std::shared_ptr<core::DeadlineTimer> m_lease_timer;
+  std::string m_vote;
 
   /**
-   * The address of the CANDIDATE node that this node voted for. 
+   * The number of votes the node received as a CANDIDATE.
    */
-  std::string m_vote;
+  int m_votes_received;
 
   /**
-   * The number of votes the node received as a CANDIDATE. Used to determine
+   * Ids of the nodes that voted for this node as a CANDIDATE. Used to determine
    * whether it received a majority and can be promoted to LEADER.
    */
-  int m_votes_received;
+  PeerSet m_granted_votes;
+
+  /**
+   * Ids of the nodes that granted the pre-vote for the next term.
+   */
+  PeerSet m_granted_pre_votes;
+
+  /**
+   * Id of this node in the cluster configuration.
+   */
+  int m_self_id;
 
   /**
    * The raft term of the node. Used to determine whether a node is out of date.
@@ -332,17 +807,21 @@ private:
   std::atomic<int> m_commit_index;
 
   /**
-   * Index of the next log entry to send to each other node. Used to determine the index
-   * where new log entries from the LEADER will be replicated.
+   * Replication progress of each other node indexed by peer id. Tracks the next index to
+   * send, the highest index replicated and the flow control state used by the replication loop.
    */
-  std::unordered_map<std::string, int> m_next_index;
+  std::vector<PeerProgress> m_progress;
 
   /**
-   * Index of the highest log entry that has been replicated on each other node.
-   * Used to determine when an entry can be committed (when a majority of nodes
-   * have a match index >= N).
+   * Ids of the nodes with valid entries in m_progress.
    */
-  std::unordered_map<std::string, int> m_match_index;
+  PeerSet m_tracked_peers;
+
+  /**
+   * Guards m_progress since the replication loop runs on the timer executor while
+   * AppendEntries replies are processed on the client completion queue thread.
+   */
+  std::mutex m_replication_lock;
 
   /**
    * The address of the current LEADER node. Useful as a hint when handling requests
@@ -351,11 +830,19 @@ private:
   std::string m_leader_id;
 
   /**
-   * The randomly generated [450, 600] delay in ms after which an election will begin.
-   * Used for calculating the election deadline.
+   * The randomly generated delay in ms after which an election will begin, between the
+   * base election timeout and the base plus jitter. Used for calculating the election deadline.
    */
   milliseconds m_election_timeout;
 
+  /**
+   * Election timeout in ms before jitter. Derived from round trip times by the LEADER and
+   * learnt from AppendEntries RPCs by FOLLOWERs when adaptive timeouts are enabled.
+   */
+  std::atomic<int> m_base_election_timeout;
+
+  std::atomic<int> m_heartbeat_interval;
+
   /**
    * The time at which the node will start an election. Useful for rejecting RequestVote
    * RPCs from nodes that have been removed from the cluster configuration.
@@ -363,29 +850,158 @@ private:
   time_point m_election_deadline;
 
   /**
-   * The time at which the node sent heartbeats messages. Useful for determining the offset
-   * at which the leader lease can start.
+   * The time at which the leader lease expires. Every reply extends the lease from the
+   * time at which a quorum last acknowledged RPCs, measured from when those RPCs were sent
+   * since FOLLOWERs reset their election timers on receipt.
    */
-  time_point m_heartbeat_time;
+  std::atomic<time_point> m_lease_expiry;
 
-  std::atomic<bool> m_lease_holder;
+  /**
+   * The time at which the node was promoted to LEADER. FOLLOWERs have not acknowledged
+   * any RPCs at this point so check-quorum only applies after an election timeout.
+   */
+  time_point m_leader_start;
 
-  std::atomic<bool> m_renew_lease;
+  /**
+   * Index of the first entry appended in the current term as LEADER. Until it is committed
+   * the LEADER does not know whether its commit index is up to date.
+   */
+  std::atomic<int> m_term_start_index;
+
+  /**
+   * Heartbeat rounds used by ReadIndex. Every broadcast starts a new round, and every
+   * AppendEntries RPC is tagged with the round in which it was sent. Guarded by
+   * m_replication_lock.
+   */
+  int m_heartbeat_round;
+
+  /**
+   * Set while a broadcast requested by a read has been queued but not yet sent.
+   */
+  bool m_heartbeat_pending;
+
+  /**
+   * Latest heartbeat round acknowledged by a quorum.
+   */
+  std::atomic<int> m_confirmed_round;
+
+  std::mutex m_read_lock;
+
+  /**
+   * Time of the last AppendEntries RPC accepted from the LEADER and the LEADER's commit
+   * index at that time. Used by FOLLOWERs to bound the staleness of local reads. Guarded
+   * by m_apply_lock.
+   */
+  time_point m_leader_contact;
+  int m_leader_commit_index;
+
+  struct PendingRead {
+    int round;
+    int term;
+    int read_index;
+    time_point deadline;
+    read_callback callback;
+  };
+
+  /**
+   * Reads waiting for a quorum to acknowledge a heartbeat round. Guarded by m_read_lock.
+   */
+  std::vector<PendingRead> m_pending_reads;
+
+  /**
+   * Reads waiting for the next ReadIndex RPC to the LEADER, and whether one is queued or
+   * in flight. Guarded by m_read_lock.
+   */
+  std::vector<read_callback> m_forwarded_reads;
+  bool m_forward_pending;
 
-  std::unordered_set<std::string> m_responding_peers;
+  /**
+   * Sends ReadIndex RPCs for FOLLOWERs, which block until the LEADER replies.
+   */
+  std::shared_ptr<core::Strand> m_forward_executor;
 
   std::shared_ptr<SessionCache> m_session;
 
-  std::condition_variable m_membership_sync;
+  struct MembershipChange {
+    protocol::raft::MembershipChangeState state;
+    int term;
+    std::vector<protocol::log::Server> servers;
+    int joint_id;
+    int configuration_id;
+    time_point last_progress;
+    std::string error;
+  };
+
+  /**
+   * Guards membership changes. Acquired after m_replication_lock.
+   */
+  std::mutex m_membership_lock;
+
+  /**
+   * Membership changes started on this node, indexed by operation id.
+   */
+  std::map<int, MembershipChange> m_membership_changes;
+  int m_active_change;
+  int m_next_change_id;
+
+  /**
+   * Set while the LEADER is handing leadership to another node. New writes are rejected so
+   * the target can catch up with the LEADER's log.
+   */
+  std::atomic<bool> m_transferring;
 
-  std::condition_variable m_session_sync;
+  /**
+   * Notified when a FOLLOWER's match index advances during a leadership transfer. Used with
+   * m_replication_lock.
+   */
+  std::condition_variable m_transfer_sync;
 
-  std::condition_variable m_write_command_sync;
+  /**
+   * Serializes changes to the group's raft log, which the write, admin, timer and move
+   * executors append to concurrently. Held from assigning an entry's index until its
+   * configuration is recorded, so configurations are inserted in log order. Acquired
+   * after the other locks of the module.
+   */
+  std::mutex m_append_lock;
+
+  /**
+   * Guards applying entries to the state machine. Reads from the store do not hold it
+   * since they are served from store snapshots.
+   */
+  std::mutex m_apply_lock;
+
+  /**
+   * Notified when entries are applied or the node steps down.
+   */
+  std::condition_variable m_apply_sync;
 
   std::shared_ptr<InmemoryStore> m_store;
 
   std::unique_ptr<StateMachine> m_state_machine;
 
+  /**
+   * State of automatic range splits and merges, only accessed by the timer executor.
+   */
+  RangePolicy m_range_policy;
+  time_point m_last_range_check;
+
+  /**
+   * Log index of the latest range change appended by this node.
+   */
+  std::atomic<int> m_range_change_index;
+
+  /**
+   * Runs MoveRange, which blocks on the target group and group 0, and whether a move is
+   * queued or running. Only the timer executor starts moves.
+   */
+  std::shared_ptr<core::Strand> m_move_executor;
+  std::atomic<bool> m_move_running;
+
+  /**
+   * Log index of the latest NO_OP appended to advance the state machine's time.
+   */
+  int m_clock_index;
+
   friend class ConsensusModuleTest;
 };
 
@@ -7,17 +7,28 @@
 
 namespace raft {
 
-GlobalCtxManager::GlobalCtxManager(const std::string& address)
+GlobalCtxManager::GlobalCtxManager(
+    const std::string& address,
+    const RaftOptions& options,
+    const int group_count,
+    const std::string& data_directory)
   : address(address)
-  , m_consensus(std::make_shared<ConsensusModule>(*this))
+  , options(options)
+  , m_data_directory(data_directory)
   , m_client(std::make_shared<RaftClientImpl>(*this))
   , m_server(std::make_shared<RaftServerImpl>(*this))
-  , m_log(std::make_shared<PersistedLog>("/data/raft/", true))
   , m_timer_queue(std::make_shared<core::TimerQueue>()) {
+  for (int group_id = 0; group_id < group_count; group_id++) {
+    m_consensus.push_back(std::make_shared<ConsensusModule>(*this, group_id, GroupDirectory(group_id) + "store/"));
+    m_log.push_back(std::make_shared<PersistedLog>(GroupDirectory(group_id), true));
+  }
 }
 
-std::shared_ptr<ConsensusModule> GlobalCtxManager::ConsensusInstance() const {
-  return m_consensus;
+std::shared_ptr<ConsensusModule> GlobalCtxManager::ConsensusInstance(const int group_id) const {
+  if (group_id < 0 || group_id >= m_consensus.size()) {
+    return nullptr;
+  }
+  return m_consensus[group_id];
 }
 
 std::shared_ptr<RaftClientImpl> GlobalCtxManager::ClientInstance() const {
@@ -28,13 +39,27 @@ std::shared_ptr<RaftServerImpl> GlobalCtxManager::ServerInstance() const {
   return m_server;
 }
 
-std::shared_ptr<Log> GlobalCtxManager::LogInstance() const {
-  return m_log;
+std::shared_ptr<Log> GlobalCtxManager::LogInstance(const int group_id) const {
+  if (group_id < 0 || group_id >= m_log.size()) {
+    return nullptr;
+  }
+  return m_log[group_id];
 }
 
 std::shared_ptr<core::TimerQueue> GlobalCtxManager::TimerQueueInstance() const {
   return m_timer_queue;
 }
 
+int GlobalCtxManager::GroupCount() const {
+  return m_consensus.size();
+}
+
+std::string GlobalCtxManager::GroupDirectory(const int group_id) const {
+  if (group_id == 0) {
+    return m_data_directory;
+  }
+  return m_data_directory + "group-" + std::to_string(group_id) + "/";
+}
+
 }
 
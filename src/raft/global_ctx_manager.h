@@ -6,6 +6,7 @@
 #include <string>
 #include <vector>
 
+#include "raft_options.h"
 #include "timer.h"
 
 namespace raft {
@@ -16,25 +17,65 @@ class Log;
 class RaftClientImpl;
 class RaftServerImpl;
 
+const std::string LOG_DIRECTORY = "/data/raft/";
+
+/**
+ * Owns the components of a node. A node hosts one or more raft groups, each with its own
+ * consensus module and log, which share the gRPC server, client channels and timer queue.
+ */
 class GlobalCtxManager {
 public:
-  GlobalCtxManager(const std::string& address);
+  /**
+   * @param data_directory the directory holding the logs and stores of the raft groups
+   */
+  GlobalCtxManager(
+      const std::string& address,
+      const RaftOptions& options = RaftOptions(),
+      const int group_count = 1,
+      const std::string& data_directory = LOG_DIRECTORY);
 
-  std::shared_ptr<ConsensusModule> ConsensusInstance() const;
+  /**
+   * Retrieve the consensus module of a raft group.
+   *
+   * @param group_id the id of the raft group
+   * @returns the consensus module, or nullptr if the group is not hosted by this node
+   */
+  std::shared_ptr<ConsensusModule> ConsensusInstance(const int group_id = 0) const;
   std::shared_ptr<RaftClientImpl> ClientInstance() const;
   std::shared_ptr<RaftServerImpl> ServerInstance() const;
-  std::shared_ptr<Log> LogInstance() const;
+
+  /**
+   * Retrieve the raft log of a raft group.
+   *
+   * @param group_id the id of the raft group
+   * @returns the log, or nullptr if the group is not hosted by this node
+   */
+  std::shared_ptr<Log> LogInstance(const int group_id = 0) const;
   std::shared_ptr<core::TimerQueue> TimerQueueInstance() const;
 
+  /**
+   * Number of raft groups hosted by this node, with ids [0, GroupCount()).
+   */
+  int GroupCount() const;
+
+  /**
+   * Group 0 keeps its log in the data directory so existing nodes restart with their
+   * data, other groups use a subdirectory per group. Each group's store is kept in the
+   * store subdirectory of its group directory.
+   */
+  std::string GroupDirectory(const int group_id) const;
+
 private:
-  std::shared_ptr<ConsensusModule> m_consensus;
+  const std::string m_data_directory;
+  std::vector<std::shared_ptr<ConsensusModule>> m_consensus;
   std::shared_ptr<RaftClientImpl> m_client;
   std::shared_ptr<RaftServerImpl> m_server;
-  std::shared_ptr<Log> m_log;
+  std::vector<std::shared_ptr<Log>> m_log;
   std::shared_ptr<core::TimerQueue> m_timer_queue;
 
 public:
   std::string address;
+  const RaftOptions options;
 };
 
 }
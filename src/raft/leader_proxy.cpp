@@ -2,7 +2,8 @@
 
 namespace raft {
 
-LeaderProxy::LeaderProxy(const std::vector<std::string>& peers) {
+LeaderProxy::LeaderProxy(const std::vector<std::string>& peers, const int group_id)
+  : m_group_id(group_id) {
   CreateConnections(peers);
 }
 
@@ -13,6 +14,14 @@ void LeaderProxy::CreateConnections(std::vector<std::string> peer_addresses) {
   }
 }
 
+int LeaderProxy::GroupId() const {
+  return m_group_id;
+}
+
+void LeaderProxy::SetGroup(const int group_id) {
+  m_group_id = group_id;
+}
+
 grpc::Status LeaderProxy::GetClusterConfiguration(protocol::raft::GetConfiguration_Response& reply) {
   auto call = std::bind(&LeaderProxy::GetConfigurationRPC, this, std::placeholders::_1, std::ref(reply));
   return RedirectToLeader(call);
@@ -26,27 +35,101 @@ grpc::Status LeaderProxy::SetClusterConfiguration(
   return RedirectToLeader(call);
 }
 
+grpc::Status LeaderProxy::GetConfigurationStatus(
+    int operation_id,
+    protocol::raft::GetConfigurationStatus_Response& reply) {
+  auto call = std::bind(&LeaderProxy::GetConfigurationStatusRPC, this, std::placeholders::_1, operation_id, std::ref(reply));
+  return RedirectToLeader(call);
+}
+
+grpc::Status LeaderProxy::AddLearner(
+    std::string address,
+    protocol::raft::AddLearner_Response& reply) {
+  auto call = std::bind(&LeaderProxy::AddLearnerRPC, this, std::placeholders::_1, address, std::ref(reply));
+  return RedirectToLeader(call);
+}
+
 grpc::Status LeaderProxy::RegisterClient(protocol::raft::RegisterClient_Response& reply) {
   auto call = std::bind(&LeaderProxy::RegisterClientRPC, this, std::placeholders::_1, std::ref(reply));
   return RedirectToLeader(call);
 }
 
 grpc::Status LeaderProxy::ClientRequest(
-    int client_id,
+    int& client_id,
     int sequence_num,
     std::string command,
     protocol::raft::ClientRequest_Response& reply) {
   auto call = std::bind(&LeaderProxy::ClientRequestRPC, this, std::placeholders::_1,
-                        client_id, sequence_num, command, std::ref(reply));
+                        std::ref(client_id), sequence_num, command, std::ref(reply));
+  grpc::Status status = RedirectToLeader(call);
+  for (int redirects = 0; redirects < MAX_GROUP_REDIRECTS && FollowGroupHint(status); redirects++) {
+    // Sessions are kept by each group, so the new group has not seen this sequence number
+    protocol::raft::RegisterClient_Response session_reply;
+    status = RegisterClient(session_reply);
+    if (!status.ok()) {
+      return status;
+    }
+    client_id = session_reply.clientid();
+    status = RedirectToLeader(call);
+  }
+  return status;
+}
+
+grpc::Status LeaderProxy::ClientQuery(
+    std::string query,
+    int min_index,
+    protocol::raft::ConsistencyLevel consistency,
+    int max_staleness_ms,
+    int snapshot_index,
+    protocol::raft::ClientQuery_Response& reply) {
+  // Every node serves reads so the request only moves to another node if this one fails
+  auto call = std::bind(&LeaderProxy::ClientQueryRPC, this, std::placeholders::_1,
+                        query, std::ref(min_index), consistency, max_staleness_ms,
+                        std::ref(snapshot_index), std::ref(reply));
+  grpc::Status status = RedirectToLeader(call);
+  for (int redirects = 0; redirects < MAX_GROUP_REDIRECTS && FollowGroupHint(status); redirects++) {
+    min_index = 0;
+    snapshot_index = 0;
+    status = RedirectToLeader(call);
+  }
+  return status;
+}
+
+grpc::Status LeaderProxy::TransferLeadership(
+    std::string target_id,
+    protocol::raft::TransferLeadership_Response& reply) {
+  auto call = std::bind(&LeaderProxy::TransferLeadershipRPC, this, std::placeholders::_1,
+                        target_id, std::ref(reply));
   return RedirectToLeader(call);
 }
 
-grpc::Status LeaderProxy::ClientQuery(std::string query, protocol::raft::ClientQuery_Response& reply)
-{
-  auto call = std::bind(&LeaderProxy::ClientQueryRPC, this, std::placeholders::_1, query, std::ref(reply));
+grpc::Status LeaderProxy::GetRanges(protocol::raft::GetRanges_Response& reply) {
+  // Every node reports the ranges of its own state machine
+  auto call = std::bind(&LeaderProxy::GetRangesRPC, this, std::placeholders::_1, std::ref(reply));
   return RedirectToLeader(call);
 }
 
+grpc::Status LeaderProxy::Scan(
+    std::string start_key,
+    std::string end_key,
+    int limit,
+    int min_index,
+    protocol::raft::ConsistencyLevel consistency,
+    int max_staleness_ms,
+    int snapshot_index,
+    protocol::raft::Scan_Response& reply) {
+  auto call = std::bind(&LeaderProxy::ScanRPC, this, std::placeholders::_1, start_key, end_key,
+                        limit, std::ref(min_index), consistency, max_staleness_ms,
+                        std::ref(snapshot_index), std::ref(reply));
+  grpc::Status status = RedirectToLeader(call);
+  for (int redirects = 0; redirects < MAX_GROUP_REDIRECTS && FollowGroupHint(status); redirects++) {
+    min_index = 0;
+    snapshot_index = 0;
+    status = RedirectToLeader(call);
+  }
+  return status;
+}
+
 grpc::Status LeaderProxy::RedirectToLeader(
       std::function<grpc::Status(std::string)> func) {
   std::unordered_set<std::string> visited;
@@ -64,6 +147,10 @@ grpc::Status LeaderProxy::RedirectToLeader(
       return status;
     }
     err.ParseFromString(status.error_details());
+    // Every node of the group would reject the key
+    if (err.statuscode() == protocol::raft::Error::WRONG_GROUP) {
+      return status;
+    }
 
     if (err.statuscode() == protocol::raft::Error::NOT_LEADER &&
         err.leaderhint().size() > 0 &&
@@ -91,11 +178,22 @@ grpc::Status LeaderProxy::Retry(
   return status;
 }
 
+bool LeaderProxy::FollowGroupHint(const grpc::Status& status) {
+  protocol::raft::Error err;
+  if (status.ok() || !err.ParseFromString(status.error_details()) ||
+      err.statuscode() != protocol::raft::Error::WRONG_GROUP) {
+    return false;
+  }
+  m_group_id = err.grouphint();
+  return true;
+}
+
 grpc::Status LeaderProxy::GetConfigurationRPC(
     std::string peer_id,
     protocol::raft::GetConfiguration_Response& reply) {
   grpc::ClientContext ctx;
   protocol::raft::GetConfiguration_Request request_args;
+  request_args.set_groupid(m_group_id);
 
   grpc::Status status = m_stubs[peer_id]->GetConfiguration(&ctx, request_args, &reply);
   return status;
@@ -108,6 +206,7 @@ grpc::Status LeaderProxy::SetConfigurationRPC(
     protocol::raft::SetConfiguration_Response& reply) {
   grpc::ClientContext ctx;
   protocol::raft::SetConfiguration_Request request_args;
+  request_args.set_groupid(m_group_id);
   request_args.set_oldid(cluster_id);
   for (auto& server:new_servers) {
     *request_args.add_new_servers() = server;
@@ -117,11 +216,38 @@ grpc::Status LeaderProxy::SetConfigurationRPC(
   return status;
 }
 
+grpc::Status LeaderProxy::GetConfigurationStatusRPC(
+    std::string peer_id,
+    int operation_id,
+    protocol::raft::GetConfigurationStatus_Response& reply) {
+  grpc::ClientContext ctx;
+  protocol::raft::GetConfigurationStatus_Request request_args;
+  request_args.set_groupid(m_group_id);
+  request_args.set_operationid(operation_id);
+
+  grpc::Status status = m_stubs[peer_id]->GetConfigurationStatus(&ctx, request_args, &reply);
+  return status;
+}
+
+grpc::Status LeaderProxy::AddLearnerRPC(
+    std::string peer_id,
+    std::string address,
+    protocol::raft::AddLearner_Response& reply) {
+  grpc::ClientContext ctx;
+  protocol::raft::AddLearner_Request request_args;
+  request_args.set_groupid(m_group_id);
+  request_args.mutable_learner()->set_address(address);
+
+  grpc::Status status = m_stubs[peer_id]->AddLearner(&ctx, request_args, &reply);
+  return status;
+}
+
 grpc::Status LeaderProxy::RegisterClientRPC(
     std::string peer_id,
     protocol::raft::RegisterClient_Response& reply) {
   grpc::ClientContext ctx;
   protocol::raft::RegisterClient_Request request_args;
+  request_args.set_groupid(m_group_id);
 
   grpc::Status status = m_stubs[peer_id]->RegisterClient(&ctx, request_args, &reply);
   return status;
@@ -135,6 +261,7 @@ grpc::Status LeaderProxy::ClientRequestRPC(
     protocol::raft::ClientRequest_Response& reply) {
   grpc::ClientContext ctx;
   protocol::raft::ClientRequest_Request request_args;
+  request_args.set_groupid(m_group_id);
   request_args.set_clientid(client_id);
   request_args.set_sequencenum(sequence_num);
   request_args.set_command(command);
@@ -146,14 +273,72 @@ grpc::Status LeaderProxy::ClientRequestRPC(
 grpc::Status LeaderProxy::ClientQueryRPC(
     std::string peer_id,
     std::string query,
+    int min_index,
+    protocol::raft::ConsistencyLevel consistency,
+    int max_staleness_ms,
+    int snapshot_index,
     protocol::raft::ClientQuery_Response& reply) {
   grpc::ClientContext ctx;
   protocol::raft::ClientQuery_Request request_args;
+  request_args.set_groupid(m_group_id);
   request_args.set_query(query);
+  request_args.set_minindex(min_index);
+  request_args.set_consistency(consistency);
+  request_args.set_maxstalenessms(max_staleness_ms);
+  request_args.set_snapshotindex(snapshot_index);
 
   grpc::Status status = m_stubs[peer_id]->ClientQuery(&ctx, request_args, &reply);
   return status;
 }
 
+grpc::Status LeaderProxy::TransferLeadershipRPC(
+    std::string peer_id,
+    std::string target_id,
+    protocol::raft::TransferLeadership_Response& reply) {
+  grpc::ClientContext ctx;
+  protocol::raft::TransferLeadership_Request request_args;
+  request_args.set_groupid(m_group_id);
+  request_args.set_targetid(target_id);
+
+  grpc::Status status = m_stubs[peer_id]->TransferLeadership(&ctx, request_args, &reply);
+  return status;
+}
+
+grpc::Status LeaderProxy::GetRangesRPC(
+    std::string peer_id,
+    protocol::raft::GetRanges_Response& reply) {
+  grpc::ClientContext ctx;
+  protocol::raft::GetRanges_Request request_args;
+  request_args.set_groupid(m_group_id);
+
+  grpc::Status status = m_stubs[peer_id]->GetRanges(&ctx, request_args, &reply);
+  return status;
+}
+
+grpc::Status LeaderProxy::ScanRPC(
+    std::string peer_id,
+    std::string start_key,
+    std::string end_key,
+    int limit,
+    int min_index,
+    protocol::raft::ConsistencyLevel consistency,
+    int max_staleness_ms,
+    int snapshot_index,
+    protocol::raft::Scan_Response& reply) {
+  grpc::ClientContext ctx;
+  protocol::raft::Scan_Request request_args;
+  request_args.set_groupid(m_group_id);
+  request_args.set_startkey(start_key);
+  request_args.set_endkey(end_key);
+  request_args.set_limit(limit);
+  request_args.set_minindex(min_index);
+  request_args.set_consistency(consistency);
+  request_args.set_maxstalenessms(max_staleness_ms);
+  request_args.set_snapshotindex(snapshot_index);
+
+  grpc::Status status = m_stubs[peer_id]->Scan(&ctx, request_args, &reply);
+  return status;
+}
+
 }
 
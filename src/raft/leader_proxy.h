@@ -12,28 +12,88 @@
 
 namespace raft {
 
+/**
+ * Number of times a request follows WRONG_GROUP errors to the group now serving its key.
+ */
+const int MAX_GROUP_REDIRECTS = 3;
+
 class LeaderProxy {
 public:
   using stub_map = std::unordered_map<std::string, std::unique_ptr<protocol::raft::RaftService::Stub>>;
 
 public:
-  LeaderProxy(const std::vector<std::string>& peers);
+  /**
+   * @param peers the addresses of nodes in the cluster
+   * @param group_id the raft group every request is addressed to
+   */
+  LeaderProxy(const std::vector<std::string>& peers, const int group_id = 0);
 
   void CreateConnections(std::vector<std::string> peer_addresses);
 
+  int GroupId() const;
+
+  /**
+   * Addresses later requests to another raft group.
+   */
+  void SetGroup(const int group_id);
+
   grpc::Status GetClusterConfiguration(protocol::raft::GetConfiguration_Response& reply);
   grpc::Status SetClusterConfiguration(
       int cluster_id,
       const std::vector<protocol::log::Server>& new_servers,
       protocol::raft::SetConfiguration_Response& reply);
+  grpc::Status GetConfigurationStatus(
+      int operation_id,
+      protocol::raft::GetConfigurationStatus_Response& reply);
+  grpc::Status AddLearner(
+      std::string address,
+      protocol::raft::AddLearner_Response& reply);
 
   grpc::Status RegisterClient(protocol::raft::RegisterClient_Response& reply);
+
+  /**
+   * Sends a command to the group serving its keys. If the keys moved to another group
+   * the command is sent there with a new session.
+   *
+   * @param client_id the session id, replaced by the new session after a redirect
+   */
   grpc::Status ClientRequest(
-      int client_id,
+      int& client_id,
       int sequence_num,
       std::string command,
       protocol::raft::ClientRequest_Response& reply);
-  grpc::Status ClientQuery(std::string query, protocol::raft::ClientQuery_Response& reply);
+  /**
+   * Reads a key from the group serving it. Indices are specific to a group, so min_index
+   * and snapshot_index are dropped when the key moved to another group.
+   */
+  grpc::Status ClientQuery(
+      std::string query,
+      int min_index,
+      protocol::raft::ConsistencyLevel consistency,
+      int max_staleness_ms,
+      int snapshot_index,
+      protocol::raft::ClientQuery_Response& reply);
+
+  grpc::Status TransferLeadership(
+      std::string target_id,
+      protocol::raft::TransferLeadership_Response& reply);
+
+  grpc::Status GetRanges(protocol::raft::GetRanges_Response& reply);
+
+  /**
+   * Reads a page from the group serving the start key, with the same redirects as
+   * ClientQuery. A page ends at the end of the group's range, Scan_Response.nextGroupId
+   * names the group serving the rest.
+   */
+  grpc::Status Scan(
+      std::string start_key,
+      std::string end_key,
+      int limit,
+      int min_index,
+      protocol::raft::ConsistencyLevel consistency,
+      int max_staleness_ms,
+      int snapshot_index,
+      protocol::raft::Scan_Response& reply);
 
 private:
   grpc::Status RedirectToLeader(
@@ -43,6 +103,13 @@ private:
       std::string address,
       std::function<grpc::Status(std::string)> func);
 
+  /**
+   * Switches to the group named by a WRONG_GROUP error.
+   *
+   * @returns whether the status was a WRONG_GROUP error
+   */
+  bool FollowGroupHint(const grpc::Status& status);
+
   grpc::Status GetConfigurationRPC(
       std::string peer_id,
       protocol::raft::GetConfiguration_Response& reply);
@@ -51,6 +118,14 @@ private:
       int cluster_id,
       const std::vector<protocol::log::Server>& new_servers,
       protocol::raft::SetConfiguration_Response& reply);
+  grpc::Status GetConfigurationStatusRPC(
+      std::string peer_id,
+      int operation_id,
+      protocol::raft::GetConfigurationStatus_Response& reply);
+  grpc::Status AddLearnerRPC(
+      std::string peer_id,
+      std::string address,
+      protocol::raft::AddLearner_Response& reply);
 
   grpc::Status RegisterClientRPC(
       std::string peer_id,
@@ -64,11 +139,35 @@ private:
   grpc::Status ClientQueryRPC(
       std::string peer_id,
       std::string query,
+      int min_index,
+      protocol::raft::ConsistencyLevel consistency,
+      int max_staleness_ms,
+      int snapshot_index,
       protocol::raft::ClientQuery_Response& reply);
 
+  grpc::Status TransferLeadershipRPC(
+      std::string peer_id,
+      std::string target_id,
+      protocol::raft::TransferLeadership_Response& reply);
+
+  grpc::Status GetRangesRPC(
+      std::string peer_id,
+      protocol::raft::GetRanges_Response& reply);
+  grpc::Status ScanRPC(
+      std::string peer_id,
+      std::string start_key,
+      std::string end_key,
+      int limit,
+      int min_index,
+      protocol::raft::ConsistencyLevel consistency,
+      int max_staleness_ms,
+      int snapshot_index,
+      protocol::raft::Scan_Response& reply);
+
 private:
   std::string m_leader_hint;
   stub_map m_stubs;
+  int m_group_id;
 };
 
 }
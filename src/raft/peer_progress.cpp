@@ -0,0 +1,189 @@
+#include "peer_progress.h"
+
+namespace raft {
+
+PeerProgress::PeerProgress(const int next_index, const int max_inflight)
+  : m_state(ProgressState::PROBE)
+  , m_next_index(next_index)
+  , m_match_index(-1)
+  , m_inflight(0)
+  , m_max_inflight(max_inflight)
+  , m_probe_sent(false)
+  , m_pending_snapshot(-1)
+  , m_last_contact()
+  , m_acked_round(-1)
+  , m_rtt_next(0) {
+}
+
+PeerProgress::ProgressState PeerProgress::State() const {
+  return m_state;
+}
+
+int PeerProgress::NextIndex() const {
+  return m_next_index;
+}
+
+int PeerProgress::MatchIndex() const {
+  return m_match_index;
+}
+
+int PeerProgress::Inflight() const {
+  return m_inflight;
+}
+
+PeerProgress::time_point PeerProgress::LastContact() const {
+  return m_last_contact;
+}
+
+int PeerProgress::AckedRound() const {
+  return m_acked_round;
+}
+
+bool PeerProgress::Paused() const {
+  switch (m_state) {
+    case ProgressState::PROBE: {
+      return m_probe_sent;
+    }
+    case ProgressState::REPLICATE: {
+      return m_inflight >= m_max_inflight;
+    }
+    case ProgressState::SNAPSHOT: {
+      return true;
+    }
+  }
+  return true;
+}
+
+bool PeerProgress::RecentlyActive(time_point now, milliseconds timeout) const {
+  return now - m_last_contact <= timeout;
+}
+
+void PeerProgress::BecomeProbe() {
+  // After a snapshot the FOLLOWER is known to contain every entry in the snapshot
+  if (m_state == ProgressState::SNAPSHOT) {
+    m_next_index = std::max(m_match_index + 1, m_pending_snapshot + 1);
+  } else {
+    m_next_index = m_match_index + 1;
+  }
+  ResetState(ProgressState::PROBE);
+}
+
+void PeerProgress::BecomeReplicate() {
+  m_next_index = m_match_index + 1;
+  ResetState(ProgressState::REPLICATE);
+}
+
+void PeerProgress::BecomeSnapshot(const int snapshot_index) {
+  ResetState(ProgressState::SNAPSHOT);
+  m_pending_snapshot = snapshot_index;
+}
+
+void PeerProgress::SentEntries(const int last_index, const int entry_count) {
+  switch (m_state) {
+    case ProgressState::PROBE: {
+      m_probe_sent = true;
+      break;
+    }
+    case ProgressState::REPLICATE: {
+      // Empty heartbeats do not occupy the in-flight window
+      if (entry_count > 0) {
+        m_next_index = last_index + 1;
+        m_inflight++;
+      }
+      break;
+    }
+    case ProgressState::SNAPSHOT: {
+      break;
+    }
+  }
+}
+
+bool PeerProgress::MaybeUpdate(const int match_index, const bool carried_entries) {
+  if (carried_entries && m_state == ProgressState::REPLICATE && m_inflight > 0) {
+    m_inflight--;
+  }
+
+  bool updated = false;
+  if (match_index > m_match_index) {
+    m_match_index = match_index;
+    updated = true;
+  }
+  m_next_index = std::max(m_next_index, match_index + 1);
+
+  if (m_state == ProgressState::PROBE) {
+    BecomeReplicate();
+  } else if (m_state == ProgressState::SNAPSHOT && m_match_index >= m_pending_snapshot) {
+    BecomeProbe();
+  }
+  return updated;
+}
+
+bool PeerProgress::MaybeDecrement(const int rejected_index, const int last_log_index) {
+  if (m_state == ProgressState::REPLICATE) {
+    // Rejections for entries already known to match are from reordered RPCs
+    if (rejected_index <= m_match_index) {
+      return false;
+    }
+    BecomeProbe();
+    return true;
+  }
+
+  // Only the latest probe determines the next index
+  if (rejected_index != m_next_index - 1) {
+    return false;
+  }
+  m_next_index = std::max(std::min(rejected_index, last_log_index + 1), m_match_index + 1);
+  m_probe_sent = false;
+  return true;
+}
+
+void PeerProgress::ResumeProbe() {
+  if (m_state == ProgressState::PROBE) {
+    m_probe_sent = false;
+  }
+}
+
+void PeerProgress::RecordContact(time_point contact_time) {
+  m_last_contact = std::max(m_last_contact, contact_time);
+}
+
+bool PeerProgress::RecordAck(const int round) {
+  if (round <= m_acked_round) {
+    return false;
+  }
+  m_acked_round = round;
+  return true;
+}
+
+void PeerProgress::RecordRtt(microseconds rtt) {
+  if (m_rtt_samples.size() < RTT_SAMPLE_WINDOW) {
+    m_rtt_samples.push_back(rtt);
+    return;
+  }
+  m_rtt_samples[m_rtt_next] = rtt;
+  m_rtt_next = (m_rtt_next + 1) % RTT_SAMPLE_WINDOW;
+}
+
+int PeerProgress::RttSamples() const {
+  return m_rtt_samples.size();
+}
+
+PeerProgress::microseconds PeerProgress::RttPercentile(const double percentile) const {
+  if (m_rtt_samples.empty()) {
+    return microseconds(0);
+  }
+
+  std::vector<microseconds> samples(m_rtt_samples);
+  int rank = std::min((int)(percentile * samples.size()), (int)samples.size() - 1);
+  std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+  return samples[rank];
+}
+
+void PeerProgress::ResetState(ProgressState new_state) {
+  m_state = new_state;
+  m_inflight = 0;
+  m_probe_sent = false;
+  m_pending_snapshot = -1;
+}
+
+}
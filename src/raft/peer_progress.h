@@ -0,0 +1,210 @@
+#ifndef PEER_PROGRESS_H
+#define PEER_PROGRESS_H
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+namespace raft {
+
+const int MAX_INFLIGHT_APPEND_ENTRIES = 4;
+const int MAX_APPEND_ENTRIES_BATCH = 256;
+const int RTT_SAMPLE_WINDOW = 128;
+
+class PeerProgress {
+public:
+  using clock_type = std::chrono::steady_clock;
+  using time_point = std::chrono::time_point<clock_type>;
+  using milliseconds = std::chrono::milliseconds;
+  using microseconds = std::chrono::microseconds;
+
+  enum class ProgressState {
+    /**
+     * The LEADER does not know where the FOLLOWER's log matches its own. At most one
+     * AppendEntries RPC without entries is sent per heartbeat (or per reply) to find
+     * the matching index, so unreachable FOLLOWERs are not sent the log tail every tick.
+     */
+    PROBE,
+    /**
+     * The FOLLOWER's log is known to match up to the match index. Entries are sent
+     * optimistically, allowing up to max_inflight AppendEntries RPCs to be outstanding.
+     */
+    REPLICATE,
+    /**
+     * The FOLLOWER is being sent a snapshot since the entries it requires have been
+     * compacted. Replication is paused until the snapshot is installed.
+     */
+    SNAPSHOT
+  };
+
+public:
+  PeerProgress(const int next_index, const int max_inflight = MAX_INFLIGHT_APPEND_ENTRIES);
+
+  ProgressState State() const;
+
+  /**
+   * Index of the next log entry to send to the FOLLOWER.
+   */
+  int NextIndex() const;
+
+  /**
+   * Index of the highest log entry known to be replicated on the FOLLOWER.
+   */
+  int MatchIndex() const;
+
+  /**
+   * Number of AppendEntries RPCs carrying entries that have not been acknowledged.
+   */
+  int Inflight() const;
+
+  /**
+   * Send time of the latest RPC acknowledged by the FOLLOWER in the current term. The
+   * FOLLOWER cannot have voted for another candidate before this time plus the minimum
+   * election timeout.
+   */
+  time_point LastContact() const;
+
+  /**
+   * Latest heartbeat round in which an AppendEntries RPC acknowledged by the FOLLOWER
+   * was sent. Used to confirm leadership before serving reads.
+   */
+  int AckedRound() const;
+
+  /**
+   * Determines whether new entries can be sent to the FOLLOWER. A probing FOLLOWER is
+   * paused while a probe is outstanding, a replicating FOLLOWER is paused while the
+   * in-flight window is full and a FOLLOWER receiving a snapshot is always paused.
+   *
+   * @returns whether the replication loop should only send an empty heartbeat
+   */
+  bool Paused() const;
+
+  /**
+   * Determines whether the FOLLOWER replied to the LEADER within a timeout.
+   *
+   * @param now the current time
+   * @param timeout the maximum age of the last reply
+   * @returns whether the FOLLOWER is reachable
+   */
+  bool RecentlyActive(time_point now, milliseconds timeout) const;
+
+  /**
+   * Transitions to PROBE, restarting the search for the matching index after the
+   * last index known to be replicated.
+   */
+  void BecomeProbe();
+
+  /**
+   * Transitions to REPLICATE once the matching index has been found.
+   */
+  void BecomeReplicate();
+
+  /**
+   * Transitions to SNAPSHOT, pausing replication until the snapshot is installed.
+   *
+   * @param snapshot_index the last log index contained in the snapshot
+   */
+  void BecomeSnapshot(const int snapshot_index);
+
+  /**
+   * Records that an AppendEntries RPC was sent to the FOLLOWER.
+   *
+   * @param last_index the index of the last entry in the RPC
+   * @param entry_count the number of entries in the RPC
+   */
+  void SentEntries(const int last_index, const int entry_count);
+
+  /**
+   * Handles a successful AppendEntries reply.
+   *
+   * @param match_index the index of the last entry in the acknowledged RPC
+   * @param carried_entries whether the acknowledged RPC counted towards the in-flight window
+   * @returns whether the match index advanced
+   */
+  bool MaybeUpdate(const int match_index, const bool carried_entries);
+
+  /**
+   * Handles a rejected AppendEntries reply by moving the next index backwards.
+   *
+   * @param rejected_index the prevLogIndex of the rejected RPC
+   * @param last_log_index the index of the last entry in the FOLLOWER's log, used to skip
+   *    over indices the FOLLOWER does not have
+   * @returns whether the rejection was for the current probe (stale rejections are ignored)
+   */
+  bool MaybeDecrement(const int rejected_index, const int last_log_index);
+
+  /**
+   * Allows a new probe to be sent. Called every heartbeat so that a lost probe does not
+   * pause the FOLLOWER forever.
+   */
+  void ResumeProbe();
+
+  /**
+   * Records that the FOLLOWER acknowledged an RPC.
+   *
+   * @param contact_time the time at which the acknowledged RPC was sent
+   */
+  void RecordContact(time_point contact_time);
+
+  /**
+   * Records a reply from the FOLLOWER in the current term.
+   *
+   * @param round the heartbeat round in which the acknowledged RPC was sent
+   * @returns whether the acknowledged round advanced
+   */
+  bool RecordAck(const int round);
+
+  /**
+   * Records the round trip time of an acknowledged AppendEntries RPC. Only the latest
+   * RTT_SAMPLE_WINDOW samples are kept.
+   *
+   * @param rtt the time between sending the RPC and receiving the reply
+   */
+  void RecordRtt(microseconds rtt);
+
+  /**
+   * Number of round trip time samples currently held.
+   */
+  int RttSamples() const;
+
+  /**
+   * Computes a percentile of the recent round trip times to the FOLLOWER.
+   *
+   * @param percentile the percentile in [0, 1]
+   * @returns the round trip time, or zero if no samples were recorded
+   */
+  microseconds RttPercentile(const double percentile) const;
+
+private:
+  void ResetState(ProgressState new_state);
+
+private:
+  ProgressState m_state;
+  int m_next_index;
+  int m_match_index;
+  int m_inflight;
+  int m_max_inflight;
+
+  /**
+   * Set while a probe is outstanding in the PROBE state.
+   */
+  bool m_probe_sent;
+
+  /**
+   * Last log index included in the snapshot being sent in the SNAPSHOT state.
+   */
+  int m_pending_snapshot;
+
+  time_point m_last_contact;
+  int m_acked_round;
+
+  /**
+   * Ring buffer of recent round trip times, m_rtt_next is the slot overwritten next.
+   */
+  std::vector<microseconds> m_rtt_samples;
+  int m_rtt_next;
+};
+
+}
+
+#endif
@@ -12,7 +12,16 @@ AsyncClient::AsyncClient(GlobalCtxManager& ctx) : m_ctx(ctx) {
 AsyncClient::~AsyncClient() {
 }
 
-void AsyncClient::CreateConnections(std::unordered_set<std::string> peer_addresses) {
+void AsyncClient::CreateConnections(const int group_id, const std::unordered_set<std::string>& group_addresses) {
+  std::lock_guard<std::mutex> lock(m_stubs_lock);
+  m_group_addresses[group_id] = group_addresses;
+
+  // Channels are shared between groups so a peer is only disconnected once no group uses it
+  std::unordered_set<std::string> peer_addresses;
+  for (auto& group:m_group_addresses) {
+    peer_addresses.insert(group.second.begin(), group.second.end());
+  }
+
   std::vector<std::string> new_addresses;
   std::vector<std::string> removed_addresses;
   for (auto& peer_id:peer_addresses) {
@@ -38,31 +47,51 @@ void AsyncClient::CreateConnections(std::unordered_set<std::string> peer_address
   }
 }
 
+std::shared_ptr<protocol::raft::RaftService::Stub> AsyncClient::Stub(const std::string& address) {
+  std::lock_guard<std::mutex> lock(m_stubs_lock);
+  auto stub = m_stubs.find(address);
+  if (stub == m_stubs.end()) {
+    return nullptr;
+  }
+  return stub->second;
+}
+
 RaftClientImpl::RaftClientImpl(GlobalCtxManager& ctx)
-  : AsyncClient(ctx) {
+  : AsyncClient(ctx)
+  , m_flush_executor(std::make_shared<core::Strand>())
+  , m_flush_scheduled(false) {
 }
 
 void RaftClientImpl::RequestVote(
-    const std::string& peer_id,
+    const std::string& address,
+    const int group_id,
+    const int peer_id,
     const int term,
     const int last_log_index,
-    const int last_log_term) {
+    const int last_log_term,
+    const bool pre_vote,
+    const bool leadership_transfer) {
   protocol::raft::RequestVote_Request request_args;
   request_args.set_term(term);
   request_args.set_candidateid(m_ctx.address);
   request_args.set_lastlogindex(last_log_index);
   request_args.set_lastlogterm(last_log_term);
+  request_args.set_prevote(pre_vote);
+  request_args.set_leadershiptransfer(leadership_transfer);
+  request_args.set_groupid(group_id);
 
-  if (!m_stubs[peer_id]) {
-    DLOG(INFO) << "Server at " << peer_id << " disconnected";
+  auto stub = Stub(address);
+  if (!stub) {
+    DLOG(INFO) << "Server at " << address << " disconnected";
     return;
   }
 
   auto* call = new AsyncClientCall<protocol::raft::RequestVote_Request, protocol::raft::RequestVote_Response>;
 
   call->request = request_args;
-  call->peer_address = peer_id;
-  call->response_reader = m_stubs[peer_id]->PrepareAsyncRequestVote(&call->ctx, request_args, &m_cq);
+  call->peer_address = address;
+  call->peer_id = peer_id;
+  call->response_reader = stub->PrepareAsyncRequestVote(&call->ctx, request_args, &m_cq);
   call->response_reader->StartCall();
 
   auto* tag = new Tag;
@@ -73,33 +102,52 @@ void RaftClientImpl::RequestVote(
 }
 
 void RaftClientImpl::AppendEntries(
-    const std::string& peer_id,
+    const std::string& address,
+    const int group_id,
+    const int peer_id,
+    const int round,
     const int term,
     const int prev_log_index,
     const int prev_log_term,
-    const std::vector<protocol::log::LogEntry> entries,
-    const int leader_commit) {
-  protocol::raft::AppendEntries_Request request_args;
+    const std::vector<std::shared_ptr<const std::string>>& entries,
+    const int leader_commit,
+    const int election_timeout,
+    const bool coalesce) {
+  auto stub = Stub(address);
+  if (!stub) {
+    LOG(WARNING) << "Server at " << address << " disconnected";
+    return;
+  }
+
+  auto* call = new AsyncClientCall<protocol::raft::AppendEntries_Request, protocol::raft::AppendEntries_Response>;
+
+  // Request is built in place since copying it would duplicate every entry
+  auto& request_args = call->request;
   request_args.set_term(term);
   request_args.set_leaderid(m_ctx.address);
   request_args.set_prevlogindex(prev_log_index);
   request_args.set_prevlogterm(prev_log_term);
   request_args.set_leadercommit(leader_commit);
+  request_args.set_electiontimeoutms(election_timeout);
+  request_args.set_groupid(group_id);
 
-  for (auto& entry:entries) {
-    *request_args.add_entries() = entry;
-  }
-
-  if (!m_stubs[peer_id]) {
-    LOG(WARNING) << "Server at " << peer_id << " disconnected";
+  // Empty heartbeats are batched with the heartbeats of other groups led by this node
+  if (coalesce && entries.empty()) {
+    QueueHeartbeat(address, peer_id, round, std::move(request_args));
+    delete call;
     return;
   }
 
-  auto* call = new AsyncClientCall<protocol::raft::AppendEntries_Request, protocol::raft::AppendEntries_Response>;
+  request_args.mutable_entries()->Reserve(entries.size());
+  for (auto& entry:entries) {
+    request_args.add_entries(*entry);
+  }
 
-  call->request = request_args;
-  call->peer_address = peer_id;
-  call->response_reader = m_stubs[peer_id]->PrepareAsyncAppendEntries(&call->ctx, request_args, &m_cq);
+  call->peer_address = address;
+  call->peer_id = peer_id;
+  call->round = round;
+  call->send_time = std::chrono::steady_clock::now();
+  call->response_reader = stub->PrepareAsyncAppendEntries(&call->ctx, request_args, &m_cq);
   call->response_reader->StartCall();
 
   auto* tag = new Tag;
@@ -109,6 +157,131 @@ void RaftClientImpl::AppendEntries(
   call->response_reader->Finish(&call->reply, &call->status, (void*)tag);
 }
 
+void RaftClientImpl::QueueHeartbeat(
+    const std::string& address,
+    const int peer_id,
+    const int round,
+    protocol::raft::AppendEntries_Request&& heartbeat) {
+  int flush_delay = std::max(1,
+      m_ctx.ConsensusInstance(heartbeat.groupid())->HeartbeatInterval() / HEARTBEAT_FLUSHES_PER_INTERVAL);
+
+  std::lock_guard<std::mutex> lock(m_heartbeat_lock);
+  auto& pending = m_pending_heartbeats[address];
+  auto* heartbeats = pending.request.mutable_heartbeats();
+  int index = 0;
+  while (index < heartbeats->size() && heartbeats->Get(index).groupid() != heartbeat.groupid()) {
+    index++;
+  }
+  if (index == heartbeats->size()) {
+    heartbeats->Add(std::move(heartbeat));
+    pending.peer_ids.push_back(peer_id);
+    pending.rounds.push_back(round);
+  } else {
+    *heartbeats->Mutable(index) = std::move(heartbeat);
+    pending.peer_ids[index] = peer_id;
+    pending.rounds[index] = round;
+  }
+
+  if (!m_flush_scheduled) {
+    if (!m_flush_timer) {
+      m_flush_timer = m_ctx.TimerQueueInstance()->CreateTimer(
+          flush_delay,
+          m_flush_executor,
+          std::bind(&RaftClientImpl::FlushHeartbeats, this));
+    }
+    m_flush_scheduled = true;
+    m_flush_timer->Reset(flush_delay);
+  }
+}
+
+void RaftClientImpl::FlushHeartbeats() {
+  std::unordered_map<std::string, PendingHeartbeats> pending_heartbeats;
+  {
+    std::lock_guard<std::mutex> lock(m_heartbeat_lock);
+    pending_heartbeats.swap(m_pending_heartbeats);
+    m_flush_scheduled = false;
+  }
+
+  for (auto& [address, pending]:pending_heartbeats) {
+    auto stub = Stub(address);
+    if (!stub) {
+      LOG(WARNING) << "Server at " << address << " disconnected";
+      continue;
+    }
+
+    auto* call = new AsyncClientCall<protocol::raft::CoalescedHeartbeat_Request, protocol::raft::CoalescedHeartbeat_Response>;
+    call->request = std::move(pending.request);
+    call->peer_address = address;
+    call->peer_ids = std::move(pending.peer_ids);
+    call->rounds = std::move(pending.rounds);
+    call->send_time = std::chrono::steady_clock::now();
+    DLOG(INFO) << "Sending CoalescedHeartbeat rpc to " << address << " for " << call->request.heartbeats_size() << " groups";
+    call->response_reader = stub->PrepareAsyncCoalescedHeartbeat(&call->ctx, call->request, &m_cq);
+    call->response_reader->StartCall();
+
+    auto* tag = new Tag;
+    tag->call = (void*)call;
+    tag->id = ClientCommandID::COALESCED_HEARTBEAT;
+
+    call->response_reader->Finish(&call->reply, &call->status, (void*)tag);
+  }
+}
+
+grpc::Status RaftClientImpl::ReadIndex(
+    const std::string& address,
+    const int group_id,
+    protocol::raft::ReadIndex_Response& reply) {
+  auto stub = Stub(address);
+  if (!stub) {
+    LOG(WARNING) << "Server at " << address << " disconnected";
+    return grpc::Status(grpc::StatusCode::UNAVAILABLE, "Server disconnected");
+  }
+
+  grpc::ClientContext ctx;
+  ctx.set_deadline(std::chrono::system_clock::now() + std::chrono::milliseconds(m_ctx.options.election_timeout));
+  protocol::raft::ReadIndex_Request request_args;
+  request_args.set_groupid(group_id);
+
+  return stub->ReadIndex(&ctx, request_args, &reply);
+}
+
+grpc::Status RaftClientImpl::ApplyRangeMove(
+    const std::string& address,
+    const protocol::raft::ApplyRangeMove_Request& request,
+    protocol::raft::ApplyRangeMove_Response& reply) {
+  auto stub = Stub(address);
+  if (!stub) {
+    LOG(WARNING) << "Server at " << address << " disconnected";
+    return grpc::Status(grpc::StatusCode::UNAVAILABLE, "Server disconnected");
+  }
+
+  // The LEADER waits up to an election timeout for the entry to be applied
+  grpc::ClientContext ctx;
+  ctx.set_deadline(std::chrono::system_clock::now() + std::chrono::milliseconds(2 * m_ctx.options.election_timeout));
+  return stub->ApplyRangeMove(&ctx, request, &reply);
+}
+
+grpc::Status RaftClientImpl::TimeoutNow(
+    const std::string& address,
+    const int group_id,
+    const int term,
+    protocol::raft::TimeoutNow_Response& reply) {
+  auto stub = Stub(address);
+  if (!stub) {
+    LOG(WARNING) << "Server at " << address << " disconnected";
+    return grpc::Status(grpc::StatusCode::UNAVAILABLE, "Server disconnected");
+  }
+
+  grpc::ClientContext ctx;
+  ctx.set_deadline(std::chrono::system_clock::now() + std::chrono::milliseconds(m_ctx.options.election_timeout));
+  protocol::raft::TimeoutNow_Request request_args;
+  request_args.set_term(term);
+  request_args.set_leaderid(m_ctx.address);
+  request_args.set_groupid(group_id);
+
+  return stub->TimeoutNow(&ctx, request_args, &reply);
+}
+
 void RaftClientImpl::AsyncCompleteRPC() {
   void* tag;
   bool ok = false;
@@ -136,6 +309,15 @@ void RaftClientImpl::AsyncCompleteRPC() {
         delete call;
         break;
       }
+      case ClientCommandID::COALESCED_HEARTBEAT: {
+        auto* call = static_cast<AsyncClientCall<protocol::raft::CoalescedHeartbeat_Request,
+          protocol::raft::CoalescedHeartbeat_Response>*>(tag_ptr->call);
+
+        HandleCoalescedHeartbeatReply(call);
+
+        delete call;
+        break;
+      }
       default: {
         LOG(ERROR) << "Invalid client ID";
       }
@@ -151,23 +333,68 @@ void RaftClientImpl::HandleRequestVoteReply(AsyncClientCall<protocol::raft::Requ
     LOG(ERROR) << "RequestVote call failed unexpectedly"; 
     return;
   }
+  auto consensus = m_ctx.ConsensusInstance(call->request.groupid());
+  if (consensus->PeerAddress(call->peer_id) != call->peer_address) {
+    return;
+  }
 
-  m_ctx.ConsensusInstance()->ProcessRequestVoteServerResponse(call->request, call->reply, call->peer_address);
+  consensus->ProcessRequestVoteServerResponse(
+      call->request, call->reply, call->peer_id);
 
   DLOG(INFO) << "RequestVote call was received";
 }
 
 void RaftClientImpl::HandleAppendEntriesReply(AsyncClientCall<protocol::raft::AppendEntries_Request,
       protocol::raft::AppendEntries_Response>* call) {
+  // The peer id was recycled for another server while the call was in flight
+  auto consensus = m_ctx.ConsensusInstance(call->request.groupid());
+  if (consensus->PeerAddress(call->peer_id) != call->peer_address) {
+    return;
+  }
   if (!call->status.ok()) {
     LOG(ERROR) << "AppendEntries call failed unexpectedly";
+    consensus->ProcessAppendEntriesServerFailure(call->request, call->peer_id);
     return;
   }
 
-  m_ctx.ConsensusInstance()->ProcessAppendEntriesServerResponse(call->request, call->reply, call->peer_address);
+  consensus->ProcessAppendEntriesServerResponse(
+      call->request, call->reply, call->peer_id, call->round, call->send_time);
 
   DLOG(INFO) << "AppendEntries call was received";
 }
 
+void RaftClientImpl::HandleCoalescedHeartbeatReply(AsyncClientCall<protocol::raft::CoalescedHeartbeat_Request,
+      protocol::raft::CoalescedHeartbeat_Response>* call) {
+  auto* heartbeats = call->request.mutable_heartbeats();
+  if (!call->status.ok()) {
+    LOG(ERROR) << "CoalescedHeartbeat call failed unexpectedly";
+    for (int i = 0; i < heartbeats->size(); i++) {
+      auto& heartbeat = *heartbeats->Mutable(i);
+      auto consensus = m_ctx.ConsensusInstance(heartbeat.groupid());
+      if (consensus->PeerAddress(call->peer_ids[i]) == call->peer_address) {
+        consensus->ProcessAppendEntriesServerFailure(heartbeat, call->peer_ids[i]);
+      }
+    }
+    return;
+  }
+
+  // Each reply is handled exactly like the reply to an individual AppendEntries RPC
+  auto* responses = call->reply.mutable_responses();
+  for (int i = 0; i < std::min(heartbeats->size(), responses->size()); i++) {
+    auto& response = *responses->Mutable(i);
+    if (response.term() < 0) {
+      continue;
+    }
+    auto& heartbeat = *heartbeats->Mutable(i);
+    auto consensus = m_ctx.ConsensusInstance(heartbeat.groupid());
+    if (consensus->PeerAddress(call->peer_ids[i]) != call->peer_address) {
+      continue;
+    }
+    consensus->ProcessAppendEntriesServerResponse(
+        heartbeat, response, call->peer_ids[i], call->rounds[i], call->send_time);
+  }
+
+  DLOG(INFO) << "CoalescedHeartbeat call was received";
 }
 
+}
@@ -2,48 +2,130 @@
 #define RAFT_CLIENT_H
 
 #include <grpcpp/grpcpp.h>
+#include <chrono>
 #include <condition_variable>
 #include <functional>
 #include <memory>
 #include <mutex>
 #include <unordered_map>
+#include <unordered_set>
 
+#include "async_executor.h"
 #include "consensus_module.h"
 #include "raft.grpc.pb.h"
+#include "timer.h"
 
 namespace raft {
 
 class GlobalCtxManager;
 
+/**
+ * Number of CoalescedHeartbeat RPCs sent to a peer per heartbeat interval at most,
+ * regardless of how many groups the node leads.
+ */
+const int HEARTBEAT_FLUSHES_PER_INTERVAL = 5;
+
 class AsyncClient {
 public:
-  using stub_map = std::unordered_map<std::string, std::unique_ptr<protocol::raft::RaftService::Stub>>;
+  using stub_map = std::unordered_map<std::string, std::shared_ptr<protocol::raft::RaftService::Stub>>;
 
 public:
   AsyncClient(GlobalCtxManager& ctx);
   virtual ~AsyncClient();
 
-  void CreateConnections(std::unordered_set<std::string> peer_addresses);
+  /**
+   * Updates the peers of a raft group, opening channels to new peers and closing channels
+   * to peers no longer in any group.
+   *
+   * @param group_id the id of the raft group
+   * @param group_addresses the addresses of every server in the group's configuration
+   */
+  void CreateConnections(const int group_id, const std::unordered_set<std::string>& group_addresses);
 
   virtual void RequestVote(
-      const std::string& peer_id,
+      const std::string& address,
+      const int group_id,
+      const int peer_id,
       const int term,
       const int last_log_index,
-      const int last_log_term) = 0;
+      const int last_log_term,
+      const bool pre_vote,
+      const bool leadership_transfer) = 0;
 
   virtual void AppendEntries(
-      const std::string& peer_id,
+      const std::string& address,
+      const int group_id,
+      const int peer_id,
+      const int round,
       const int term,
       const int prev_log_index,
       const int prev_log_term,
-      const std::vector<protocol::log::LogEntry> entries,
-      const int leader_commit) = 0;
+      const std::vector<std::shared_ptr<const std::string>>& entries,
+      const int leader_commit,
+      const int election_timeout,
+      const bool coalesce) = 0;
+
+  /**
+   * Requests a read index from the LEADER. Unlike the other RPCs this call blocks, so it
+   * must not be made from the server or completion queue threads.
+   *
+   * @param address the ip address of the LEADER
+   * @param group_id the raft group to read from
+   * @param reply the ReadIndex RPC response containing the read index
+   * @returns status of the RPC, containing the LEADER's error details on failure
+   */
+  virtual grpc::Status ReadIndex(
+      const std::string& address,
+      const int group_id,
+      protocol::raft::ReadIndex_Response& reply) = 0;
+
+  /**
+   * Asks a FOLLOWER to start an election immediately. Blocks until the FOLLOWER replies,
+   * which it does without contacting other nodes.
+   *
+   * @param address the ip address of the FOLLOWER
+   * @param group_id the raft group to transfer leadership of
+   * @param term the raft term of the LEADER
+   * @param reply the TimeoutNow RPC response containing the FOLLOWER's term
+   * @returns status of the RPC
+   */
+  virtual grpc::Status TimeoutNow(
+      const std::string& address,
+      const int group_id,
+      const int term,
+      protocol::raft::TimeoutNow_Response& reply) = 0;
+
+  /**
+   * Asks the LEADER of a raft group to apply part of a range move. Blocks until the entry
+   * is applied, so it must not be made from the server or completion queue threads.
+   *
+   * @param address the ip address of the LEADER
+   * @param request the move entry and the group to apply it to
+   * @param reply the ApplyRangeMove RPC response containing the index of the entry
+   * @returns status of the RPC, containing the LEADER's error details on failure
+   */
+  virtual grpc::Status ApplyRangeMove(
+      const std::string& address,
+      const protocol::raft::ApplyRangeMove_Request& request,
+      protocol::raft::ApplyRangeMove_Response& reply) = 0;
 
   virtual void AsyncCompleteRPC() = 0;
 
+protected:
+  /**
+   * Looks up the stub of a peer. Stubs are shared so a concurrent reconfiguration of
+   * another group cannot destroy one while it is in use.
+   *
+   * @param address the ip address of the peer
+   * @returns the stub, or nullptr if the peer is not connected
+   */
+  std::shared_ptr<protocol::raft::RaftService::Stub> Stub(const std::string& address);
+
 protected:
   GlobalCtxManager& m_ctx;
   stub_map m_stubs;
+  std::unordered_map<int, std::unordered_set<std::string>> m_group_addresses;
+  std::mutex m_stubs_lock;
   grpc::CompletionQueue m_cq;
 };
 
@@ -56,7 +138,16 @@ public:
     SET_CONFIGURATION,
     REGISTER_CLIENT,
     CLIENT_REQUEST,
-    CLIENT_QUERY
+    CLIENT_QUERY,
+    READ_INDEX,
+    TRANSFER_LEADERSHIP,
+    TIMEOUT_NOW,
+    ADD_LEARNER,
+    GET_CONFIGURATION_STATUS,
+    COALESCED_HEARTBEAT,
+    GET_RANGES,
+    SCAN,
+    APPLY_RANGE_MOVE
   };
 
   struct Tag {
@@ -71,18 +162,43 @@ public:
   RaftClientImpl& operator=(const RaftClientImpl&) = delete;
 
   void RequestVote(
-      const std::string& peer_id,
+      const std::string& address,
+      const int group_id,
+      const int peer_id,
       const int term,
       const int last_log_index,
-      const int last_log_term) override;
+      const int last_log_term,
+      const bool pre_vote,
+      const bool leadership_transfer) override;
 
   void AppendEntries(
-      const std::string& peer_id,
+      const std::string& address,
+      const int group_id,
+      const int peer_id,
+      const int round,
       const int term,
       const int prev_log_index,
       const int prev_log_term,
-      const std::vector<protocol::log::LogEntry> entries,
-      const int leader_commit) override;
+      const std::vector<std::shared_ptr<const std::string>>& entries,
+      const int leader_commit,
+      const int election_timeout,
+      const bool coalesce) override;
+
+  grpc::Status ReadIndex(
+      const std::string& address,
+      const int group_id,
+      protocol::raft::ReadIndex_Response& reply) override;
+
+  grpc::Status TimeoutNow(
+      const std::string& address,
+      const int group_id,
+      const int term,
+      protocol::raft::TimeoutNow_Response& reply) override;
+
+  grpc::Status ApplyRangeMove(
+      const std::string& address,
+      const protocol::raft::ApplyRangeMove_Request& request,
+      protocol::raft::ApplyRangeMove_Response& reply) override;
 
   void AsyncCompleteRPC() override;
 
@@ -95,13 +211,55 @@ private:
     grpc::Status status;
     std::unique_ptr<grpc::ClientAsyncResponseReader<ResponseType>> response_reader;
     std::string peer_address;
+    int peer_id;
+    int round;
+    std::chrono::steady_clock::time_point send_time;
+    // Peer id and round of each heartbeat in a CoalescedHeartbeat RPC, since peer ids
+    // are assigned per group
+    std::vector<int> peer_ids;
+    std::vector<int> rounds;
   };
 
+  /**
+   * Heartbeats waiting to be sent to a peer in a single CoalescedHeartbeat RPC.
+   */
+  struct PendingHeartbeats {
+    protocol::raft::CoalescedHeartbeat_Request request;
+    std::vector<int> peer_ids;
+    std::vector<int> rounds;
+  };
+
+  /**
+   * Adds an empty AppendEntries RPC to the next CoalescedHeartbeat RPC to the peer,
+   * replacing an older heartbeat from the same group. Schedules a flush within a fraction
+   * of the group's heartbeat interval if none is pending.
+   */
+  void QueueHeartbeat(
+      const std::string& address,
+      const int peer_id,
+      const int round,
+      protocol::raft::AppendEntries_Request&& heartbeat);
+
+  /**
+   * Sends one CoalescedHeartbeat RPC to every peer with queued heartbeats.
+   */
+  void FlushHeartbeats();
+
+  void HandleCoalescedHeartbeatReply(AsyncClientCall<protocol::raft::CoalescedHeartbeat_Request,
+      protocol::raft::CoalescedHeartbeat_Response>* call);
+
   void HandleRequestVoteReply(AsyncClientCall<protocol::raft::RequestVote_Request,
       protocol::raft::RequestVote_Response>* call);
 
   void HandleAppendEntriesReply(AsyncClientCall<protocol::raft::AppendEntries_Request,
       protocol::raft::AppendEntries_Response>* call);
+
+private:
+  std::unordered_map<std::string, PendingHeartbeats> m_pending_heartbeats;
+  std::mutex m_heartbeat_lock;
+  std::shared_ptr<core::AsyncExecutor> m_flush_executor;
+  std::shared_ptr<core::DeadlineTimer> m_flush_timer;
+  bool m_flush_scheduled;
 };
 
 }
@@ -0,0 +1,35 @@
+#include "raft_options.h"
+
+namespace raft {
+
+int RaftOptions::MinElectionTimeout() const {
+  return adaptive ? min_election_timeout : election_timeout;
+}
+
+bool RaftOptions::Validate(std::string& error) const {
+  if (election_timeout <= 0 || heartbeat_interval <= 0 || election_jitter < 0 || lease_timeout < 0) {
+    error = "Timeouts must be positive";
+    return false;
+  }
+  if (adaptive && (min_election_timeout <= 0 || min_election_timeout > election_timeout)) {
+    error = "Minimum election timeout must be positive and at most the election timeout";
+    return false;
+  }
+  if (adaptive && rtt_multiplier <= 0) {
+    error = "Round trip time multiplier must be positive";
+    return false;
+  }
+  if (heartbeat_interval >= election_timeout) {
+    error = "Heartbeat interval must be below the election timeout";
+    return false;
+  }
+  // FOLLOWERs could vote for a new LEADER while the old LEADER still serves lease reads
+  if (lease_timeout >= MinElectionTimeout()) {
+    error = "Lease timeout must be below the minimum election timeout";
+    return false;
+  }
+  return true;
+}
+
+}
+
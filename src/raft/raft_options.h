@@ -0,0 +1,77 @@
+#ifndef RAFT_OPTIONS_H
+#define RAFT_OPTIONS_H
+
+#include <string>
+
+namespace raft {
+
+const int ELECTION_TIMEOUT = 1000;
+const int ELECTION_TIMEOUT_JITTER = 150;
+const int HEARTBEAT_TIMEOUT = 500;
+const int LEADER_LEASE_TIMEOUT = 900;
+const int MIN_ELECTION_TIMEOUT = 50;
+const int ADAPTIVE_RTT_MULTIPLIER = 10;
+
+/**
+ * Timing parameters of a raft node. The defaults suit a cluster spread over a WAN. On
+ * low latency networks adaptive timeouts let the cluster fail over much faster.
+ */
+struct RaftOptions {
+  /**
+   * Minimum time in ms a FOLLOWER waits without hearing from the LEADER before starting
+   * an election. With adaptive timeouts this is the upper bound of the election timeout.
+   */
+  int election_timeout = ELECTION_TIMEOUT;
+
+  /**
+   * Maximum random delay in ms added to the election timeout so CANDIDATEs rarely split
+   * the vote. Scaled down along with the election timeout in adaptive mode.
+   */
+  int election_jitter = ELECTION_TIMEOUT_JITTER;
+
+  /**
+   * Interval in ms between heartbeats sent by the LEADER.
+   */
+  int heartbeat_interval = HEARTBEAT_TIMEOUT;
+
+  /**
+   * Time in ms past a quorum's acknowledgement during which the LEADER serves lease
+   * reads. Must be below every election timeout a FOLLOWER may use.
+   */
+  int lease_timeout = LEADER_LEASE_TIMEOUT;
+
+  /**
+   * Derives the election timeout from the p99 AppendEntries round trip time to the
+   * FOLLOWERs instead of using a fixed value. The LEADER advertises the derived timeout
+   * in every AppendEntries RPC so FOLLOWERs wait for the same duration.
+   */
+  bool adaptive = false;
+
+  /**
+   * Lower bound of the adaptive election timeout in ms.
+   */
+  int min_election_timeout = MIN_ELECTION_TIMEOUT;
+
+  /**
+   * Adaptive election timeout as a multiple of the p99 round trip time.
+   */
+  int rtt_multiplier = ADAPTIVE_RTT_MULTIPLIER;
+
+  /**
+   * Smallest election timeout the node can use, which bounds the leader lease.
+   */
+  int MinElectionTimeout() const;
+
+  /**
+   * Checks that the options are consistent.
+   *
+   * @param error set to a description of the first invalid option
+   * @returns whether the options are valid
+   */
+  bool Validate(std::string& error) const;
+};
+
+}
+
+#endif
+
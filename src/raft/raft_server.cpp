@@ -1,4 +1,5 @@
 #include <glog/logging.h>
+#include <algorithm>
 
 #include "raft_server.h"
 #include "global_ctx_manager.h"
@@ -19,6 +20,22 @@ AsyncServer::CallData::CallData(
   : m_ctx(ctx), m_service(service), m_scq(scq), m_status(CallStatus::CREATE) {
 }
 
+std::shared_ptr<core::AsyncExecutor> AsyncServer::CallData::GroupExecutor(
+    const std::vector<std::shared_ptr<core::AsyncExecutor>>& executors,
+    const int group_id) {
+  if (group_id < 0 || group_id >= executors.size()) {
+    return executors[0];
+  }
+  return executors[group_id];
+}
+
+grpc::Status AsyncServer::CallData::UnknownGroupError(const int group_id) {
+  protocol::raft::Error err;
+  err.set_statuscode(protocol::raft::Error::Code::Error_Code_UNKNOWN_GROUP);
+  std::string err_msg = "Raft group " + std::to_string(group_id) + " is not hosted by this node";
+  return grpc::Status(grpc::StatusCode::UNKNOWN, err_msg, err.SerializeAsString());
+}
+
 RaftServerImpl::RaftServerImpl(GlobalCtxManager& ctx)
   : AsyncServer(ctx) {
 }
@@ -33,6 +50,12 @@ RaftServerImpl::~RaftServerImpl() {
 }
 
 void RaftServerImpl::ServerInit() {
+  for (int group_id = 0; group_id < m_ctx.GroupCount(); group_id++) {
+    m_read_executors.push_back(std::make_shared<core::Strand>());
+    m_write_executors.push_back(std::make_shared<core::Strand>());
+    m_admin_executors.push_back(std::make_shared<core::Strand>());
+  }
+
   grpc::ServerBuilder builder;
   builder.AddListeningPort(m_ctx.address, grpc::InsecureServerCredentials());
   builder.RegisterService(&m_service);
@@ -46,11 +69,20 @@ void RaftServerImpl::ServerInit() {
 void RaftServerImpl::RPCEventLoop() {
   new RaftServerImpl::RequestVoteData(m_ctx, &m_service, m_scq.get());
   new RaftServerImpl::AppendEntriesData(m_ctx, &m_service, m_scq.get());
+  new RaftServerImpl::CoalescedHeartbeatData(m_ctx, &m_service, m_scq.get());
   new RaftServerImpl::GetConfigurationData(m_ctx, &m_service, m_scq.get());
   new RaftServerImpl::SetConfigurationData(m_ctx, &m_service, m_scq.get());
-  new RaftServerImpl::RegisterClientData(m_ctx, &m_service, m_scq.get());
-  new RaftServerImpl::ClientRequestData(m_ctx, &m_service, m_scq.get());
-  new RaftServerImpl::ClientQueryData(m_ctx, &m_service, m_scq.get());
+  new RaftServerImpl::RegisterClientData(m_ctx, &m_service, m_scq.get(), m_write_executors);
+  new RaftServerImpl::ClientRequestData(m_ctx, &m_service, m_scq.get(), m_write_executors);
+  new RaftServerImpl::ClientQueryData(m_ctx, &m_service, m_scq.get(), m_read_executors);
+  new RaftServerImpl::ReadIndexData(m_ctx, &m_service, m_scq.get());
+  new RaftServerImpl::TransferLeadershipData(m_ctx, &m_service, m_scq.get(), m_admin_executors);
+  new RaftServerImpl::TimeoutNowData(m_ctx, &m_service, m_scq.get());
+  new RaftServerImpl::AddLearnerData(m_ctx, &m_service, m_scq.get(), m_admin_executors);
+  new RaftServerImpl::GetConfigurationStatusData(m_ctx, &m_service, m_scq.get());
+  new RaftServerImpl::GetRangesData(m_ctx, &m_service, m_scq.get(), m_read_executors);
+  new RaftServerImpl::ScanData(m_ctx, &m_service, m_scq.get(), m_read_executors);
+  new RaftServerImpl::ApplyRangeMoveData(m_ctx, &m_service, m_scq.get(), m_admin_executors);
 
   void* tag;
   bool ok;
@@ -66,6 +98,10 @@ void RaftServerImpl::RPCEventLoop() {
           static_cast<RaftServerImpl::AppendEntriesData*>(tag_ptr->call)->Proceed();
           break;
         }
+        case RaftClientImpl::ClientCommandID::COALESCED_HEARTBEAT: {
+          static_cast<RaftServerImpl::CoalescedHeartbeatData*>(tag_ptr->call)->Proceed();
+          break;
+        }
         case RaftClientImpl::ClientCommandID::GET_CONFIGURATION: {
           static_cast<RaftServerImpl::GetConfigurationData*>(tag_ptr->call)->Proceed();
           break;
@@ -86,6 +122,38 @@ void RaftServerImpl::RPCEventLoop() {
           static_cast<RaftServerImpl::ClientQueryData*>(tag_ptr->call)->Proceed();
           break;
         }
+        case RaftClientImpl::ClientCommandID::READ_INDEX: {
+          static_cast<RaftServerImpl::ReadIndexData*>(tag_ptr->call)->Proceed();
+          break;
+        }
+        case RaftClientImpl::ClientCommandID::TRANSFER_LEADERSHIP: {
+          static_cast<RaftServerImpl::TransferLeadershipData*>(tag_ptr->call)->Proceed();
+          break;
+        }
+        case RaftClientImpl::ClientCommandID::TIMEOUT_NOW: {
+          static_cast<RaftServerImpl::TimeoutNowData*>(tag_ptr->call)->Proceed();
+          break;
+        }
+        case RaftClientImpl::ClientCommandID::ADD_LEARNER: {
+          static_cast<RaftServerImpl::AddLearnerData*>(tag_ptr->call)->Proceed();
+          break;
+        }
+        case RaftClientImpl::ClientCommandID::GET_CONFIGURATION_STATUS: {
+          static_cast<RaftServerImpl::GetConfigurationStatusData*>(tag_ptr->call)->Proceed();
+          break;
+        }
+        case RaftClientImpl::ClientCommandID::GET_RANGES: {
+          static_cast<RaftServerImpl::GetRangesData*>(tag_ptr->call)->Proceed();
+          break;
+        }
+        case RaftClientImpl::ClientCommandID::SCAN: {
+          static_cast<RaftServerImpl::ScanData*>(tag_ptr->call)->Proceed();
+          break;
+        }
+        case RaftClientImpl::ClientCommandID::APPLY_RANGE_MOVE: {
+          static_cast<RaftServerImpl::ApplyRangeMoveData*>(tag_ptr->call)->Proceed();
+          break;
+        }
       }    
     } else {
       LOG(WARNING) << "RPC call failed unexpectedly";
@@ -120,7 +188,7 @@ void RaftServerImpl::RequestVoteData::Proceed() {
       DLOG(INFO) << "Processing RequestVote reply...";
       new RequestVoteData(m_ctx, m_service, m_scq);
 
-      auto [m_response, s] = m_ctx.ConsensusInstance()->ProcessRequestVoteClientRequest(m_request);
+      auto [m_response, s] = RouteToGroup(m_request, &ConsensusModule::ProcessRequestVoteClientRequest);
 
       m_status = CallStatus::FINISH;
       m_responder.Finish(m_response, s, (void*)&m_tag);
@@ -159,7 +227,7 @@ void RaftServerImpl::AppendEntriesData::Proceed() {
       DLOG(INFO) << "Processing AppendEntries reply...";
       new AppendEntriesData(m_ctx, m_service, m_scq);
 
-      auto [m_response, s] = m_ctx.ConsensusInstance()->ProcessAppendEntriesClientRequest(m_request);
+      auto [m_response, s] = RouteToGroup(m_request, &ConsensusModule::ProcessAppendEntriesClientRequest);
 
       m_status = CallStatus::FINISH;
       m_responder.Finish(m_response, s, (void*)&m_tag);
@@ -171,6 +239,52 @@ void RaftServerImpl::AppendEntriesData::Proceed() {
   }
 }
 
+RaftServerImpl::CoalescedHeartbeatData::CoalescedHeartbeatData(
+    GlobalCtxManager& ctx,
+    protocol::raft::RaftService::AsyncService* service,
+    grpc::ServerCompletionQueue* scq)
+  : CallData(ctx, service, scq), m_responder(&m_server_ctx) {
+  m_tag.id = RaftClientImpl::ClientCommandID::COALESCED_HEARTBEAT;
+  m_tag.call = this;
+  Proceed();
+}
+
+void RaftServerImpl::CoalescedHeartbeatData::Proceed() {
+  switch (m_status) {
+    case CallStatus::CREATE: {
+      m_status = CallStatus::PROCESS;
+      m_service->RequestCoalescedHeartbeat(
+          &m_server_ctx,
+          &m_request,
+          &m_responder,
+          m_scq,
+          m_scq,
+          (void*)&m_tag);
+      break;
+    }
+    case CallStatus::PROCESS: {
+      DLOG(INFO) << "Processing CoalescedHeartbeat reply with " << m_request.heartbeats_size() << " groups...";
+      new CoalescedHeartbeatData(m_ctx, m_service, m_scq);
+
+      for (auto& heartbeat:*m_request.mutable_heartbeats()) {
+        auto* response = m_response.add_responses();
+        auto [heartbeat_response, s] = RouteToGroup(heartbeat, &ConsensusModule::ProcessAppendEntriesClientRequest);
+        *response = heartbeat_response;
+        if (!s.ok()) {
+          response->set_term(-1);
+        }
+      }
+
+      m_status = CallStatus::FINISH;
+      m_responder.Finish(m_response, grpc::Status::OK, (void*)&m_tag);
+      break;
+    }
+    case CallStatus::FINISH: {
+      delete this;
+    }
+  }
+}
+
 RaftServerImpl::SetConfigurationData::SetConfigurationData(
     GlobalCtxManager& ctx,
     protocol::raft::RaftService::AsyncService* service,
@@ -198,7 +312,7 @@ void RaftServerImpl::SetConfigurationData::Proceed() {
       DLOG(INFO) << "Processing SetConfiguration reply...";
       new SetConfigurationData(m_ctx, m_service, m_scq);
 
-      auto [m_response, s] = m_ctx.ConsensusInstance()->ProcessSetConfigurationClientRequest(m_request);
+      auto [m_response, s] = RouteToGroup(m_request, &ConsensusModule::ProcessSetConfigurationClientRequest);
 
       m_status = CallStatus::FINISH;
       m_responder.Finish(m_response, s, (void*)&m_tag);
@@ -237,7 +351,7 @@ void RaftServerImpl::GetConfigurationData::Proceed() {
       DLOG(INFO) << "Processing GetConfiguration reply...";
       new GetConfigurationData(m_ctx, m_service, m_scq);
 
-      auto [m_response, s] = m_ctx.ConsensusInstance()->ProcessGetConfigurationClientRequest();
+      auto [m_response, s] = RouteToGroup(m_request, &ConsensusModule::ProcessGetConfigurationClientRequest);
 
       m_status = CallStatus::FINISH;
       m_responder.Finish(m_response, s, (void*)&m_tag);
@@ -252,8 +366,9 @@ void RaftServerImpl::GetConfigurationData::Proceed() {
 RaftServerImpl::RegisterClientData::RegisterClientData(
     GlobalCtxManager& ctx,
     protocol::raft::RaftService::AsyncService* service,
-    grpc::ServerCompletionQueue* scq)
-  : CallData(ctx, service, scq), m_responder(&m_server_ctx) {
+    grpc::ServerCompletionQueue* scq,
+    const std::vector<std::shared_ptr<core::AsyncExecutor>>& executors)
+  : CallData(ctx, service, scq), m_responder(&m_server_ctx), m_executors(executors) {
   m_tag.id = RaftClientImpl::ClientCommandID::REGISTER_CLIENT;
   m_tag.call = this;
   Proceed();
@@ -274,12 +389,14 @@ void RaftServerImpl::RegisterClientData::Proceed() {
     }
     case CallStatus::PROCESS: {
       DLOG(INFO) << "Processing RegisterClient reply...";
-      new RegisterClientData(m_ctx, m_service, m_scq);
+      new RegisterClientData(m_ctx, m_service, m_scq, m_executors);
 
-      auto [m_response, s] = m_ctx.ConsensusInstance()->ProcessRegisterClientClientRequest();
+      GroupExecutor(m_executors, m_request.groupid())->Enqueue([this] {
+        auto [m_response, s] = RouteToGroup(m_request, &ConsensusModule::ProcessRegisterClientClientRequest);
 
-      m_status = CallStatus::FINISH;
-      m_responder.Finish(m_response, s, (void*)&m_tag);
+        m_status = CallStatus::FINISH;
+        m_responder.Finish(m_response, s, (void*)&m_tag);
+      });
       break;
     }
     case CallStatus::FINISH: {
@@ -290,8 +407,9 @@ void RaftServerImpl::RegisterClientData::Proceed() {
 RaftServerImpl::ClientRequestData::ClientRequestData(
     GlobalCtxManager& ctx,
     protocol::raft::RaftService::AsyncService* service,
-    grpc::ServerCompletionQueue* scq)
-  : CallData(ctx, service, scq), m_responder(&m_server_ctx) {
+    grpc::ServerCompletionQueue* scq,
+    const std::vector<std::shared_ptr<core::AsyncExecutor>>& executors)
+  : CallData(ctx, service, scq), m_responder(&m_server_ctx), m_executors(executors) {
   m_tag.id = RaftClientImpl::ClientCommandID::CLIENT_REQUEST;
   m_tag.call = this;
   Proceed();
@@ -312,12 +430,14 @@ void RaftServerImpl::ClientRequestData::Proceed() {
     }
     case CallStatus::PROCESS: {
       DLOG(INFO) << "Processing ClientRequest reply...";
-      new ClientRequestData(m_ctx, m_service, m_scq);
+      new ClientRequestData(m_ctx, m_service, m_scq, m_executors);
 
-      auto [m_response, s] = m_ctx.ConsensusInstance()->ProcessClientRequestClientRequest(m_request);
+      GroupExecutor(m_executors, m_request.groupid())->Enqueue([this] {
+        auto [m_response, s] = RouteToGroup(m_request, &ConsensusModule::ProcessClientRequestClientRequest);
 
-      m_status = CallStatus::FINISH;
-      m_responder.Finish(m_response, s, (void*)&m_tag);
+        m_status = CallStatus::FINISH;
+        m_responder.Finish(m_response, s, (void*)&m_tag);
+      });
       break;
     }
     case CallStatus::FINISH: {
@@ -329,8 +449,9 @@ void RaftServerImpl::ClientRequestData::Proceed() {
 RaftServerImpl::ClientQueryData::ClientQueryData(
     GlobalCtxManager& ctx,
     protocol::raft::RaftService::AsyncService* service,
-    grpc::ServerCompletionQueue* scq)
-  : CallData(ctx, service, scq), m_responder(&m_server_ctx) {
+    grpc::ServerCompletionQueue* scq,
+    const std::vector<std::shared_ptr<core::AsyncExecutor>>& executors)
+  : CallData(ctx, service, scq), m_responder(&m_server_ctx), m_executors(executors) {
   m_tag.id = RaftClientImpl::ClientCommandID::CLIENT_QUERY;
   m_tag.call = this;
   Proceed();
@@ -351,9 +472,283 @@ void RaftServerImpl::ClientQueryData::Proceed() {
     }
     case CallStatus::PROCESS: {
       DLOG(INFO) << "Processing ClientQuery reply...";
-      new ClientQueryData(m_ctx, m_service, m_scq);
+      new ClientQueryData(m_ctx, m_service, m_scq, m_executors);
+
+      auto consensus = m_ctx.ConsensusInstance(m_request.groupid());
+      if (consensus && m_request.consistency() == protocol::raft::ConsistencyLevel::LINEARIZABLE) {
+        consensus->ReadIndexAsync([this](const int read_index, grpc::Status status) {
+          if (!status.ok()) {
+            m_status = CallStatus::FINISH;
+            m_responder.Finish(protocol::raft::ClientQuery_Response(), status, (void*)&m_tag);
+            return;
+          }
+
+          // Once the read index is confirmed the node only has to apply it
+          m_request.set_consistency(protocol::raft::ConsistencyLevel::ANY);
+          m_request.set_minindex(std::max<int64_t>(m_request.minindex(), read_index));
+          Serve();
+        });
+        break;
+      }
+      Serve();
+      break;
+    }
+    case CallStatus::FINISH: {
+      delete this;
+    }
+  }
+}
+
+void RaftServerImpl::ClientQueryData::Serve() {
+  GroupExecutor(m_executors, m_request.groupid())->Enqueue([this] {
+    auto [m_response, s] = RouteToGroup(m_request, &ConsensusModule::ProcessClientQueryClientRequest);
 
-      auto [m_response, s] = m_ctx.ConsensusInstance()->ProcessClientQueryClientRequest(m_request);
+    m_status = CallStatus::FINISH;
+    m_responder.Finish(m_response, s, (void*)&m_tag);
+  });
+}
+
+RaftServerImpl::ReadIndexData::ReadIndexData(
+    GlobalCtxManager& ctx,
+    protocol::raft::RaftService::AsyncService* service,
+    grpc::ServerCompletionQueue* scq)
+  : CallData(ctx, service, scq), m_responder(&m_server_ctx) {
+  m_tag.id = RaftClientImpl::ClientCommandID::READ_INDEX;
+  m_tag.call = this;
+  Proceed();
+}
+
+void RaftServerImpl::ReadIndexData::Proceed() {
+  switch (m_status) {
+    case CallStatus::CREATE: {
+      m_status = CallStatus::PROCESS;
+      m_service->RequestReadIndex(
+          &m_server_ctx,
+          &m_request,
+          &m_responder,
+          m_scq,
+          m_scq,
+          (void*)&m_tag);
+      break;
+    }
+    case CallStatus::PROCESS: {
+      DLOG(INFO) << "Processing ReadIndex reply...";
+      new ReadIndexData(m_ctx, m_service, m_scq);
+
+      auto consensus = m_ctx.ConsensusInstance(m_request.groupid());
+      if (!consensus) {
+        m_status = CallStatus::FINISH;
+        m_responder.Finish(m_response, UnknownGroupError(m_request.groupid()), (void*)&m_tag);
+        break;
+      }
+      consensus->ProcessReadIndexClientRequest([this](protocol::raft::ReadIndex_Response reply, grpc::Status status) {
+        m_response = std::move(reply);
+        m_status = CallStatus::FINISH;
+        m_responder.Finish(m_response, status, (void*)&m_tag);
+      });
+      break;
+    }
+    case CallStatus::FINISH: {
+      delete this;
+    }
+  }
+}
+
+
+RaftServerImpl::TransferLeadershipData::TransferLeadershipData(
+    GlobalCtxManager& ctx,
+    protocol::raft::RaftService::AsyncService* service,
+    grpc::ServerCompletionQueue* scq,
+    const std::vector<std::shared_ptr<core::AsyncExecutor>>& executors)
+  : CallData(ctx, service, scq), m_responder(&m_server_ctx), m_executors(executors) {
+  m_tag.id = RaftClientImpl::ClientCommandID::TRANSFER_LEADERSHIP;
+  m_tag.call = this;
+  Proceed();
+}
+
+void RaftServerImpl::TransferLeadershipData::Proceed() {
+  switch (m_status) {
+    case CallStatus::CREATE: {
+      m_status = CallStatus::PROCESS;
+      m_service->RequestTransferLeadership(
+          &m_server_ctx,
+          &m_request,
+          &m_responder,
+          m_scq,
+          m_scq,
+          (void*)&m_tag);
+      break;
+    }
+    case CallStatus::PROCESS: {
+      DLOG(INFO) << "Processing TransferLeadership reply...";
+      new TransferLeadershipData(m_ctx, m_service, m_scq, m_executors);
+
+      GroupExecutor(m_executors, m_request.groupid())->Enqueue([this] {
+        auto [m_response, s] = RouteToGroup(m_request, &ConsensusModule::ProcessTransferLeadershipClientRequest);
+
+        m_status = CallStatus::FINISH;
+        m_responder.Finish(m_response, s, (void*)&m_tag);
+      });
+      break;
+    }
+    case CallStatus::FINISH: {
+      delete this;
+    }
+  }
+}
+
+RaftServerImpl::TimeoutNowData::TimeoutNowData(
+    GlobalCtxManager& ctx,
+    protocol::raft::RaftService::AsyncService* service,
+    grpc::ServerCompletionQueue* scq)
+  : CallData(ctx, service, scq), m_responder(&m_server_ctx) {
+  m_tag.id = RaftClientImpl::ClientCommandID::TIMEOUT_NOW;
+  m_tag.call = this;
+  Proceed();
+}
+
+void RaftServerImpl::TimeoutNowData::Proceed() {
+  switch (m_status) {
+    case CallStatus::CREATE: {
+      m_status = CallStatus::PROCESS;
+      m_service->RequestTimeoutNow(
+          &m_server_ctx,
+          &m_request,
+          &m_responder,
+          m_scq,
+          m_scq,
+          (void*)&m_tag);
+      break;
+    }
+    case CallStatus::PROCESS: {
+      DLOG(INFO) << "Processing TimeoutNow reply...";
+      new TimeoutNowData(m_ctx, m_service, m_scq);
+
+      auto [m_response, s] = RouteToGroup(m_request, &ConsensusModule::ProcessTimeoutNowClientRequest);
+
+      m_status = CallStatus::FINISH;
+      m_responder.Finish(m_response, s, (void*)&m_tag);
+      break;
+    }
+    case CallStatus::FINISH: {
+      delete this;
+    }
+  }
+}
+
+
+RaftServerImpl::AddLearnerData::AddLearnerData(
+    GlobalCtxManager& ctx,
+    protocol::raft::RaftService::AsyncService* service,
+    grpc::ServerCompletionQueue* scq,
+    const std::vector<std::shared_ptr<core::AsyncExecutor>>& executors)
+  : CallData(ctx, service, scq), m_responder(&m_server_ctx), m_executors(executors) {
+  m_tag.id = RaftClientImpl::ClientCommandID::ADD_LEARNER;
+  m_tag.call = this;
+  Proceed();
+}
+
+void RaftServerImpl::AddLearnerData::Proceed() {
+  switch (m_status) {
+    case CallStatus::CREATE: {
+      m_status = CallStatus::PROCESS;
+      m_service->RequestAddLearner(
+          &m_server_ctx,
+          &m_request,
+          &m_responder,
+          m_scq,
+          m_scq,
+          (void*)&m_tag);
+      break;
+    }
+    case CallStatus::PROCESS: {
+      DLOG(INFO) << "Processing AddLearner reply...";
+      new AddLearnerData(m_ctx, m_service, m_scq, m_executors);
+
+      GroupExecutor(m_executors, m_request.groupid())->Enqueue([this] {
+        auto [m_response, s] = RouteToGroup(m_request, &ConsensusModule::ProcessAddLearnerClientRequest);
+
+        m_status = CallStatus::FINISH;
+        m_responder.Finish(m_response, s, (void*)&m_tag);
+      });
+      break;
+    }
+    case CallStatus::FINISH: {
+      delete this;
+    }
+  }
+}
+
+RaftServerImpl::ApplyRangeMoveData::ApplyRangeMoveData(
+    GlobalCtxManager& ctx,
+    protocol::raft::RaftService::AsyncService* service,
+    grpc::ServerCompletionQueue* scq,
+    const std::vector<std::shared_ptr<core::AsyncExecutor>>& executors)
+  : CallData(ctx, service, scq), m_responder(&m_server_ctx), m_executors(executors) {
+  m_tag.id = RaftClientImpl::ClientCommandID::APPLY_RANGE_MOVE;
+  m_tag.call = this;
+  Proceed();
+}
+
+void RaftServerImpl::ApplyRangeMoveData::Proceed() {
+  switch (m_status) {
+    case CallStatus::CREATE: {
+      m_status = CallStatus::PROCESS;
+      m_service->RequestApplyRangeMove(
+          &m_server_ctx,
+          &m_request,
+          &m_responder,
+          m_scq,
+          m_scq,
+          (void*)&m_tag);
+      break;
+    }
+    case CallStatus::PROCESS: {
+      DLOG(INFO) << "Processing ApplyRangeMove reply...";
+      new ApplyRangeMoveData(m_ctx, m_service, m_scq, m_executors);
+
+      GroupExecutor(m_executors, m_request.groupid())->Enqueue([this] {
+        auto [m_response, s] = RouteToGroup(m_request, &ConsensusModule::ProcessApplyRangeMoveClientRequest);
+
+        m_status = CallStatus::FINISH;
+        m_responder.Finish(m_response, s, (void*)&m_tag);
+      });
+      break;
+    }
+    case CallStatus::FINISH: {
+      delete this;
+    }
+  }
+}
+
+RaftServerImpl::GetConfigurationStatusData::GetConfigurationStatusData(
+    GlobalCtxManager& ctx,
+    protocol::raft::RaftService::AsyncService* service,
+    grpc::ServerCompletionQueue* scq)
+  : CallData(ctx, service, scq), m_responder(&m_server_ctx) {
+  m_tag.id = RaftClientImpl::ClientCommandID::GET_CONFIGURATION_STATUS;
+  m_tag.call = this;
+  Proceed();
+}
+
+void RaftServerImpl::GetConfigurationStatusData::Proceed() {
+  switch (m_status) {
+    case CallStatus::CREATE: {
+      m_status = CallStatus::PROCESS;
+      m_service->RequestGetConfigurationStatus(
+          &m_server_ctx,
+          &m_request,
+          &m_responder,
+          m_scq,
+          m_scq,
+          (void*)&m_tag);
+      break;
+    }
+    case CallStatus::PROCESS: {
+      DLOG(INFO) << "Processing GetConfigurationStatus reply...";
+      new GetConfigurationStatusData(m_ctx, m_service, m_scq);
+
+      auto [m_response, s] = RouteToGroup(m_request, &ConsensusModule::ProcessGetConfigurationStatusClientRequest);
 
       m_status = CallStatus::FINISH;
       m_responder.Finish(m_response, s, (void*)&m_tag);
@@ -365,5 +760,110 @@ void RaftServerImpl::ClientQueryData::Proceed() {
   }
 }
 
+
+RaftServerImpl::GetRangesData::GetRangesData(
+    GlobalCtxManager& ctx,
+    protocol::raft::RaftService::AsyncService* service,
+    grpc::ServerCompletionQueue* scq,
+    const std::vector<std::shared_ptr<core::AsyncExecutor>>& executors)
+  : CallData(ctx, service, scq), m_responder(&m_server_ctx), m_executors(executors) {
+  m_tag.id = RaftClientImpl::ClientCommandID::GET_RANGES;
+  m_tag.call = this;
+  Proceed();
+}
+
+void RaftServerImpl::GetRangesData::Proceed() {
+  switch (m_status) {
+    case CallStatus::CREATE: {
+      m_status = CallStatus::PROCESS;
+      m_service->RequestGetRanges(
+          &m_server_ctx,
+          &m_request,
+          &m_responder,
+          m_scq,
+          m_scq,
+          (void*)&m_tag);
+      break;
+    }
+    case CallStatus::PROCESS: {
+      DLOG(INFO) << "Processing GetRanges reply...";
+      new GetRangesData(m_ctx, m_service, m_scq, m_executors);
+
+      GroupExecutor(m_executors, m_request.groupid())->Enqueue([this] {
+        auto [m_response, s] = RouteToGroup(m_request, &ConsensusModule::ProcessGetRangesClientRequest);
+
+        m_status = CallStatus::FINISH;
+        m_responder.Finish(m_response, s, (void*)&m_tag);
+      });
+      break;
+    }
+    case CallStatus::FINISH: {
+      delete this;
+    }
+  }
+}
+
+RaftServerImpl::ScanData::ScanData(
+    GlobalCtxManager& ctx,
+    protocol::raft::RaftService::AsyncService* service,
+    grpc::ServerCompletionQueue* scq,
+    const std::vector<std::shared_ptr<core::AsyncExecutor>>& executors)
+  : CallData(ctx, service, scq), m_responder(&m_server_ctx), m_executors(executors) {
+  m_tag.id = RaftClientImpl::ClientCommandID::SCAN;
+  m_tag.call = this;
+  Proceed();
+}
+
+void RaftServerImpl::ScanData::Proceed() {
+  switch (m_status) {
+    case CallStatus::CREATE: {
+      m_status = CallStatus::PROCESS;
+      m_service->RequestScan(
+          &m_server_ctx,
+          &m_request,
+          &m_responder,
+          m_scq,
+          m_scq,
+          (void*)&m_tag);
+      break;
+    }
+    case CallStatus::PROCESS: {
+      DLOG(INFO) << "Processing Scan reply...";
+      new ScanData(m_ctx, m_service, m_scq, m_executors);
+
+      auto consensus = m_ctx.ConsensusInstance(m_request.groupid());
+      if (consensus && m_request.consistency() == protocol::raft::ConsistencyLevel::LINEARIZABLE) {
+        consensus->ReadIndexAsync([this](const int read_index, grpc::Status status) {
+          if (!status.ok()) {
+            m_status = CallStatus::FINISH;
+            m_responder.Finish(protocol::raft::Scan_Response(), status, (void*)&m_tag);
+            return;
+          }
+
+          // Once the read index is confirmed the node only has to apply it
+          m_request.set_consistency(protocol::raft::ConsistencyLevel::ANY);
+          m_request.set_minindex(std::max<int64_t>(m_request.minindex(), read_index));
+          Serve();
+        });
+        break;
+      }
+      Serve();
+      break;
+    }
+    case CallStatus::FINISH: {
+      delete this;
+    }
+  }
+}
+
+void RaftServerImpl::ScanData::Serve() {
+  GroupExecutor(m_executors, m_request.groupid())->Enqueue([this] {
+    auto [m_response, s] = RouteToGroup(m_request, &ConsensusModule::ProcessScanClientRequest);
+
+    m_status = CallStatus::FINISH;
+    m_responder.Finish(m_response, s, (void*)&m_tag);
+  });
+}
+
 }
 
@@ -5,8 +5,12 @@
 #include <grpcpp/ext/proto_server_reflection_plugin.h>
 #include <grpcpp/health_check_service_interface.h>
 #include <memory>
+#include <tuple>
+#include <vector>
 
+#include "async_executor.h"
 #include "consensus_module.h"
+#include "global_ctx_manager.h"
 #include "grpcpp/ext/proto_server_reflection_plugin.h"
 #include "grpcpp/health_check_service_interface.h"
 #include "raft_client.h"
@@ -38,6 +42,35 @@ protected:
 
       virtual void Proceed() = 0;
 
+  protected:
+      /**
+       * Passes a request to the consensus module of the raft group it is addressed to.
+       *
+       * @param request the RPC request containing the group id
+       * @param handler the consensus module method processing the request
+       * @returns the handler's response, or an UNKNOWN_GROUP error if the group is not
+       *    hosted by this node
+       */
+      template <typename RequestType, typename ResponseType>
+      std::tuple<ResponseType, grpc::Status> RouteToGroup(
+          RequestType& request,
+          std::tuple<ResponseType, grpc::Status> (ConsensusModule::*handler)(RequestType&));
+
+      template <typename RequestType, typename ResponseType>
+      std::tuple<ResponseType, grpc::Status> RouteToGroup(
+          RequestType& request,
+          std::tuple<ResponseType, grpc::Status> (ConsensusModule::*handler)());
+
+      /**
+       * Selects the executor of the raft group a request is addressed to. Requests for
+       * unknown groups use group 0's executor and are rejected by RouteToGroup.
+       */
+      static std::shared_ptr<core::AsyncExecutor> GroupExecutor(
+          const std::vector<std::shared_ptr<core::AsyncExecutor>>& executors,
+          const int group_id);
+
+      static grpc::Status UnknownGroupError(const int group_id);
+
   protected:
       enum class CallStatus {
           CREATE,
@@ -98,6 +131,25 @@ public:
       RaftClientImpl::Tag m_tag;
   };
 
+  /**
+   * Fans out the heartbeats of every group led by a peer to the local consensus modules.
+   */
+  class CoalescedHeartbeatData : public CallData {
+  public:
+      CoalescedHeartbeatData(
+          GlobalCtxManager& ctx,
+          protocol::raft::RaftService::AsyncService* service,
+          grpc::ServerCompletionQueue* scq);
+
+      void Proceed() override;
+
+  private:
+      protocol::raft::CoalescedHeartbeat_Request m_request;
+      protocol::raft::CoalescedHeartbeat_Response m_response;
+      grpc::ServerAsyncResponseWriter<protocol::raft::CoalescedHeartbeat_Response> m_responder;
+      RaftClientImpl::Tag m_tag;
+  };
+
   class SetConfigurationData : public CallData {
   public:
     SetConfigurationData(
@@ -135,7 +187,8 @@ public:
     RegisterClientData(
         GlobalCtxManager& ctx,
         protocol::raft::RaftService::AsyncService* service,
-        grpc::ServerCompletionQueue* scq);
+        grpc::ServerCompletionQueue* scq,
+        const std::vector<std::shared_ptr<core::AsyncExecutor>>& executors);
 
     void Proceed() override;
 
@@ -144,14 +197,20 @@ public:
     protocol::raft::RegisterClient_Response m_response;
     grpc::ServerAsyncResponseWriter<protocol::raft::RegisterClient_Response> m_responder;
     RaftClientImpl::Tag m_tag;
+    const std::vector<std::shared_ptr<core::AsyncExecutor>>& m_executors;
   };
 
+  /**
+   * Writes block until the entry is applied, so each raft group processes them on its own
+   * executor. Otherwise a write to one group would stall every other group's writes.
+   */
   class ClientRequestData: public CallData {
   public:
     ClientRequestData(
         GlobalCtxManager& ctx,
         protocol::raft::RaftService::AsyncService* service,
-        grpc::ServerCompletionQueue* scq);
+        grpc::ServerCompletionQueue* scq,
+        const std::vector<std::shared_ptr<core::AsyncExecutor>>& executors);
 
     void Proceed() override;
 
@@ -160,28 +219,240 @@ public:
     protocol::raft::ClientRequest_Request  m_response;
     grpc::ServerAsyncResponseWriter<protocol::raft::ClientRequest_Response> m_responder;
     RaftClientImpl::Tag m_tag;
+    const std::vector<std::shared_ptr<core::AsyncExecutor>>& m_executors;
   };
 
+  /**
+   * Reads are processed on a separate executor since they block until the node has
+   * applied the read index, which requires the RPC thread to handle AppendEntries.
+   * Linearizable reads obtain the read index before they are queued, so concurrent
+   * reads share heartbeat rounds.
+   */
   class ClientQueryData: public CallData {
   public:
     ClientQueryData(
         GlobalCtxManager& ctx,
         protocol::raft::RaftService::AsyncService* service,
-        grpc::ServerCompletionQueue* scq);
+        grpc::ServerCompletionQueue* scq,
+        const std::vector<std::shared_ptr<core::AsyncExecutor>>& executors);
 
     void Proceed() override;
 
+  private:
+    /**
+     * Serves the read on the executor of its raft group.
+     */
+    void Serve();
+
   private:
     protocol::raft::ClientQuery_Request m_request;
     protocol::raft::ClientQuery_Request  m_response;
     grpc::ServerAsyncResponseWriter<protocol::raft::ClientQuery_Response> m_responder;
     RaftClientImpl::Tag m_tag;
+    const std::vector<std::shared_ptr<core::AsyncExecutor>>& m_executors;
+  };
+
+  /**
+   * Completed by the consensus module once a quorum acknowledges the heartbeat round
+   * confirming the read index, without occupying an executor while waiting.
+   */
+  class ReadIndexData: public CallData {
+  public:
+    ReadIndexData(
+        GlobalCtxManager& ctx,
+        protocol::raft::RaftService::AsyncService* service,
+        grpc::ServerCompletionQueue* scq);
+
+    void Proceed() override;
+
+  private:
+    protocol::raft::ReadIndex_Request m_request;
+    protocol::raft::ReadIndex_Response m_response;
+    grpc::ServerAsyncResponseWriter<protocol::raft::ReadIndex_Response> m_responder;
+    RaftClientImpl::Tag m_tag;
+  };
+
+  /**
+   * Processed on a separate executor since the transfer waits for the target to catch up
+   * and be elected, which requires the RPC thread to handle AppendEntries replies.
+   */
+  class TransferLeadershipData: public CallData {
+  public:
+    TransferLeadershipData(
+        GlobalCtxManager& ctx,
+        protocol::raft::RaftService::AsyncService* service,
+        grpc::ServerCompletionQueue* scq,
+        const std::vector<std::shared_ptr<core::AsyncExecutor>>& executors);
+
+    void Proceed() override;
+
+  private:
+    protocol::raft::TransferLeadership_Request m_request;
+    protocol::raft::TransferLeadership_Response m_response;
+    grpc::ServerAsyncResponseWriter<protocol::raft::TransferLeadership_Response> m_responder;
+    RaftClientImpl::Tag m_tag;
+    const std::vector<std::shared_ptr<core::AsyncExecutor>>& m_executors;
+  };
+
+  class TimeoutNowData: public CallData {
+  public:
+    TimeoutNowData(
+        GlobalCtxManager& ctx,
+        protocol::raft::RaftService::AsyncService* service,
+        grpc::ServerCompletionQueue* scq);
+
+    void Proceed() override;
+
+  private:
+    protocol::raft::TimeoutNow_Request m_request;
+    protocol::raft::TimeoutNow_Response m_response;
+    grpc::ServerAsyncResponseWriter<protocol::raft::TimeoutNow_Response> m_responder;
+    RaftClientImpl::Tag m_tag;
+  };
+
+  /**
+   * Processed on a separate executor since it waits for the new configuration to be
+   * applied, which requires the RPC thread to handle AppendEntries replies.
+   */
+  class AddLearnerData: public CallData {
+  public:
+    AddLearnerData(
+        GlobalCtxManager& ctx,
+        protocol::raft::RaftService::AsyncService* service,
+        grpc::ServerCompletionQueue* scq,
+        const std::vector<std::shared_ptr<core::AsyncExecutor>>& executors);
+
+    void Proceed() override;
+
+  private:
+    protocol::raft::AddLearner_Request m_request;
+    protocol::raft::AddLearner_Response m_response;
+    grpc::ServerAsyncResponseWriter<protocol::raft::AddLearner_Response> m_responder;
+    RaftClientImpl::Tag m_tag;
+    const std::vector<std::shared_ptr<core::AsyncExecutor>>& m_executors;
+  };
+
+  /**
+   * Processed on the admin executors since it waits for the move to be applied.
+   */
+  class ApplyRangeMoveData: public CallData {
+  public:
+    ApplyRangeMoveData(
+        GlobalCtxManager& ctx,
+        protocol::raft::RaftService::AsyncService* service,
+        grpc::ServerCompletionQueue* scq,
+        const std::vector<std::shared_ptr<core::AsyncExecutor>>& executors);
+
+    void Proceed() override;
+
+  private:
+    protocol::raft::ApplyRangeMove_Request m_request;
+    protocol::raft::ApplyRangeMove_Response m_response;
+    grpc::ServerAsyncResponseWriter<protocol::raft::ApplyRangeMove_Response> m_responder;
+    RaftClientImpl::Tag m_tag;
+    const std::vector<std::shared_ptr<core::AsyncExecutor>>& m_executors;
+  };
+
+  class GetConfigurationStatusData: public CallData {
+  public:
+    GetConfigurationStatusData(
+        GlobalCtxManager& ctx,
+        protocol::raft::RaftService::AsyncService* service,
+        grpc::ServerCompletionQueue* scq);
+
+    void Proceed() override;
+
+  private:
+    protocol::raft::GetConfigurationStatus_Request m_request;
+    protocol::raft::GetConfigurationStatus_Response m_response;
+    grpc::ServerAsyncResponseWriter<protocol::raft::GetConfigurationStatus_Response> m_responder;
+    RaftClientImpl::Tag m_tag;
+  };
+
+  class ScanData: public CallData {
+  public:
+    ScanData(
+        GlobalCtxManager& ctx,
+        protocol::raft::RaftService::AsyncService* service,
+        grpc::ServerCompletionQueue* scq,
+        const std::vector<std::shared_ptr<core::AsyncExecutor>>& executors);
+
+    void Proceed() override;
+
+  private:
+    /**
+     * Serves the page on the executor of its raft group.
+     */
+    void Serve();
+
+  private:
+    protocol::raft::Scan_Request m_request;
+    protocol::raft::Scan_Response m_response;
+    grpc::ServerAsyncResponseWriter<protocol::raft::Scan_Response> m_responder;
+    RaftClientImpl::Tag m_tag;
+    const std::vector<std::shared_ptr<core::AsyncExecutor>>& m_executors;
+  };
+
+  class GetRangesData: public CallData {
+  public:
+    GetRangesData(
+        GlobalCtxManager& ctx,
+        protocol::raft::RaftService::AsyncService* service,
+        grpc::ServerCompletionQueue* scq,
+        const std::vector<std::shared_ptr<core::AsyncExecutor>>& executors);
+
+    void Proceed() override;
+
+  private:
+    protocol::raft::GetRanges_Request m_request;
+    protocol::raft::GetRanges_Response m_response;
+    grpc::ServerAsyncResponseWriter<protocol::raft::GetRanges_Response> m_responder;
+    RaftClientImpl::Tag m_tag;
+    const std::vector<std::shared_ptr<core::AsyncExecutor>>& m_executors;
   };
 
 private:
   protocol::raft::RaftService::AsyncService m_service;
+
+  /**
+   * Executors running read requests off the RPC thread, one per raft group.
+   */
+  std::vector<std::shared_ptr<core::AsyncExecutor>> m_read_executors;
+
+  /**
+   * Executors running write requests off the RPC thread, one per raft group.
+   */
+  std::vector<std::shared_ptr<core::AsyncExecutor>> m_write_executors;
+
+  /**
+   * Executors running long administrative requests off the RPC thread, one per raft
+   * group, so they do not delay the group's writes.
+   */
+  std::vector<std::shared_ptr<core::AsyncExecutor>> m_admin_executors;
 };
 
+template <typename RequestType, typename ResponseType>
+std::tuple<ResponseType, grpc::Status> AsyncServer::CallData::RouteToGroup(
+    RequestType& request,
+    std::tuple<ResponseType, grpc::Status> (ConsensusModule::*handler)(RequestType&)) {
+  auto consensus = m_ctx.ConsensusInstance(request.groupid());
+  if (!consensus) {
+    return std::make_tuple(ResponseType(), UnknownGroupError(request.groupid()));
+  }
+  return ((*consensus).*handler)(request);
+}
+
+template <typename RequestType, typename ResponseType>
+std::tuple<ResponseType, grpc::Status> AsyncServer::CallData::RouteToGroup(
+    RequestType& request,
+    std::tuple<ResponseType, grpc::Status> (ConsensusModule::*handler)()) {
+  auto consensus = m_ctx.ConsensusInstance(request.groupid());
+  if (!consensus) {
+    return std::make_tuple(ResponseType(), UnknownGroupError(request.groupid()));
+  }
+  return ((*consensus).*handler)();
+}
+
 }
 
 #endif
@@ -0,0 +1,120 @@
+#include <iterator>
+
+#include "coding.h"
+#include "range_directory.h"
+
+namespace raft {
+
+RangeDirectory::RangeDirectory(const int group_id) {
+  m_groups.emplace("", group_id);
+}
+
+int RangeDirectory::GroupFor(std::string_view key) const {
+  std::lock_guard<std::mutex> lock(m_lock);
+  return std::prev(m_groups.upper_bound(key))->second;
+}
+
+std::string RangeDirectory::EndOf(std::string_view key) const {
+  std::lock_guard<std::mutex> lock(m_lock);
+  auto it = m_groups.upper_bound(key);
+  return it == m_groups.end() ? "" : it->first;
+}
+
+bool RangeDirectory::Serves(const int group_id, std::string_view start_key, std::string_view end_key) const {
+  std::lock_guard<std::mutex> lock(m_lock);
+  auto it = std::prev(m_groups.upper_bound(start_key));
+  // Adjacent ranges of one group are merged, so the keys are served by one range
+  if (it->second != group_id) {
+    return false;
+  }
+  auto next = std::next(it);
+  return next == m_groups.end() || (!end_key.empty() && end_key <= next->first);
+}
+
+bool RangeDirectory::Overlaps(const int group_id, std::string_view start_key, std::string_view end_key) const {
+  std::lock_guard<std::mutex> lock(m_lock);
+  for (auto it = std::prev(m_groups.upper_bound(start_key)); it != m_groups.end(); it++) {
+    if (!end_key.empty() && it->first >= end_key) {
+      break;
+    }
+    if (it->second == group_id) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void RangeDirectory::Assign(const std::string& start_key, const std::string& end_key, const int group_id) {
+  std::lock_guard<std::mutex> lock(m_lock);
+  if (!end_key.empty() && end_key <= start_key) {
+    return;
+  }
+
+  // Keys from the end onwards keep the group they had
+  if (!end_key.empty()) {
+    auto end_it = std::prev(m_groups.upper_bound(end_key));
+    m_groups.emplace(end_key, end_it->second);
+  }
+  auto start_it = m_groups.lower_bound(start_key);
+  auto end_it = end_key.empty() ? m_groups.end() : m_groups.find(end_key);
+  m_groups.erase(start_it, end_it);
+
+  auto [it, inserted] = m_groups.emplace(start_key, group_id);
+  if (end_it != m_groups.end()) {
+    Coalesce(end_it);
+  }
+  Coalesce(it);
+}
+
+std::vector<RangeDirectory::Assignment> RangeDirectory::Assignments() const {
+  std::lock_guard<std::mutex> lock(m_lock);
+  std::vector<Assignment> assignments;
+  for (auto it = m_groups.begin(); it != m_groups.end(); it++) {
+    auto next = std::next(it);
+    assignments.push_back({it->first, next == m_groups.end() ? "" : next->first, it->second});
+  }
+  return assignments;
+}
+
+std::string RangeDirectory::Serialize() const {
+  std::lock_guard<std::mutex> lock(m_lock);
+  std::string out;
+  core::EncodeVarint(out, m_groups.size());
+  for (auto& [start_key, group_id]:m_groups) {
+    core::EncodeString(out, start_key);
+    core::EncodeVarint(out, group_id);
+  }
+  return out;
+}
+
+bool RangeDirectory::Restore(std::string_view data) {
+  std::map<std::string, int, std::less<>> groups;
+  uint64_t range_count;
+  if (!core::DecodeVarint(data, range_count)) {
+    return false;
+  }
+  for (uint64_t i = 0; i < range_count; i++) {
+    std::string_view start_key;
+    uint64_t group_id;
+    if (!core::DecodeString(data, start_key) || !core::DecodeVarint(data, group_id)) {
+      return false;
+    }
+    groups.emplace(start_key, (int)group_id);
+  }
+  if (!data.empty() || groups.empty() || groups.begin()->first != "") {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(m_lock);
+  m_groups = std::move(groups);
+  return true;
+}
+
+void RangeDirectory::Coalesce(std::map<std::string, int, std::less<>>::iterator it) {
+  if (it != m_groups.begin() && std::prev(it)->second == it->second) {
+    m_groups.erase(it);
+  }
+}
+
+}
+
@@ -0,0 +1,102 @@
+#ifndef RANGE_DIRECTORY_H
+#define RANGE_DIRECTORY_H
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace raft {
+
+/**
+ * Assignment of contiguous key ranges to raft groups. The first range starts at the empty
+ * key and the last range is unbounded, adjacent ranges of the same group are merged.
+ * Every group keeps a directory updated by the entries of its own log, so which keys a
+ * group serves is decided identically on every replica. The directory of group 0 also
+ * records every completed move between other groups and is used to route requests.
+ */
+class RangeDirectory {
+public:
+  struct Assignment {
+    std::string start_key;
+    /**
+     * Empty for the last range.
+     */
+    std::string end_key;
+    int group_id;
+  };
+
+public:
+  /**
+   * @param group_id the group initially serving every key
+   */
+  RangeDirectory(const int group_id = 0);
+
+  /**
+   * Finds the group serving a key.
+   */
+  int GroupFor(std::string_view key) const;
+
+  /**
+   * Finds the end of the range containing a key.
+   *
+   * @returns the first key after the range, empty if the range is unbounded
+   */
+  std::string EndOf(std::string_view key) const;
+
+  /**
+   * Determines whether every key in [start_key, end_key) is served by a group.
+   *
+   * @param end_key the exclusive upper bound, empty for no upper bound
+   */
+  bool Serves(const int group_id, std::string_view start_key, std::string_view end_key) const;
+
+  /**
+   * Determines whether any key in [start_key, end_key) is served by a group.
+   *
+   * @param end_key the exclusive upper bound, empty for no upper bound
+   */
+  bool Overlaps(const int group_id, std::string_view start_key, std::string_view end_key) const;
+
+  /**
+   * Assigns every key in [start_key, end_key) to a group.
+   *
+   * @param end_key the exclusive upper bound, empty for no upper bound
+   */
+  void Assign(const std::string& start_key, const std::string& end_key, const int group_id);
+
+  /**
+   * Retrieve every range in key order.
+   */
+  std::vector<Assignment> Assignments() const;
+
+  std::string Serialize() const;
+
+  /**
+   * Replaces the ranges with ones encoded by Serialize.
+   *
+   * @returns whether the encoding was valid
+   */
+  bool Restore(std::string_view data);
+
+private:
+  /**
+   * Merges the range starting at a key into the range before it if both are served by
+   * the same group. Requires m_lock.
+   */
+  void Coalesce(std::map<std::string, int, std::less<>>::iterator it);
+
+private:
+  mutable std::mutex m_lock;
+
+  /**
+   * Groups keyed by the first key of their range.
+   */
+  std::map<std::string, int, std::less<>> m_groups;
+};
+
+}
+
+#endif
+
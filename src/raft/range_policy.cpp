@@ -0,0 +1,114 @@
+#include "range_policy.h"
+
+namespace raft {
+
+RangePolicy::RangePolicy(RangeThresholds thresholds)
+  : m_thresholds(thresholds) {
+}
+
+std::optional<protocol::log::LogEntry> RangePolicy::Evaluate(const InmemoryStore& store, time_point now) {
+  auto ranges = store.Ranges();
+
+  // Rate of each range since the previous evaluation, negative if unknown
+  std::vector<double> qps(ranges.size(), -1);
+  std::unordered_map<std::string, Sample> samples;
+  for (int i = 0; i < ranges.size(); i++) {
+    auto& range = ranges[i];
+    auto it = m_samples.find(range.start_key);
+    if (it != m_samples.end() && now > it->second.time && range.operations >= it->second.operations) {
+      std::chrono::duration<double> elapsed = now - it->second.time;
+      qps[i] = (range.operations - it->second.operations) / elapsed.count();
+    }
+    samples[range.start_key] = {range.operations, now};
+  }
+  m_samples = std::move(samples);
+  m_rates.clear();
+  for (int i = 0; i < ranges.size(); i++) {
+    m_rates.emplace_back(ranges[i], qps[i]);
+  }
+
+  for (int i = 0; i < ranges.size(); i++) {
+    if (ranges[i].size_bytes < m_thresholds.split_bytes && qps[i] < m_thresholds.split_qps) {
+      continue;
+    }
+    auto split_key = store.MedianKey(ranges[i].start_key);
+    if (split_key.has_value()) {
+      return RangeChange(protocol::log::LogOpCode::RANGE_SPLIT, split_key.value());
+    }
+  }
+
+  for (int i = 1; i < ranges.size(); i++) {
+    bool cold = qps[i - 1] >= 0 && qps[i - 1] < m_thresholds.merge_qps &&
+      qps[i] >= 0 && qps[i] < m_thresholds.merge_qps;
+    if (cold && ranges[i - 1].size_bytes + ranges[i].size_bytes < m_thresholds.merge_bytes) {
+      return RangeChange(protocol::log::LogOpCode::RANGE_MERGE, ranges[i].start_key);
+    }
+  }
+  return std::nullopt;
+}
+
+std::optional<protocol::log::LogEntry> RangePolicy::Rebalance(
+    const RangeDirectory& directory,
+    const int group_id,
+    const std::vector<std::shared_ptr<InmemoryStore>>& group_stores,
+    time_point now) {
+  // Rate of each group since the previous rebalance, negative if unknown
+  std::vector<double> group_qps(group_stores.size(), -1);
+  std::vector<Sample> group_samples(group_stores.size());
+  for (int i = 0; i < group_stores.size(); i++) {
+    uint64_t operations = 0;
+    for (auto& range:group_stores[i]->Ranges()) {
+      operations += range.operations;
+    }
+    // Counters of split and merged ranges restart, so the total may decrease
+    if (i < m_group_samples.size() && now > m_group_samples[i].time && operations >= m_group_samples[i].operations) {
+      std::chrono::duration<double> elapsed = now - m_group_samples[i].time;
+      group_qps[i] = (operations - m_group_samples[i].operations) / elapsed.count();
+    }
+    group_samples[i] = {operations, now};
+  }
+  m_group_samples = std::move(group_samples);
+  if (group_id >= group_qps.size() || group_qps[group_id] < 0) {
+    return std::nullopt;
+  }
+
+  int target_id = -1;
+  for (int i = 0; i < group_qps.size(); i++) {
+    if (i != group_id && group_qps[i] >= 0 && (target_id < 0 || group_qps[i] < group_qps[target_id])) {
+      target_id = i;
+    }
+  }
+  if (target_id < 0) {
+    return std::nullopt;
+  }
+
+  const std::pair<InmemoryStore::RangeStats, double>* hottest = nullptr;
+  for (auto& rate:m_rates) {
+    auto& range = rate.first;
+    if (rate.second >= m_thresholds.move_qps && range.size_bytes <= m_thresholds.move_bytes &&
+        directory.Serves(group_id, range.start_key, range.end_key) &&
+        (!hottest || rate.second > hottest->second)) {
+      hottest = &rate;
+    }
+  }
+  if (!hottest || group_qps[target_id] + hottest->second >= group_qps[group_id] - hottest->second) {
+    return std::nullopt;
+  }
+
+  protocol::log::LogEntry entry;
+  entry.set_type(protocol::log::LogOpCode::RANGE_MOVE_OUT);
+  entry.mutable_move()->set_startkey(hottest->first.start_key);
+  entry.mutable_move()->set_endkey(hottest->first.end_key);
+  entry.mutable_move()->set_groupid(target_id);
+  return entry;
+}
+
+protocol::log::LogEntry RangePolicy::RangeChange(protocol::log::LogOpCode type, const std::string& key) const {
+  protocol::log::LogEntry entry;
+  entry.set_type(type);
+  entry.mutable_range()->set_key(key);
+  return entry;
+}
+
+}
+
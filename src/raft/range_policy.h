@@ -0,0 +1,114 @@
+#ifndef RANGE_POLICY_H
+#define RANGE_POLICY_H
+
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "inmemory_store.h"
+#include "log.pb.h"
+#include "range_directory.h"
+
+namespace raft {
+
+const size_t RANGE_SPLIT_BYTES = 64 * 1024 * 1024;
+const double RANGE_SPLIT_QPS = 2500;
+const size_t RANGE_MERGE_BYTES = 16 * 1024 * 1024;
+const double RANGE_MERGE_QPS = 250;
+const int RANGE_CHECK_INTERVAL = 1000;
+const double RANGE_MOVE_QPS = 1000;
+const size_t RANGE_MOVE_BYTES = 16 * 1024 * 1024;
+
+/**
+ * Limits beyond which the LEADER changes ranges. Rates are in operations per second.
+ */
+struct RangeThresholds {
+  size_t split_bytes = RANGE_SPLIT_BYTES;
+  double split_qps = RANGE_SPLIT_QPS;
+  size_t merge_bytes = RANGE_MERGE_BYTES;
+  double merge_qps = RANGE_MERGE_QPS;
+  double move_qps = RANGE_MOVE_QPS;
+  size_t move_bytes = RANGE_MOVE_BYTES;
+};
+
+/**
+ * Decides when the LEADER splits or merges the ranges of its state machine. Ranges are
+ * split when they grow too large or serve too many operations, and adjacent ranges are
+ * merged once both have gone cold. Hot ranges are moved to the least loaded raft group so
+ * load spreads across the LEADERs of several groups. Only the LEADER evaluates the
+ * policy, the resulting change is replicated through the log so every replica
+ * partitions its store identically.
+ */
+class RangePolicy {
+public:
+  using clock_type = std::chrono::steady_clock;
+  using time_point = std::chrono::time_point<clock_type>;
+
+public:
+  RangePolicy(RangeThresholds thresholds = RangeThresholds());
+
+  /**
+   * Samples the ranges of a store and proposes at most one range change. Operation rates
+   * are measured between consecutive calls, so ranges seen for the first time are never
+   * merged.
+   *
+   * @param store the state machine's store
+   * @param now the time of the sample
+   * @returns a RANGE_SPLIT or RANGE_MERGE entry without a term, or nothing if the ranges
+   *    should be left as they are
+   */
+  std::optional<protocol::log::LogEntry> Evaluate(const InmemoryStore& store, time_point now);
+
+  /**
+   * Proposes moving the hottest range of a group to the least loaded group, using the
+   * range rates measured by the latest Evaluate. The load of a group is the rate of the
+   * operations its store on this node served, which includes every write but only the
+   * reads served by this node. A range only moves if the target stays less loaded than
+   * the source afterwards, so ranges do not move back and forth.
+   *
+   * @param directory the group's range directory
+   * @param group_id the group whose ranges are evaluated
+   * @param group_stores the store of every group on this node, indexed by group id
+   * @param now the time of the sample
+   * @returns a RANGE_MOVE_OUT entry without a term, or nothing if no range should move
+   */
+  std::optional<protocol::log::LogEntry> Rebalance(
+      const RangeDirectory& directory,
+      const int group_id,
+      const std::vector<std::shared_ptr<InmemoryStore>>& group_stores,
+      time_point now);
+
+private:
+  struct Sample {
+    uint64_t operations;
+    time_point time;
+  };
+
+  protocol::log::LogEntry RangeChange(protocol::log::LogOpCode type, const std::string& key) const;
+
+private:
+  const RangeThresholds m_thresholds;
+
+  /**
+   * Operation counters of every range at the previous evaluation, keyed by start key.
+   */
+  std::unordered_map<std::string, Sample> m_samples;
+
+  /**
+   * Ranges of the latest evaluation with their rates, negative if unknown.
+   */
+  std::vector<std::pair<InmemoryStore::RangeStats, double>> m_rates;
+
+  /**
+   * Operation counters of every group at the previous rebalance, indexed by group id.
+   */
+  std::vector<Sample> m_group_samples;
+};
+
+}
+
+#endif
+
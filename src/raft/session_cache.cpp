@@ -1,5 +1,6 @@
 #include <glog/logging.h>
 
+#include "coding.h"
 #include "session_cache.h"
 
 namespace raft {
@@ -21,7 +22,18 @@ bool SessionCache::GetCachedResponse(
     int client_id, int sequence_num, protocol::raft::ClientRequest_Response& reply) {
   bool is_cached = true;
   try {
-    reply = m_session_cache.NodeValue(client_id, sequence_num);
+    reply = m_session_cache.NodeValue(client_id, sequence_num, true);
+  } catch(const std::out_of_range& e) {
+    is_cached = false;
+  }
+  return is_cached;
+}
+
+bool SessionCache::PeekCachedResponse(
+    int client_id, int sequence_num, protocol::raft::ClientRequest_Response& reply) {
+  bool is_cached = true;
+  try {
+    reply = m_session_cache.NodeValue(client_id, sequence_num, false);
   } catch(const std::out_of_range& e) {
     is_cached = false;
   }
@@ -32,6 +44,14 @@ bool SessionCache::SessionExists(int client_id) {
   return m_session_cache.NodeExists(client_id);
 }
 
+std::string SessionCache::Serialize() {
+  return m_session_cache.Serialize();
+}
+
+bool SessionCache::Restore(std::string_view data) {
+  return m_session_cache.Restore(data);
+}
+
 SessionCache::ClientRequestLRUCache::ClientRequestLRUCache(int capacity)
   : m_capacity(capacity)
   , m_size(0) {
@@ -52,7 +72,7 @@ void SessionCache::ClientRequestLRUCache::CreateNode(int client_id) {
 }
 
 protocol::raft::ClientRequest_Response SessionCache::ClientRequestLRUCache::NodeValue(
-    int client_id, int sequence_num) {
+    int client_id, int sequence_num, const bool touch) {
   std::lock_guard<std::mutex> guard(m_lock);
   if (m_cache.find(client_id) == m_cache.end()) {
     throw std::out_of_range("Session with id does not exist");
@@ -61,6 +81,9 @@ protocol::raft::ClientRequest_Response SessionCache::ClientRequestLRUCache::Node
   if (curr->val.find(sequence_num) == curr->val.end()) {
     throw std::out_of_range("Session with given sequence_num does not exist");
   }
+  if (!touch) {
+    return curr->val[sequence_num];
+  }
 
   // Reconnect previous and next nodes
   curr->prev->next = curr->next;
@@ -98,6 +121,53 @@ bool SessionCache::ClientRequestLRUCache::NodeExists(int client_id) {
   return m_cache.find(client_id) != m_cache.end();
 }
 
+std::string SessionCache::ClientRequestLRUCache::Serialize() {
+  std::lock_guard<std::mutex> guard(m_lock);
+  std::string out;
+  core::EncodeVarint(out, m_size);
+  for (auto curr = m_tail->prev; curr != m_head; curr = curr->prev) {
+    core::EncodeVarint(out, (uint32_t)curr->id);
+    core::EncodeVarint(out, curr->val.size());
+    for (auto& [sequence_num, reply]:curr->val) {
+      core::EncodeVarint(out, (uint32_t)sequence_num);
+      core::EncodeString(out, reply.SerializeAsString());
+    }
+  }
+  return out;
+}
+
+bool SessionCache::ClientRequestLRUCache::Restore(std::string_view data) {
+  std::lock_guard<std::mutex> guard(m_lock);
+  m_cache.clear();
+  m_head->next = m_tail;
+  m_tail->prev = m_head;
+  m_size = 0;
+
+  // Pushing from least to most recently used rebuilds the eviction order
+  uint64_t node_count;
+  if (!core::DecodeVarint(data, node_count)) {
+    return false;
+  }
+  for (uint64_t i = 0; i < node_count; i++) {
+    uint64_t client_id, response_count;
+    if (!core::DecodeVarint(data, client_id) || !core::DecodeVarint(data, response_count)) {
+      return false;
+    }
+    auto curr = std::make_shared<LRUNode>((int)client_id);
+    for (uint64_t j = 0; j < response_count; j++) {
+      uint64_t sequence_num;
+      std::string_view encoded;
+      if (!core::DecodeVarint(data, sequence_num) || !core::DecodeString(data, encoded) ||
+          !curr->val[(int)sequence_num].ParseFromArray(encoded.data(), encoded.size())) {
+        return false;
+      }
+    }
+    m_cache[curr->id] = curr;
+    PushHead(curr);
+  }
+  return data.empty();
+}
+
 void SessionCache::ClientRequestLRUCache::PushHead(std::shared_ptr<LRUNode> curr) {
   if (m_size == 0) {
     m_head->next = curr;
@@ -4,6 +4,7 @@
 #include <memory>
 #include <mutex>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 
 #include "raft.grpc.pb.h"
@@ -19,11 +20,35 @@ public:
   void CacheResponse(
       int client_id, int sequence_num, protocol::raft::ClientRequest_Response& reply);
 
+  /**
+   * Looks up the response to an applied request and marks the session as recently used.
+   * Only called while applying log entries so every replica evicts the same sessions.
+   */
   bool GetCachedResponse(
       int client_id, int sequence_num, protocol::raft::ClientRequest_Response& reply);
 
+  /**
+   * Looks up the response to an applied request without changing the eviction order.
+   * Used by request handlers, which run outside the log.
+   */
+  bool PeekCachedResponse(
+      int client_id, int sequence_num, protocol::raft::ClientRequest_Response& reply);
+
   bool SessionExists(int client_id);
 
+  /**
+   * Encodes every session with its cached responses in eviction order. Only called
+   * while applying log entries, so the result matches the applied index.
+   */
+  std::string Serialize();
+
+  /**
+   * Replaces the sessions with ones encoded by Serialize.
+   *
+   * @returns whether the encoding was valid
+   */
+  bool Restore(std::string_view data);
+
 private:
   class ClientRequestLRUCache {
   public:
@@ -31,12 +56,21 @@ private:
 
     void CreateNode(int client_id);
 
-    protocol::raft::ClientRequest_Response NodeValue(int client_id, int sequence_num);
+    /**
+     * @param touch whether the node moves to the head of the LRU list
+     */
+    protocol::raft::ClientRequest_Response NodeValue(int client_id, int sequence_num, const bool touch);
     void UpdateNode(
         int client_id, int sequence_num, protocol::raft::ClientRequest_Response& reply);
 
     bool NodeExists(int client_id);
 
+    /**
+     * Encodes the nodes from least to most recently used.
+     */
+    std::string Serialize();
+    bool Restore(std::string_view data);
+
   private:
     struct LRUNode {
       LRUNode(int id);
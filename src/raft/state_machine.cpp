@@ -1,20 +1,42 @@
+#include <glog/logging.h>
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+
+#include "coding.h"
+
 #include "state_machine.h"
 
 namespace raft {
 
-StateMachine::StateMachine(std::shared_ptr<SessionCache> sessions, std::shared_ptr<InmemoryStore> store)
-  : m_last_applied(-1), m_sessions(sessions), m_store(store) {
+const int RANGE_DELETE_PAGE = 1000;
+
+StateMachine::StateMachine(
+    std::shared_ptr<SessionCache> sessions,
+    std::shared_ptr<InmemoryStore> store,
+    const int group_id)
+  : m_last_applied(store->AppliedIndex())
+  , m_sessions(sessions)
+  , m_store(store)
+  , m_group_id(group_id)
+  , m_directory(0)
+  , m_moved_in_index(0) {
+  // Entries after the checkpoint are deduplicated against the sessions at the checkpoint
+  auto checkpoint_state = m_store->CheckpointState();
+  if (!checkpoint_state.empty() && !RestoreCheckpointState(checkpoint_state)) {
+    LOG(FATAL) << "Failed to restore the checkpoint state at index " << m_last_applied.load();
+  }
 }
 
 int StateMachine::LastApplied() const {
   return m_last_applied.load();
 }
 
-void StateMachine::IncrementLastApplied() {
-  m_last_applied++;
-}
+std::string StateMachine::ApplyCommand(int log_index, const protocol::log::LogEntry& log_entry) {
+  // Timestamps from different LEADERs may go backwards, the time never does
+  m_store->SetTime(log_index, std::max(m_store->Time(), (int64_t)log_entry.timestamp()));
+  m_store->ExpireKeys(log_index);
 
-std::string StateMachine::ApplyCommand(int log_index, protocol::log::LogEntry &log_entry) {
   switch (log_entry.type()) {
     case protocol::log::LogOpCode::NO_OP: {
       break;
@@ -24,19 +46,316 @@ std::string StateMachine::ApplyCommand(int log_index, protocol::log::LogEntry &l
       break;
     }
     case protocol::log::LogOpCode::DATA: {
-      std::string command = log_entry.data();
-      int split_pos = command.find(':');
-      std::string key = command.substr(0, split_pos);
-      std::string val = command.substr(split_pos + 1);
-      m_store->Write(key, val);
+      protocol::raft::ClientRequest_Response reply;
+      // Commands from expired sessions and retried commands are not applied
+      if (!m_sessions->SessionExists(log_entry.clientid()) ||
+          m_sessions->GetCachedResponse(log_entry.clientid(), log_entry.sequencenum(), reply)) {
+        break;
+      }
+
+      auto command = DecodeCommand(log_entry.data());
+      if (!command.has_value()) {
+        reply.set_status(false);
+        reply.set_response("INVALID_COMMAND");
+      } else if (!ServesCommand(command.value())) {
+        reply.set_status(false);
+        reply.set_response("WRONG_GROUP");
+      } else if (command->type == CommandType::BATCH) {
+        ApplyBatch(log_index, command.value(), reply);
+      } else {
+        write_set writes;
+        protocol::raft::CommandResult result;
+        if (EvaluateOperation(command.value(), writes, result)) {
+          CommitWrites(log_index, writes);
+        }
+        reply.set_status(result.status());
+        reply.set_response(std::move(*result.mutable_response()));
+        reply.set_value(std::move(*result.mutable_value()));
+      }
+      reply.set_index(log_index);
+      m_sessions->CacheResponse(log_entry.clientid(), log_entry.sequencenum(), reply);
+      break;
+    }
+    case protocol::log::LogOpCode::RANGE_SPLIT: {
+      m_store->Split(log_entry.range().key());
+      break;
+    }
+    case protocol::log::LogOpCode::RANGE_MERGE: {
+      m_store->Merge(log_entry.range().key());
+      break;
+    }
+    case protocol::log::LogOpCode::RANGE_MOVE_OUT:
+    case protocol::log::LogOpCode::RANGE_MOVE_IN:
+    case protocol::log::LogOpCode::RANGE_ASSIGN:
+    case protocol::log::LogOpCode::RANGE_MOVE_DONE: {
+      ApplyRangeMove(log_index, log_entry);
       break;
     }
     default: {
     }
   }
-  IncrementLastApplied();
+  m_store->SetAppliedIndex(log_index);
+  m_last_applied.store(log_index);
+
+  if (log_index % MVCC_GC_INTERVAL == 0) {
+    if (m_store->CanRequestFlush() && m_store->MemoryBytes() >= LSM_MEMTABLE_BYTES) {
+      m_store->RequestFlush(CheckpointState());
+    }
+    m_store->CollectGarbage();
+  }
   return "SUCCESS";
 }
 
+const RangeDirectory& StateMachine::Directory() const {
+  return m_directory;
 }
 
+bool StateMachine::Serves(std::string_view key) const {
+  return m_directory.GroupFor(key) == m_group_id;
+}
+
+int StateMachine::MovedInIndex() const {
+  return m_moved_in_index.load();
+}
+
+std::vector<protocol::log::RangeMove> StateMachine::OutgoingMoves() const {
+  std::lock_guard<std::mutex> lock(m_moves_lock);
+  std::vector<protocol::log::RangeMove> moves;
+  for (auto& [start_key, move]:m_outgoing_moves) {
+    moves.push_back(move);
+  }
+  return moves;
+}
+
+void StateMachine::ApplyBatch(
+    const int log_index,
+    const Command& batch,
+    protocol::raft::ClientRequest_Response& reply) {
+  write_set writes;
+  for (auto& operation:batch.operations) {
+    if (!EvaluateOperation(operation, writes, *reply.add_results())) {
+      reply.set_status(false);
+      reply.set_response("ABORTED");
+      return;
+    }
+  }
+
+  CommitWrites(log_index, writes);
+  reply.set_status(true);
+  reply.set_response("SUCCESS");
+}
+
+bool StateMachine::EvaluateOperation(
+    const Command& command,
+    write_set& writes,
+    protocol::raft::CommandResult& result) {
+  switch (command.type) {
+    case CommandType::PUT: {
+      // Values are copied once, straight from the log entry into the write set
+      writes[command.key] = InmemoryStore::Value{std::string(command.value.value()), ExpiryTime(command)};
+      result.set_response("SUCCESS");
+      break;
+    }
+    case CommandType::DELETE: {
+      if (!CurrentValue(command.key, writes).has_value()) {
+        result.set_response("NOT_FOUND");
+        break;
+      }
+      writes[command.key] = std::nullopt;
+      result.set_response("SUCCESS");
+      break;
+    }
+    case CommandType::COMPARE_AND_SWAP: {
+      auto current = CurrentValue(command.key, writes);
+      bool matches = command.expected.has_value()
+        ? current.has_value() && current->data == command.expected.value()
+        : !current.has_value();
+      if (!matches) {
+        result.set_status(false);
+        result.set_response("CONDITION_FAILED");
+        result.set_value(current.has_value() ? current->data : "");
+        return false;
+      }
+
+      // Without a new value the key is deleted if it matched
+      if (command.value.has_value()) {
+        writes[command.key] = InmemoryStore::Value{std::string(command.value.value()), ExpiryTime(command)};
+      } else if (current.has_value()) {
+        writes[command.key] = std::nullopt;
+      }
+      result.set_response("SUCCESS");
+      break;
+    }
+    case CommandType::INCREMENT: {
+      auto current = CurrentValue(command.key, writes);
+      int64_t value = 0;
+      if (current.has_value()) {
+        auto& data = current->data;
+        auto [end, ec] = std::from_chars(data.data(), data.data() + data.size(), value);
+        if (ec != std::errc() || end != data.data() + data.size()) {
+          result.set_status(false);
+          result.set_response("NOT_AN_INTEGER");
+          return false;
+        }
+      }
+      if (__builtin_add_overflow(value, command.delta, &value)) {
+        result.set_status(false);
+        result.set_response("OVERFLOW");
+        return false;
+      }
+
+      // Missing keys count from zero, existing keys keep their expiry
+      int64_t expires_at = current.has_value() ? current->expires_at : NO_EXPIRY;
+      writes[command.key] = InmemoryStore::Value{std::to_string(value), expires_at};
+      result.set_response("SUCCESS");
+      result.set_value(std::to_string(value));
+      break;
+    }
+    default: {
+      result.set_status(false);
+      result.set_response("UNSUPPORTED_COMMAND");
+      return false;
+    }
+  }
+  result.set_status(true);
+  return true;
+}
+
+std::optional<InmemoryStore::Value> StateMachine::CurrentValue(std::string_view key, const write_set& writes) const {
+  auto it = writes.find(key);
+  if (it != writes.end()) {
+    return it->second;
+  }
+
+  try {
+    return m_store->ReadValue(key);
+  } catch (const std::out_of_range& e) {
+    return std::nullopt;
+  }
+}
+
+int64_t StateMachine::ExpiryTime(const Command& command) const {
+  if (command.ttl_ms == 0) {
+    return NO_EXPIRY;
+  }
+  return m_store->Time() + command.ttl_ms;
+}
+
+void StateMachine::CommitWrites(const int log_index, write_set& writes) {
+  for (auto& [key, value]:writes) {
+    if (value.has_value()) {
+      m_store->Write(key, value->data, log_index, value->expires_at);
+    } else {
+      m_store->Delete(key, log_index);
+    }
+  }
+}
+
+bool StateMachine::ServesCommand(const Command& command) const {
+  if (command.type != CommandType::BATCH) {
+    return Serves(command.key);
+  }
+  for (auto& operation:command.operations) {
+    if (!Serves(operation.key)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void StateMachine::ApplyRangeMove(const int log_index, const protocol::log::LogEntry& log_entry) {
+  auto& move = log_entry.move();
+  switch (log_entry.type()) {
+    case protocol::log::LogOpCode::RANGE_MOVE_OUT: {
+      // Commands touching the range are rejected from now on, so its values are final
+      if (!m_directory.Serves(m_group_id, move.startkey(), move.endkey())) {
+        break;
+      }
+      m_directory.Assign(move.startkey(), move.endkey(), move.groupid());
+      std::lock_guard<std::mutex> lock(m_moves_lock);
+      m_outgoing_moves[move.startkey()] = move;
+      break;
+    }
+    case protocol::log::LogOpCode::RANGE_MOVE_IN: {
+      // A resumed move may resend values the group already serves and has overwritten
+      if (m_directory.Serves(m_group_id, move.startkey(), move.endkey())) {
+        break;
+      }
+      for (auto& value:move.values()) {
+        m_store->Write(value.key(), value.value(), log_index, value.expiresat());
+      }
+      if (move.last()) {
+        m_directory.Assign(move.startkey(), move.endkey(), m_group_id);
+        m_moved_in_index.store(log_index);
+      }
+      break;
+    }
+    case protocol::log::LogOpCode::RANGE_ASSIGN: {
+      // Only moves in and out of the group change which keys it serves
+      if (move.groupid() != m_group_id && !m_directory.Overlaps(m_group_id, move.startkey(), move.endkey())) {
+        m_directory.Assign(move.startkey(), move.endkey(), move.groupid());
+      }
+      break;
+    }
+    case protocol::log::LogOpCode::RANGE_MOVE_DONE: {
+      if (!m_directory.Overlaps(m_group_id, move.startkey(), move.endkey())) {
+        DeleteRange(log_index, move.startkey(), move.endkey());
+      }
+      std::lock_guard<std::mutex> lock(m_moves_lock);
+      m_outgoing_moves.erase(move.startkey());
+      break;
+    }
+    default: {
+    }
+  }
+}
+
+void StateMachine::DeleteRange(const int log_index, const std::string& start_key, const std::string& end_key) {
+  // Scans see the store as of the previous entry, so keys deleted here are still listed
+  std::string next_key = start_key;
+  while (true) {
+    auto entries = m_store->Scan(next_key, end_key, RANGE_DELETE_PAGE);
+    for (auto& [key, value]:entries) {
+      m_store->Delete(key, log_index);
+    }
+    if (entries.size() < RANGE_DELETE_PAGE) {
+      break;
+    }
+    next_key = entries.back().first + '\0';
+  }
+}
+
+std::string StateMachine::CheckpointState() const {
+  std::string out;
+  core::EncodeString(out, m_sessions->Serialize());
+  core::EncodeString(out, m_directory.Serialize());
+  auto moves = OutgoingMoves();
+  core::EncodeVarint(out, moves.size());
+  for (auto& move:moves) {
+    core::EncodeString(out, move.SerializeAsString());
+  }
+  return out;
+}
+
+bool StateMachine::RestoreCheckpointState(std::string_view data) {
+  std::string_view sessions, directory;
+  uint64_t move_count;
+  if (!core::DecodeString(data, sessions) || !core::DecodeString(data, directory) ||
+      !core::DecodeVarint(data, move_count) ||
+      !m_sessions->Restore(sessions) || !m_directory.Restore(directory)) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(m_moves_lock);
+  for (uint64_t i = 0; i < move_count; i++) {
+    std::string_view encoded;
+    protocol::log::RangeMove move;
+    if (!core::DecodeString(data, encoded) || !move.ParseFromArray(encoded.data(), encoded.size())) {
+      return false;
+    }
+    m_outgoing_moves[move.startkey()] = move;
+  }
+  return data.empty();
+}
+
+}
@@ -2,30 +2,168 @@
 #define STATE_MACHINE_H
 
 #include <atomic>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
+#include "command_codec.h"
 #include "inmemory_store.h"
 #include "raft.grpc.pb.h"
+#include "range_directory.h"
 #include "session_cache.h"
 
 namespace raft {
 
 class StateMachine {
 public:
-  StateMachine(std::shared_ptr<SessionCache> sessions, std::shared_ptr<InmemoryStore> store);
+  /**
+   * Restores the client sessions, range directory and unfinished moves saved with the
+   * store's checkpoint.
+   *
+   * @param group_id the raft group whose log is applied. Group 0 initially serves every
+   *    key, other groups serve keys once ranges are moved to them.
+   */
+  StateMachine(
+      std::shared_ptr<SessionCache> sessions,
+      std::shared_ptr<InmemoryStore> store,
+      const int group_id = 0);
 
+  /**
+   * Retrieve the index of the last log entry applied to the state machine. Starts at the
+   * store's checkpoint, so entries persisted by the store are not applied again.
+   *
+   * @return m_last_applied
+   */
   int LastApplied() const;
-  void IncrementLastApplied();
 
-  std::string ApplyCommand(int log_index, protocol::log::LogEntry& log_entry);
+  /**
+   * Applies a committed log entry. Entries must be applied in log order. Client commands
+   * are deduplicated using the client session so that retried commands are only applied
+   * once, and the response is cached in the session for the request handler. Conditional
+   * commands only depend on the store and the command, so every replica reaches the same
+   * outcome. Values expire at the time of the entry that wrote them plus their TTL, where
+   * the time comes from the LEADER's timestamps in the log. Every
+   * operation of a command is written at the entry's index, so readers at any index
+   * observe either all or none of a batch. Old
+   * versions in the store are garbage collected every MVCC_GC_INTERVAL entries. Once the
+   * store holds LSM_MEMTABLE_BYTES a flush is requested at the entry's index together
+   * with the client sessions and the range directory, so a restarted node applies
+   * entries after the checkpoint exactly like the node that applied them. The flush itself runs in the
+   * background.
+   *
+   * Commands touching keys the group does not serve fail with WRONG_GROUP. Entries moving
+   * ranges between groups update the group's range directory, so every replica agrees
+   * on which commands were rejected.
+   *
+   * @param log_index the index of the entry in the raft log
+   * @param log_entry the committed entry
+   * @returns the result of the command
+   */
+  std::string ApplyCommand(int log_index, const protocol::log::LogEntry& log_entry);
+
+  /**
+   * Ranges served by each group as known to this group.
+   */
+  const RangeDirectory& Directory() const;
+
+  /**
+   * Determines whether the group serves a key at the last applied index.
+   */
+  bool Serves(std::string_view key) const;
+
+  /**
+   * Retrieve the index of the last entry that finished moving a range into the group.
+   * Snapshots below it may lack values of keys the group serves.
+   */
+  int MovedInIndex() const;
+
+  /**
+   * Ranges this group stopped serving whose values have not been deleted yet, because
+   * the target group or group 0 may not have applied the move.
+   */
+  std::vector<protocol::log::RangeMove> OutgoingMoves() const;
 
 private:
+  /**
+   * Writes staged by the operations of a command, keyed by views into the command. A
+   * key without a value is deleted.
+   */
+  using write_set = std::map<std::string_view, std::optional<InmemoryStore::Value>>;
+
+  /**
+   * Applies every operation of a batch if all of them succeed, none otherwise.
+   *
+   * @param log_index the index of the entry holding the batch
+   * @param batch the batch, viewing the entry's data
+   * @param reply the response receiving a result per evaluated operation
+   */
+  void ApplyBatch(const int log_index, const Command& batch, protocol::raft::ClientRequest_Response& reply);
+
+  /**
+   * Evaluates a single operation against the store and the writes staged by earlier
+   * operations of the same command, staging its own writes.
+   *
+   * @param command the operation
+   * @param writes the staged writes
+   * @param result set to the outcome of the operation
+   * @returns whether the operation succeeded
+   */
+  bool EvaluateOperation(const Command& command, write_set& writes, protocol::raft::CommandResult& result);
+
+  /**
+   * Retrieves the value of a key including staged writes.
+   */
+  std::optional<InmemoryStore::Value> CurrentValue(std::string_view key, const write_set& writes) const;
+
+  /**
+   * Computes when a value written by a command expires, relative to the time of the
+   * entry being applied.
+   */
+  int64_t ExpiryTime(const Command& command) const;
+
+  /**
+   * Moves staged writes into the store.
+   */
+  void CommitWrites(const int log_index, write_set& writes);
+
+  /**
+   * Determines whether the group serves every key of a command.
+   */
+  bool ServesCommand(const Command& command) const;
+
+  void ApplyRangeMove(const int log_index, const protocol::log::LogEntry& log_entry);
+
+  /**
+   * Deletes every key of a range at a log index.
+   */
+  void DeleteRange(const int log_index, const std::string& start_key, const std::string& end_key);
+
+  /**
+   * Encodes the state saved with a flush of the store, which must match the applied
+   * index.
+   */
+  std::string CheckpointState() const;
+
+  bool RestoreCheckpointState(std::string_view data);
+
   std::shared_ptr<SessionCache> m_sessions;
   std::shared_ptr<InmemoryStore> m_store;
   std::atomic<int> m_last_applied;
+  const int m_group_id;
+  RangeDirectory m_directory;
+  std::atomic<int> m_moved_in_index;
+
+  /**
+   * Outgoing moves keyed by the start key of their range, read by the LEADER to resume
+   * them.
+   */
+  mutable std::mutex m_moves_lock;
+  std::map<std::string, protocol::log::RangeMove> m_outgoing_moves;
 };
 
 }
@@ -52,8 +52,11 @@ PersistedLog::Page& PersistedLog::Page::operator=(const Page&& page) {
   return *this;
 } 
 
-PersistedLog::Page::Record::Record(int offset, protocol::log::LogEntry entry)
-  : offset(offset), entry(entry) {
+PersistedLog::Page::Record::Record(
+    int offset,
+    protocol::log::LogEntry entry,
+    std::shared_ptr<const std::string> data)
+  : offset(offset), entry(entry), data(data) {
 }
 
 void PersistedLog::Page::Close() {
@@ -77,15 +80,27 @@ int PersistedLog::Page::RemainingSpace() const {
   return max_file_size - byte_offset;
 }
 
-bool PersistedLog::Page::WriteLogEntry(std::fstream& file, const protocol::log::LogEntry& new_entry) {
-  // Note that the result isn't flushed to disk so that writes can be batched
-  bool success = google::protobuf::util::SerializeDelimitedToOstream(new_entry, &file);
-  if (success) {
-    log_entries.push_back(Page::Record(byte_offset, new_entry));
-    byte_offset += new_entry.ByteSizeLong();
-    end_index++;
+bool PersistedLog::Page::WriteLogEntry(
+    std::fstream& file,
+    const protocol::log::LogEntry& new_entry,
+    std::shared_ptr<const std::string> data) {
+  // Same layout as a delimited protobuf message, the bytes are written directly since
+  // they are already serialized. Note that the result isn't flushed to disk so that
+  // writes can be batched
+  {
+    google::protobuf::io::OstreamOutputStream file_stream(&file);
+    google::protobuf::io::CodedOutputStream coded_stream(&file_stream);
+    coded_stream.WriteVarint32(data->size());
+    coded_stream.WriteRaw(data->data(), data->size());
+    if (coded_stream.HadError()) {
+      return false;
+    }
   }
-  return success;
+
+  log_entries.push_back(Page::Record(byte_offset, new_entry, data));
+  byte_offset += data->size();
+  end_index++;
+  return file.good();
 }
 
 void PersistedLog::Page::TruncateSuffix(int removal_index) {
@@ -190,35 +205,18 @@ protocol::log::LogEntry PersistedLog::Entry(const int idx) const {
 }
 
 std::vector<protocol::log::LogEntry> PersistedLog::Entries(int start, int end) const {
-  if (start > end || end > LastLogIndex() + 1 || start < 0) {
-    LOG(FATAL) << "Raft log slice query invalid, start = " << start << " end = " << end << " last_log_index = " << LastLogIndex();
+  std::vector<protocol::log::LogEntry> query_entries;
+  for (auto record:Records(start, end)) {
+    query_entries.push_back(record->entry);
   }
 
-  std::vector<Page::Record> query_records;
-  int curr = start;
-  while (curr < end) {
-    // Upper bound gets page with start_index > idx so that previous page in map is correct page
-    auto it = m_log_indices.upper_bound(curr);
-    it--;
-    const auto& page = it->second;
-
-    // Prevent start - page->start_index from being negative to prevent indexing out of bounds
-    start = start >= page->start_index ? start - page->start_index : 0;
-    // If end is inside the upper range then entries in [start, end - start_index) must be retrieved
-    // If end is outside the upper range then entries in [start, end) are retrieved
-    if (page->end_index >= end) {
-      query_records.insert(query_records.end(), page->log_entries.begin() + start, page->log_entries.begin() + end - page->start_index);
-    } else {
-      query_records.insert(query_records.end(), page->log_entries.begin() + start, page->log_entries.end());
-    }
-
-    // The end index matches the start index of the next page
-    curr = page->end_index;
-  }
+  return query_entries;
+}
 
-  std::vector<protocol::log::LogEntry> query_entries;
-  for (auto& record:query_records) {
-    query_entries.push_back(record.entry);
+std::vector<std::shared_ptr<const std::string>> PersistedLog::SerializedEntries(int start, int end) const {
+  std::vector<std::shared_ptr<const std::string>> query_entries;
+  for (auto record:Records(start, end)) {
+    query_entries.push_back(record->data);
   }
 
   return query_entries;
@@ -246,9 +244,11 @@ int PersistedLog::Append(protocol::log::LogEntry& new_entry) {
   return log_index;
 }
 
-std::pair<int, int> PersistedLog::Append(const std::vector<protocol::log::LogEntry>& new_entries) {
+std::pair<int, int> PersistedLog::Append(
+    const std::vector<protocol::log::LogEntry>& new_entries,
+    const std::vector<std::shared_ptr<const std::string>>& serialized_entries) {
   int start = LogSize();
-  PersistLogEntries(new_entries);
+  PersistLogEntries(new_entries, serialized_entries);
   int end = LogSize();
   return {start, end};
 }
@@ -296,6 +296,33 @@ void PersistedLog::TruncateSuffix(const int removal_index) {
   }
 }
 
+std::vector<const PersistedLog::Page::Record*> PersistedLog::Records(int start, int end) const {
+  if (start > end || end > LastLogIndex() + 1 || start < 0) {
+    LOG(FATAL) << "Raft log slice query invalid, start = " << start << " end = " << end << " last_log_index = " << LastLogIndex();
+  }
+
+  std::vector<const Page::Record*> query_records;
+  query_records.reserve(end - start);
+  int curr = start;
+  while (curr < end) {
+    // Upper bound gets page with start_index > idx so that previous page in map is correct page
+    auto it = m_log_indices.upper_bound(curr);
+    it--;
+    const auto& page = it->second;
+
+    // Records in [curr, min(end, page->end_index)) are stored in this page
+    int page_end = std::min(end, page->end_index);
+    for (int i = curr; i < page_end; i++) {
+      query_records.push_back(&page->log_entries[i - page->start_index]);
+    }
+
+    // The end index matches the start index of the next page
+    curr = page->end_index;
+  }
+
+  return query_records;
+}
+
 std::vector<std::string> PersistedLog::ListDirectoryContents(const std::string& dir) {
   std::vector<std::string> file_list;
   for (const auto& entry:std::filesystem::directory_iterator(dir)) {
@@ -360,14 +387,22 @@ void PersistedLog::PersistMetadata(const std::string& metadata_path) {
   out.flush();
 }
 
-void PersistedLog::PersistLogEntries(const std::vector<protocol::log::LogEntry>& new_entries) {
+void PersistedLog::PersistLogEntries(
+    const std::vector<protocol::log::LogEntry>& new_entries,
+    const std::vector<std::shared_ptr<const std::string>>& serialized_entries) {
   std::string log_path = m_dir + m_open_page->filename;
   std::fstream out(log_path, std::ios::out | std::ios::app | std::ios::binary);
 
   bool success = true;
-  for (auto &entry:new_entries) {
+  for (int i = 0; i < new_entries.size(); i++) {
+    auto& entry = new_entries[i];
+    // Entries are serialized at most once, the bytes are reused when replicating to FOLLOWERs
+    auto data = serialized_entries.empty()
+      ? std::make_shared<const std::string>(entry.SerializeAsString())
+      : serialized_entries[i];
+
     // If there is no space remaining in current open file open a new file
-    if (entry.ByteSizeLong() > m_open_page->RemainingSpace()) {
+    if (data->size() > m_open_page->RemainingSpace()) {
       CreateOpenFile();
       out.close();
 
@@ -375,7 +410,7 @@ void PersistedLog::PersistLogEntries(const std::vector<protocol::log::LogEntry>&
       out.open(log_path, std::ios::out | std::ios::app | std::ios::binary);
     }
 
-    success = m_open_page->WriteLogEntry(out, entry);
+    success = m_open_page->WriteLogEntry(out, entry, data);
     if (!success) {
       LOG(FATAL) << "Unexpected serialization failure when persisting raft log to disk";
     }
@@ -391,12 +426,22 @@ std::vector<PersistedLog::Page::Record> PersistedLog::LoadLogEntries(const std::
   std::fstream in(log_path, std::ios::in | std::ios::binary);
 
   google::protobuf::io::IstreamInputStream log_stream(&in);
+  google::protobuf::io::CodedInputStream coded_stream(&log_stream);
   std::vector<Page::Record> log_entries;
-  protocol::log::LogEntry temp_log_entry;
 
-  while (google::protobuf::util::ParseDelimitedFromZeroCopyStream(&temp_log_entry, &log_stream, nullptr)) {
-    int offset = log_stream.ByteCount() - temp_log_entry.ByteSizeLong() - 1;
-    log_entries.push_back(Page::Record(offset, temp_log_entry));
+  while (true) {
+    int offset = coded_stream.CurrentPosition();
+    uint32_t size;
+    std::string data;
+    if (!coded_stream.ReadVarint32(&size) || !coded_stream.ReadString(&data, size)) {
+      break;
+    }
+
+    protocol::log::LogEntry log_entry;
+    if (!log_entry.ParseFromString(data)) {
+      break;
+    }
+    log_entries.push_back(Page::Record(offset, log_entry, std::make_shared<const std::string>(std::move(data))));
   }
 
   DLOG(INFO) << "Restored log entries from disk, size = " << log_entries.size();
@@ -10,6 +10,7 @@
 #include <filesystem>
 #include <fstream>
 #include <map>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -90,6 +91,18 @@ public:
    */
   virtual std::vector<protocol::log::LogEntry> Entries(int start, int end) const = 0;
 
+  /**
+   * Retrieves the serialized bytes of entries between two indices from raft log.
+   * The bytes are shared with the log so they can be spliced into outgoing
+   * AppendEntries requests without serializing the entries again.
+   *
+   * @param start the starting index at which entries are retrieved (inclusive)
+   * @param end the ending index at which entries are retrieved (exclusive)
+   * @returns list of serialized raft log entries
+   * @throws std::out_of_range Thrown if requested range does not exist in log.
+   */
+  virtual std::vector<std::shared_ptr<const std::string>> SerializedEntries(int start, int end) const = 0;
+
   virtual std::tuple<int, bool> LatestConfiguration(protocol::log::Configuration& configuration) const = 0;
 
   virtual int Append(protocol::log::LogEntry& new_entry) = 0;
@@ -98,8 +111,12 @@ public:
    * Stores new transactions at the end of the raft log.
    *
    * @param new_entries list of entries that must be appended to log
+   * @param serialized_entries the serialized bytes of each entry, written to disk as is.
+   *    FOLLOWERs pass the bytes received from the LEADER. Entries are serialized if empty.
    */
-  virtual std::pair<int, int> Append(const std::vector<protocol::log::LogEntry>& new_entries) = 0;
+  virtual std::pair<int, int> Append(
+      const std::vector<protocol::log::LogEntry>& new_entries,
+      const std::vector<std::shared_ptr<const std::string>>& serialized_entries = {}) = 0;
 
   /**
    * Removes all entries from raft log at and after a given index.
@@ -139,24 +156,33 @@ public:
 
   protocol::log::LogEntry Entry(const int idx) const override;
   std::vector<protocol::log::LogEntry> Entries(int start, int end) const override;
+  std::vector<std::shared_ptr<const std::string>> SerializedEntries(int start, int end) const override;
 
   std::tuple<int, bool> LatestConfiguration(protocol::log::Configuration& configuration) const override;
 
   int Append(protocol::log::LogEntry& new_entry) override;
-  std::pair<int, int> Append(const std::vector<protocol::log::LogEntry>& new_entries) override;
+  std::pair<int, int> Append(
+      const std::vector<protocol::log::LogEntry>& new_entries,
+      const std::vector<std::shared_ptr<const std::string>>& serialized_entries = {}) override;
 
   void TruncateSuffix(const int removal_index) override;
 
   class Page {
   public:
     struct Record {
-      Record(int offset, protocol::log::LogEntry entry);
+      Record(int offset, protocol::log::LogEntry entry, std::shared_ptr<const std::string> data);
 
       /**
        * Raft log entry persisted to disk.
        */
       protocol::log::LogEntry entry;
 
+      /**
+       * Serialized form of the log entry, exactly as written to disk. Shared with
+       * outgoing AppendEntries requests so each entry is only serialized once.
+       */
+      std::shared_ptr<const std::string> data;
+
       /**
        * Byte offset in file where the log entry binary data starts.
        */
@@ -191,9 +217,13 @@ public:
      *
      * @param file an opened file where log entry is stored
      * @param new_entry the log entry that must be persisted
+     * @param data the serialized bytes of new_entry
      * @returns whether the entry was successfully written to disk
      */
-    bool WriteLogEntry(std::fstream& file, const protocol::log::LogEntry& new_entry);
+    bool WriteLogEntry(
+        std::fstream& file,
+        const protocol::log::LogEntry& new_entry,
+        std::shared_ptr<const std::string> data);
 
     /**
      * Removes all log entries from the page at and after an index, N, from disk and memory.
@@ -260,6 +290,15 @@ public:
   };
 
 private:
+  /**
+   * Collects the in memory records for entries between two indices from raft log.
+   *
+   * @param start the starting index at which records are retrieved (inclusive)
+   * @param end the ending index at which records are retrieved (exclusive)
+   * @returns pointers to records owned by the pages of the log
+   */
+  std::vector<const Page::Record*> Records(int start, int end) const;
+
   /**
    * Get all files in a directory (does not recursively iterate through folders).
    *
@@ -303,9 +342,12 @@ private:
    * enough space in open file, the file is closed and entries are written to a new file.
    *
    * @param new_entries the log entries that must be persisted
+   * @param serialized_entries the serialized bytes of each entry, or empty to serialize them
    * @throws std::runtime_error thrown if there was an error serializing a log entry to disk
    */
-  void PersistLogEntries(const std::vector<protocol::log::LogEntry>& new_entries);
+  void PersistLogEntries(
+      const std::vector<protocol::log::LogEntry>& new_entries,
+      const std::vector<std::shared_ptr<const std::string>>& serialized_entries = {});
 
   /**
    * Read raft metadata from disk.
@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+#include <string>
+
+#include "arena.h"
+
+namespace core {
+
+TEST(SlabArena, FreedSlotsAreReused) {
+  SlabArena arena;
+  char* first = arena.Allocate(20);
+  EXPECT_EQ(arena.AllocatedBytes(), 24);
+  EXPECT_EQ(arena.ReservedBytes(), ARENA_CHUNK_SIZE);
+
+  arena.Free(first, 20);
+  EXPECT_EQ(arena.AllocatedBytes(), 0);
+  // Any size in the same class takes the freed slot
+  EXPECT_EQ(arena.Allocate(17), first);
+  EXPECT_NE(arena.Allocate(17), first);
+  EXPECT_EQ(arena.ReservedBytes(), ARENA_CHUNK_SIZE);
+}
+
+TEST(SlabArena, LargeAllocationsBypassChunks) {
+  SlabArena arena;
+  EXPECT_EQ(arena.Allocate(0), nullptr);
+
+  char* data = arena.Allocate(10000);
+  EXPECT_EQ(arena.ReservedBytes(), 10000);
+  EXPECT_EQ(arena.AllocatedBytes(), 10000);
+  arena.Free(data, 10000);
+  EXPECT_EQ(arena.ReservedBytes(), 0);
+
+  // Left for the destructor to free
+  arena.Allocate(10000);
+}
+
+TEST(PackedString, ShortStringsAreInlined) {
+  SlabArena arena;
+  auto short_string = PackedString::Create(arena, "short");
+  EXPECT_FALSE(short_string.Allocated());
+  EXPECT_EQ(short_string.View(), "short");
+  EXPECT_EQ(arena.AllocatedBytes(), 0);
+
+  std::string value(100, 'x');
+  auto long_string = PackedString::Create(arena, value);
+  EXPECT_TRUE(long_string.Allocated());
+  EXPECT_EQ(long_string.View(), value);
+  EXPECT_EQ(arena.AllocatedBytes(), 128);
+
+  long_string.Release(arena);
+  EXPECT_EQ(long_string.Size(), 0);
+  EXPECT_EQ(arena.AllocatedBytes(), 0);
+  EXPECT_EQ(sizeof(PackedString), 16);
+}
+
+}
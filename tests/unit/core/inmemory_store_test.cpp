@@ -0,0 +1,204 @@
+#include <gtest/gtest.h>
+
+#include "inmemory_store.h"
+
+TEST(InmemoryStore, SplitMovesKeysToNewRange) {
+  InmemoryStore store;
+  store.Write("a", "1", 0);
+  store.Write("m", "2", 1);
+  store.Write("z", "3", 2);
+
+  EXPECT_TRUE(store.Split("m"));
+  // The key already starts a range
+  EXPECT_FALSE(store.Split("m"));
+
+  auto ranges = store.Ranges();
+  ASSERT_EQ(ranges.size(), 2);
+  EXPECT_EQ(ranges[0].start_key, "");
+  EXPECT_EQ(ranges[0].end_key, "m");
+  EXPECT_EQ(ranges[0].key_count, 1);
+  EXPECT_EQ(ranges[0].size_bytes, 2);
+  EXPECT_EQ(ranges[1].start_key, "m");
+  EXPECT_EQ(ranges[1].end_key, "");
+  EXPECT_EQ(ranges[1].key_count, 2);
+  EXPECT_EQ(ranges[1].size_bytes, 4);
+
+  EXPECT_EQ(store.Read("a"), "1");
+  EXPECT_EQ(store.Read("z"), "3");
+  EXPECT_THROW(store.Read("b"), std::out_of_range);
+}
+
+TEST(InmemoryStore, MergeIntoPreviousRange) {
+  InmemoryStore store;
+  store.Write("a", "1", 0);
+  store.Write("m", "2", 1);
+  store.Split("m");
+
+  // The first range has no range to merge into
+  EXPECT_FALSE(store.Merge(""));
+  EXPECT_FALSE(store.Merge("b"));
+  EXPECT_TRUE(store.Merge("m"));
+
+  auto ranges = store.Ranges();
+  ASSERT_EQ(ranges.size(), 1);
+  EXPECT_EQ(ranges[0].key_count, 2);
+  EXPECT_EQ(ranges[0].size_bytes, 4);
+  EXPECT_EQ(ranges[0].operations, 2);
+  EXPECT_EQ(store.Read("m"), "2");
+}
+
+TEST(InmemoryStore, MedianKeySplitsRangeInHalf) {
+  InmemoryStore store;
+  EXPECT_FALSE(store.MedianKey("").has_value());
+
+  for (auto key:{"a", "b", "c", "d"}) {
+    store.Write(key, "value", 0);
+  }
+  auto median = store.MedianKey("");
+  ASSERT_TRUE(median.has_value());
+  EXPECT_EQ(median.value(), "c");
+}
+
+TEST(InmemoryStore, ScanAcrossRanges) {
+  InmemoryStore store;
+  for (auto key:{"e", "a", "d", "b", "c"}) {
+    store.Write(key, std::string(key) + "1", 0);
+  }
+  store.Split("c");
+
+  auto entries = store.Scan("b", "e", 10);
+  ASSERT_EQ(entries.size(), 3);
+  EXPECT_EQ(entries[0].first, "b");
+  EXPECT_EQ(entries[1].first, "c");
+  EXPECT_EQ(entries[2].first, "d");
+  EXPECT_EQ(entries[2].second, "d1");
+
+  // Empty end key scans to the end of the store
+  entries = store.Scan("", "", 2);
+  ASSERT_EQ(entries.size(), 2);
+  EXPECT_EQ(entries[1].first, "b");
+
+  store.Merge("c");
+  EXPECT_EQ(store.Scan("c", "", 10).size(), 3);
+}
+
+TEST(InmemoryStore, ScanLimitCutsInsideSecondRange) {
+  InmemoryStore store;
+  for (auto key:{"a", "b", "c", "d", "e", "f"}) {
+    store.Write(key, std::string(key) + "1", 0);
+  }
+  store.Split("c");
+
+  // The page ends after two of the second range's four keys
+  auto entries = store.Scan("a", "", 4);
+  ASSERT_EQ(entries.size(), 4);
+  EXPECT_EQ(entries[1].first, "b");
+  EXPECT_EQ(entries[2].first, "c");
+  EXPECT_EQ(entries[3].first, "d");
+  EXPECT_EQ(entries[3].second, "d1");
+
+  // The next page continues after the last key returned
+  entries = store.Scan(entries.back().first + '\0', "", 4);
+  ASSERT_EQ(entries.size(), 2);
+  EXPECT_EQ(entries[0].first, "e");
+  EXPECT_EQ(entries[1].first, "f");
+
+  entries = store.Scan("b", "f", 3);
+  ASSERT_EQ(entries.size(), 3);
+  EXPECT_EQ(entries[0].first, "b");
+  EXPECT_EQ(entries[2].first, "d");
+}
+
+TEST(InmemoryStore, SnapshotReadsAtFixedIndex) {
+  InmemoryStore store(0);
+  store.Write("a", "1", 0);
+  store.SetAppliedIndex(0);
+
+  auto snapshot = store.OpenSnapshot();
+  ASSERT_NE(snapshot, nullptr);
+  EXPECT_EQ(snapshot->Index(), 0);
+
+  store.Write("a", "2", 1);
+  store.Write("b", "3", 2);
+  store.SetAppliedIndex(2);
+
+  EXPECT_EQ(snapshot->Read("a"), "1");
+  EXPECT_THROW(snapshot->Read("b"), std::out_of_range);
+  EXPECT_EQ(snapshot->Scan("", "", 10).size(), 1);
+  EXPECT_EQ(store.Read("a"), "2");
+
+  // Indices that have not been applied cannot be read
+  EXPECT_EQ(store.OpenSnapshot(3), nullptr);
+}
+
+TEST(InmemoryStore, GarbageCollectionRespectsOpenSnapshots) {
+  InmemoryStore store(0);
+  store.Write("a", "1", 0);
+  store.SetAppliedIndex(0);
+  auto snapshot = store.OpenSnapshot();
+
+  store.Write("a", "22", 1);
+  store.Write("a", "333", 2);
+  store.SetAppliedIndex(2);
+
+  // Versions after the snapshot's version are superseded but nothing is visible only
+  // below the snapshot
+  EXPECT_EQ(store.CollectGarbage(), 0);
+  EXPECT_EQ(snapshot->Read("a"), "1");
+
+  snapshot.reset();
+  EXPECT_EQ(store.CollectGarbage(), 3);
+  EXPECT_EQ(store.Ranges()[0].size_bytes, 4);
+  EXPECT_EQ(store.OpenSnapshot(1), nullptr);
+  EXPECT_EQ(store.Read("a"), "333");
+}
+
+TEST(InmemoryStore, DeleteHidesKeyFromLaterReads) {
+  InmemoryStore store;
+  store.Write("a", "1", 0);
+  store.Write("b", "2", 1);
+  EXPECT_TRUE(store.Delete("a", 2));
+  EXPECT_FALSE(store.Delete("missing", 3));
+  store.SetAppliedIndex(3);
+
+  EXPECT_THROW(store.Read("a"), std::out_of_range);
+  EXPECT_EQ(store.Read("a", 1), "1");
+  EXPECT_EQ(store.Scan("", "", 10).size(), 1);
+  EXPECT_EQ(store.Scan("", "", 10, 1).size(), 2);
+}
+
+TEST(InmemoryStore, CachedReadsSeeLaterWrites) {
+  InmemoryStore store;
+  store.Write("a", "1", 0);
+  store.SetAppliedIndex(0);
+  EXPECT_EQ(store.Read("a"), "1");
+  EXPECT_EQ(store.Read("a"), "1");
+  EXPECT_EQ(store.CacheStats().hits, 1);
+
+  store.Write("a", "2", 1);
+  store.SetAppliedIndex(1);
+  EXPECT_EQ(store.Read("a"), "2");
+  EXPECT_EQ(store.Read("a", 0), "1");
+  store.Delete("a", 2);
+  store.SetAppliedIndex(2);
+  EXPECT_THROW(store.Read("a"), std::out_of_range);
+}
+
+TEST(InmemoryStore, CollectedDeletesLeaveKeyIndex) {
+  InmemoryStore store(0);
+  int index = 0;
+  for (auto key:{"a", "b", "c", "d", "e", "f"}) {
+    store.Write(key, "value", index++);
+  }
+  for (auto key:{"a", "b", "c", "d"}) {
+    store.Delete(key, index++);
+  }
+  store.SetAppliedIndex(index - 1);
+  store.CollectGarbage();
+
+  // The median is chosen from the key index, which no longer holds the deleted keys
+  ASSERT_EQ(store.Ranges()[0].key_count, 2);
+  auto median = store.MedianKey("");
+  ASSERT_TRUE(median.has_value());
+  EXPECT_EQ(median.value(), "f");
+}
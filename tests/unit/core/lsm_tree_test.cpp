@@ -0,0 +1,224 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+
+#include "inmemory_store.h"
+#include "lsm_tree.h"
+
+namespace core {
+
+class LsmTreeTest: public ::testing::Test {
+protected:
+  void SetUp() override {
+    directory = (std::filesystem::temp_directory_path() / "maelstromdb_lsm_test/").string();
+    std::filesystem::remove_all(directory);
+  }
+
+  void TearDown() override {
+    std::filesystem::remove_all(directory);
+  }
+
+  void InstallTable(
+      LsmTree& tree,
+      const std::vector<std::pair<std::string, std::string>>& entries,
+      const int checkpoint_index) {
+    auto writer = tree.NewTable();
+    for (auto& [key, value]:entries) {
+      writer->Add(key, value);
+    }
+    ASSERT_TRUE(tree.Install(std::move(writer), checkpoint_index, 0, {""}));
+  }
+
+  std::string directory;
+};
+
+TEST_F(LsmTreeTest, SSTableSeeksAcrossIndexBlocks) {
+  std::filesystem::create_directories(directory);
+  SSTableWriter writer(directory + "0.sst");
+  for (int i = 0; i < 100; i++) {
+    writer.Add("key" + std::to_string(1000 + i), std::to_string(i));
+  }
+  ASSERT_TRUE(writer.Finish());
+
+  auto table = SSTable::Open(directory + "0.sst");
+  ASSERT_NE(table, nullptr);
+  EXPECT_EQ(table->Get("key1000")->value, "0");
+  EXPECT_EQ(table->Get("key1099")->value, "99");
+  EXPECT_EQ(table->Get("key1050")->value, "50");
+  EXPECT_FALSE(table->Get("key0").has_value());
+  EXPECT_FALSE(table->Get("key2000").has_value());
+
+  SSTable::Iterator it(*table);
+  it.Seek("key1031a");
+  ASSERT_TRUE(it.Valid());
+  EXPECT_EQ(it.Key(), "key1032");
+  for (int i = 32; i < 100; i++) {
+    ASSERT_TRUE(it.Valid());
+    EXPECT_EQ(it.Value(), std::to_string(i));
+    it.Next();
+  }
+  EXPECT_FALSE(it.Valid());
+}
+
+TEST_F(LsmTreeTest, ReopenRestoresCheckpoint) {
+  {
+    LsmTree tree(directory);
+    EXPECT_EQ(tree.CheckpointIndex(), -1);
+    InstallTable(tree, {{"a", "1"}, {"b", "2"}}, 10);
+    InstallTable(tree, {{"b", "3"}}, 20);
+
+    // Table abandoned by a flush that did not finish
+    auto writer = tree.NewTable();
+    writer->Add("c", "4");
+    writer->Finish();
+  }
+
+  LsmTree tree(directory);
+  EXPECT_EQ(tree.CheckpointIndex(), 20);
+  EXPECT_EQ(tree.TableCount(), 2);
+  EXPECT_EQ(tree.Get("a", 0)->value, "1");
+  // Newer tables shadow older ones
+  EXPECT_EQ(tree.Get("b", 0)->value, "3");
+  EXPECT_FALSE(tree.Get("c", 0).has_value());
+
+  auto entries = tree.Scan("", "", 10, 0);
+  ASSERT_EQ(entries.size(), 2);
+  EXPECT_EQ(entries[1], std::make_pair(std::string("b"), std::string("3")));
+}
+
+TEST_F(LsmTreeTest, CompactionMergesTables) {
+  LsmTree tree(directory);
+  InstallTable(tree, {{"a", "1"}, {"c", "1"}}, 1);
+  InstallTable(tree, {{"b", "2"}, {"c", "2"}}, 2);
+  InstallTable(tree, {{"d", "3"}}, 3);
+
+  tree.Compact();
+  EXPECT_EQ(tree.TableCount(), 1);
+  EXPECT_EQ(tree.CheckpointIndex(), 3);
+
+  auto entries = tree.Scan("b", "d", 10, 0);
+  ASSERT_EQ(entries.size(), 2);
+  EXPECT_EQ(entries[0], std::make_pair(std::string("b"), std::string("2")));
+  EXPECT_EQ(entries[1], std::make_pair(std::string("c"), std::string("2")));
+}
+
+TEST_F(LsmTreeTest, TombstonesHideOlderTables) {
+  LsmTree tree(directory);
+  InstallTable(tree, {{"a", "1"}, {"b", "1"}}, 1);
+  auto writer = tree.NewTable();
+  writer->AddDeletion("a");
+  ASSERT_TRUE(tree.Install(std::move(writer), 2, 0, {""}));
+
+  EXPECT_FALSE(tree.Get("a", 0).has_value());
+  EXPECT_EQ(tree.Scan("", "", 10, 0).size(), 1);
+
+  tree.Compact();
+  EXPECT_FALSE(tree.Get("a", 0).has_value());
+  EXPECT_EQ(tree.Get("b", 0)->value, "1");
+}
+
+TEST_F(LsmTreeTest, ExpiredValuesDroppedByCompaction) {
+  LsmTree tree(directory);
+  auto writer = tree.NewTable();
+  writer->Add("a", "1", 100);
+  writer->Add("b", "2");
+  ASSERT_TRUE(tree.Install(std::move(writer), 1, 50, {""}));
+  EXPECT_EQ(tree.Get("a", 99)->expires_at, 100);
+  EXPECT_FALSE(tree.Get("a", 100).has_value());
+  EXPECT_EQ(tree.Scan("", "", 10, 100).size(), 1);
+
+  // Values are kept until they expire by the checkpoint time
+  InstallTable(tree, {{"c", "3"}}, 2);
+  tree.Compact();
+  EXPECT_EQ(tree.Scan("", "", 10, 0).size(), 3);
+
+  writer = tree.NewTable();
+  ASSERT_TRUE(tree.Install(std::move(writer), 3, 100, {""}));
+  tree.Compact();
+  EXPECT_FALSE(tree.Get("a", 0).has_value());
+}
+
+TEST_F(LsmTreeTest, StoreDeletesFlushedKeys) {
+  InmemoryStore store(0, std::make_shared<LsmTree>(directory));
+  store.Write("a", "1", 0);
+  store.Write("b", "2", 1);
+  store.SetAppliedIndex(1);
+  store.CollectGarbage();
+  store.Flush();
+
+  EXPECT_TRUE(store.Delete("a", 2));
+  store.SetAppliedIndex(2);
+  EXPECT_THROW(store.Read("a"), std::out_of_range);
+  auto entries = store.Scan("", "", 10);
+  ASSERT_EQ(entries.size(), 1);
+  EXPECT_EQ(entries[0].first, "b");
+
+  // The tombstone is flushed along with the remaining keys
+  store.CollectGarbage();
+  store.Flush();
+  EXPECT_THROW(store.Read("a"), std::out_of_range);
+  EXPECT_EQ(store.Scan("", "", 10).size(), 1);
+}
+
+TEST_F(LsmTreeTest, StoreRestartsFromFlushedCheckpoint) {
+  {
+    InmemoryStore store(0, std::make_shared<LsmTree>(directory));
+    store.Write("a", "1", 0);
+    store.Write("m", "2", 1);
+    store.Split("m");
+    store.SetTime(2, 500);
+    store.Write("a", "3", 2);
+    store.Write("b", "5", 2, 400);
+    store.SetAppliedIndex(2);
+    store.CollectGarbage();
+    store.Flush();
+
+    EXPECT_EQ(store.Ranges()[0].key_count, 0);
+    // Flushed keys are read from disk
+    EXPECT_EQ(store.Read("a"), "3");
+    store.Write("z", "4", 3);
+    store.SetAppliedIndex(3);
+    EXPECT_EQ(store.Scan("", "", 10, LATEST_INDEX).size(), 3);
+  }
+
+  // Entries after the checkpoint are replayed from the raft log
+  InmemoryStore store(0, std::make_shared<LsmTree>(directory));
+  EXPECT_EQ(store.AppliedIndex(), 2);
+  EXPECT_EQ(store.Time(), 500);
+  EXPECT_EQ(store.Ranges().size(), 2);
+  // Values expired at the checkpoint are flushed as tombstones
+  EXPECT_THROW(store.Read("b"), std::out_of_range);
+  EXPECT_EQ(store.Read("a"), "3");
+  EXPECT_EQ(store.Read("m"), "2");
+  EXPECT_THROW(store.Read("z"), std::out_of_range);
+}
+
+TEST_F(LsmTreeTest, StoreFlushesRequestedIndexInBackground) {
+  {
+    InmemoryStore store(1, std::make_shared<LsmTree>(directory));
+    store.Write("a", "1", 1);
+    store.SetAppliedIndex(1);
+    ASSERT_TRUE(store.RequestFlush("sessions"));
+    EXPECT_FALSE(store.CanRequestFlush());
+    EXPECT_FALSE(store.RequestFlush("other"));
+
+    // The flush is scheduled once the horizon reaches the requested index, and later
+    // writes are not part of it
+    store.Write("a", "2", 2);
+    store.SetAppliedIndex(2);
+    store.CollectGarbage();
+    store.Write("b", "3", 3);
+    store.SetAppliedIndex(3);
+    store.CollectGarbage();
+    EXPECT_EQ(store.Read("a"), "2");
+  }
+
+  InmemoryStore store(1, std::make_shared<LsmTree>(directory));
+  EXPECT_EQ(store.AppliedIndex(), 1);
+  EXPECT_EQ(store.CheckpointState(), "sessions");
+  EXPECT_EQ(store.Read("a"), "1");
+  EXPECT_THROW(store.Read("b"), std::out_of_range);
+  EXPECT_TRUE(store.CanRequestFlush());
+}
+
+}
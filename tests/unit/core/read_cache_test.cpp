@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+
+#include "read_cache.h"
+
+namespace core {
+
+ReadCache::Entry MakeEntry(const std::string& value, const int index, const int64_t expires_at = 0) {
+  return {std::make_shared<const std::string>(value), index, expires_at};
+}
+
+TEST(ReadCache, ServesReadsAtOrAboveVersion) {
+  ReadCache cache;
+  EXPECT_FALSE(cache.Get("a", 5, 0).has_value());
+  cache.Insert("a", MakeEntry("1", 3), 5);
+
+  EXPECT_EQ(*cache.Get("a", 5, 0)->value, "1");
+  // Reads below the cached version need the older value from the store
+  EXPECT_FALSE(cache.Get("a", 2, 0).has_value());
+
+  auto stats = cache.GetStats();
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(stats.misses, 2);
+  EXPECT_EQ(stats.entries, 1);
+}
+
+TEST(ReadCache, ExpiredValuesAreNotServed) {
+  ReadCache cache;
+  cache.Insert("a", MakeEntry("1", 0, 100), 0);
+  EXPECT_TRUE(cache.Get("a", 0, 99).has_value());
+  EXPECT_FALSE(cache.Get("a", 0, 100).has_value());
+}
+
+TEST(ReadCache, InvalidationRejectsStaleInserts) {
+  ReadCache cache;
+  cache.Insert("a", MakeEntry("1", 0), 4);
+  cache.Invalidate("a", 5);
+  EXPECT_FALSE(cache.Get("a", 5, 0).has_value());
+
+  // A reader at index 4 raced with the write and offers the old value afterwards
+  cache.Insert("a", MakeEntry("1", 0), 4);
+  EXPECT_FALSE(cache.Get("a", 5, 0).has_value());
+
+  cache.Insert("a", MakeEntry("2", 5), 5);
+  EXPECT_EQ(*cache.Get("a", 5, 0)->value, "2");
+}
+
+TEST(ReadCache, AdmissionKeepsFrequentKeys) {
+  // A single entry per shard
+  ReadCache cache(READ_CACHE_SHARD_COUNT);
+  for (int i = 0; i < 5; i++) {
+    cache.Get("hot", 0, 0);
+  }
+  cache.Insert("hot", MakeEntry("1", 0), 0);
+
+  // Keys read once cannot evict the hot key from its shard
+  for (int i = 0; i < 1000; i++) {
+    EXPECT_TRUE(cache.Get("hot", 0, 0).has_value());
+    std::string key = "cold" + std::to_string(i);
+    cache.Get(key, 0, 0);
+    cache.Insert(key, MakeEntry("2", 0), 0);
+  }
+  EXPECT_TRUE(cache.Get("hot", 0, 0).has_value());
+  EXPECT_GT(cache.GetStats().rejected, 0);
+  EXPECT_LE(cache.GetStats().entries, READ_CACHE_SHARD_COUNT);
+}
+
+TEST(FrequencySketch, CountsDecayAfterSample) {
+  FrequencySketch sketch(16);
+  for (int i = 0; i < 10; i++) {
+    sketch.Increment("a");
+  }
+  EXPECT_GE(sketch.Frequency("a"), 10);
+  EXPECT_EQ(sketch.Frequency("missing"), 0);
+
+  // 160 accesses halve every counter
+  for (int i = 0; i < 150; i++) {
+    sketch.Increment("b" + std::to_string(i % 3));
+  }
+  EXPECT_LT(sketch.Frequency("a"), 10);
+}
+
+}
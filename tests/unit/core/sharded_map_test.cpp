@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "sharded_map.h"
+
+namespace core {
+
+TEST(ShardedMap, PutReturnsSizeChange) {
+  ShardedMap map;
+  EXPECT_EQ(map.Put("key", "value", 1), 8);
+  // A write at the same index replaces the version
+  EXPECT_EQ(map.Put("key", "v", 1), -4);
+  EXPECT_EQ(map.Put("key", "new", 2), 3);
+  EXPECT_EQ(map.Size(), 1);
+
+  std::string_view key = "key";
+  EXPECT_EQ(map.Get(key, 1)->value, "v");
+  EXPECT_EQ(map.Get(key, 5)->value, "new");
+  EXPECT_FALSE(map.Get(key, 0).has_value());
+  EXPECT_FALSE(map.Get("missing", 5).has_value());
+}
+
+TEST(ShardedMap, CollectKeepsVersionVisibleAtHorizon) {
+  ShardedMap map;
+  map.Put("key", "a", 1);
+  map.Put("key", "bb", 3);
+  map.Put("key", "ccc", 5);
+
+  EXPECT_EQ(map.Collect(4, false), 1);
+  EXPECT_EQ(map.Get("key", 4)->value, "bb");
+  EXPECT_FALSE(map.Get("key", 2).has_value());
+
+  // The latest version is never collected
+  EXPECT_EQ(map.Collect(10, false), 2);
+  EXPECT_EQ(map.Get("key", 10)->value, "ccc");
+}
+
+TEST(ShardedMap, TombstonesHideValueUntilCollected) {
+  ShardedMap map;
+  map.Put("key", "value", 1);
+  EXPECT_EQ(map.Delete("key", 3), 0);
+  EXPECT_EQ(map.Get("key", 2)->value, "value");
+  EXPECT_TRUE(map.Get("key", 3)->deleted);
+
+  // Tombstones stay while older values may live elsewhere
+  map.Collect(3, false);
+  EXPECT_TRUE(map.Contains("key"));
+  EXPECT_EQ(map.Collect(3, true), 3);
+  EXPECT_FALSE(map.Contains("key"));
+}
+
+TEST(ShardedMap, MoveIfAndMergeFrom) {
+  ShardedMap map;
+  for (int i = 0; i < 100; i++) {
+    map.Put(std::to_string(i), "x", 0);
+  }
+
+  ShardedMap dest;
+  size_t moved_bytes = map.MoveIf([](std::string_view key) {
+    return key.size() == 1;
+  }, dest);
+  EXPECT_EQ(moved_bytes, 20);
+  EXPECT_EQ(map.Size(), 90);
+  EXPECT_EQ(dest.Size(), 10);
+  EXPECT_FALSE(map.Get("5", 0).has_value());
+
+  map.MergeFrom(dest);
+  EXPECT_EQ(map.Size(), 100);
+  EXPECT_EQ(dest.Size(), 0);
+  EXPECT_EQ(map.Get("5", 0)->value, "x");
+}
+
+TEST(ShardedMap, CollectedVersionsReuseArenaMemory) {
+  ShardedMap map;
+  std::string value(100, 'x');
+  for (int i = 0; i < 100; i++) {
+    map.Put("key" + std::to_string(i), value, 1);
+  }
+  for (int i = 0; i < 100; i++) {
+    map.Put("key" + std::to_string(i), value, 2);
+  }
+  auto usage = map.Memory();
+  EXPECT_GT(usage.arena_bytes, 200 * value.size());
+  EXPECT_GT(usage.index_bytes, 0);
+
+  // Slots freed by collected versions hold the next versions
+  map.Collect(2, false);
+  for (int i = 0; i < 100; i++) {
+    map.Put("key" + std::to_string(i), value, 3);
+  }
+  EXPECT_EQ(map.Memory().arena_bytes, usage.arena_bytes);
+  EXPECT_EQ(map.Get("key5", 3)->value, value);
+}
+
+TEST(ShardedMap, ConcurrentReadsDuringWrites) {
+  ShardedMap map;
+  for (int i = 0; i < 64; i++) {
+    map.Put(std::to_string(i), "0", 0);
+  }
+
+  std::thread writer([&map] {
+    for (int round = 1; round <= 100; round++) {
+      for (int i = 0; i < 64; i++) {
+        map.Put(std::to_string(i), std::to_string(round), round);
+      }
+    }
+  });
+
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; t++) {
+    readers.emplace_back([&map] {
+      for (int round = 0; round < 100; round++) {
+        for (int i = 0; i < 64; i++) {
+          auto value = map.Get(std::to_string(i), 100);
+          ASSERT_TRUE(value.has_value());
+          EXPECT_LE(std::stoi(value->value), 100);
+        }
+      }
+    });
+  }
+
+  writer.join();
+  for (auto& reader:readers) {
+    reader.join();
+  }
+  EXPECT_EQ(map.Get("63", 100)->value, "100");
+}
+
+}
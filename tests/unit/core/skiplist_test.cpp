@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "skiplist.h"
+
+namespace core {
+
+TEST(SkipList, IteratesKeysInOrder) {
+  SkipList list;
+  for (auto key:{"d", "a", "c", "b"}) {
+    EXPECT_TRUE(list.Insert(key));
+  }
+  EXPECT_FALSE(list.Insert("c"));
+  EXPECT_TRUE(list.Contains("a"));
+  EXPECT_FALSE(list.Contains("e"));
+
+  std::vector<std::string> keys;
+  for (auto it = list.Begin(); it.Valid(); it.Next()) {
+    keys.push_back(it.Key());
+  }
+  EXPECT_EQ(keys, std::vector<std::string>({"a", "b", "c", "d"}));
+
+  auto it = list.Seek("bb");
+  ASSERT_TRUE(it.Valid());
+  EXPECT_EQ(it.Key(), "c");
+}
+
+TEST(SkipList, TruncateRemovesTail) {
+  SkipList list;
+  for (int i = 0; i < 100; i++) {
+    list.Insert(std::to_string(i));
+  }
+
+  list.Truncate("5");
+  EXPECT_TRUE(list.Contains("49"));
+  EXPECT_FALSE(list.Contains("5"));
+  EXPECT_FALSE(list.Contains("99"));
+  EXPECT_FALSE(list.Seek("5").Valid());
+
+  // The list remains usable after truncation
+  EXPECT_TRUE(list.Insert("7"));
+  EXPECT_TRUE(list.Contains("7"));
+}
+
+TEST(SkipList, ReadersSeeOrderedKeysDuringInserts) {
+  SkipList list;
+  std::thread writer([&list] {
+    for (int i = 0; i < 2000; i++) {
+      list.Insert(std::to_string(i));
+    }
+  });
+
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; t++) {
+    readers.emplace_back([&list] {
+      for (int round = 0; round < 50; round++) {
+        std::string prev;
+        for (auto it = list.Begin(); it.Valid(); it.Next()) {
+          EXPECT_LT(prev, it.Key());
+          prev = it.Key();
+        }
+      }
+    });
+  }
+
+  writer.join();
+  for (auto& reader:readers) {
+    reader.join();
+  }
+}
+
+}
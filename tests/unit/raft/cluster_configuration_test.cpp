@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+
+#include "cluster_configuration.h"
+
+namespace raft {
+
+protocol::log::Configuration BuildConfiguration(
+    const std::vector<std::string>& prev_servers,
+    const std::vector<std::string>& next_servers) {
+  protocol::log::Configuration configuration;
+  for (auto& address:prev_servers) {
+    configuration.add_prev_configuration()->set_address(address);
+  }
+  for (auto& address:next_servers) {
+    configuration.add_next_configuration()->set_address(address);
+  }
+  return configuration;
+}
+
+TEST(PeerId, StableAcrossConfigurations) {
+  ClusterConfiguration cc;
+  int self = cc.PeerId("a");
+  cc.SetConfiguration(0, BuildConfiguration({"a", "b", "c"}, {}));
+  int b = cc.PeerId("b");
+
+  cc.SetConfiguration(5, BuildConfiguration({"b", "c", "d"}, {}));
+  EXPECT_EQ(cc.PeerId("a"), self);
+  EXPECT_EQ(cc.PeerId("b"), b);
+  EXPECT_EQ(cc.PeerAddress(b), "b");
+  EXPECT_FALSE(cc.KnownServer(self));
+  EXPECT_TRUE(cc.KnownServer(cc.PeerId("d")));
+  EXPECT_EQ(cc.ServerAddresses().size(), 3);
+}
+
+TEST(CheckQuorum, StableMajority) {
+  ClusterConfiguration cc;
+  cc.SetConfiguration(0, BuildConfiguration({"a", "b", "c"}, {}));
+
+  PeerSet votes;
+  votes.set(cc.PeerId("a"));
+  EXPECT_FALSE(cc.CheckQuorum(votes));
+
+  // Servers outside the configuration do not count towards a majority
+  votes.set(cc.PeerId("d"));
+  EXPECT_FALSE(cc.CheckQuorum(votes));
+
+  votes.set(cc.PeerId("c"));
+  EXPECT_TRUE(cc.CheckQuorum(votes));
+}
+
+TEST(CheckQuorum, LearnersDoNotVote) {
+  ClusterConfiguration cc;
+  auto configuration = BuildConfiguration({"a", "b", "c"}, {});
+  configuration.add_learners()->set_address("d");
+  configuration.add_learners()->set_address("e");
+  cc.SetConfiguration(0, configuration);
+
+  int d = cc.PeerId("d");
+  EXPECT_TRUE(cc.IsLearner(d));
+  EXPECT_TRUE(cc.Members().test(d));
+  EXPECT_FALSE(cc.Voters().test(d));
+  EXPECT_EQ(cc.ServerAddresses().size(), 5);
+
+  PeerSet votes;
+  votes.set(cc.PeerId("a"));
+  votes.set(d);
+  votes.set(cc.PeerId("e"));
+  EXPECT_FALSE(cc.CheckQuorum(votes));
+}
+
+TEST(CheckQuorum, JointRequiresBothMajorities) {
+  ClusterConfiguration cc;
+  cc.SetConfiguration(0, BuildConfiguration({"a", "b", "c"}, {"c", "d", "e"}));
+  EXPECT_EQ(cc.State(), ClusterConfiguration::ConfigurationState::JOINT);
+
+  PeerSet votes;
+  votes.set(cc.PeerId("a"));
+  votes.set(cc.PeerId("b"));
+  EXPECT_FALSE(cc.CheckQuorum(votes));
+
+  votes.set(cc.PeerId("d"));
+  EXPECT_FALSE(cc.CheckQuorum(votes));
+
+  votes.set(cc.PeerId("e"));
+  EXPECT_TRUE(cc.CheckQuorum(votes));
+}
+
+TEST(LogSync, TracksNewServersOnly) {
+  ClusterConfiguration cc;
+  cc.SetConfiguration(0, BuildConfiguration({"a", "b"}, {}));
+  cc.StartLogSync(10, {"a", "b", "c"});
+  EXPECT_TRUE(cc.KnownServer("c"));
+
+  EXPECT_FALSE(cc.UpdateSyncProgress(cc.PeerId("b"), 10));
+  EXPECT_TRUE(cc.UpdateSyncProgress(cc.PeerId("c"), 10));
+  EXPECT_TRUE(cc.SyncComplete());
+
+  cc.CancelLogSync();
+  EXPECT_FALSE(cc.KnownServer("c"));
+}
+
+TEST(PeerId, RecyclesIdsOfServersInNoRetainedConfiguration) {
+  ClusterConfiguration cc;
+  int self = cc.SelfId("self");
+  std::vector<std::string> servers{"self"};
+  for (int i = 1; i < MAX_CLUSTER_SIZE - 1; i++) {
+    servers.push_back("server" + std::to_string(i));
+  }
+  cc.InsertNewConfiguration(0, BuildConfiguration(servers, {}));
+  cc.InsertNewConfiguration(5, BuildConfiguration({"self", "a"}, {}));
+  EXPECT_TRUE(cc.TakeRecycledPeers().none());
+
+  // The first configuration may still be restored by a truncation
+  EXPECT_FALSE(cc.ReservePeers({"b"}));
+
+  cc.Compact(5);
+  ASSERT_TRUE(cc.ReservePeers({"b", "c"}));
+  int b = cc.PeerId("b");
+  int c = cc.PeerId("c");
+  EXPECT_NE(b, c);
+  EXPECT_NE(b, self);
+  EXPECT_EQ(cc.PeerAddress(b), "b");
+  EXPECT_EQ(cc.PeerId("self"), self);
+
+  auto recycled = cc.TakeRecycledPeers();
+  EXPECT_TRUE(recycled.test(b));
+  EXPECT_TRUE(recycled.test(c));
+  EXPECT_TRUE(cc.TakeRecycledPeers().none());
+}
+
+}
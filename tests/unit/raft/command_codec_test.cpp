@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+
+#include "command_codec.h"
+
+namespace raft {
+
+TEST(CommandCodec, KeysAndValuesMayContainAnyByte) {
+  std::string key("a:b\0c", 5);
+  std::string encoded = EncodePut(key, "x:y");
+  auto command = DecodeCommand(encoded);
+  ASSERT_TRUE(command.has_value());
+  EXPECT_EQ(command->type, CommandType::PUT);
+  EXPECT_EQ(command->key, key);
+  EXPECT_EQ(command->value, "x:y");
+  // Decoded strings view the encoded command
+  EXPECT_GE(command->key.data(), encoded.data());
+  EXPECT_LT(command->key.data(), encoded.data() + encoded.size());
+
+  command = DecodeCommand(EncodeDelete("key"));
+  ASSERT_TRUE(command.has_value());
+  EXPECT_EQ(command->type, CommandType::DELETE);
+  EXPECT_FALSE(command->value.has_value());
+}
+
+TEST(CommandCodec, ConditionalCommands) {
+  auto command = DecodeCommand(EncodeCompareAndSwap("key", std::nullopt, "new"));
+  ASSERT_TRUE(command.has_value());
+  EXPECT_EQ(command->type, CommandType::COMPARE_AND_SWAP);
+  EXPECT_FALSE(command->expected.has_value());
+  EXPECT_EQ(command->value, "new");
+
+  command = DecodeCommand(EncodeCompareAndSwap("key", "", std::nullopt, 5000));
+  ASSERT_TRUE(command.has_value());
+  EXPECT_EQ(command->expected, "");
+  EXPECT_FALSE(command->value.has_value());
+  EXPECT_EQ(command->ttl_ms, 5000);
+
+  command = DecodeCommand(EncodeIncrement("counter", -5));
+  ASSERT_TRUE(command.has_value());
+  EXPECT_EQ(command->type, CommandType::INCREMENT);
+  EXPECT_EQ(command->delta, -5);
+}
+
+TEST(CommandCodec, BatchHoldsOperationsInOrder) {
+  std::string encoded = EncodeBatch({EncodePut("a", "1"), EncodeDelete("b"), EncodeIncrement("c", 1)});
+  auto command = DecodeCommand(encoded);
+  ASSERT_TRUE(command.has_value());
+  ASSERT_EQ(command->operations.size(), 3);
+  EXPECT_EQ(command->operations[0].type, CommandType::PUT);
+  EXPECT_EQ(command->operations[1].key, "b");
+  EXPECT_EQ(command->operations[2].delta, 1);
+
+  // Batches cannot be nested
+  EXPECT_FALSE(DecodeCommand(EncodeBatch({encoded})).has_value());
+}
+
+TEST(CommandCodec, RejectsMalformedCommands) {
+  EXPECT_FALSE(DecodeCommand("").has_value());
+  EXPECT_FALSE(DecodeCommand("key:value").has_value());
+
+  std::string encoded = EncodePut("key", "value");
+  EXPECT_FALSE(DecodeCommand(encoded.substr(0, encoded.size() - 1)).has_value());
+  EXPECT_FALSE(DecodeCommand(encoded + "x").has_value());
+}
+
+}
@@ -1,4 +1,6 @@
 #include <gtest/gtest.h>
+#include <filesystem>
+#include <future>
 #include <memory>
 
 #include "consensus_module.h"
@@ -60,7 +62,9 @@ class ConsensusModuleTest: public ::testing::Test {
 protected:
   void SetUp() override {
     std::string fake_address = "localhost:test";
-    ctx = new GlobalCtxManager(fake_address);
+    directory = (std::filesystem::temp_directory_path() / "maelstromdb_consensus_test/").string();
+    std::filesystem::remove_all(directory);
+    ctx = new GlobalCtxManager(fake_address, RaftOptions(), 1, directory);
     auto cm = ctx->ConsensusInstance();
 
     cm->StateMachineInit();
@@ -69,17 +73,16 @@ protected:
             cm,
             cm->Term())),
         BuildFakeTimer(std::bind(&ConsensusModule::HeartbeatCallback,
-            cm)),
-        BuildFakeTimer(std::bind(&ConsensusModule::ResetToFollower,
-            cm,
-            cm->Term())));
+            cm)));
   };
 
   void TearDown() override {
     delete ctx;
+    std::filesystem::remove_all(directory);
   }
 
   GlobalCtxManager* ctx;
+  std::string directory;
 };
 
 TEST_F(ConsensusModuleTest, ResetToFollowerValidState) {
@@ -92,5 +95,77 @@ TEST_F(ConsensusModuleTest, ResetToFollowerValidState) {
   EXPECT_EQ(cm->VotesReceived(), 0);
 }
 
+TEST_F(ConsensusModuleTest, PreVoteLeavesTermAndVoteUnchanged) {
+  auto cm = ctx->ConsensusInstance();
+  cm->ResetToFollower(5);
+
+  protocol::raft::RequestVote_Request request;
+  request.set_term(6);
+  request.set_candidateid("localhost:candidate");
+  request.set_lastlogindex(100);
+  request.set_lastlogterm(5);
+  request.set_prevote(true);
+
+  auto [reply, status] = cm->ProcessRequestVoteClientRequest(request);
+  EXPECT_TRUE(status.ok());
+  EXPECT_TRUE(reply.votegranted());
+  EXPECT_EQ(reply.term(), 5);
+  EXPECT_EQ(cm->Term(), 5);
+  EXPECT_EQ(cm->Vote(), "");
+
+  // CANDIDATE campaigning for a term this node has already reached would not win
+  request.set_term(5);
+  std::tie(reply, status) = cm->ProcessRequestVoteClientRequest(request);
+  EXPECT_FALSE(reply.votegranted());
 }
 
+TEST_F(ConsensusModuleTest, TimeoutNowFromStaleLeaderIgnored) {
+  auto cm = ctx->ConsensusInstance();
+  cm->ResetToFollower(3);
+
+  protocol::raft::TimeoutNow_Request request;
+  request.set_term(2);
+  request.set_leaderid("localhost:leader");
+
+  auto [reply, status] = cm->ProcessTimeoutNowClientRequest(request);
+  EXPECT_FALSE(status.ok());
+  EXPECT_EQ(reply.term(), 3);
+  EXPECT_EQ(cm->Term(), 3);
+  EXPECT_EQ(cm->State(), ConsensusModule::RaftState::FOLLOWER);
+}
+
+TEST_F(ConsensusModuleTest, ReadIndexFailsWithoutKnownLeader) {
+  auto cm = ctx->ConsensusInstance();
+  cm->ResetToFollower(3);
+
+  std::promise<grpc::Status> first, second;
+  cm->ReadIndexAsync([&first](const int read_index, grpc::Status status) {
+    first.set_value(status);
+  });
+  cm->ReadIndexAsync([&second](const int read_index, grpc::Status status) {
+    second.set_value(status);
+  });
+
+  auto first_result = first.get_future();
+  auto second_result = second.get_future();
+  ASSERT_EQ(first_result.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+  ASSERT_EQ(second_result.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+  EXPECT_FALSE(first_result.get().ok());
+  EXPECT_FALSE(second_result.get().ok());
+}
+
+TEST(MultiRaft, GroupsHaveSeparateConsensusAndLogs) {
+  auto directory = (std::filesystem::temp_directory_path() / "maelstromdb_multiraft_test/").string();
+  std::filesystem::remove_all(directory);
+  GlobalCtxManager ctx("localhost:test", RaftOptions(), 2, directory);
+  EXPECT_EQ(ctx.GroupCount(), 2);
+  EXPECT_EQ(ctx.ConsensusInstance()->GroupId(), 0);
+  EXPECT_EQ(ctx.ConsensusInstance(1)->GroupId(), 1);
+  EXPECT_NE(ctx.LogInstance(0), ctx.LogInstance(1));
+
+  // Requests for groups the node does not host are rejected by the server
+  EXPECT_EQ(ctx.ConsensusInstance(2), nullptr);
+  EXPECT_EQ(ctx.LogInstance(-1), nullptr);
+}
+
+}
@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+
+#include "peer_progress.h"
+
+namespace raft {
+
+TEST(PeerProgress, ProbeSendsSingleMessage) {
+  PeerProgress progress(10);
+  EXPECT_EQ(progress.State(), PeerProgress::ProgressState::PROBE);
+  EXPECT_FALSE(progress.Paused());
+
+  progress.SentEntries(9, 0);
+  EXPECT_TRUE(progress.Paused());
+
+  // Heartbeat allows another probe in case the previous one was lost
+  progress.ResumeProbe();
+  EXPECT_FALSE(progress.Paused());
+}
+
+TEST(PeerProgress, ProbeRejectionSkipsMissingEntries) {
+  PeerProgress progress(10);
+  progress.SentEntries(9, 0);
+
+  // FOLLOWER only has entries [0, 4] so the next probe starts after its last entry
+  EXPECT_TRUE(progress.MaybeDecrement(9, 4));
+  EXPECT_EQ(progress.NextIndex(), 5);
+  EXPECT_FALSE(progress.Paused());
+
+  // Stale rejection for an earlier probe is ignored
+  EXPECT_FALSE(progress.MaybeDecrement(9, 4));
+  EXPECT_EQ(progress.NextIndex(), 5);
+}
+
+TEST(PeerProgress, ReplicateLimitsInflightWindow) {
+  PeerProgress progress(0, 2);
+  EXPECT_FALSE(progress.MaybeUpdate(-1, false));
+  EXPECT_EQ(progress.State(), PeerProgress::ProgressState::REPLICATE);
+
+  progress.SentEntries(4, 5);
+  progress.SentEntries(9, 5);
+  EXPECT_EQ(progress.NextIndex(), 10);
+  EXPECT_EQ(progress.Inflight(), 2);
+  EXPECT_TRUE(progress.Paused());
+
+  EXPECT_TRUE(progress.MaybeUpdate(4, true));
+  EXPECT_EQ(progress.MatchIndex(), 4);
+  EXPECT_EQ(progress.Inflight(), 1);
+  EXPECT_FALSE(progress.Paused());
+}
+
+TEST(PeerProgress, ReplicateRejectionFallsBackToProbe) {
+  PeerProgress progress(0);
+  progress.MaybeUpdate(4, false);
+  progress.SentEntries(9, 5);
+  progress.SentEntries(14, 5);
+
+  // Rejection of entries already known to match is from a reordered RPC
+  EXPECT_FALSE(progress.MaybeDecrement(4, 6));
+  EXPECT_EQ(progress.State(), PeerProgress::ProgressState::REPLICATE);
+
+  EXPECT_TRUE(progress.MaybeDecrement(9, 6));
+  EXPECT_EQ(progress.State(), PeerProgress::ProgressState::PROBE);
+  EXPECT_EQ(progress.NextIndex(), 5);
+  EXPECT_EQ(progress.Inflight(), 0);
+}
+
+TEST(PeerProgress, AckedRoundOnlyAdvances) {
+  PeerProgress progress(0);
+  EXPECT_EQ(progress.AckedRound(), -1);
+
+  EXPECT_TRUE(progress.RecordAck(3));
+  // Replies to RPCs sent in earlier rounds can arrive late
+  EXPECT_FALSE(progress.RecordAck(2));
+  EXPECT_EQ(progress.AckedRound(), 3);
+}
+
+TEST(PeerProgress, RttPercentileUsesRecentSamples) {
+  PeerProgress progress(0);
+  EXPECT_EQ(progress.RttPercentile(0.99).count(), 0);
+
+  for (int i = 1; i <= 100; i++) {
+    progress.RecordRtt(PeerProgress::microseconds(i));
+  }
+  EXPECT_EQ(progress.RttPercentile(0.5).count(), 51);
+  EXPECT_EQ(progress.RttPercentile(0.99).count(), 100);
+
+  // Older samples are overwritten once the window is full
+  for (int i = 0; i < RTT_SAMPLE_WINDOW; i++) {
+    progress.RecordRtt(PeerProgress::microseconds(10));
+  }
+  EXPECT_EQ(progress.RttSamples(), RTT_SAMPLE_WINDOW);
+  EXPECT_EQ(progress.RttPercentile(0.99).count(), 10);
+}
+
+}
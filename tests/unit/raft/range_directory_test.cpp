@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+
+#include "range_directory.h"
+
+namespace raft {
+
+TEST(RangeDirectory, AssignSplitsAndCoalescesRanges) {
+  RangeDirectory directory;
+  directory.Assign("f", "m", 1);
+  EXPECT_EQ(directory.GroupFor("a"), 0);
+  EXPECT_EQ(directory.GroupFor("f"), 1);
+  EXPECT_EQ(directory.GroupFor("l"), 1);
+  EXPECT_EQ(directory.GroupFor("m"), 0);
+  EXPECT_EQ(directory.EndOf("a"), "f");
+  EXPECT_EQ(directory.EndOf("g"), "m");
+  EXPECT_EQ(directory.EndOf("z"), "");
+  EXPECT_EQ(directory.Assignments().size(), 3);
+
+  // Moving the range back leaves a single range again
+  directory.Assign("f", "m", 0);
+  auto assignments = directory.Assignments();
+  ASSERT_EQ(assignments.size(), 1);
+  EXPECT_EQ(assignments[0].start_key, "");
+  EXPECT_EQ(assignments[0].end_key, "");
+  EXPECT_EQ(assignments[0].group_id, 0);
+}
+
+TEST(RangeDirectory, ServesAndOverlaps) {
+  RangeDirectory directory;
+  directory.Assign("f", "m", 1);
+  directory.Assign("t", "", 2);
+
+  EXPECT_TRUE(directory.Serves(1, "f", "m"));
+  EXPECT_TRUE(directory.Serves(1, "g", "h"));
+  EXPECT_FALSE(directory.Serves(1, "f", "n"));
+  EXPECT_FALSE(directory.Serves(0, "a", ""));
+  EXPECT_TRUE(directory.Serves(2, "t", ""));
+
+  EXPECT_TRUE(directory.Overlaps(1, "a", "g"));
+  EXPECT_FALSE(directory.Overlaps(1, "a", "f"));
+  EXPECT_TRUE(directory.Overlaps(0, "g", ""));
+  EXPECT_FALSE(directory.Overlaps(2, "a", "t"));
+}
+
+TEST(RangeDirectory, SerializeAndRestore) {
+  RangeDirectory directory;
+  directory.Assign("f", "m", 1);
+  directory.Assign("t", "", 2);
+
+  RangeDirectory restored(3);
+  ASSERT_TRUE(restored.Restore(directory.Serialize()));
+  EXPECT_EQ(restored.GroupFor(""), 0);
+  EXPECT_EQ(restored.GroupFor("g"), 1);
+  EXPECT_EQ(restored.GroupFor("z"), 2);
+  EXPECT_EQ(restored.Assignments().size(), 4);
+
+  EXPECT_FALSE(restored.Restore("\x01"));
+  EXPECT_EQ(restored.GroupFor("g"), 1);
+}
+
+}
@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+
+#include "range_policy.h"
+
+namespace raft {
+
+TEST(RangePolicy, SplitLargeRange) {
+  InmemoryStore store;
+  for (auto key:{"a", "b", "c", "d"}) {
+    store.Write(key, "value", 0);
+  }
+
+  RangePolicy policy({.split_bytes = 16});
+  auto entry = policy.Evaluate(store, RangePolicy::clock_type::now());
+  ASSERT_TRUE(entry.has_value());
+  EXPECT_EQ(entry->type(), protocol::log::LogOpCode::RANGE_SPLIT);
+  EXPECT_EQ(entry->range().key(), "c");
+}
+
+TEST(RangePolicy, SplitHotRange) {
+  InmemoryStore store;
+  store.Write("a", "1", 0);
+  store.Write("b", "2", 1);
+
+  RangePolicy policy({.split_qps = 100});
+  auto now = RangePolicy::clock_type::now();
+  EXPECT_FALSE(policy.Evaluate(store, now).has_value());
+
+  for (int i = 0; i < 200; i++) {
+    store.Read("a");
+  }
+  auto entry = policy.Evaluate(store, now + std::chrono::seconds(1));
+  ASSERT_TRUE(entry.has_value());
+  EXPECT_EQ(entry->type(), protocol::log::LogOpCode::RANGE_SPLIT);
+}
+
+TEST(RangePolicy, MergeColdRangesOnlyWithHistory) {
+  InmemoryStore store;
+  store.Write("a", "1", 0);
+  store.Write("m", "2", 1);
+  store.Split("m");
+
+  RangePolicy policy;
+  auto now = RangePolicy::clock_type::now();
+  // Rates are unknown until the second evaluation
+  EXPECT_FALSE(policy.Evaluate(store, now).has_value());
+
+  auto entry = policy.Evaluate(store, now + std::chrono::seconds(1));
+  ASSERT_TRUE(entry.has_value());
+  EXPECT_EQ(entry->type(), protocol::log::LogOpCode::RANGE_MERGE);
+  EXPECT_EQ(entry->range().key(), "m");
+}
+
+TEST(RangePolicy, MoveHotRangeToIdleGroup) {
+  auto store = std::make_shared<InmemoryStore>();
+  auto idle_store = std::make_shared<InmemoryStore>();
+  for (auto key:{"a", "c", "e"}) {
+    store->Write(key, "value", 0);
+  }
+  store->Split("c");
+  store->Split("e");
+
+  RangeDirectory directory;
+  RangePolicy policy({.move_qps = 1000});
+  auto now = RangePolicy::clock_type::now();
+  policy.Evaluate(*store, now);
+  EXPECT_FALSE(policy.Rebalance(directory, 0, {store, idle_store}, now).has_value());
+
+  for (int i = 0; i < 1200; i++) {
+    for (auto key:{"a", "c", "e"}) {
+      store->Read(key);
+    }
+  }
+  now += std::chrono::seconds(1);
+  EXPECT_FALSE(policy.Evaluate(*store, now).has_value());
+  auto entry = policy.Rebalance(directory, 0, {store, idle_store}, now);
+  ASSERT_TRUE(entry.has_value());
+  EXPECT_EQ(entry->type(), protocol::log::LogOpCode::RANGE_MOVE_OUT);
+  EXPECT_EQ(entry->move().startkey(), "");
+  EXPECT_EQ(entry->move().endkey(), "c");
+  EXPECT_EQ(entry->move().groupid(), 1);
+}
+
+TEST(RangePolicy, KeepRangeIfTargetWouldBeBusier) {
+  auto store = std::make_shared<InmemoryStore>();
+  auto busy_store = std::make_shared<InmemoryStore>();
+  for (auto key:{"a", "c", "e"}) {
+    store->Write(key, "value", 0);
+  }
+  store->Split("c");
+  store->Split("e");
+  busy_store->Write("z", "value", 0);
+
+  RangeDirectory directory;
+  RangePolicy policy({.move_qps = 1000});
+  auto now = RangePolicy::clock_type::now();
+  policy.Evaluate(*store, now);
+  policy.Rebalance(directory, 0, {store, busy_store}, now);
+
+  for (int i = 0; i < 1200; i++) {
+    for (auto key:{"a", "c", "e"}) {
+      store->Read(key);
+    }
+    busy_store->Read("z");
+    busy_store->Read("z");
+  }
+  now += std::chrono::seconds(1);
+  policy.Evaluate(*store, now);
+  EXPECT_FALSE(policy.Rebalance(directory, 0, {store, busy_store}, now).has_value());
+}
+
+}
@@ -101,5 +101,49 @@ TEST(CacheResponse, LRUSessionExpiry) {
   EXPECT_TRUE(MessageDifferencer::Equals(got_reply, reply));
 }
 
+TEST(CacheResponse, PeekKeepsEvictionOrder) {
+  auto sc = SessionCache(2);
+  sc.AddSession(1);
+  sc.AddSession(2);
+
+  protocol::raft::ClientRequest_Response reply;
+  reply.set_status(true);
+  sc.CacheResponse(1, 1, reply);
+  sc.CacheResponse(2, 1, reply);
+
+  // Handlers peek outside the log, so session 1 stays least recently used
+  protocol::raft::ClientRequest_Response got_reply;
+  EXPECT_TRUE(sc.PeekCachedResponse(1, 1, got_reply));
+  sc.AddSession(3);
+  EXPECT_FALSE(sc.SessionExists(1));
+  EXPECT_TRUE(sc.SessionExists(2));
 }
 
+TEST(Serialize, RestoresResponsesAndEvictionOrder) {
+  auto sc = SessionCache(2);
+  sc.AddSession(1);
+  sc.AddSession(2);
+
+  protocol::raft::ClientRequest_Response reply;
+  reply.set_status(true);
+  reply.set_response("SUCCESS");
+  reply.set_index(7);
+  sc.CacheResponse(2, 3, reply);
+  sc.CacheResponse(1, 5, reply);
+
+  auto restored = SessionCache(2);
+  restored.AddSession(9);
+  ASSERT_TRUE(restored.Restore(sc.Serialize()));
+  EXPECT_FALSE(restored.SessionExists(9));
+  protocol::raft::ClientRequest_Response got_reply;
+  EXPECT_TRUE(restored.PeekCachedResponse(1, 5, got_reply));
+  EXPECT_TRUE(MessageDifferencer::Equals(got_reply, reply));
+
+  // Session 2 is still least recently used
+  restored.AddSession(4);
+  EXPECT_FALSE(restored.SessionExists(2));
+  EXPECT_TRUE(restored.SessionExists(1));
+  EXPECT_FALSE(restored.Restore("\x05"));
+}
+
+}
@@ -0,0 +1,225 @@
+#include <gtest/gtest.h>
+
+#include "command_codec.h"
+#include "state_machine.h"
+
+namespace raft {
+
+class StateMachineTest: public ::testing::Test {
+protected:
+  void SetUp() override {
+    CreateStateMachine(0);
+  }
+
+  void CreateStateMachine(const int group_id) {
+    sessions = std::make_shared<SessionCache>(10);
+    store = std::make_shared<InmemoryStore>();
+    state_machine = std::make_unique<StateMachine>(sessions, store, group_id);
+
+    protocol::log::LogEntry register_entry;
+    register_entry.set_type(protocol::log::LogOpCode::REGISTER_CLIENT);
+    state_machine->ApplyCommand(0, register_entry);
+  }
+
+  protocol::raft::ClientRequest_Response Apply(const std::string& command, const int64_t timestamp = 0) {
+    int log_index = state_machine->LastApplied() + 1;
+    protocol::log::LogEntry entry;
+    entry.set_timestamp(timestamp);
+    entry.set_type(protocol::log::LogOpCode::DATA);
+    entry.set_data(command);
+    entry.set_clientid(0);
+    entry.set_sequencenum(log_index);
+    state_machine->ApplyCommand(log_index, entry);
+
+    protocol::raft::ClientRequest_Response reply;
+    sessions->GetCachedResponse(0, log_index, reply);
+    return reply;
+  }
+
+  int ApplyMove(
+      protocol::log::LogOpCode type,
+      const std::string& start_key,
+      const std::string& end_key,
+      const int group_id,
+      const std::vector<std::pair<std::string, std::string>>& values = {},
+      const bool last = false) {
+    int log_index = state_machine->LastApplied() + 1;
+    protocol::log::LogEntry entry;
+    entry.set_type(type);
+    auto move = entry.mutable_move();
+    move->set_startkey(start_key);
+    move->set_endkey(end_key);
+    move->set_groupid(group_id);
+    for (auto& [key, value]:values) {
+      auto moved_value = move->add_values();
+      moved_value->set_key(key);
+      moved_value->set_value(value);
+    }
+    move->set_last(last);
+    state_machine->ApplyCommand(log_index, entry);
+    return log_index;
+  }
+
+  std::shared_ptr<SessionCache> sessions;
+  std::shared_ptr<InmemoryStore> store;
+  std::unique_ptr<StateMachine> state_machine;
+};
+
+TEST_F(StateMachineTest, PutAndDelete) {
+  auto reply = Apply(EncodePut("key", "value"));
+  EXPECT_TRUE(reply.status());
+  EXPECT_EQ(reply.index(), 1);
+  EXPECT_EQ(store->Read("key"), "value");
+
+  EXPECT_EQ(Apply(EncodeDelete("key")).response(), "SUCCESS");
+  EXPECT_EQ(Apply(EncodeDelete("key")).response(), "NOT_FOUND");
+  EXPECT_THROW(store->Read("key"), std::out_of_range);
+
+  reply = Apply("key:value");
+  EXPECT_FALSE(reply.status());
+  EXPECT_EQ(reply.response(), "INVALID_COMMAND");
+}
+
+TEST_F(StateMachineTest, BatchAppliesAtSingleIndex) {
+  Apply(EncodePut("a", "old"));
+  auto reply = Apply(EncodeBatch({EncodePut("a", "1"), EncodePut("b", "2"), EncodeDelete("a"), EncodeDelete("c")}));
+  EXPECT_TRUE(reply.status());
+  ASSERT_EQ(reply.results_size(), 4);
+  EXPECT_EQ(reply.results(2).response(), "SUCCESS");
+  EXPECT_EQ(reply.results(3).response(), "NOT_FOUND");
+
+  // Later operations see the writes of earlier ones
+  EXPECT_THROW(store->Read("a"), std::out_of_range);
+  EXPECT_EQ(store->Read("b", reply.index()), "2");
+  EXPECT_THROW(store->Read("b", reply.index() - 1), std::out_of_range);
+}
+
+TEST_F(StateMachineTest, CompareAndSwap) {
+  EXPECT_TRUE(Apply(EncodeCompareAndSwap("lock", std::nullopt, "owner1")).status());
+  auto reply = Apply(EncodeCompareAndSwap("lock", std::nullopt, "owner2"));
+  EXPECT_FALSE(reply.status());
+  EXPECT_EQ(reply.response(), "CONDITION_FAILED");
+  EXPECT_EQ(reply.value(), "owner1");
+
+  EXPECT_TRUE(Apply(EncodeCompareAndSwap("lock", "owner1", "owner2")).status());
+  EXPECT_EQ(store->Read("lock"), "owner2");
+
+  // Conditional delete
+  EXPECT_FALSE(Apply(EncodeCompareAndSwap("lock", "owner1", std::nullopt)).status());
+  EXPECT_TRUE(Apply(EncodeCompareAndSwap("lock", "owner2", std::nullopt)).status());
+  EXPECT_THROW(store->Read("lock"), std::out_of_range);
+}
+
+TEST_F(StateMachineTest, Increment) {
+  auto reply = Apply(EncodeIncrement("counter", 5));
+  EXPECT_TRUE(reply.status());
+  EXPECT_EQ(reply.value(), "5");
+  EXPECT_EQ(Apply(EncodeIncrement("counter", -7)).value(), "-2");
+  EXPECT_EQ(store->Read("counter"), "-2");
+
+  Apply(EncodePut("name", "x"));
+  EXPECT_EQ(Apply(EncodeIncrement("name", 1)).response(), "NOT_AN_INTEGER");
+  Apply(EncodePut("max", std::to_string(INT64_MAX)));
+  EXPECT_EQ(Apply(EncodeIncrement("max", 1)).response(), "OVERFLOW");
+}
+
+TEST_F(StateMachineTest, FailedConditionAbortsBatch) {
+  Apply(EncodePut("balance", "10"));
+  auto reply = Apply(EncodeBatch({
+      EncodeIncrement("balance", -5),
+      EncodePut("log", "withdraw"),
+      EncodeCompareAndSwap("balance", "10", "0")}));
+  EXPECT_FALSE(reply.status());
+  EXPECT_EQ(reply.response(), "ABORTED");
+  ASSERT_EQ(reply.results_size(), 3);
+  // Conditions see the writes of earlier operations
+  EXPECT_EQ(reply.results(2).value(), "5");
+
+  EXPECT_EQ(store->Read("balance"), "10");
+  EXPECT_THROW(store->Read("log"), std::out_of_range);
+}
+
+TEST_F(StateMachineTest, ValuesExpireAtLogTime) {
+  Apply(EncodePut("session", "a", 100), 1000);
+  Apply(EncodePut("other", "b"), 1050);
+  EXPECT_EQ(store->Read("session"), "a");
+  EXPECT_EQ(store->NextExpiry(), 1100);
+
+  // An earlier timestamp from a new LEADER does not move the time backwards
+  Apply(EncodePut("other", "c"), 900);
+  EXPECT_EQ(store->Time(), 1050);
+
+  int expiry_index = state_machine->LastApplied() + 1;
+  protocol::log::LogEntry noop_entry;
+  noop_entry.set_timestamp(1100);
+  state_machine->ApplyCommand(expiry_index, noop_entry);
+  EXPECT_THROW(store->Read("session"), std::out_of_range);
+  EXPECT_EQ(store->Read("session", expiry_index - 1), "a");
+  EXPECT_FALSE(store->NextExpiry().has_value());
+
+  // Increments keep the expiry of the value
+  Apply(EncodePut("counter", "1", 100), 1200);
+  EXPECT_EQ(Apply(EncodeIncrement("counter", 1), 1250).value(), "2");
+  Apply(EncodePut("other", "d"), 1300);
+  EXPECT_THROW(store->Read("counter"), std::out_of_range);
+  EXPECT_EQ(Apply(EncodeIncrement("counter", 1), 1300).value(), "1");
+}
+
+TEST_F(StateMachineTest, MoveOutRejectsCommandsUntilDone) {
+  Apply(EncodePut("a", "1"));
+  Apply(EncodePut("x", "2"));
+  ApplyMove(protocol::log::LogOpCode::RANGE_MOVE_OUT, "", "m", 1);
+  EXPECT_FALSE(state_machine->Serves("a"));
+  EXPECT_TRUE(state_machine->Serves("x"));
+  ASSERT_EQ(state_machine->OutgoingMoves().size(), 1);
+
+  // A batch is rejected as a whole if any key moved
+  auto reply = Apply(EncodeBatch({EncodePut("x", "3"), EncodePut("b", "4")}));
+  EXPECT_FALSE(reply.status());
+  EXPECT_EQ(reply.response(), "WRONG_GROUP");
+  EXPECT_EQ(store->Read("x"), "2");
+  EXPECT_TRUE(Apply(EncodePut("x", "3")).status());
+
+  // The values are kept until the move is done so it can be resumed
+  EXPECT_EQ(store->Read("a"), "1");
+  ApplyMove(protocol::log::LogOpCode::RANGE_MOVE_DONE, "", "m", 1);
+  EXPECT_THROW(store->Read("a"), std::out_of_range);
+  EXPECT_EQ(store->Read("x"), "3");
+  EXPECT_TRUE(state_machine->OutgoingMoves().empty());
+}
+
+TEST_F(StateMachineTest, MoveInGrantsOwnershipWithLastChunk) {
+  CreateStateMachine(1);
+  EXPECT_FALSE(state_machine->Serves("a"));
+  EXPECT_EQ(Apply(EncodePut("a", "0")).response(), "WRONG_GROUP");
+
+  ApplyMove(protocol::log::LogOpCode::RANGE_MOVE_IN, "", "m", 1, {{"a", "1"}});
+  EXPECT_FALSE(state_machine->Serves("a"));
+  int moved_index = ApplyMove(protocol::log::LogOpCode::RANGE_MOVE_IN, "", "m", 1, {{"b", "2"}}, true);
+  EXPECT_TRUE(state_machine->Serves("a"));
+  EXPECT_FALSE(state_machine->Serves("m"));
+  EXPECT_EQ(state_machine->MovedInIndex(), moved_index);
+  EXPECT_EQ(store->Read("a"), "1");
+  EXPECT_EQ(store->Read("b"), "2");
+
+  // A resumed move resends chunks, which must not overwrite newer values
+  EXPECT_TRUE(Apply(EncodePut("a", "3")).status());
+  ApplyMove(protocol::log::LogOpCode::RANGE_MOVE_IN, "", "m", 1, {{"a", "1"}}, true);
+  EXPECT_EQ(store->Read("a"), "3");
+}
+
+TEST_F(StateMachineTest, AssignOnlyRecordsMovesBetweenOtherGroups) {
+  ApplyMove(protocol::log::LogOpCode::RANGE_MOVE_OUT, "m", "", 1);
+  ApplyMove(protocol::log::LogOpCode::RANGE_ASSIGN, "m", "", 1);
+  ApplyMove(protocol::log::LogOpCode::RANGE_ASSIGN, "t", "", 2);
+  EXPECT_EQ(state_machine->Directory().GroupFor("n"), 1);
+  EXPECT_EQ(state_machine->Directory().GroupFor("u"), 2);
+
+  // Only a move into the group lets it serve keys again
+  ApplyMove(protocol::log::LogOpCode::RANGE_ASSIGN, "m", "", 0);
+  EXPECT_FALSE(state_machine->Serves("n"));
+  ApplyMove(protocol::log::LogOpCode::RANGE_ASSIGN, "a", "n", 3);
+  EXPECT_TRUE(state_machine->Serves("a"));
+}
+
+}
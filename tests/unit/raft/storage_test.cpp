@@ -179,6 +179,37 @@ TEST_F(AppendTest, ValidateMultipleFileEntries) {
   }
 }
 
+TEST_F(AppendTest, ValidateSerializedEntries) {
+  SetUp(8, 25);
+
+  // Verify that the stored bytes of each entry decode to the originally appended entry
+  auto result_slice = log->SerializedEntries(2, 7);
+  ASSERT_EQ(result_slice.size(), 5);
+  for (int i = 0; i < result_slice.size(); i++) {
+    protocol::log::LogEntry result_entry;
+    ASSERT_TRUE(result_entry.ParseFromString(*result_slice[i]));
+    EXPECT_EQ(result_entry.term(), entries[i + 2].term());
+    EXPECT_EQ(result_entry.data(), entries[i + 2].data());
+  }
+
+  // Verify that the bytes are shared with the log rather than copied
+  EXPECT_EQ(log->SerializedEntries(2, 3)[0], result_slice[0]);
+}
+
+TEST_F(AppendTest, ValidateReceivedBytesStored) {
+  SetUp(0);
+
+  // Bytes received from the LEADER are stored without serializing the entry again
+  protocol::log::LogEntry new_entry;
+  new_entry.set_term(3);
+  new_entry.set_data("received");
+  auto data = std::make_shared<const std::string>(new_entry.SerializeAsString());
+  log->Append({new_entry}, {data});
+
+  EXPECT_EQ(log->SerializedEntries(0, 1)[0], data);
+  EXPECT_EQ(log->Entry(0).data(), "received");
+}
+
 TEST_F(RestoreLogTest, HandlesSingleFilePersistence) {
   SetUp(3);
 
@@ -219,6 +250,17 @@ TEST_F(RestoreLogTest, HandlesMultipleFilePersistence) {
   }
 }
 
+TEST_F(RestoreLogTest, HandlesSerializedEntryPersistence) {
+  SetUp(8, 25);
+
+  // Verify that bytes restored from disk match the bytes that were written
+  auto result_slice = log->SerializedEntries(0, 8);
+  ASSERT_EQ(result_slice.size(), entries.size());
+  for (int i = 0; i < entry_count; i++) {
+    EXPECT_EQ(*result_slice[i], entries[i].SerializeAsString());
+  }
+}
+
 TEST_F(TruncateTest, HandlesOpenPageDeletion) {
   SetUp(3);
   log->TruncateSuffix(0);